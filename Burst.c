@@ -0,0 +1,218 @@
+/*! @file
+ *  Burst.c
+ *
+ *  @brief Burst capture of one analog channel, far faster than the link can carry
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Burst_module Burst module documentation
+**  @{
+ */
+
+#include "Burst.h"
+#include "Sampler.h"
+#include "Time.h"
+
+static int16_t Buffer[BURST_SIZE];
+
+static TBurstState State = BURST_IDLE;
+static TBurstTrigger Trigger;
+static bool Forced;
+static int32_t Level;
+static uint16_t PreTrigger;
+static uint16_t PostTrigger;
+
+// Where Burst_Poll got up to in the buffer
+static uint16_t Position;
+// Samples taken since arming, up to one more than the pre-trigger
+static uint16_t Filled;
+// The sample before Position, for spotting a crossing
+static int32_t Previous;
+
+// Where the trigger sample is in the buffer, and the samples taken from it on
+static uint16_t TriggerPosition;
+static uint32_t AfterTrigger;
+
+// The oldest sample of the capture in the buffer
+static uint16_t Start;
+
+static TBurstInfo Info;
+
+/*! @brief Gets a sample as a number, in the same two's complement counts as the Sampler reads.
+ *
+ *  @param sample The sample as the ADC gave it.
+ *  @return int32_t - the sample in ADC counts.
+ */
+static int32_t Value(const int16_t sample)
+{
+  return Sampler_Convert(Info.channelNb, sample);
+}
+
+/*! @brief Starts sampling a channel, and waits for the trigger.
+ *
+ *  @param channelNb The Sampler channel.
+ *  @param sampleRate The samples per second.
+ *  @param nbSamples The number of samples to capture.
+ *  @param preTrigger The number of those samples to keep from before the trigger.
+ *  @param trigger What starts the capture.
+ *  @param level The level the channel has to cross, in ADC counts.
+ *  @return bool - TRUE if the capture was armed.
+ *  @note Assumes the Sampler has been initialized.
+ */
+bool Burst_Arm(const uint8_t channelNb, const uint32_t sampleRate, const uint16_t nbSamples, const uint16_t preTrigger,
+	       const TBurstTrigger trigger, const int32_t level)
+{
+  if ((nbSamples == 0) || (nbSamples > BURST_SIZE) || (preTrigger >= nbSamples) || (trigger > BURST_TRIGGER_FALLING))
+    {
+      return 0;
+    }
+
+  Burst_Cancel();
+  Info.channelNb = channelNb;
+  Info.sampleRate = sampleRate;
+  Trigger = trigger;
+  Forced = (trigger == BURST_TRIGGER_NOW);
+  Level = level;
+  PreTrigger = preTrigger;
+  PostTrigger = nbSamples - preTrigger;
+  Position = 0;
+  Filled = 0;
+  AfterTrigger = 0;
+  if (!Sampler_StartBurst(channelNb, sampleRate, Buffer, BURST_SIZE))
+    {
+      return 0;
+    }
+  State = BURST_ARMED;
+  return 1;
+}
+
+/*! @brief Triggers an armed capture now, whatever the channel is doing.
+ *
+ *  @return bool - TRUE if a capture was armed.
+ */
+bool Burst_Trigger(void)
+{
+  if (State != BURST_ARMED)
+    {
+      return 0;
+    }
+  Forced = 1;
+  return 1;
+}
+
+/*! @brief Throws away the capture, and stops sampling if it hasn't already.
+ */
+void Burst_Cancel(void)
+{
+  if ((State == BURST_ARMED) || (State == BURST_TRIGGERED))
+    {
+      Sampler_StopBurst();
+    }
+  State = BURST_IDLE;
+}
+
+/*! @brief Looks for the trigger in the samples taken since the last call, and stops once the capture is complete.
+ *
+ *  @return TBurstState - where the capture is up to.
+ */
+TBurstState Burst_Poll(void)
+{
+  if ((State != BURST_ARMED) && (State != BURST_TRIGGERED))
+    {
+      return State;
+    }
+
+  uint16_t position = Sampler_BurstPosition();
+  uint16_t nbNew = (position + BURST_SIZE - Position) % BURST_SIZE;
+
+  while ((State == BURST_ARMED) && nbNew)
+    {
+      int32_t sample = Value(Buffer[Position]);
+
+      // Only look once there are enough samples before it, and a sample before it to cross from
+      bool crossed = (Filled > 0) && (((Trigger == BURST_TRIGGER_RISING) && (Previous < Level) && (sample >= Level))
+	  || ((Trigger == BURST_TRIGGER_FALLING) && (Previous > Level) && (sample <= Level)));
+      if ((Filled >= PreTrigger) && (Forced || crossed))
+	{
+	  TriggerPosition = Position;
+	  State = BURST_TRIGGERED;
+	  // Date the trigger sample back from the newest one
+	  uint32_t age = (position + BURST_SIZE - Position) % BURST_SIZE;
+	  Info.timestamp = Time_Now() - (((uint64_t) age * Time_TicksPerSecond()) / Info.sampleRate);
+	  break;
+	}
+      if (Filled <= PreTrigger)
+	{
+	  Filled++;
+	}
+      Previous = sample;
+      Position = (Position + 1) % BURST_SIZE;
+      nbNew--;
+    }
+
+  if (State == BURST_TRIGGERED)
+    {
+      AfterTrigger += nbNew;
+      Position = position;
+      if (AfterTrigger < PostTrigger)
+	{
+	  return State;
+	}
+
+      // Sampling ran on a little while the trigger was being found; the capture loses that much pre-trigger
+      AfterTrigger += (Sampler_StopBurst() + BURST_SIZE - Position) % BURST_SIZE;
+      uint32_t preTrigger = PreTrigger;
+      if (AfterTrigger + preTrigger > BURST_SIZE)
+	{
+	  preTrigger = (AfterTrigger < BURST_SIZE) ? (BURST_SIZE - AfterTrigger) : 0;
+	}
+      Info.triggerIndex = preTrigger;
+      Info.nbSamples = (AfterTrigger <= BURST_SIZE) ? (preTrigger + PostTrigger) : 0;
+      Start = (TriggerPosition + BURST_SIZE - preTrigger) % BURST_SIZE;
+      State = BURST_DONE;
+    }
+  return State;
+}
+
+/*! @brief Gets the details of a finished capture.
+ *
+ *  @param info Set to the details.
+ *  @return bool - TRUE if a capture is held.
+ */
+bool Burst_Info(TBurstInfo * const info)
+{
+  if (State != BURST_DONE)
+    {
+      return 0;
+    }
+  *info = Info;
+  return 1;
+}
+
+/*! @brief Copies samples out of a finished capture.
+ *
+ *  @param first The first sample, where 0 is the oldest.
+ *  @param samples Where to put the samples.
+ *  @param nbSamples The number of samples wanted.
+ *  @return uint16_t - the number of samples copied, 0 if no capture is held.
+ */
+uint16_t Burst_Read(const uint16_t first, int16_t * const samples, const uint16_t nbSamples)
+{
+  uint16_t nbRead = 0;
+
+  if (State != BURST_DONE)
+    {
+      return 0;
+    }
+  for (uint32_t i = first; (i < Info.nbSamples) && (nbRead < nbSamples); i++)
+    {
+      samples[nbRead++] = (int16_t) Value(Buffer[(Start + i) % BURST_SIZE]);
+    }
+  return nbRead;
+}
+
+/* END Burst */
+/*!
+** @}
+*/
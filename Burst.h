@@ -0,0 +1,107 @@
+/*! @file
+ *
+ *  @brief Burst capture of one analog channel, far faster than the link can carry.
+ *
+ *  Once armed, the Sampler fills a RAM buffer round and round at up to SAMPLER_BURST_MAX_RATE,
+ *  while Burst_Poll watches the new samples for the trigger. Sampling stops once the samples wanted after the trigger
+ *  are in, leaving the ones before it (the pre-trigger) in the buffer too. The normal scan then carries on,
+ *  and the capture stays in the buffer to be read out at the link's own pace.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef BURST_H
+#define BURST_H
+
+// new types
+#include "types.h"
+
+// Number of samples the buffer holds
+#define BURST_SIZE 16384
+
+/*!
+ * @brief What starts a capture.
+ */
+typedef enum
+{
+  BURST_TRIGGER_NOW,        /*!< As soon as the pre-trigger samples are in. */
+  BURST_TRIGGER_RISING,     /*!< The channel rising through the level. */
+  BURST_TRIGGER_FALLING     /*!< The channel falling through the level. */
+} TBurstTrigger;
+
+/*!
+ * @brief Where a capture is up to.
+ */
+typedef enum
+{
+  BURST_IDLE,       /*!< Not armed. */
+  BURST_ARMED,      /*!< Sampling, and waiting for the trigger. */
+  BURST_TRIGGERED,  /*!< Sampling the rest of the capture. */
+  BURST_DONE        /*!< The capture is in the buffer. */
+} TBurstState;
+
+/*!
+ * @brief A finished capture.
+ */
+typedef struct
+{
+  uint64_t timestamp;       /*!< Time_Now of the trigger sample. */
+  uint32_t sampleRate;      /*!< The samples per second. */
+  uint16_t nbSamples;       /*!< The number of samples captured. */
+  uint16_t triggerIndex;    /*!< The trigger sample. Less than the pre-trigger asked for if the trigger was seen late. */
+  uint8_t channelNb;        /*!< The Sampler channel. */
+  uint8_t reserved[7];      /*!< Padding. */
+} TBurstInfo;
+
+/*! @brief Starts sampling a channel, and waits for the trigger.
+ *
+ *  Replaces any capture armed or held.
+ *  @param channelNb The Sampler channel.
+ *  @param sampleRate The samples per second, up to SAMPLER_BURST_MAX_RATE.
+ *  @param nbSamples The number of samples to capture, up to BURST_SIZE.
+ *    The smaller it is, the longer Burst_Poll can be late with the trigger without losing pre-trigger samples.
+ *  @param preTrigger The number of those samples to keep from before the trigger.
+ *  @param trigger What starts the capture.
+ *  @param level The level the channel has to cross, in the two's complement counts the Sampler reads.
+ *  @return bool - TRUE if the capture was armed.
+ *  @note Assumes the Sampler has been initialized.
+ */
+bool Burst_Arm(const uint8_t channelNb, const uint32_t sampleRate, const uint16_t nbSamples, const uint16_t preTrigger,
+	       const TBurstTrigger trigger, const int32_t level);
+
+/*! @brief Triggers an armed capture now, whatever the channel is doing.
+ *
+ *  @return bool - TRUE if a capture was armed.
+ */
+bool Burst_Trigger(void);
+
+/*! @brief Throws away the capture, and stops sampling if it hasn't already.
+ */
+void Burst_Cancel(void);
+
+/*! @brief Looks for the trigger in the samples taken since the last call, and stops once the capture is complete.
+ *
+ *  Must be called while armed at least once per BURST_SIZE samples.
+ *  @return TBurstState - where the capture is up to.
+ */
+TBurstState Burst_Poll(void);
+
+/*! @brief Gets the details of a finished capture.
+ *
+ *  @param info Set to the details.
+ *  @return bool - TRUE if a capture is held.
+ */
+bool Burst_Info(TBurstInfo* const info);
+
+/*! @brief Copies samples out of a finished capture.
+ *
+ *  The samples are in the two's complement counts the Sampler reads.
+ *  @param first The first sample, where 0 is the oldest.
+ *  @param samples Where to put the samples.
+ *  @param nbSamples The number of samples wanted.
+ *  @return uint16_t - the number of samples copied, 0 if no capture is held.
+ */
+uint16_t Burst_Read(const uint16_t first, int16_t* const samples, const uint16_t nbSamples);
+
+#endif
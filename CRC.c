@@ -0,0 +1,71 @@
+/*! @file
+ *  CRC.c
+ *
+ *  @brief Routines for calculating cyclic redundancy checks
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup CRC_module CRC module documentation
+**  @{
+ */
+
+#include "CRC.h"
+
+// CRC-16/CCITT (polynomial 0x1021) of every 4-bit value, so the CRC is built a nibble at a time
+static const uint16_t NibbleTable[16] =
+{
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+// Reflected CRC-32 (polynomial 0xEDB88320) of every 4-bit value
+static const uint32_t NibbleTable32[16] =
+{
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+/*! @brief Calculates a CRC-16/CCITT over a block of bytes.
+ *
+ *  @param crc The CRC of the preceding data, or CRC_16_INIT for a new calculation.
+ *  @param data A pointer to the bytes to include in the CRC.
+ *  @param length The number of bytes to include in the CRC.
+ *  @return uint16_t - the updated CRC.
+ */
+uint16_t CRC_16(uint16_t crc, const void* const data, const size_t length)
+{
+  const uint8_t *bytes = (const uint8_t *) data;
+
+  for (size_t i = 0; i < length; i++)
+    {
+      crc = (crc << 4) ^ NibbleTable[(crc >> 12) ^ (bytes[i] >> 4)];
+      crc = (crc << 4) ^ NibbleTable[(crc >> 12) ^ (bytes[i] & 0x0F)];
+    }
+  return crc;
+}
+
+/*! @brief Calculates a CRC-32 (IEEE 802.3, reflected) over a block of bytes.
+ *
+ *  @param crc The CRC of the preceding data, or CRC_32_INIT for a new calculation.
+ *  @param data A pointer to the bytes to include in the CRC.
+ *  @param length The number of bytes to include in the CRC.
+ *  @return uint32_t - the updated CRC.
+ */
+uint32_t CRC_32(uint32_t crc, const void* const data, const size_t length)
+{
+  const uint8_t *bytes = (const uint8_t *) data;
+
+  // Reflected, so the low nibble goes first
+  for (size_t i = 0; i < length; i++)
+    {
+      crc = (crc >> 4) ^ NibbleTable32[(crc ^ bytes[i]) & 0x0F];
+      crc = (crc >> 4) ^ NibbleTable32[(crc ^ (bytes[i] >> 4)) & 0x0F];
+    }
+  return crc;
+}
+
+/* END CRC */
+/*!
+** @}
+*/
@@ -0,0 +1,44 @@
+/*! @file
+ *
+ *  @brief Routines for calculating cyclic redundancy checks.
+ *
+ *  This contains the CRC functions used to validate data held in Flash and firmware images.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef CRC_H
+#define CRC_H
+
+// new types
+#include "types.h"
+
+#include <stddef.h>
+
+// Starting value for a new CRC-16 calculation
+#define CRC_16_INIT 0xFFFF
+
+// Starting value for a new CRC-32 calculation
+#define CRC_32_INIT 0xFFFFFFFFLU
+
+/*! @brief Calculates a CRC-16/CCITT over a block of bytes.
+ *
+ *  @param crc The CRC of the preceding data, or CRC_16_INIT for a new calculation.
+ *  @param data A pointer to the bytes to include in the CRC.
+ *  @param length The number of bytes to include in the CRC.
+ *  @return uint16_t - the updated CRC.
+ */
+uint16_t CRC_16(uint16_t crc, const void* const data, const size_t length);
+
+/*! @brief Calculates a CRC-32 (IEEE 802.3, reflected) over a block of bytes.
+ *
+ *  The standard CRC-32 of a message is the bitwise inverse of the final result.
+ *  @param crc The CRC of the preceding data, or CRC_32_INIT for a new calculation.
+ *  @param data A pointer to the bytes to include in the CRC.
+ *  @param length The number of bytes to include in the CRC.
+ *  @return uint32_t - the updated CRC.
+ */
+uint32_t CRC_32(uint32_t crc, const void* const data, const size_t length);
+
+#endif
@@ -0,0 +1,183 @@
+/*! @file
+ *  Config.c
+ *
+ *  @brief Power-fail-safe tower configuration
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Config_module Config module documentation
+**  @{
+ */
+
+#include "Config.h"
+#include "Flash.h"
+#include "CRC.h"
+
+// Number of copies of the configuration
+#define NB_SLOTS FLASH_CONFIG_NB_SECTORS
+
+// Slots from NB_SLOTS up are the copies left in block 0 by a block swap. They are read, never written.
+#define NB_SCANNED_SLOTS (NB_SLOTS * 2)
+
+/*!
+ * @brief One copy of the configuration, programmed as a single phrase.
+ */
+typedef union
+{
+  uint64_t l;
+  struct
+  {
+    uint16_t sequence;      /*!< Incremented on every commit. */
+    uint16_t towerNumber;   /*!< The tower number. */
+    uint16_t towerMode;     /*!< The tower mode. */
+    uint16_t crc;           /*!< CRC-16 of the fields above. */
+  } s;
+} TConfigRecord;
+
+// Settings in use
+static TConfig Current;
+// Slot holding the newest committed copy
+static uint8_t Active;
+// Sequence number of the newest committed copy
+static uint16_t Sequence;
+// Set when the settings differ from the newest committed copy
+static bool Dirty;
+
+/*! @brief Gets the address of one of the configuration slots.
+ *
+ *  @param slot The slot number, NB_SLOTS and up for the mirrored copies.
+ *  @return uint32_t - the address of the start of the slot.
+ */
+static uint32_t SlotAddress(const uint8_t slot)
+{
+  uint32_t address = FLASH_CONFIG_START + ((slot % NB_SLOTS) * FLASH_SECTOR_SIZE);
+  if (slot >= NB_SLOTS)
+    {
+      address -= FLASH_MIRROR_OFFSET;
+    }
+  return address;
+}
+
+/*! @brief Calculates the CRC of a record.
+ *
+ *  @param record The record.
+ *  @return uint16_t - the CRC of everything but the CRC field.
+ */
+static uint16_t RecordCRC(const TConfigRecord * const record)
+{
+  return CRC_16(CRC_16_INIT, &record->l, sizeof(record->l) - sizeof(record->s.crc));
+}
+
+/*! @brief Loads the newest valid configuration.
+ *
+ *  @param defaults The settings to use on a blank or corrupted device.
+ *  @return bool - TRUE if the configuration was loaded.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Config_Init(const TConfig* const defaults)
+{
+  bool found = 0;
+  bool mirrored = 0;
+
+  for (uint8_t slot = 0; slot < NB_SCANNED_SLOTS; slot++)
+    {
+      TConfigRecord record;
+      record.l = _FP(SlotAddress(slot));
+
+      // A slot torn by a power failure fails the CRC. The sequence number wraps, so compare the difference.
+      if ((record.l != UINT64_MAX) && (record.s.crc == RecordCRC(&record))
+	  && (!found || ((int16_t)(record.s.sequence - Sequence) > 0)))
+	{
+	  found = 1;
+	  mirrored = (slot >= NB_SLOTS);
+	  Active = slot % NB_SLOTS;
+	  Sequence = record.s.sequence;
+	  Current.towerNumber.l = record.s.towerNumber;
+	  Current.towerMode.l = record.s.towerMode;
+	}
+    }
+
+  if (!found)
+    {
+      // Make slot 0 the first to be written
+      Active = NB_SLOTS - 1;
+      Sequence = 0;
+      Current = *defaults;
+    }
+  // A copy found in block 0 after a block swap is committed back into the configuration sectors
+  Dirty = !found || mirrored;
+  return 1;
+}
+
+/*! @brief Gets the current settings.
+ *
+ *  @return const TConfig* - the settings, including any changes that haven't been committed yet.
+ */
+const TConfig* Config_Get(void)
+{
+  return &Current;
+}
+
+/*! @brief Changes the settings in RAM.
+ *
+ *  @param config The new settings.
+ *  @return bool - TRUE if the settings were updated.
+ */
+bool Config_Set(const TConfig* const config)
+{
+  if ((config->towerNumber.l != Current.towerNumber.l) || (config->towerMode.l != Current.towerMode.l))
+    {
+      Current = *config;
+      Dirty = 1;
+    }
+  return 1;
+}
+
+/*! @brief Checks whether the settings have changed since the last commit.
+ *
+ *  @return bool - TRUE if Config_Commit has work to do.
+ */
+bool Config_IsDirty(void)
+{
+  return Dirty;
+}
+
+/*! @brief Writes the settings into the older slot.
+ *
+ *  @return bool - TRUE if the commit was queued, or there was nothing to commit.
+ *  @note Assumes Config_Init has been called.
+ */
+bool Config_Commit(void)
+{
+  if (!Dirty)
+    {
+      return 1;
+    }
+
+  TConfigRecord record;
+  uint8_t slot = (Active + 1) % NB_SLOTS;
+
+  // Cleared before the settings are read, so a change made while the commands are queued is committed next time
+  Dirty = 0;
+  record.s.sequence = Sequence + 1;
+  record.s.towerNumber = Current.towerNumber.l;
+  record.s.towerMode = Current.towerMode.l;
+  record.s.crc = RecordCRC(&record);
+
+  // The newest copy is untouched until the other slot has been erased and programmed
+  if (!Flash_EraseSector(SlotAddress(slot)) || !Flash_ProgramPhrase(SlotAddress(slot), record.l))
+    {
+      Dirty = 1;
+      return 0;
+    }
+
+  Active = slot;
+  Sequence = record.s.sequence;
+  return 1;
+}
+
+/* END Config */
+/*!
+** @}
+*/
@@ -0,0 +1,66 @@
+/*! @file
+ *
+ *  @brief Power-fail-safe tower configuration.
+ *
+ *  The configuration is committed as a single phrase holding a sequence number, the settings and a CRC.
+ *  Commits alternate between two sectors, so the previous copy stays intact until the new one has been
+ *  completely programmed. At boot the newest copy with a valid CRC is used.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// new types
+#include "types.h"
+
+/*!
+ * @brief The committed tower settings.
+ */
+typedef struct
+{
+  uint16union_t towerNumber;  /*!< The tower number. */
+  uint16union_t towerMode;    /*!< The tower mode. */
+} TConfig;
+
+/*! @brief Loads the newest valid configuration.
+ *
+ *  Reads one phrase from each slot, and from the copies a block swap leaves in block 0. If neither holds a valid configuration the defaults are used
+ *  and left pending, so they go out on the next Config_Commit.
+ *  @param defaults The settings to use on a blank or corrupted device.
+ *  @return bool - TRUE if the configuration was loaded.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Config_Init(const TConfig* const defaults);
+
+/*! @brief Gets the current settings.
+ *
+ *  @return const TConfig* - the settings, including any changes that haven't been committed yet.
+ */
+const TConfig* Config_Get(void);
+
+/*! @brief Changes the settings in RAM.
+ *
+ *  @param config The new settings.
+ *  @return bool - TRUE if the settings were updated.
+ */
+bool Config_Set(const TConfig* const config);
+
+/*! @brief Checks whether the settings have changed since the last commit.
+ *
+ *  @return bool - TRUE if Config_Commit has work to do.
+ */
+bool Config_IsDirty(void);
+
+/*! @brief Writes the settings into the older slot.
+ *
+ *  Costs one sector erase and one phrase program, the same as a single Flash write.
+ *  Config_Set may be called while this waits for room in the Flash queue. The change is committed next time.
+ *  @return bool - TRUE if the commit was queued, or there was nothing to commit.
+ *  @note Assumes Config_Init has been called.
+ */
+bool Config_Commit(void);
+
+#endif
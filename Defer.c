@@ -0,0 +1,157 @@
+/*! @file
+ *  Defer.c
+ *
+ *  @brief Deferred calls from interrupts to a thread
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Defer_module Defer module documentation
+**  @{
+ */
+
+#include "Defer.h"
+#include "Time.h"
+#include "Event.h"
+#include "PE_Types.h"
+
+/*!
+ * @brief A posted call.
+ */
+typedef struct
+{
+  void (*function)(void*);  /*!< The function to call. */
+  void *arguments;          /*!< The argument to pass to it. */
+  uint64_t posted;          /*!< Time_Now when it was posted. */
+  volatile bool ready;      /*!< Set once the poster has filled in the slot. */
+} TDeferCall;
+
+static TDeferCall Queue[DEFER_QUEUE_SIZE];
+
+// Free-running slot counters. Posters claim slots at the head, Defer_Run runs them from the tail.
+static volatile uint32_t Head;
+static volatile uint32_t Tail;
+
+// Counted by posters
+static volatile uint32_t Overflows;
+// Only touched by the thread running Defer_Run
+static uint32_t Run;
+static uint64_t TotalLatency;
+static uint64_t MaxLatency;
+
+/*! @brief Empties the queue and clears the statistics.
+ *
+ *  @return bool - TRUE if the queue was successfully initialized.
+ */
+bool Defer_Init(void)
+{
+  for (uint8_t i = 0; i < DEFER_QUEUE_SIZE; i++)
+    {
+      Queue[i].ready = 0;
+    }
+  Head = 0;
+  Tail = 0;
+  Defer_ResetStats();
+  return 1;
+}
+
+/*! @brief Queues a call to be run by Defer_Run.
+ *
+ *  @param function The function to call.
+ *  @param arguments The argument to pass to the function.
+ *  @return bool - TRUE if the call was queued.
+ */
+bool Defer_Post(void (*function)(void*), void* arguments)
+{
+  uint32_t head = Head;
+
+  // Claim a slot. A higher priority post that gets in first just makes the exchange fail and retry.
+  do
+    {
+      if (head - Tail >= DEFER_QUEUE_SIZE)
+	{
+	  __atomic_fetch_add(&Overflows, 1, __ATOMIC_RELAXED);
+	  return 0;
+	}
+    }
+  while (!__atomic_compare_exchange_n(&Head, &head, head + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+  TDeferCall *call = &Queue[head % DEFER_QUEUE_SIZE];
+  call->function = function;
+  call->arguments = arguments;
+  call->posted = Time_Now();
+  __atomic_store_n(&call->ready, 1, __ATOMIC_RELEASE);
+  Event_Set(EVENT_DEFER);
+  return 1;
+}
+
+/*! @brief Runs the calls that have been posted.
+ *
+ *  @return uint8_t - the number of calls run.
+ *  @note Only call from one thread.
+ */
+uint8_t Defer_Run(void)
+{
+  uint8_t nbRun = 0;
+  // Calls posted while running these wait for the next run, so a call that reposts itself can't starve the loop
+  uint32_t head = Head;
+
+  while (Tail != head)
+    {
+      TDeferCall *call = &Queue[Tail % DEFER_QUEUE_SIZE];
+
+      // The slot is claimed but its poster was preempted before filling it in. Pick it up next time.
+      if (!__atomic_load_n(&call->ready, __ATOMIC_ACQUIRE))
+	{
+	  break;
+	}
+
+      void (*function)(void*) = call->function;
+      void *arguments = call->arguments;
+      uint64_t latency = Time_Now() - call->posted;
+
+      // Hand the slot back before the call, so the call itself can post
+      call->ready = 0;
+      __atomic_store_n(&Tail, Tail + 1, __ATOMIC_RELEASE);
+
+      Run++;
+      TotalLatency += latency;
+      if (latency > MaxLatency)
+	{
+	  MaxLatency = latency;
+	}
+
+      function(arguments);
+      nbRun++;
+    }
+  return nbRun;
+}
+
+/*! @brief Gets the statistics since the last reset.
+ *
+ *  @param stats Set to the statistics.
+ */
+void Defer_GetStats(TDeferStats * const stats)
+{
+  stats->run = Run;
+  stats->overflows = Overflows;
+  stats->totalLatency = TotalLatency;
+  stats->maxLatency = MaxLatency;
+}
+
+/*! @brief Clears the statistics.
+ *
+ *  @note Only call from one thread.
+ */
+void Defer_ResetStats(void)
+{
+  __atomic_store_n(&Overflows, 0, __ATOMIC_RELAXED);
+  Run = 0;
+  TotalLatency = 0;
+  MaxLatency = 0;
+}
+
+/* END Defer */
+/*!
+** @}
+*/
@@ -0,0 +1,68 @@
+/*! @file
+ *
+ *  @brief Deferred calls from interrupts to a thread.
+ *
+ *  An interrupt posts a function and argument instead of doing slow work itself, and the thread that runs Defer_Run calls it later.
+ *  Posting takes no lock, so any interrupt can post at any priority, even into a post it has preempted.
+ *  Calls run in the order their slots were claimed.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef DEFER_H
+#define DEFER_H
+
+// new types
+#include "types.h"
+
+// Number of calls that can be waiting. Must be a power of 2.
+#define DEFER_QUEUE_SIZE 16
+
+/*!
+ * @brief Statistics of the deferred calls.
+ */
+typedef struct
+{
+  uint32_t run;            /*!< The number of calls run. */
+  uint32_t overflows;      /*!< The number of calls dropped because the queue was full. */
+  uint64_t totalLatency;   /*!< The total time between post and run, in Time_Now ticks. */
+  uint64_t maxLatency;     /*!< The longest time between post and run, in Time_Now ticks. */
+} TDeferStats;
+
+/*! @brief Empties the queue and clears the statistics.
+ *
+ *  @return bool - TRUE if the queue was successfully initialized.
+ *  @note Call before interrupts are enabled.
+ */
+bool Defer_Init(void);
+
+/*! @brief Queues a call to be run by Defer_Run.
+ *
+ *  @param function The function to call.
+ *  @param arguments The argument to pass to the function.
+ *  @return bool - TRUE if the call was queued, FALSE (and counted as an overflow) if the queue is full.
+ *  @note Safe to call from any interrupt.
+ */
+bool Defer_Post(void (*function)(void*), void* arguments);
+
+/*! @brief Runs the calls that have been posted.
+ *
+ *  @return uint8_t - the number of calls run.
+ *  @note Only call from one thread.
+ */
+uint8_t Defer_Run(void);
+
+/*! @brief Gets the statistics since the last reset.
+ *
+ *  @param stats Set to the statistics.
+ */
+void Defer_GetStats(TDeferStats* const stats);
+
+/*! @brief Clears the statistics.
+ *
+ *  @note Only call from one thread.
+ */
+void Defer_ResetStats(void);
+
+#endif
@@ -0,0 +1,163 @@
+/*! @file
+ *  Event.c
+ *
+ *  @brief Event flags that wake the threads
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Event_module Event module documentation
+**  @{
+ */
+
+#include "Event.h"
+#include "Time.h"
+#include "OS.h"
+#include "PE_Types.h"
+#include "CPU.h"
+
+/*!
+ * @brief A thread waiting on a set of flags.
+ */
+typedef struct
+{
+  uint32_t events;        /*!< The EVENT_ flags the thread takes. */
+  OS_ECB *semaphore;      /*!< Signalled when the first of them is set. */
+} TWaiter;
+
+// Flags set by the interrupts and not yet taken
+static volatile uint32_t Pending;
+
+static TWaiter Waiters[EVENT_MAX_WAITERS];
+static volatile uint8_t NbWaiters;
+
+// Time spent asleep since the load was last read
+static uint64_t IdleTicks;
+// When the load was last read
+static uint64_t WindowStart;
+
+/*! @brief Clears the flags and starts counting idle time.
+ *
+ *  @return bool - TRUE if the events were successfully initialized.
+ */
+bool Event_Init(void)
+{
+  Pending = 0;
+  NbWaiters = 0;
+  IdleTicks = 0;
+  WindowStart = Time_Now();
+  return 1;
+}
+
+/*! @brief Sets event flags.
+ *
+ *  @param events The EVENT_ flags to set.
+ */
+void Event_Set(const uint32_t events)
+{
+  uint32_t previous = __atomic_fetch_or(&Pending, events, __ATOMIC_RELEASE);
+
+  // A thread whose flags were already set has been woken, or will find them before it waits again
+  for (uint8_t i = 0; i < NbWaiters; i++)
+    {
+      if ((events & Waiters[i].events) && !(previous & Waiters[i].events))
+	{
+	  (void) OS_SemaphoreSignal(Waiters[i].semaphore);
+	}
+    }
+}
+
+/*! @brief Finds the waiter for a set of flags, adding it on the first wait.
+ *
+ *  @param events The EVENT_ flags.
+ *  @return TWaiter* - the waiter, or NULL if there are already EVENT_MAX_WAITERS.
+ */
+static TWaiter *FindWaiter(const uint32_t events)
+{
+  TWaiter *waiter = NULL;
+
+  for (uint8_t i = 0; i < NbWaiters; i++)
+    {
+      if (Waiters[i].events == events)
+	{
+	  return &Waiters[i];
+	}
+    }
+
+  EnterCritical();
+  if (NbWaiters < EVENT_MAX_WAITERS)
+    {
+      waiter = &Waiters[NbWaiters];
+      waiter->events = events;
+      waiter->semaphore = OS_SemaphoreCreate(0);
+      if (waiter->semaphore)
+	{
+	  // Only seen by Event_Set once it is complete
+	  NbWaiters++;
+	}
+      else
+	{
+	  waiter = NULL;
+	}
+    }
+  ExitCritical();
+  return waiter;
+}
+
+/*! @brief Takes the pending flags among a set, blocking the calling thread until there are some.
+ *
+ *  @param events The EVENT_ flags to wait on.
+ *  @return uint32_t - the flags among events set since the last call.
+ */
+uint32_t Event_Wait(const uint32_t events)
+{
+  TWaiter *waiter = FindWaiter(events);
+  uint32_t taken;
+
+  if (!waiter)
+    {
+      return 0;
+    }
+
+  // The semaphore may hold a signal for flags already taken, so check again after every wake-up
+  while ((taken = (__atomic_fetch_and(&Pending, ~events, __ATOMIC_ACQUIRE) & events)) == 0)
+    {
+      (void) OS_SemaphoreWait(waiter->semaphore, 0);
+    }
+  return taken;
+}
+
+/*! @brief Sleeps until the next interrupt, counting the time asleep.
+ *
+ *  @note Called from the idle thread with interrupts masked, so an interrupt that has already come in still ends the WFI.
+ */
+void OS_IdleHook(void)
+{
+  uint64_t asleep = Time_Now();
+  __asm volatile ("wfi");
+  IdleTicks += Time_Now() - asleep;
+}
+
+/*! @brief Gets the CPU load since the last call.
+ *
+ *  @return uint16_t - the fraction of the time the idle thread was not asleep, in tenths of a percent.
+ */
+uint16_t Event_Load(void)
+{
+  uint64_t now = Time_Now();
+  uint64_t window = now - WindowStart;
+  uint64_t idle = IdleTicks;
+
+  WindowStart = now;
+  IdleTicks = 0;
+  if ((window == 0) || (idle >= window))
+    {
+      return 0;
+    }
+  return (uint16_t) (1000 - ((idle * 1000) / window));
+}
+
+/* END Event */
+/*!
+** @}
+*/
@@ -0,0 +1,64 @@
+/*! @file
+ *
+ *  @brief Event flags that wake the threads.
+ *
+ *  Interrupts set a flag for each kind of work they hand to a thread. Each thread waits on its own flags, blocked
+ *  on a semaphore which is only signalled by the first of them to be set, and takes all of them at once.
+ *  While no thread has work the idle thread sleeps in WFI, counting the time it spends asleep.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef EVENT_H
+#define EVENT_H
+
+// new types
+#include "types.h"
+
+// Bytes have been received
+#define EVENT_PACKET  0x01
+// The transmit FIFO has emptied
+#define EVENT_UART_TX 0x02
+// A Flash command has completed
+#define EVENT_FLASH   0x04
+// Input captures are waiting
+#define EVENT_CAPTURE 0x08
+// Deferred calls are waiting
+#define EVENT_DEFER   0x10
+// Pending Flash writes are due to be committed
+#define EVENT_COMMIT  0x20
+
+// Number of different sets of flags that threads can wait on
+#define EVENT_MAX_WAITERS 4
+
+/*! @brief Clears the flags and starts counting idle time.
+ *
+ *  @return bool - TRUE if the events were successfully initialized.
+ *  @note Assumes Time and the OS have been initialized.
+ */
+bool Event_Init(void);
+
+/*! @brief Sets event flags.
+ *
+ *  @param events The EVENT_ flags to set.
+ *  @note Safe to call from any interrupt.
+ */
+void Event_Set(const uint32_t events);
+
+/*! @brief Takes the pending flags among a set, blocking the calling thread until there are some.
+ *
+ *  @param events The EVENT_ flags to wait on. Threads must wait on different flags.
+ *  @return uint32_t - the flags among events set since the last call, or 0 if EVENT_MAX_WAITERS sets are already waited on.
+ *  @note Only call from a thread.
+ */
+uint32_t Event_Wait(const uint32_t events);
+
+/*! @brief Gets the CPU load since the last call.
+ *
+ *  @return uint16_t - the fraction of the time the idle thread was not asleep, in tenths of a percent.
+ *  @note Only call from one thread.
+ */
+uint16_t Event_Load(void);
+
+#endif
@@ -75,6 +75,16 @@ bool FIFO_Get(TFIFO * const fifo, uint8_t * const dataPtr)
   return 1;
 }
 
+/* gets the number of free bytes in the FIFO
+ * assumes FIFO_Init has been called
+ * input: struct TFIFO pointer, FIFO - location of the FIFO to check
+ * output: integer - the number of bytes that can be stored before the FIFO is full
+ */
+uint16_t FIFO_Space(const TFIFO * const fifo)
+{
+  return FIFO_SIZE - fifo->NbBytes;  // a single read, so no critical section is needed
+}
+
 /* END FIFO */
 /*!
 ** @}
@@ -53,4 +53,12 @@ bool FIFO_Put(TFIFO * const fifo, const uint8_t data);
  */
 bool FIFO_Get(TFIFO * const fifo, uint8_t * const dataPtr);
 
+/*! @brief Gets the number of free bytes in the FIFO.
+ *
+ *  @param fifo A pointer to a FIFO struct.
+ *  @return uint16_t - the number of bytes that can be put before the FIFO is full.
+ *  @note Assumes that FIFO_Init has been called.
+ */
+uint16_t FIFO_Space(const TFIFO * const fifo);
+
 #endif
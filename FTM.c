@@ -12,6 +12,8 @@
  *  @{
 */
 #include "FTM.h"
+#include "Event.h"
+#include "Profile.h"
 #include <MK70F12.h>
 #include <strings.h>
 
@@ -19,6 +21,26 @@
 
 static TFTMChannel const* TimerCache[PIT_CHANNEL_COUNT] = {0};
 
+// PTA pin of each FTM0 channel on ALT3
+static const uint8_t CapturePin[PIT_CHANNEL_COUNT] = {3, 4, 5, 6, 7, 0, 1, 2};
+
+/*!
+ * @brief Captures of one channel, pushed by FTM0_ISR and taken by FTM_CaptureGet.
+ */
+typedef struct
+{
+  volatile uint32_t timestamp[FTM_CAPTURE_RING_SIZE];  /*!< The captured edges. */
+  volatile bool rising[FTM_CAPTURE_RING_SIZE];         /*!< TRUE for each rising edge, FALSE for each falling one. */
+  volatile uint16_t head;     /*!< Free-running count of captures pushed, only written by the ISR. */
+  volatile uint16_t tail;     /*!< Free-running count of captures taken, only written by the reader. */
+  volatile uint16_t dropped;  /*!< Captures lost because the ring was full. */
+} TCaptureRing;
+
+static TCaptureRing CaptureRing[PIT_CHANNEL_COUNT];
+
+// Counter overflows, the upper half of the capture timestamps
+static volatile uint16_t Overflows;
+
 /*! @brief Sets up the FTM before first use.
  *
  *  Enables the FTM as a free running 16-bit counter.
@@ -40,6 +62,7 @@ bool FTM_Init()
   NVICICPR1 = (1 << 30); // 62mod32 = 30
   // Enable interrupts from the FTM
   NVICISER1 = (1 << 30);
+  return 1;
 }
 
 
@@ -65,10 +88,42 @@ bool FTM_Set(const TFTMChannel* const aFTMChannel)
       return 0;
     }
 
-  // making sure it only supports simple output compare
-  if (aFTMChannel->timerFunction != TIMER_FUNCTION_OUTPUT_COMPARE)
+  if (aFTMChannel->timerFunction == TIMER_FUNCTION_INPUT_CAPTURE)
     {
-      return 0;
+      uint8_t channelNb = aFTMChannel->channelNb;
+      uint32_t edges;
+
+      switch (aFTMChannel->ioType.inputDetection)
+	{
+	  case TIMER_INPUT_RISING:
+	    edges = FTM_CnSC_ELSA_MASK;
+	    break;
+	  case TIMER_INPUT_FALLING:
+	    edges = FTM_CnSC_ELSB_MASK;
+	    break;
+	  case TIMER_INPUT_ANY:
+	    edges = FTM_CnSC_ELSA_MASK | FTM_CnSC_ELSB_MASK;
+	    break;
+	  default:
+	    // Capture off: release the channel
+	    FTM0_CnSC(channelNb) = 0;
+	    TimerCache[channelNb] = 0;
+	    return 1;
+	}
+
+      CaptureRing[channelNb].head = 0;
+      CaptureRing[channelNb].tail = 0;
+      CaptureRing[channelNb].dropped = 0;
+      TimerCache[channelNb] = aFTMChannel;
+
+      // Route the pin to the FTM
+      SIM_SCGC5 |= SIM_SCGC5_PORTA_MASK;
+      PORTA_PCR(CapturePin[channelNb]) = PORT_PCR_MUX(3);
+
+      // Count overflows so the timestamps don't wrap every 2.7 s
+      FTM0_SC |= FTM_SC_TOIE_MASK;
+      FTM0_CnSC(channelNb) = edges | FTM_CnSC_CHIE_MASK;
+      return 1;
     }
 
   // If there is no user function;
@@ -78,7 +133,7 @@ bool FTM_Set(const TFTMChannel* const aFTMChannel)
     }
 
   TimerCache[aFTMChannel->channelNb] = aFTMChannel;
-
+  return 1;
 }
 
 /*! @brief Starts a timer if set up for output compare.
@@ -95,10 +150,226 @@ bool FTM_StartTimer(const TFTMChannel* const aFTMChannel)
     }
   FTM0_CnSC(aFTMChannel->channelNb) = (FTM_CnSC_MSA_MASK | FTM_CnSC_CHIE_MASK);
   FTM0_CnV(aFTMChannel->channelNb) = FTM0_CNT + aFTMChannel->delayCount;
+  return 1;
+}
 
+/*! @brief Re-arms a timer relative to its last compare point rather than to now.
+ *
+ *  @param aFTMChannel is a structure containing the parameters to be used in setting up the timer channel.
+ *  @param delayCount is the number of module clock periods from the last compare point to the next.
+ *  @return bool - TRUE if the next compare point is still ahead of the counter, FALSE if it has already been missed.
+ *  @note Assumes the timer has been started.
+ */
+bool FTM_Advance(const TFTMChannel* const aFTMChannel, const uint16_t delayCount)
+{
+  uint8_t channelNb = aFTMChannel->channelNb;
+  uint16_t compare = FTM0_CnV(channelNb) + delayCount;
+
+  FTM0_CnV(channelNb) = compare;
+  FTM0_CnSC(channelNb) = (FTM_CnSC_MSA_MASK | FTM_CnSC_CHIE_MASK);
+
+  // The counter is free running, so the sign of the 16-bit difference says which side of it the compare point is
+  return ((int16_t) (compare - (uint16_t) FTM0_CNT) > 0);
 }
 
 
+/*! @brief Takes the oldest capture from an input capture channel.
+ *
+ *  @param channelNb The channel number.
+ *  @param timestamp Set to the time of the edge.
+ *  @param rising Set to TRUE for a rising edge, FALSE for a falling one. May be NULL.
+ *  @return bool - TRUE if there was a capture.
+ */
+bool FTM_CaptureGet(const uint8_t channelNb, uint32_t* const timestamp, bool* const rising)
+{
+  if (channelNb >= PIT_CHANNEL_COUNT)
+    {
+      return 0;
+    }
+
+  TCaptureRing *ring = &CaptureRing[channelNb];
+  uint16_t tail = ring->tail;
+  if (tail == ring->head)
+    {
+      return 0;
+    }
+  *timestamp = ring->timestamp[tail % FTM_CAPTURE_RING_SIZE];
+  if (rising)
+    {
+      *rising = ring->rising[tail % FTM_CAPTURE_RING_SIZE];
+    }
+  ring->tail = tail + 1;  // hands the slot back to the ISR
+  return 1;
+}
+
+/*! @brief Gets the direction of the oldest capture waiting on an input capture channel, without taking it.
+ *
+ *  @param channelNb The channel number.
+ *  @return bool - TRUE if the oldest capture is a rising edge, FALSE if it is a falling edge or there is none.
+ */
+bool FTM_CaptureRising(const uint8_t channelNb)
+{
+  if (FTM_CaptureCount(channelNb) == 0)
+    {
+      return 0;
+    }
+  return CaptureRing[channelNb].rising[CaptureRing[channelNb].tail % FTM_CAPTURE_RING_SIZE];
+}
+
+/*! @brief Gets the number of captures waiting on an input capture channel.
+ *
+ *  @param channelNb The channel number.
+ *  @return uint16_t - the number of captures FTM_CaptureGet can take.
+ */
+uint16_t FTM_CaptureCount(const uint8_t channelNb)
+{
+  if (channelNb >= PIT_CHANNEL_COUNT)
+    {
+      return 0;
+    }
+  return (uint16_t) (CaptureRing[channelNb].head - CaptureRing[channelNb].tail);
+}
+
+/*! @brief Gets the number of captures lost because the ring was full.
+ *
+ *  @param channelNb The channel number.
+ *  @return uint16_t - the number of captures dropped since the channel was set up.
+ */
+uint16_t FTM_CaptureDropped(const uint8_t channelNb)
+{
+  if (channelNb >= PIT_CHANNEL_COUNT)
+    {
+      return 0;
+    }
+  return CaptureRing[channelNb].dropped;
+}
+
+/*! @brief Takes a batch of captures from a channel.
+ *
+ *  @param channelNb The channel number.
+ *  @param nbEdges The number of edges in the batch, at least 2.
+ *  @param span Set to the time from the first edge of the batch to the last.
+ *  @return bool - TRUE if there were enough captures for a batch.
+ */
+static bool CaptureBatch(const uint8_t channelNb, const uint8_t nbEdges, uint32_t * const span)
+{
+  uint32_t first, last;
+
+  if ((nbEdges < 2) || (nbEdges > FTM_CAPTURE_RING_SIZE) || (FTM_CaptureCount(channelNb) < nbEdges))
+    {
+      return 0;
+    }
+
+  FTM_CaptureGet(channelNb, &first, 0);
+  for (uint8_t i = 2; i < nbEdges; i++)
+    {
+      FTM_CaptureGet(channelNb, &last, 0);
+    }
+  // The last edge stays in the ring as the first of the next batch, so no interval is lost
+  last = CaptureRing[channelNb].timestamp[CaptureRing[channelNb].tail % FTM_CAPTURE_RING_SIZE];
+
+  *span = last - first;
+  return 1;
+}
+
+/*! @brief Measures the average time between edges over a batch of captures.
+ *
+ *  @param channelNb The channel number.
+ *  @param nbEdges The number of edges in the batch, at least 2.
+ *  @param period Set to the average time between edges, in fixed frequency clock counts.
+ *  @return bool - TRUE if there were enough captures for a batch.
+ */
+bool FTM_CapturePeriod(const uint8_t channelNb, const uint8_t nbEdges, uint32_t* const period)
+{
+  uint32_t span;
+
+  if (!CaptureBatch(channelNb, nbEdges, &span))
+    {
+      return 0;
+    }
+  *period = span / (nbEdges - 1);
+  return 1;
+}
+
+/*! @brief Measures the edge frequency over a batch of captures.
+ *
+ *  @param channelNb The channel number.
+ *  @param nbEdges The number of edges in the batch, at least 2.
+ *  @param milliHz Set to the average edge frequency, in mHz.
+ *  @return bool - TRUE if there were enough captures for a batch.
+ */
+bool FTM_CaptureFrequency(const uint8_t channelNb, const uint8_t nbEdges, uint32_t* const milliHz)
+{
+  uint32_t span;
+
+  if (!CaptureBatch(channelNb, nbEdges, &span) || (span == 0))
+    {
+      return 0;
+    }
+  // Divide the whole span rather than the rounded period, for the full resolution of the batch
+  *milliHz = (uint32_t) (((uint64_t) FTM_CLOCK_HZ * 1000 * (nbEdges - 1)) / span);
+  return 1;
+}
+
+/*! @brief Measures the duty cycle over a batch of whole cycles, by pairing rising and falling edges.
+ *
+ *  @param channelNb The channel number, set up with TIMER_INPUT_ANY.
+ *  @param nbCycles The number of cycles in the batch, at least 1 and less than half of FTM_CAPTURE_RING_SIZE.
+ *  @param perMille Set to the time the input was high, in thousandths of the batch.
+ *  @return bool - TRUE if there were enough alternating captures for a batch.
+ */
+bool FTM_CaptureDuty(const uint8_t channelNb, const uint8_t nbCycles, uint16_t* const perMille)
+{
+  uint16_t nbEdges = 2 * nbCycles + 1;
+
+  if ((channelNb >= PIT_CHANNEL_COUNT) || !TimerCache[channelNb] || (TimerCache[channelNb]->timerFunction != TIMER_FUNCTION_INPUT_CAPTURE)
+      || (TimerCache[channelNb]->ioType.inputDetection != TIMER_INPUT_ANY) || (nbCycles == 0) || (nbEdges > FTM_CAPTURE_RING_SIZE))
+    {
+      return 0;
+    }
+
+  TCaptureRing *ring = &CaptureRing[channelNb];
+
+  // A cycle starts on a rising edge
+  while ((FTM_CaptureCount(channelNb) > 0) && !FTM_CaptureRising(channelNb))
+    {
+      ring->tail++;
+    }
+  if (FTM_CaptureCount(channelNb) < nbEdges)
+    {
+      return 0;
+    }
+
+  uint16_t tail = ring->tail;
+  uint32_t high = 0;
+  for (uint16_t i = 1; i < nbEdges; i++)
+    {
+      uint8_t previous = (tail + i - 1) % FTM_CAPTURE_RING_SIZE;
+      uint8_t slot = (tail + i) % FTM_CAPTURE_RING_SIZE;
+
+      // Two edges the same way round means one in between was missed, so the pairing is lost up to here
+      if (ring->rising[slot] == ring->rising[previous])
+	{
+	  ring->tail = tail + i;
+	  return 0;
+	}
+      if (!ring->rising[slot])
+	{
+	  high += ring->timestamp[slot] - ring->timestamp[previous];
+	}
+    }
+
+  uint32_t span = ring->timestamp[(tail + nbEdges - 1) % FTM_CAPTURE_RING_SIZE] - ring->timestamp[tail % FTM_CAPTURE_RING_SIZE];
+  // The last rising edge stays in the ring as the first of the next batch
+  ring->tail = tail + nbEdges - 1;
+  if (span == 0)
+    {
+      return 0;
+    }
+  *perMille = (uint16_t) (((uint64_t) high * 1000) / span);
+  return 1;
+}
+
 /*! @brief Interrupt service routine for the FTM.
  *
  *  If a timer channel was set up as output compare, then the user callback function will be called.
@@ -106,15 +377,80 @@ bool FTM_StartTimer(const TFTMChannel* const aFTMChannel)
  */
 void __attribute__ ((interrupt)) FTM0_ISR(void)
     {
-      uint32_t status = FTM0_STATUS;
-      for (size_t i = 0; i < PIT_CHANNEL_COUNT; i++)
+      PROFILE_ENTER(PROFILE_FTM);
+      uint32_t status = FTM0_STATUS & ((1 << PIT_CHANNEL_COUNT) - 1);
+      uint16_t captured[PIT_CHANNEL_COUNT];
+      bool overflowed = 0;
+
+      // Latch the captures before looking at the overflow flag, so an overflow in between is seen below
+      for (uint32_t pending = status; pending; pending &= pending - 1)
+	{
+	  captured[__builtin_ctz(pending)] = FTM0_CnV(__builtin_ctz(pending));
+	}
+      if (status)
+	{
+	  // A channel's value is the count at its edge or compare point, which is when it triggered
+	  PROFILE_LATENCY(PROFILE_FTM, (uint16_t) (FTM0_CNT - captured[__builtin_ctz(status)]), FTM_CLOCK_HZ);
+	}
+      if (FTM0_SC & FTM_SC_TOF_MASK)
+	{
+	  FTM0_SC &= ~FTM_SC_TOF_MASK;
+	  Overflows++;
+	  overflowed = 1;
+	}
+
+      // Only visit the channels that fired
+      while (status)
 	{
-	  if (TimerCache[i] && (status & (1 << i)))
-	      {
-	        FTM0_CnSC(i) &= ~FTM_CnSC_CHF_MASK;
-	        (TimerCache[i]->callbackFunction)(TimerCache[i]->callbackArguments);
-	      }
+	  uint8_t i = __builtin_ctz(status);
+	  status &= status - 1;
+
+	  if (TimerCache[i] && (TimerCache[i]->timerFunction == TIMER_FUNCTION_INPUT_CAPTURE))
+	    {
+	      TCaptureRing *ring = &CaptureRing[i];
+	      FTM0_CnSC(i) &= ~FTM_CnSC_CHF_MASK;
+
+	      // A capture from the top half of the count was taken before the overflow just counted
+	      uint16_t upper = Overflows - (overflowed && (captured[i] & 0x8000));
+	      if ((uint16_t) (ring->head - ring->tail) < FTM_CAPTURE_RING_SIZE)
+		{
+		  ring->timestamp[ring->head % FTM_CAPTURE_RING_SIZE] = ((uint32_t) upper << 16) | captured[i];
+		  switch (TimerCache[i]->ioType.inputDetection)
+		    {
+		      case TIMER_INPUT_RISING:
+			ring->rising[ring->head % FTM_CAPTURE_RING_SIZE] = 1;
+			break;
+		      case TIMER_INPUT_FALLING:
+			ring->rising[ring->head % FTM_CAPTURE_RING_SIZE] = 0;
+			break;
+		      default:
+			// The pin reads through the FTM mux, and has settled on the level after the edge
+			ring->rising[ring->head % FTM_CAPTURE_RING_SIZE] = ((GPIOA_PDIR & (1 << CapturePin[i])) != 0);
+			break;
+		    }
+		  ring->head++;  // publishes the capture to the reader
+		  Event_Set(EVENT_CAPTURE);
+		}
+	      else
+		{
+		  ring->dropped++;
+		}
+	      if (!TimerCache[i]->callbackFunction)
+		{
+		  continue;
+		}
+	    }
+	  else
+	    {
+	      // One-shot: the callback re-arms the channel if it wants another event
+	      FTM0_CnSC(i) &= ~(FTM_CnSC_CHF_MASK | FTM_CnSC_CHIE_MASK);
+	    }
+	  if (TimerCache[i])
+	    {
+	      (TimerCache[i]->callbackFunction)(TimerCache[i]->callbackArguments);
+	    }
 	}
+      PROFILE_EXIT(PROFILE_FTM);
     }
 
 /*  END FTM Module */
@@ -55,6 +55,16 @@ typedef struct
  */
 #define FIXED_FREQ_CLK 2
 
+/*
+ *  frequency of the fixed frequency clock, in Hz
+ */
+#define FTM_CLOCK_HZ 24414
+
+/*
+ *  number of captures each input capture channel can buffer, a power of 2
+ */
+#define FTM_CAPTURE_RING_SIZE 32
+
 /*! @brief Sets up the FTM before first use.
  *
  *  Enables the FTM as a free running 16-bit counter.
@@ -64,6 +74,9 @@ bool FTM_Init();
 
 /*! @brief Sets up a timer channel.
  *
+ *  An input capture channel takes its pin (PTA0-PTA7, FTM0_CH0-CH7 on ALT3) and timestamps every selected edge
+ *  into a ring read with FTM_CaptureGet. Note that PTA0-PTA3 are also the JTAG pins.
+ *  An input capture with TIMER_INPUT_OFF releases the channel.
  *  @param aFTMChannel is a structure containing the parameters to be used in setting up the timer channel.
  *    channelNb is the channel number of the FTM to use.
  *    delayCount is the delay count (in module clock periods) for an output compare event.
@@ -71,7 +84,7 @@ bool FTM_Init();
  *    ioType is a union that depends on the setting of the channel as input capture or output compare:
  *      outputAction is the action to take on a successful output compare.
  *      inputDetection is the type of input capture detection.
- *    callbackFunction is a pointer to a user callback function.
+ *    callbackFunction is a pointer to a user callback function. It may be NULL for an input capture.
  *    callbackArguments is a pointer to the user arguments to use with the user callback function.
  *  @return bool - TRUE if the timer was set up successfully.
  *  @note Assumes the FTM has been initialized.
@@ -81,16 +94,93 @@ bool FTM_Set(const TFTMChannel* const aFTMChannel);
 
 /*! @brief Starts a timer if set up for output compare.
  *
+ *  The timer is one-shot: the callback is called once, delayCount counts from now.
  *  @param aFTMChannel is a structure containing the parameters to be used in setting up the timer channel.
  *  @return bool - TRUE if the timer was started successfully.
  *  @note Assumes the FTM has been initialized.
  */
 bool FTM_StartTimer(const TFTMChannel* const aFTMChannel);
 
+/*! @brief Re-arms a timer relative to its last compare point rather than to now.
+ *
+ *  Called from the callback, this gives a periodic timer that doesn't drift with interrupt latency.
+ *  @param aFTMChannel is a structure containing the parameters to be used in setting up the timer channel.
+ *  @param delayCount is the number of module clock periods from the last compare point to the next.
+ *  @return bool - TRUE if the next compare point is still ahead of the counter, FALSE if it has already been missed.
+ *  @note Assumes the timer has been started.
+ */
+bool FTM_Advance(const TFTMChannel* const aFTMChannel, const uint16_t delayCount);
+
+
+/*! @brief Takes the oldest capture from an input capture channel.
+ *
+ *  Timestamps are 32-bit counts of the fixed frequency clock: the capture value extended with the count of counter overflows.
+ *  With TIMER_INPUT_ANY, the direction of each edge is the level of the pin when the capture is serviced,
+ *  so pulses must be longer than the interrupt latency.
+ *  @param channelNb The channel number.
+ *  @param timestamp Set to the time of the edge.
+ *  @param rising Set to TRUE for a rising edge, FALSE for a falling one. May be NULL.
+ *  @return bool - TRUE if there was a capture.
+ *  @note Lock-free. Call from one context only.
+ */
+bool FTM_CaptureGet(const uint8_t channelNb, uint32_t* const timestamp, bool* const rising);
+
+/*! @brief Gets the direction of the oldest capture waiting on an input capture channel, without taking it.
+ *
+ *  @param channelNb The channel number.
+ *  @return bool - TRUE if the oldest capture is a rising edge, FALSE if it is a falling edge or there is none.
+ */
+bool FTM_CaptureRising(const uint8_t channelNb);
+
+/*! @brief Gets the number of captures waiting on an input capture channel.
+ *
+ *  @param channelNb The channel number.
+ *  @return uint16_t - the number of captures FTM_CaptureGet can take.
+ */
+uint16_t FTM_CaptureCount(const uint8_t channelNb);
+
+/*! @brief Gets the number of captures lost because the ring was full.
+ *
+ *  @param channelNb The channel number.
+ *  @return uint16_t - the number of captures dropped since the channel was set up.
+ */
+uint16_t FTM_CaptureDropped(const uint8_t channelNb);
+
+/*! @brief Measures the average time between edges over a batch of captures.
+ *
+ *  Takes nbEdges - 1 captures from the ring and leaves the last one to start the next batch, so no interval is lost between batches.
+ *  With TIMER_INPUT_ANY, consecutive edges are half a cycle apart.
+ *  @param channelNb The channel number.
+ *  @param nbEdges The number of edges in the batch, at least 2.
+ *  @param period Set to the average time between edges, in fixed frequency clock counts.
+ *  @return bool - TRUE if there were enough captures for a batch.
+ */
+bool FTM_CapturePeriod(const uint8_t channelNb, const uint8_t nbEdges, uint32_t* const period);
+
+/*! @brief Measures the edge frequency over a batch of captures.
+ *
+ *  @param channelNb The channel number.
+ *  @param nbEdges The number of edges in the batch, at least 2.
+ *  @param milliHz Set to the average edge frequency, in mHz.
+ *  @return bool - TRUE if there were enough captures for a batch.
+ */
+bool FTM_CaptureFrequency(const uint8_t channelNb, const uint8_t nbEdges, uint32_t* const milliHz);
+
+/*! @brief Measures the duty cycle over a batch of whole cycles, by pairing rising and falling edges.
+ *
+ *  A cycle runs from a rising edge to the next one. Falling edges ahead of the first rising edge are discarded,
+ *  and the last rising edge stays in the ring to start the next batch. If an edge was missed, the captures
+ *  up to the gap are discarded and no batch is measured.
+ *  @param channelNb The channel number, set up with TIMER_INPUT_ANY.
+ *  @param nbCycles The number of cycles in the batch, at least 1 and less than half of FTM_CAPTURE_RING_SIZE.
+ *  @param perMille Set to the time the input was high, in thousandths of the batch.
+ *  @return bool - TRUE if there were enough alternating captures for a batch.
+ */
+bool FTM_CaptureDuty(const uint8_t channelNb, const uint8_t nbCycles, uint16_t* const perMille);
 
 /*! @brief Interrupt service routine for the FTM.
  *
- *  If a timer channel was set up as output compare, then the user callback function will be called.
+ *  The user callback function of every channel whose compare point has been reached is called.
  *  @note Assumes the FTM has been initialized.
  */
 void __attribute__ ((interrupt)) FTM0_ISR(void);
@@ -0,0 +1,198 @@
+/*! @file
+ *  Filter.c
+ *
+ *  @brief Decimating filters for the sampled analog channels
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Filter_module Filter module documentation
+**  @{
+ */
+
+#include "Filter.h"
+#include "Sampler.h"
+#include "PE_Types.h"
+
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#endif
+
+// Samples taken from the Sampler at a time
+#define CHUNK_SIZE 32
+
+/*!
+ * @brief The state of one channel's filter.
+ */
+typedef struct
+{
+  uint32_t cursor;        /*!< The Sampler count of the next sample to filter. */
+  int32_t sum;            /*!< The sum of the samples in the current block. */
+  uint8_t count;          /*!< The number of samples in the current block. */
+  uint8_t decimation;     /*!< The number of samples in a block. */
+  uint8_t nbTaps;         /*!< The number of FIR taps, rounded up to even, or 0 for no FIR. */
+  uint8_t newest;         /*!< Where the newest block average is in the history. */
+  int16_t taps[FILTER_MAX_TAPS] __attribute__((aligned(4)));  /*!< The Q15 coefficients, newest first. */
+  int16_t history[2 * FILTER_MAX_TAPS];  /*!< Block averages, newest first from newest, stored twice so the window never wraps. */
+} TFilter;
+
+static TFilter Filters[SAMPLER_NB_CHANNELS];
+
+/*! @brief Multiplies and accumulates two vectors of Q15 values.
+ *
+ *  @param taps The coefficients.
+ *  @param x The samples.
+ *  @param nbTaps The length of the vectors, which must be even.
+ *  @return int64_t - the exact sum of the products, in Q30.
+ */
+static int64_t Dot(const int16_t * const taps, const int16_t * const x, const uint8_t nbTaps)
+{
+  int64_t sum = 0;
+
+#if defined(__ARM_FEATURE_DSP)
+  // Two products per instruction. The history isn't always word aligned, which LDR allows on the M4.
+  for (uint8_t i = 0; i < nbTaps; i += 2)
+    {
+      int32_t t, s;
+      memcpy(&t, &taps[i], sizeof(t));
+      memcpy(&s, &x[i], sizeof(s));
+      sum = __smlald(t, s, sum);
+    }
+#else
+  for (uint8_t i = 0; i < nbTaps; i++)
+    {
+      sum += (int32_t) taps[i] * x[i];
+    }
+#endif
+
+  return sum;
+}
+
+/*! @brief Runs a block average through the FIR.
+ *
+ *  @param filter The filter.
+ *  @param average The block average.
+ *  @return int16_t - the filter output.
+ */
+static int16_t FIR(TFilter * const filter, const int16_t average)
+{
+  if (filter->nbTaps == 0)
+    {
+      return average;
+    }
+
+  filter->newest = (filter->newest + FILTER_MAX_TAPS - 1) % FILTER_MAX_TAPS;
+  filter->history[filter->newest] = average;
+  filter->history[filter->newest + FILTER_MAX_TAPS] = average;
+
+  // Round Q30 back to Q15 and saturate
+  int64_t y = (Dot(filter->taps, &filter->history[filter->newest], filter->nbTaps) + (1 << 14)) >> 15;
+  if (y > INT16_MAX)
+    {
+      return INT16_MAX;
+    }
+  if (y < INT16_MIN)
+    {
+      return INT16_MIN;
+    }
+  return (int16_t) y;
+}
+
+/*! @brief Sets every channel to a plain boxcar decimator and starts them at the newest sample.
+ *
+ *  @param decimation The number of samples averaged into each output.
+ *  @return bool - TRUE if the filters were successfully initialized.
+ */
+bool Filter_Init(const uint8_t decimation)
+{
+  for (uint8_t channelNb = 0; channelNb < SAMPLER_NB_CHANNELS; channelNb++)
+    {
+      if (!Filter_Set(channelNb, decimation, NULL, 0))
+	{
+	  return 0;
+	}
+    }
+  return 1;
+}
+
+/*! @brief Configures the filter of a channel, discarding its state.
+ *
+ *  @param channelNb The Sampler channel.
+ *  @param decimation The number of samples averaged into each output.
+ *  @param taps The Q15 FIR coefficients, or NULL for no FIR.
+ *  @param nbTaps The number of coefficients.
+ *  @return bool - TRUE if the filter was configured.
+ */
+bool Filter_Set(const uint8_t channelNb, const uint8_t decimation, const int16_t * const taps, const uint8_t nbTaps)
+{
+  if ((channelNb >= SAMPLER_NB_CHANNELS) || (decimation == 0) || (nbTaps > FILTER_MAX_TAPS) || (!taps && nbTaps))
+    {
+      return 0;
+    }
+
+  TFilter *filter = &Filters[channelNb];
+  filter->cursor = Sampler_Count();
+  filter->sum = 0;
+  filter->count = 0;
+  filter->decimation = decimation;
+  filter->newest = 0;
+  memset(filter->history, 0, sizeof(filter->history));
+
+  // An odd length gets a zero tap, so the dual multiply-accumulate always works in pairs
+  memset(filter->taps, 0, sizeof(filter->taps));
+  if (nbTaps)
+    {
+      memcpy(filter->taps, taps, nbTaps * sizeof(int16_t));
+    }
+  filter->nbTaps = (nbTaps + 1) & ~1;
+  return 1;
+}
+
+/*! @brief Filters the samples taken since the last call.
+ *
+ *  @param channelNb The Sampler channel.
+ *  @param output Where to put the decimated outputs.
+ *  @param maxOutputs The size of the output buffer.
+ *  @return uint16_t - the number of outputs made.
+ */
+uint16_t Filter_Read(const uint8_t channelNb, int16_t * const output, const uint16_t maxOutputs)
+{
+  int16_t samples[CHUNK_SIZE];
+  uint16_t nbOutputs = 0;
+
+  if (channelNb >= SAMPLER_NB_CHANNELS)
+    {
+      return 0;
+    }
+
+  TFilter *filter = &Filters[channelNb];
+  while (nbOutputs < maxOutputs)
+    {
+      // Only take the samples the room left in the output buffer can use
+      uint32_t wanted = ((uint32_t) (maxOutputs - nbOutputs) * filter->decimation) - filter->count;
+      uint16_t nbSamples = Sampler_Read(channelNb, &filter->cursor, samples, (wanted < CHUNK_SIZE) ? wanted : CHUNK_SIZE);
+      if (nbSamples == 0)
+	{
+	  break;
+	}
+
+      for (uint16_t i = 0; i < nbSamples; i++)
+	{
+	  filter->sum += samples[i];
+	  if (++filter->count == filter->decimation)
+	    {
+	      output[nbOutputs++] = FIR(filter, (int16_t) (filter->sum / filter->decimation));
+	      filter->sum = 0;
+	      filter->count = 0;
+	    }
+	}
+    }
+  return nbOutputs;
+}
+
+/* END Filter */
+/*!
+** @}
+*/
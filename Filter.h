@@ -0,0 +1,53 @@
+/*! @file
+ *
+ *  @brief Decimating filters for the sampled analog channels.
+ *
+ *  Each channel averages blocks of samples from the Sampler (a boxcar decimator), then optionally runs
+ *  the averages through a Q15 FIR filter. Only the decimated output is passed on.
+ *  The FIR uses the Cortex-M4 dual multiply-accumulate (SMLALD) when the DSP extension is available,
+ *  and portable C otherwise. Both accumulate exactly in 64 bits, so they give bit-identical results.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+// new types
+#include "types.h"
+
+// Largest number of FIR taps. Must be even.
+#define FILTER_MAX_TAPS 16
+
+// Largest decimation factor
+#define FILTER_MAX_DECIMATION 255
+
+/*! @brief Sets every channel to a plain boxcar decimator and starts them at the newest sample.
+ *
+ *  @param decimation The number of samples averaged into each output.
+ *  @return bool - TRUE if the filters were successfully initialized.
+ *  @note Assumes the Sampler has been initialized.
+ */
+bool Filter_Init(const uint8_t decimation);
+
+/*! @brief Configures the filter of a channel, discarding its state.
+ *
+ *  @param channelNb The Sampler channel.
+ *  @param decimation The number of samples averaged into each output, from 1 to FILTER_MAX_DECIMATION.
+ *  @param taps The Q15 FIR coefficients, newest sample first, or NULL for no FIR.
+ *  @param nbTaps The number of coefficients, up to FILTER_MAX_TAPS.
+ *  @return bool - TRUE if the filter was configured.
+ */
+bool Filter_Set(const uint8_t channelNb, const uint8_t decimation, const int16_t* const taps, const uint8_t nbTaps);
+
+/*! @brief Filters the samples taken since the last call.
+ *
+ *  @param channelNb The Sampler channel.
+ *  @param output Where to put the decimated outputs, in the same units as the samples.
+ *  @param maxOutputs The size of the output buffer. Samples that would make more outputs are left for the next call.
+ *  @return uint16_t - the number of outputs made.
+ */
+uint16_t Filter_Read(const uint8_t channelNb, int16_t* const output, const uint16_t maxOutputs);
+
+#endif
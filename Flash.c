@@ -12,18 +12,35 @@
 
 #include "types.h"
 #include "Flash.h"
+#include "FlashLog.h"
+#include "Time.h"
+#include "Event.h"
+#include "Defer.h"
 #include "MK70F12.h"
+#include "PE_Types.h"
+#include "CPU.h"
 
 #include <string.h>
 
-#define SECTOR_SIZE 4095
+// Number of bytes tracked by each word of the allocation map
+#define MAP_BITS_PER_WORD 32
 
-#define FLASH_EMPTY 0
-#define FLASH_ALLOCATED 1
+// Largest alignment the allocator will use
+#define MAX_ALIGNMENT 8
 
+//One bit per byte of the data area, 0 is unallocated, 1 is allocated
+static uint32_t AllocationMap[FLASH_DATA_SIZE / MAP_BITS_PER_WORD] = { 0 };
 
-//0 is unallocated, 1 is allocated
-static uint8_t AllocationMap[FLASH_DATA_SIZE] = { FLASH_EMPTY };
+// RAM copy of the non-volatile variables. Variables live here, Flash is only touched on a flush.
+static uint8_t Shadow[FLASH_DATA_SIZE] __attribute__ ((aligned(8)));
+
+// TRUE when the shadow holds writes that have not been committed to Flash yet
+static volatile bool Dirty = 0;
+
+// The shadow as it was when the commit under way, or the last one, was taken
+static uint32_t Snapshot[FLASHLOG_NB_KEYS];
+// Set while a snapshot is being appended to the log
+static volatile bool Committing = 0;
 
 /*
  * Flash Commands
@@ -37,6 +54,75 @@ static uint8_t AllocationMap[FLASH_DATA_SIZE] = { FLASH_EMPTY };
 
 #define FLASH_CMD_PGM8 0x07LU
 
+//Program Section, from the programming acceleration RAM
+#define FLASH_CMD_PGMSEC 0x0BLU
+
+//Swap Control
+#define FLASH_CMD_SWAP 0x46LU
+
+// Number of bytes in a phrase, the smallest unit that can be programmed
+#define FLASH_PHRASE_SIZE 8
+
+// Number of phrases checked by Read 1s Section before a sector is erased
+#define FLASH_PHRASES_PER_SECTOR (FLASH_SECTOR_SIZE / FLASH_PHRASE_SIZE)
+
+// Programming acceleration RAM (FlexRAM), where Program Section takes its data from
+#define FLASH_ACCEL_RAM_START 0x14000000LU
+#define FLASH_ACCEL_RAM_SIZE  0x1000LU
+
+// Fewer phrases than this are programmed one at a time, as staging them isn't worth it
+#define FLASH_SECTION_MIN_PHRASES 2
+
+// Bytes copied into the acceleration RAM at a time, so the copy only holds off interrupts briefly
+#define FLASH_STAGE_PIECE 64
+
+/*!
+ * @brief What has to happen to turn one phrase into another.
+ */
+typedef enum
+{
+  FLASH_PLAN_SKIP,      /*!< The phrase already holds the data. */
+  FLASH_PLAN_PROGRAM,   /*!< The phrase is erased and can be programmed. */
+  FLASH_PLAN_ERASE      /*!< The sector has to be erased first. */
+} TFlashPlan;
+
+// Number of commands that can be waiting for the FTFE
+#define FLASH_QUEUE_SIZE 16
+
+/*!
+ * @brief A command waiting for the FTFE.
+ */
+typedef struct
+{
+  uint8_t command;    /*!< The FTFE command code. */
+  uint32_t address;   /*!< The Flash address the command acts on. */
+  uint64_t phrase;    /*!< The data to program, for program commands. */
+  const uint8_t *source;  /*!< For block writes, the data still to be programmed. */
+  uint16_t length;        /*!< For block writes, the number of bytes still to be programmed. */
+  uint16_t chunk;         /*!< For block writes, the number of bytes the running command programs. */
+  bool verified;      /*!< For erase commands, TRUE once Read 1s Section found the sector is not blank. */
+  uint64_t queued;    /*!< The time the request was queued. */
+} TFlashRequest;
+
+// Commands in the order they will be launched. The head is the one the FTFE is running.
+static TFlashRequest Queue[FLASH_QUEUE_SIZE];
+static uint8_t QueueStart = 0;
+static uint8_t QueueEnd = 0;
+static uint8_t volatile QueueNbItems = 0;
+
+// Set when a command fails, cleared when the status is read
+static volatile bool Error = 0;
+
+// The block write whose next section is waiting to be copied into the acceleration RAM, or NULL.
+// The FTFE stays idle until a thread has made the copy and started the command.
+static TFlashRequest * volatile Unstaged = NULL;
+// Bytes of the section copied so far
+static volatile uint16_t Staged = 0;
+
+// Times the last retired request was queued and completed, 0 before any has completed
+static volatile uint64_t LastQueued = 0;
+static volatile uint64_t LastCompleted = 0;
+
 /* @brief Wait for the CCIF register to be set to 1.
  *
  */
@@ -46,34 +132,26 @@ void WaitCCIF()
 		;
 }
 
-/*! @brief Set CCIF and the wait for it to be set.
- * Used to start a flash command and wait for it to complete
+/*! @brief Launches the command loaded into the FCCOB registers and waits for it to complete.
  *
+ *  Runs from RAM, so it can launch commands during which the program flash can't be read.
+ *  @note Assumes interrupts are disabled, as their handlers are in Flash.
  */
-void SetCCIF()
+static void __attribute__ ((section(".data.ramfunc"), long_call, noinline)) LaunchFromRAM(void)
 {
-	FTFE_FSTAT = FTFE_FSTAT_CCIF_MASK;
-	WaitCCIF();
-}
-
-bool MGSTAT0Error()
-{
-	return FTFE_FSTAT & FTFE_FSTAT_MGSTAT0_MASK;
+  FTFE_FSTAT = FTFE_FSTAT_CCIF_MASK;
+  while (!(FTFE_FSTAT & FTFE_FSTAT_CCIF_MASK))
+    ;
 }
 
 /*!
- * @brief Handle the error registers and resets them
+ * @brief Handle the error registers of the last command
  * @return TRUE if success
  */
-bool HandleRegisters()
+static bool HandleRegisters()
 {
   uint8_t fstat_buffer = FTFE_FSTAT;
-  //Command Complete Interrupt Flag. 0 = in progress, 1 = idle
-  bool CCIFset = ((fstat_buffer & FTFE_FSTAT_CCIF_MASK) == FTFE_FSTAT_CCIF_MASK);
 
-  //FTFE Read Collision Error Flag. 1 = collision detected
-  bool RDCOLERRset = ((fstat_buffer & FTFE_FSTAT_RDCOLERR_MASK)
-			== FTFE_FSTAT_RDCOLERR_MASK);
   //Flash Access Error Flag. 1 = error
   bool ACCERRset = ((fstat_buffer & FTFE_FSTAT_ACCERR_MASK)
       == FTFE_FSTAT_ACCERR_MASK);
@@ -86,6 +164,335 @@ bool HandleRegisters()
   bool MGSTAT0set = ((fstat_buffer & FTFE_FSTAT_MGSTAT0_MASK)
 			== FTFE_FSTAT_MGSTAT0_MASK);
 
+  return !(ACCERRset || FPVIOLset || MGSTAT0set);
+}
+
+/*! @brief Works out what it takes to change the contents of a phrase.
+ *
+ *  The FTFE stores an ECC with every phrase, so a phrase that has been programmed can't be
+ *  programmed again, even when the new data only clears bits.
+ *  @param oldPhrase The phrase as it is in Flash.
+ *  @param newPhrase The phrase as it should be.
+ *  @return TFlashPlan - the cheapest way to get there.
+ */
+static TFlashPlan PlanPhrase(const uint64_t oldPhrase, const uint64_t newPhrase)
+{
+  if (oldPhrase == newPhrase)
+    {
+      return FLASH_PLAN_SKIP;
+    }
+  if (oldPhrase == UINT64_MAX)
+    {
+      return FLASH_PLAN_PROGRAM;
+    }
+  return FLASH_PLAN_ERASE;
+}
+
+/*! @brief Loads a command into the FTFE and starts it.
+ *
+ *  @param command The FTFE command code.
+ *  @param address The Flash address the command acts on.
+ *  @param data For FLASH_CMD_PGM8, the phrase to program.
+ *  @param nbPhrases For FLASH_CMD_RD1SEC and FLASH_CMD_PGMSEC, the number of phrases.
+ *  @note Assumes the FTFE is idle.
+ */
+static void Start(const uint8_t command, const uint32_t address, const uint8_t * const data, const uint16_t nbPhrases)
+{
+  uint32_8union_t flashStart;
+  flashStart.l = address;
+
+  // Clear the error flags left by the previous command
+  FTFE_FSTAT = FTFE_FSTAT_ACCERR_MASK | FTFE_FSTAT_FPVIOL_MASK;
+
+  FTFE_FCCOB0 = command;        // defines the FTFE command
+  FTFE_FCCOB1 = flashStart.s.b; // sets flash address[23:16]
+  FTFE_FCCOB2 = flashStart.s.c; // sets flash address[15:8]
+
+  switch (command)
+    {
+      case FLASH_CMD_PGM8:
+	FTFE_FCCOB3 = (flashStart.s.d & 0xF8);
+
+	//Order of these is reversed and switched so that the allocation mapping works
+	FTFE_FCCOB4 = data[3];
+	FTFE_FCCOB5 = data[2];
+	FTFE_FCCOB6 = data[1];
+	FTFE_FCCOB7 = data[0];
+	FTFE_FCCOB8 = data[7];
+	FTFE_FCCOB9 = data[6];
+	FTFE_FCCOBA = data[5];
+	FTFE_FCCOBB = data[4];
+	break;
+
+      case FLASH_CMD_PGMSEC:
+	FTFE_FCCOB3 = (flashStart.s.d & 0xF8);
+	FTFE_FCCOB4 = (nbPhrases >> 8);
+	FTFE_FCCOB5 = (nbPhrases & 0xFF);
+	break;
+
+      case FLASH_CMD_RD1SEC:
+	FTFE_FCCOB3 = (flashStart.s.d & 0xF0);
+	FTFE_FCCOB4 = (nbPhrases >> 8);
+	FTFE_FCCOB5 = (nbPhrases & 0xFF);
+	FTFE_FCCOB6 = 0;                // normal read level
+	break;
+
+      default:
+	FTFE_FCCOB3 = (flashStart.s.d & 0xF0); // sets flash address[7:0]
+	break;
+    }
+
+  FTFE_FSTAT = FTFE_FSTAT_CCIF_MASK;      // launch the command
+  FTFE_FCNFG |= FTFE_FCNFG_CCIE_MASK;     // and interrupt when it completes
+}
+
+/*! @brief Copies the next section of a block write into the acceleration RAM and starts programming it.
+ *
+ *  Posted by LaunchBlock, and also called by any thread that waits for the Flash, so a waiting thread never depends on
+ *  the thread that runs the deferred calls. The copy is made a piece at a time with interrupts disabled, and a thread
+ *  that preempts another part way through just carries on from where it got to.
+ *  @param arguments Unused.
+ *  @note Does nothing if no section is waiting. Must not be called from an interrupt.
+ */
+static void StageSection(void *arguments)
+{
+  bool more;
+
+  do
+    {
+      EnterCritical();
+      // The request stays at the head of the queue, and the FTFE idle, until the command is started
+      TFlashRequest *request = Unstaged;
+      if (request)
+	{
+	  uint16_t piece = request->chunk - Staged;
+	  if (piece > FLASH_STAGE_PIECE)
+	    {
+	      piece = FLASH_STAGE_PIECE;
+	    }
+	  memcpy((uint8_t *) FLASH_ACCEL_RAM_START + Staged, request->source + Staged, piece);
+	  Staged += piece;
+
+	  if (Staged == request->chunk)
+	    {
+	      Unstaged = NULL;
+	      Start(FLASH_CMD_PGMSEC, request->address, NULL, request->chunk / FLASH_PHRASE_SIZE);
+	    }
+	}
+      more = (Unstaged != NULL);
+      ExitCritical();
+    }
+  while (more);
+}
+
+/*! @brief Starts the next command of a block write.
+ *
+ *  Runs of erased phrases are staged in the programming acceleration RAM and programmed with one
+ *  Program Section command. Copying a run can take a few thousand cycles, too long for the interrupt,
+ *  so it is left to StageSection and the FTFE interrupt is turned off until then.
+ *  Short runs, and every run while the FlexRAM isn't available, are programmed a phrase at a time.
+ *  @param request The block write, which is advanced past any data that is already in Flash.
+ *  @return bool - TRUE if the FTFE was started or the next section is waiting to be staged, FALSE if the block write is finished.
+ *  @note Assumes the FTFE is idle.
+ */
+static bool LaunchBlock(TFlashRequest * const request)
+{
+  while (request->length > 0)
+    {
+      // A section stays within one sector and fits in the acceleration RAM
+      uint32_t chunk = FLASH_SECTOR_SIZE - (request->address % FLASH_SECTOR_SIZE);
+      if (chunk > FLASH_ACCEL_RAM_SIZE)
+	{
+	  chunk = FLASH_ACCEL_RAM_SIZE;
+	}
+      if (chunk > request->length)
+	{
+	  chunk = request->length;
+	}
+
+      bool erased = 1;
+      for (uint32_t i = 0; (i < chunk) && erased; i += FLASH_PHRASE_SIZE)
+	{
+	  erased = (_FP(request->address + i) == UINT64_MAX);
+	}
+
+      if (erased && (chunk >= (FLASH_SECTION_MIN_PHRASES * FLASH_PHRASE_SIZE)) && (FTFE_FCNFG & FTFE_FCNFG_RAMRDY_MASK))
+	{
+	  request->chunk = chunk;
+	  Staged = 0;
+	  Unstaged = request;
+	  // CCIF stays set while the FTFE is idle, which would keep the interrupt firing
+	  FTFE_FCNFG &= ~FTFE_FCNFG_CCIE_MASK;
+	  (void) Defer_Post(&StageSection, NULL);
+	  return 1;
+	}
+
+      // Phrase path
+      uint64_t phrase;
+      memcpy(&phrase, request->source, FLASH_PHRASE_SIZE);
+      switch (PlanPhrase(_FP(request->address), phrase))
+	{
+	  case FLASH_PLAN_PROGRAM:
+	    request->chunk = FLASH_PHRASE_SIZE;
+	    Start(FLASH_CMD_PGM8, request->address, request->source, 0);
+	    return 1;
+	  case FLASH_PLAN_ERASE:
+	    Error = 1;
+	    return 0;
+	  default:
+	    break;
+	}
+
+      request->address += FLASH_PHRASE_SIZE;
+      request->source += FLASH_PHRASE_SIZE;
+      request->length -= FLASH_PHRASE_SIZE;
+    }
+  return 0;
+}
+
+/*! @brief Starts the FTFE on a queued request.
+ *
+ *  A program command is only started if the phrase needs it and is erased.
+ *  An erase command first runs Read 1s Section so a blank sector isn't erased again.
+ *  @param request The request to start.
+ *  @return bool - TRUE if the FTFE was started, FALSE if the request needs no command.
+ *  @note Assumes the FTFE is idle.
+ */
+static bool Launch(TFlashRequest * const request)
+{
+  switch (request->command)
+    {
+      case FLASH_CMD_PGM8:
+	// The FTFE is idle, so the phrase can be read
+	switch (PlanPhrase(_FP(request->address), request->phrase))
+	  {
+	    case FLASH_PLAN_SKIP:
+	      return 0;
+	    case FLASH_PLAN_ERASE:
+	      Error = 1;
+	      return 0;
+	    default:
+	      break;
+	  }
+	Start(FLASH_CMD_PGM8, request->address, (uint8_t *) &request->phrase, 0);
+	return 1;
+
+      case FLASH_CMD_PGMSEC:
+	return LaunchBlock(request);
+
+      default:
+	if (!request->verified)
+	  {
+	    // check whether the sector is blank
+	    Start(FLASH_CMD_RD1SEC, request->address, NULL, FLASH_PHRASES_PER_SECTOR);
+	  }
+	else
+	  {
+	    Start(FLASH_CMD_ERSSCR, request->address, NULL, 0);
+	  }
+	return 1;
+    }
+}
+
+/*! @brief Starts the first queued command that needs the FTFE.
+ *
+ *  Requests that need no command are retired on the way.
+ */
+static void StartNext(void)
+{
+  while (QueueNbItems > 0)
+    {
+      if (Launch(&Queue[QueueStart]))
+	{
+	  return;
+	}
+      QueueStart = (QueueStart + 1) % FLASH_QUEUE_SIZE;
+      QueueNbItems--;
+    }
+
+  // Nothing left to do, so stop the interrupt from firing
+  FTFE_FCNFG &= ~FTFE_FCNFG_CCIE_MASK;
+}
+
+/*! @brief Retires the running command if it has completed and starts the next one.
+ *
+ *  @note Must be called with interrupts disabled or from the FTFE interrupt.
+ */
+static void Service(void)
+{
+  if ((QueueNbItems == 0) || Unstaged || !(FTFE_FSTAT & FTFE_FSTAT_CCIF_MASK))
+    {
+      return;
+    }
+
+  TFlashRequest *request = &Queue[QueueStart];
+  bool success = HandleRegisters();
+
+  if ((request->command == FLASH_CMD_ERSSCR) && !request->verified)
+    {
+      // Read 1s Section sets MGSTAT0 if any bit is programmed. Erase unless it proved the sector blank.
+      request->verified = 1;
+      if (!success)
+	{
+	  Launch(request);
+	  return;
+	}
+    }
+  else if ((request->command == FLASH_CMD_PGMSEC) && success)
+    {
+      // Carry on with the rest of the block
+      request->address += request->chunk;
+      request->source += request->chunk;
+      request->length -= request->chunk;
+      if (LaunchBlock(request))
+	{
+	  return;
+	}
+    }
+  else if (!success)
+    {
+      Error = 1;
+    }
+
+  LastQueued = request->queued;
+  LastCompleted = Time_Now();
+  Event_Set(EVENT_FLASH);
+  QueueStart = (QueueStart + 1) % FLASH_QUEUE_SIZE;
+  QueueNbItems--;
+  StartNext();
+}
+
+/*! @brief Adds a request to the queue, starting it straight away if the FTFE is idle.
+ *
+ *  @param request The request, which is copied into the queue.
+ *  @return bool - TRUE if the request was queued.
+ *  @note Waits for a slot if the queue is full.
+ */
+static bool Submit(const TFlashRequest * const request)
+{
+  // Checked with interrupts disabled, as another thread may queue a command between the check and the copy
+  EnterCritical();
+  while (QueueNbItems >= FLASH_QUEUE_SIZE)
+    {
+      ExitCritical();
+      StageSection(NULL);
+      EnterCritical();
+      Service();
+    }
+
+  Queue[QueueEnd] = *request;
+  Queue[QueueEnd].queued = Time_Now();
+  QueueEnd = (QueueEnd + 1) % FLASH_QUEUE_SIZE;
+  QueueNbItems++;
+
+  if (QueueNbItems == 1)
+    {
+      StartNext();
+    }
+  ExitCritical();
+
+  // A block write that starts straight away is staged here rather than waiting for the deferred call
+  StageSection(NULL);
   return 1;
 }
 
@@ -100,116 +507,289 @@ bool Flash_Init()
 
   //Wait for the flash module to start up
   WaitCCIF();
+
+  // Setting up NVIC for FTFE command complete see K70 manual pg 97
+  // Vector=34, IRQ=18
+  // NVIC non-IPR=0 IPR=4
+  // Clear any pending interrupts on FTFE
+  NVICICPR0 = (1 << 18);
+  // Enable interrupts from the FTFE
+  NVICISER0 = (1 << 18);
+
+  // Formatting the log on first boot is finished before anything reads it
+  if (!FlashLog_Init() || !Flash_Wait())
+    {
+      return 0;
+    }
+
+  // Reads are served from RAM from now on
+  for (uint16_t i = 0; i < FLASHLOG_NB_KEYS; i++)
+    {
+      ((uint32_t *) Shadow)[i] = FlashLog_Get(i);
+    }
+  Dirty = 0;
+  return 1;
+}
+
+/*! @brief Checks or marks a run of bytes in the allocation map.
+ *
+ *  @param start Offset of the first byte.
+ *  @param size The number of bytes.
+ *  @param allocate TRUE to mark the bytes as allocated, FALSE to only check them.
+ *  @return bool - TRUE if none of the bytes were allocated beforehand.
+ */
+static bool UpdateMap(uint16_t start, uint16_t size, const bool allocate)
+{
+  while (size > 0)
+    {
+      uint16_t bit = start % MAP_BITS_PER_WORD;
+      uint16_t count = MAP_BITS_PER_WORD - bit;
+      if (count > size)
+	{
+	  count = size;
+	}
+
+      uint32_t mask = (count == MAP_BITS_PER_WORD) ? UINT32_MAX : (((1LU << count) - 1) << bit);
+      if (allocate)
+	{
+	  AllocationMap[start / MAP_BITS_PER_WORD] |= mask;
+	}
+      else if (AllocationMap[start / MAP_BITS_PER_WORD] & mask)
+	{
+	  return 0;
+	}
+
+      start += count;
+      size -= count;
+    }
   return 1;
 }
 
 /*! @brief Makes space for a non-volatile variable in the Flash memory.
  *
  *  @param variable is the address of a pointer to a variable that is to be allocated space in Flash memory.
- *  @param size The size, in bytes, of the variable that is to be allocated space in the Flash memory. Valid values are 1, 2 and 4.
+ *  @param size The size, in bytes, of the variable that is to be allocated space in the Flash memory, up to FLASH_DATA_SIZE.
  *  @return BOOL - TRUE if the variable was allocated space in the Flash memory.
  *  @note Assumes Flash has been initialized.
  */
-bool Flash_AllocateVar(volatile void ** variable, const uint8_t size)
+bool Flash_AllocateVar(volatile void ** variable, const uint16_t size)
 {
-  //The number of sequential unallocated bytes.
-  size_t sequential = 0;
+  if ((size == 0) || (size > FLASH_DATA_SIZE))
+    {
+      return 0;
+    }
 
-  //Location of the allocation in the array.
-  size_t location = 0;
-  //loop over allocation map.
-  for (size_t i = 0; i < FLASH_DATA_SIZE; i++)
+  // Smallest power of two that holds the variable, capped at a phrase
+  uint16_t alignment = 1;
+  while ((alignment < size) && (alignment < MAX_ALIGNMENT))
     {
-      if (AllocationMap[i] == 0)
-	{
-	  sequential++;
-	}
-      else
+      alignment <<= 1;
+    }
+
+  uint16_t location = 0;
+  while (location + size <= FLASH_DATA_SIZE)
+    {
+      // Jump to the first free byte, skipping whole words that are full
+      uint16_t word = location / MAP_BITS_PER_WORD;
+      uint32_t free = ~AllocationMap[word] & (UINT32_MAX << (location % MAP_BITS_PER_WORD));
+      if (free == 0)
 	{
-	  sequential = 0;
+	  location = (word + 1) * MAP_BITS_PER_WORD;
+	  continue;
 	}
+      location = (word * MAP_BITS_PER_WORD) + __builtin_ctz(free);
+
       //Assign *variable to an aligned memory address
-      if (i % size == 0)
+      location = (location + alignment - 1) & ~(alignment - 1);
+      if (location + size > FLASH_DATA_SIZE)
 	{
-	  location = i;
+	  break;
 	}
-      /* If there are the correct number of sequential bytes free
-       * 	 * and the position is aligned
-      */
-      if (sequential >= size && ((i + 1) % size == 0))
+
+      if (UpdateMap(location, size, 0))
 	{
-	  //Iterate over allocation map and mark the bytes as allocated
-	  for (size_t j = location; j <= i; j++)
-	    {
-	      AllocationMap[j] = FLASH_ALLOCATED;
-	    }
-	  *variable = (void*) (FLASH_DATA_START + location);
+	  UpdateMap(location, size, 1);
+	  *variable = (void*) &Shadow[location];
 	  return 1;
 	}
+      location += alignment;
     }
   return 0;
 }
 
-/*! @brief Erases flash and then writes phrase
- *	@return TRUE if success
+/*! @brief Queues a phrase to be programmed into an erased location.
+ *  The write is skipped if the phrase already holds the data.
+ *  @param address The phrase aligned address to program.
+ *  @param phrase The 8 bytes to program.
+ *	@return TRUE if the command was queued
  */
-bool WritePhrase(const uint64_t phrase)
+bool Flash_ProgramPhrase(const uint32_t address, const uint64_t phrase)
 {
-  WaitCCIF();
-  bool result = Flash_Erase();
-  if (result != 1)
+  TFlashRequest request = { FLASH_CMD_PGM8, address, phrase, NULL, 0, 0, 0 };
+  return Submit(&request);
+}
+
+/*! @brief Queues a sector to be erased
+ *  The erase is skipped if the sector is already blank.
+ *  @param address the start address we are erasing from
+ *  @return BOOL - TRUE if the command was queued
+ */
+bool Flash_EraseSector(const uint32_t address)
+{ // reset our sector to all 1s. this kills the sector.
+  TFlashRequest request = { FLASH_CMD_ERSSCR, address, 0, NULL, 0, 0, 0 };
+  return Submit(&request);
+}
+
+/*! @brief Queues a block of data to be programmed into erased Flash.
+ *  Whole runs of phrases go through the programming acceleration RAM with Program Section.
+ *  @param address The phrase aligned address to program.
+ *  @param source The data, which must stay unchanged until the command completes.
+ *  @param length The number of bytes, a multiple of 8.
+ *  @return BOOL - TRUE if the block was queued
+ */
+bool Flash_WriteBlock(const uint32_t address, const void * const source, const uint16_t length)
+{
+  if ((address % FLASH_PHRASE_SIZE) || (length % FLASH_PHRASE_SIZE))
     {
+      //not aligned
       return 0;
     }
 
-  uint32_8union_t flashStart;
-  flashStart.l = FLASH_DATA_START;
+  TFlashRequest request = { FLASH_CMD_PGMSEC, address, 0, (const uint8_t *) source, length, 0, 0 };
+  return Submit(&request);
+}
 
-  FTFE_FCCOB0 = FLASH_CMD_PGM8; // defines the FTFE command to write
-  FTFE_FCCOB1 = flashStart.s.b; // sets flash address[23:16] to 128
-  FTFE_FCCOB2 = flashStart.s.c; // sets flash address[15:8] to 0
-  FTFE_FCCOB3 = (flashStart.s.d & 0xF8);
+/*! @brief Reports the progress of the queued commands.
+ *
+ *  @return TFlashStatus - FLASH_STATUS_BUSY while commands are queued, then FLASH_STATUS_ERROR once if any of them failed.
+ */
+TFlashStatus Flash_Status(void)
+{
+  if (QueueNbItems > 0)
+    {
+      return FLASH_STATUS_BUSY;
+    }
+  if (Error)
+    {
+      Error = 0;
+      return FLASH_STATUS_ERROR;
+    }
+  return FLASH_STATUS_IDLE;
+}
+
+/*! @brief Runs a Swap Control command on the swap indicator.
+ *
+ *  @param control The Swap Control code.
+ *  @param state Set to the swap state after the command. May be NULL.
+ *  @return bool - TRUE if the queued commands and the Swap Control command succeeded.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_SwapControl(const uint8_t control, uint8_t * const state)
+{
+  uint32_8union_t indicator;
+  indicator.l = FLASH_SWAP_INDICATOR;
 
-  uint8_t *data = (uint8_t *) &phrase;
+  // The FTFE is left idle with its interrupt disabled, so the command can be polled
+  if (!Flash_Wait())
+    {
+      return 0;
+    }
 
-  //Order of these is reversed and switched so that the allocation mapping works
-  FTFE_FCCOB4 = data[3];
-  FTFE_FCCOB5 = data[2];
-  FTFE_FCCOB6 = data[1];
-  FTFE_FCCOB7 = data[0];
-  FTFE_FCCOB8 = data[7];
-  FTFE_FCCOB9 = data[6];
-  FTFE_FCCOBA = data[5];
-  FTFE_FCCOBB = data[4];
+  FTFE_FSTAT = FTFE_FSTAT_ACCERR_MASK | FTFE_FSTAT_FPVIOL_MASK;
+  FTFE_FCCOB0 = FLASH_CMD_SWAP;
+  FTFE_FCCOB1 = indicator.s.b;
+  FTFE_FCCOB2 = indicator.s.c;
+  FTFE_FCCOB3 = indicator.s.d;
+  FTFE_FCCOB4 = control;
 
-  SetCCIF();
+  // Swap Control works on both blocks, so nothing may be fetched from Flash until it completes
+  EnterCritical();
+  LaunchFromRAM();
+  ExitCritical();
 
+  if (state)
+    {
+      *state = FTFE_FCCOB5;
+    }
   return HandleRegisters();
 }
 
-void ReadPhrase(uint64_t * const phrase)
+/*! @brief Checks whether any commands are still queued.
+ *
+ *  @return bool - TRUE while the data sectors must not be read directly.
+ */
+bool Flash_IsBusy(void)
 {
-  WaitCCIF();
-  *phrase = _FP(FLASH_DATA_START);
+  return (QueueNbItems > 0);
 }
 
-/*! @brief erases a sector
- *  @param address the start address we are erasing from
- *  @return BOOL - TRUE if successful
+/*! @brief Gets the timestamps of the last command to complete.
+ *
+ *  @param queued Set to the Time_Now at which the command was queued.
+ *  @param completed Set to the Time_Now at which it completed.
+ *  @return bool - TRUE if any command has completed.
  */
-static bool EraseSector(const uint32_t address)
-{ // reset our phrase to all 1s. this kills the phrase.
-  uint32_8union_t flashStart;
-  flashStart.l = FLASH_DATA_START;
+bool Flash_LastCommandTime(uint64_t* const queued, uint64_t* const completed)
+{
+  EnterCritical();
+  *queued = LastQueued;
+  *completed = LastCompleted;
+  ExitCritical();
+  return (*completed != 0);
+}
+
+/*! @brief Waits for all the queued commands to complete.
+ *
+ *  @return bool - TRUE if all the commands succeeded.
+ */
+bool Flash_Wait(void)
+{
+  TFlashStatus status;
 
-  FTFE_FCCOB0 = FLASH_CMD_ERSSCR; // defines the FTFE command to erase
-  FTFE_FCCOB1 = flashStart.s.b; // sets flash address[23:16] to 128
-  FTFE_FCCOB2 = flashStart.s.c; // sets flash address[15:8] to 0
-  FTFE_FCCOB3 = (flashStart.s.d & 0xF0); // sets flash address[7:0] to 0
+  // Polling works whether or not interrupts are enabled
+  do
+    {
+      StageSection(NULL);
+      EnterCritical();
+      Service();
+      ExitCritical();
+      status = Flash_Status();
+    }
+  while (status == FLASH_STATUS_BUSY);
 
-  SetCCIF();
-  return 1; // also control will return here once the CCIF flag says it's done
+  return (status == FLASH_STATUS_IDLE);
+}
 
+/*! @brief Interrupt service routine for the FTFE.
+ *
+ *  The running command has completed, so the next queued command is started.
+ *  @note Assumes the Flash has been initialized.
+ */
+void __attribute__ ((interrupt)) FTFE_ISR(void)
+{
+  Service();
+}
+
+/*! @brief Returns the offset of an address within the shadow.
+ *
+ *  @param address An address handed out by Flash_AllocateVar.
+ *  @param size The size, in bytes, of the access.
+ *  @return size_t - the offset, or FLASH_DATA_SIZE if the access is out of range or not aligned.
+ */
+static size_t ShadowOffset(volatile void * const address, const size_t size)
+{
+  size_t index = (size_t) ((uint8_t *) address - Shadow);
+  if (index >= FLASH_DATA_SIZE || index + size > FLASH_DATA_SIZE)
+    {
+      //Out of range.
+      return FLASH_DATA_SIZE;
+    }
+  if (index % size != 0)
+    {
+      //not aligned
+      return FLASH_DATA_SIZE;
+    }
+  return index;
 }
 
 /*! @brief Puts a 32-bit integer to Flash.
@@ -221,23 +801,15 @@ static bool EraseSector(const uint32_t address)
  */
 bool Flash_Write32(uint32_t volatile * const address, const uint32_t data)
 {
-  size_t index = (size_t) address - FLASH_DATA_START;
-  if (index >= FLASH_DATA_SIZE || index < 0)
+  if (ShadowOffset(address, sizeof(uint32_t)) == FLASH_DATA_SIZE)
     {
-      //Out of range.
       return 0;
     }
-  if (index % 4 != 0)
+  if (*address != data)
     {
-      //not aligned
-      return 0;
+      *address = data;
+      Dirty = 1;
     }
-  index /= 4;
-  uint64_t tempPhrase;
-  ReadPhrase(&tempPhrase);
-  uint32_t *psuedoArray = (uint32_t *) &tempPhrase;
-  psuedoArray[index] = data;
-  WritePhrase(tempPhrase);
   return 1;
 }
 
@@ -250,23 +822,15 @@ bool Flash_Write32(uint32_t volatile * const address, const uint32_t data)
  */
 bool Flash_Write16(uint16_t volatile * const address, const uint16_t data)
 {
-  size_t index = (size_t) address - FLASH_DATA_START;
-  if (index >= FLASH_DATA_SIZE || index < 0)
+  if (ShadowOffset(address, sizeof(uint16_t)) == FLASH_DATA_SIZE)
     {
-      //Out of range.
       return 0;
     }
-  if (index % 2 != 0)
+  if (*address != data)
     {
-      //not aligned
-      return 0;
+      *address = data;
+      Dirty = 1;
     }
-  index /= 2;
-  uint64_t tempPhrase;
-  ReadPhrase(&tempPhrase);
-  uint16_t *psuedoArray = (uint16_t *) &tempPhrase;
-  psuedoArray[index] = data;
-  WritePhrase(tempPhrase);
   return 1;
 }
 
@@ -279,34 +843,108 @@ bool Flash_Write16(uint16_t volatile * const address, const uint16_t data)
  */
 bool Flash_Write8(uint8_t volatile * const address, const uint8_t data)
 {
-  size_t index = (size_t) address - FLASH_DATA_START;
-  if (index >= FLASH_DATA_SIZE || index < 0)
+  if (ShadowOffset(address, sizeof(uint8_t)) == FLASH_DATA_SIZE)
     {
-      //Out of range.
       return 0;
     }
-  uint64_t tempPhrase;
-  ReadPhrase(&tempPhrase);
-  uint8_t *psuedoArray = (uint8_t *) &tempPhrase;
-  psuedoArray[index] = data;
-  WritePhrase(tempPhrase);
+  if (*address != data)
+    {
+      *address = data;
+      Dirty = 1;
+    }
   return 1;
 }
 
-/*! @brief Erases the entire Flash sector.
+/*! @brief Gets the address of a byte of the non-volatile data area.
  *
- *  @return BOOL - TRUE if the Flash "data" sector was erased successfully.
+ *  @param offset Offset of the byte from the start of the data area.
+ *  @return uint8_t* - the RAM address of the byte, or NULL if the offset is out of range.
+ */
+volatile uint8_t* Flash_Data(const uint16_t offset)
+{
+  if (offset >= FLASH_DATA_SIZE)
+    {
+      return NULL;
+    }
+  return &Shadow[offset];
+}
+
+/*! @brief Checks whether there are writes waiting to be committed.
+ *
+ *  @return bool - TRUE if the shadow differs from the Flash.
+ */
+bool Flash_IsDirty(void)
+{
+  return Dirty;
+}
+
+/*! @brief Takes a copy of the pending writes for Flash_CommitSnapshot.
+ *
+ *  @return bool - TRUE if there were writes to copy.
+ */
+bool Flash_Snapshot(void)
+{
+  if (!Dirty)
+    {
+      return 0;
+    }
+  Dirty = 0;
+  memcpy(Snapshot, Shadow, sizeof(Snapshot));
+  return 1;
+}
+
+/*! @brief Commits the last snapshot to Flash.
+ *
+ *  Only the words that differ from the log are appended, so a commit does not erase.
+ *  @return bool - TRUE if the commit succeeded.
+ */
+bool Flash_CommitSnapshot(void)
+{
+  bool success = 1;
+
+  Committing = 1;
+  for (uint16_t i = 0; (i < FLASHLOG_NB_KEYS) && success; i++)
+    {
+      success = FlashLog_Put(i, Snapshot[i]);
+    }
+  if (!success)
+    {
+      // The shadow still holds the words, so the next commit tries them again
+      Dirty = 1;
+    }
+  Committing = 0;
+  return success;
+}
+
+/*! @brief Commits the shadow to Flash.
+ *
+ *  @return BOOL - TRUE if there was nothing to commit or the commit succeeded.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_Flush(void)
+{
+  // The log takes one writer at a time, and the one that was interrupted can't finish until this returns
+  if (Committing)
+    {
+      return 0;
+    }
+  return !Flash_Snapshot() || Flash_CommitSnapshot();
+}
+
+/*! @brief Erases all the non-volatile variables.
+ *
+ *  @return BOOL - TRUE if the Flash "data" was erased successfully.
  *  @note Assumes Flash has been initialized.
  */
 bool Flash_Erase(void)
 {
-  WaitCCIF();
-  EraseSector(FLASH_DATA_START);
-  //SetCCIF();
-  //todo: set only once
 // Only do this if you want the allocation to clear too.
 //	memset(allocationMap, 0, FLASH_DATA_SIZE);
-  return HandleRegisters();
+
+  // Pending writes are discarded along with the stored values
+  memset(Shadow, 0xFF, FLASH_DATA_SIZE);
+  Dirty = 0;
+  return FlashLog_Clear();
 }
 
 /* END flash */
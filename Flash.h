@@ -14,18 +14,67 @@
 // new types
 #include "types.h"
 
+/*!
+ * @brief Progress of the queued Flash commands.
+ */
+typedef enum
+{
+  FLASH_STATUS_IDLE,
+  FLASH_STATUS_BUSY,
+  FLASH_STATUS_ERROR
+} TFlashStatus;
+
 // FLASH data access
 #define _FB(flashAddress)  *(uint8_t  volatile *)(flashAddress)
 #define _FH(flashAddress)  *(uint16_t volatile *)(flashAddress)
 #define _FW(flashAddress)  *(uint32_t volatile *)(flashAddress)
 #define _FP(flashAddress)  *(uint64_t volatile *)(flashAddress)
 
-// Address of the start of the Flash block we are using for data storage
-#define FLASH_DATA_START 0x00080000LU
-// Address of the end of the Flash block we are using for data storage
-#define FLASH_DATA_END   0x00080007LU
-// The number of bytes in the flash block (currently 8)
-#define FLASH_DATA_SIZE ((FLASH_DATA_END-FLASH_DATA_START)+1)
+// The number of bytes in a Flash sector, the smallest area that can be erased
+#define FLASH_SECTOR_SIZE 0x1000LU
+
+// The number of bytes in each of the two program flash blocks.
+// The swap system can exchange the blocks, so the running firmware is always in block 0 and block 1 receives updates.
+#define FLASH_BLOCK_SIZE 0x80000LU
+// After a block swap, anything programmed in block 1 before it shows up this much lower, in block 0
+#define FLASH_MIRROR_OFFSET FLASH_BLOCK_SIZE
+
+// The number of sectors in the data region. The data log uses one half at a time, so this must be even.
+#define FLASH_DATA_NB_SECTORS 4
+// The number of sectors holding the A/B copies of the committed configuration
+#define FLASH_CONFIG_NB_SECTORS 2
+// Sectors at the top of each block that are kept out of the firmware image: the data region, the configuration and the swap indicator.
+// The linker must not place code or constants there.
+#define FLASH_RESERVED_NB_SECTORS (FLASH_DATA_NB_SECTORS + FLASH_CONFIG_NB_SECTORS + 1)
+// The largest firmware image
+#define FLASH_IMAGE_MAX_SIZE (FLASH_BLOCK_SIZE - (FLASH_RESERVED_NB_SECTORS * FLASH_SECTOR_SIZE))
+
+// Address of the start of the Flash region we are using for data storage.
+// This is at the top of program flash block 1 and the code runs from block 0, so the CPU keeps running while the data sectors are erased or programmed.
+#define FLASH_DATA_START (FLASH_BLOCK_SIZE + FLASH_IMAGE_MAX_SIZE)
+// Address of the end of the Flash region we are using for data storage
+#define FLASH_DATA_END   (FLASH_DATA_START + (FLASH_DATA_NB_SECTORS * FLASH_SECTOR_SIZE) - 1)
+// The number of bytes of non-volatile variables, a multiple of 32
+#define FLASH_DATA_SIZE 256
+
+// The sectors after the data region hold the configuration
+#define FLASH_CONFIG_START (FLASH_DATA_END + 1)
+
+// The swap indicator is the top sector of block 0. Its copy in block 1 is the top sector of the device.
+#define FLASH_SWAP_INDICATOR (FLASH_BLOCK_SIZE - FLASH_SECTOR_SIZE)
+
+// Swap Control codes
+#define FLASH_SWAP_INITIALIZE   0x01
+#define FLASH_SWAP_SET_UPDATE   0x02
+#define FLASH_SWAP_SET_COMPLETE 0x04
+#define FLASH_SWAP_REPORT       0x08
+
+// Swap states reported by Swap Control
+#define FLASH_SWAP_UNINITIALIZED 0x00
+#define FLASH_SWAP_READY         0x01
+#define FLASH_SWAP_UPDATE        0x02
+#define FLASH_SWAP_UPDATE_ERASED 0x03
+#define FLASH_SWAP_COMPLETE      0x04
 
 /*! @brief Enables the Flash module.
  *
@@ -35,21 +84,25 @@ bool Flash_Init(void);
  
 /*! @brief Allocates space for a non-volatile variable in the Flash memory.
  *
+ *  The variable is placed in a RAM shadow of the data sector, so reading it through the pointer never touches the Flash.
+ *  Space is handed out first-fit, so variables get the same addresses on every boot as long as they are allocated in the same order.
  *  @param variable is the address of a pointer to a variable that is to be allocated space in Flash memory.
  *         The pointer will be allocated to a relevant address:
  *         If the variable is a byte, then any address.
  *         If the variable is a half-word, then an even address.
  *         If the variable is a word, then an address divisible by 4.
+ *         Anything larger is placed on an address divisible by 8.
  *         This allows the resulting variable to be used with the relevant Flash_Write function which assumes a certain memory address.
  *         e.g. a 16-bit variable will be on an even address
- *  @param size The size, in bytes, of the variable that is to be allocated space in the Flash memory. Valid values are 1, 2 and 4.
+ *  @param size The size, in bytes, of the variable that is to be allocated space in the Flash memory, up to FLASH_DATA_SIZE.
  *  @return bool - TRUE if the variable was allocated space in the Flash memory.
  *  @note Assumes Flash has been initialized.
  */
-bool Flash_AllocateVar(volatile void** variable, const uint8_t size);
+bool Flash_AllocateVar(volatile void** variable, const uint16_t size);
 
 /*! @brief Writes a 32-bit number to Flash.
  *
+ *  The write only updates the RAM shadow; it reaches the Flash on the next Flash_Flush.
  *  @param address The address of the data.
  *  @param data The 32-bit data to write.
  *  @return bool - TRUE if Flash was written successfully, FALSE if address is not aligned to a 4-byte boundary or if there is a programming error.
@@ -59,6 +112,7 @@ bool Flash_Write32(volatile uint32_t* const address, const uint32_t data);
  
 /*! @brief Writes a 16-bit number to Flash.
  *
+ *  The write only updates the RAM shadow; it reaches the Flash on the next Flash_Flush.
  *  @param address The address of the data.
  *  @param data The 16-bit data to write.
  *  @return bool - TRUE if Flash was written successfully, FALSE if address is not aligned to a 2-byte boundary or if there is a programming error.
@@ -68,6 +122,7 @@ bool Flash_Write16(volatile uint16_t* const address, const uint16_t data);
 
 /*! @brief Writes an 8-bit number to Flash.
  *
+ *  The write only updates the RAM shadow; it reaches the Flash on the next Flash_Flush.
  *  @param address The address of the data.
  *  @param data The 8-bit data to write.
  *  @return bool - TRUE if Flash was written successfully, FALSE if there is a programming error.
@@ -75,11 +130,140 @@ bool Flash_Write16(volatile uint16_t* const address, const uint16_t data);
  */
 bool Flash_Write8(volatile uint8_t* const address, const uint8_t data);
 
-/*! @brief Erases the entire Flash sector.
+/*! @brief Gets the address of a byte of the non-volatile data area.
+ *
+ *  @param offset Offset of the byte from the start of the data area.
+ *  @return uint8_t* - the RAM address of the byte, or NULL if the offset is out of range.
+ *  @note Assumes Flash has been initialized.
+ */
+volatile uint8_t* Flash_Data(const uint16_t offset);
+
+/*! @brief Checks whether there are writes waiting to be committed.
+ *
+ *  @return bool - TRUE if the shadow differs from the Flash.
+ */
+bool Flash_IsDirty(void);
+
+/*! @brief Commits all pending writes to Flash.
+ *
+ *  Each changed 32-bit word is appended to the data log, so a commit does not erase.
+ *  The commands are queued and this returns without waiting for them to complete.
+ *  Call this after a burst of configuration changes, when the link has gone idle, and before any reset.
+ *  @return bool - TRUE if there was nothing to commit or the commit succeeded, FALSE if it failed
+ *    or it interrupted a thread in Flash_CommitSnapshot.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_Flush(void);
+
+/*! @brief Takes a copy of the pending writes, the first half of Flash_Flush.
  *
- *  @return bool - TRUE if the Flash "data" sector was erased successfully.
+ *  Call it with the writers locked out, so the copy holds whole changes.
+ *  @return bool - TRUE if there were writes to copy, FALSE if there is nothing to commit.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_Snapshot(void);
+
+/*! @brief Commits the copy taken by Flash_Snapshot, the second half of Flash_Flush.
+ *
+ *  The writers can carry on changing the shadow meanwhile. Their writes go out on the next commit.
+ *  Filling the log makes it compact into the other half, which queues more commands than the queue holds,
+ *  so this can wait for whole sector erases. Call it without holding any lock the other threads need.
+ *  @return bool - TRUE if the commit succeeded. If not, the writes are left pending.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_CommitSnapshot(void);
+
+/*! @brief Erases all the non-volatile variables.
+ *
+ *  Any writes that have not been flushed are discarded.
+ *  @return bool - TRUE if the Flash "data" was erased successfully.
  *  @note Assumes Flash has been initialized.
  */
 bool Flash_Erase(void);
 
+/*! @brief Queues a phrase to be programmed into an erased location of the Flash.
+ *
+ *  Returns as soon as the command is queued, only waiting if the queue is full.
+ *  Nothing is programmed if the phrase already holds the data. A phrase that holds other data
+ *  is reported as an error, as programmed phrases can't be programmed again without an erase.
+ *  @param address The phrase aligned address to program.
+ *  @param phrase The 8 bytes to program.
+ *  @return bool - TRUE if the command was queued.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_ProgramPhrase(const uint32_t address, const uint64_t phrase);
+
+/*! @brief Queues one sector of the Flash to be erased.
+ *
+ *  Returns as soon as the command is queued, only waiting if the queue is full.
+ *  The sector is checked with Read 1s Section first and is only erased if it isn't already blank.
+ *  @param address An address within the sector.
+ *  @return bool - TRUE if the command was queued.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_EraseSector(const uint32_t address);
+
+/*! @brief Queues a block of data to be programmed into erased Flash.
+ *
+ *  Runs of phrases are staged in the programming acceleration RAM and programmed with one
+ *  Program Section command per run, so a large block costs a few commands rather than one per phrase.
+ *  The runs are copied into the acceleration RAM by a thread, never by the FTFE interrupt: by the call itself if the
+ *  FTFE is free, otherwise by a deferred call (see Defer_Run) or by whichever thread waits for the Flash first.
+ *  Short blocks, and all blocks while the FlexRAM is not available, fall back to programming a phrase at a time.
+ *  Phrases that already hold the data are skipped.
+ *  @param address The phrase aligned address to program.
+ *  @param source The data. It must stay unchanged until Flash_Status stops reporting busy.
+ *  @param length The number of bytes, a multiple of 8.
+ *  @return bool - TRUE if the block was queued.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_WriteBlock(const uint32_t address, const void* const source, const uint16_t length);
+
+/*! @brief Reports the progress of the queued commands.
+ *
+ *  The data sectors must not be read directly while the status is busy.
+ *  @return TFlashStatus - FLASH_STATUS_BUSY while commands are queued, then FLASH_STATUS_ERROR once if any of them failed.
+ */
+TFlashStatus Flash_Status(void);
+
+/*! @brief Runs a Swap Control command on the swap indicator.
+ *
+ *  Waits for the queued commands to finish first, then runs the command to completion.
+ *  @param control The Swap Control code, e.g. FLASH_SWAP_REPORT.
+ *  @param state Set to the swap state after the command. May be NULL.
+ *  @return bool - TRUE if the queued commands and the Swap Control command succeeded.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_SwapControl(const uint8_t control, uint8_t* const state);
+
+/*! @brief Checks whether any commands are still queued.
+ *
+ *  Unlike Flash_Status, this leaves a pending error to be reported.
+ *  @return bool - TRUE while the data sectors must not be read directly.
+ */
+bool Flash_IsBusy(void);
+
+/*! @brief Gets the timestamps of the last command to complete.
+ *
+ *  The difference between them is how long the command spent queued and running.
+ *  @param queued Set to the Time_Now at which the command was queued.
+ *  @param completed Set to the Time_Now at which it completed.
+ *  @return bool - TRUE if any command has completed.
+ */
+bool Flash_LastCommandTime(uint64_t* const queued, uint64_t* const completed);
+
+/*! @brief Waits for all the queued commands to complete.
+ *
+ *  @return bool - TRUE if all the commands succeeded.
+ *  @note Works with interrupts disabled.
+ */
+bool Flash_Wait(void);
+
+/*! @brief Interrupt service routine for the FTFE.
+ *
+ *  The running command has completed, so the next queued command is started.
+ *  @note Assumes the Flash has been initialized.
+ */
+void __attribute__ ((interrupt)) FTFE_ISR(void);
+
 #endif
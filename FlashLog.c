@@ -0,0 +1,278 @@
+/*! @file
+ *  FlashLog.c
+ *
+ *  @brief Log-structured key-value store in the Flash data sectors
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup FlashLog_module FlashLog module documentation
+**  @{
+ */
+
+#include "FlashLog.h"
+#include "CRC.h"
+
+// Number of banks the log alternates between
+#define NB_BANKS 2
+
+// Banks from NB_BANKS up are the copies left in block 0 by a block swap. They are read, never written.
+#define NB_SCANNED_BANKS (NB_BANKS * 2)
+
+// Number of sectors in each bank, half of the data region
+#define SECTORS_PER_BANK (FLASH_DATA_NB_SECTORS / NB_BANKS)
+
+// Number of phrases in a bank, including the header
+#define RECORDS_PER_BANK ((SECTORS_PER_BANK * FLASH_SECTOR_SIZE) / 8)
+
+// Key of the record at the start of each bank. Its value is the bank's sequence number.
+#define KEY_HEADER 0xFFFE
+// Key read back from an erased phrase
+#define KEY_ERASED 0xFFFF
+
+#if (FLASHLOG_NB_KEYS >= RECORDS_PER_BANK)
+#error "A compacted log must fit in one bank with room to append"
+#endif
+
+/*!
+ * @brief One record of the log, programmed as a single phrase.
+ */
+typedef union
+{
+  uint64_t l;
+  struct
+  {
+    uint16_t key;     /*!< The key, KEY_HEADER for the sector header. */
+    uint16_t crc;     /*!< CRC-16 of the key and the value. */
+    uint32_t value;   /*!< The value. */
+  } s;
+} TLogRecord;
+
+// Latest value of every key, so reads never touch the Flash
+static uint32_t Index[FLASHLOG_NB_KEYS];
+
+// Bank being appended to
+static uint8_t Active;
+// Index of the next free phrase in the active bank
+static uint16_t Fill;
+// Sequence number of the active bank, incremented on every compaction
+static uint32_t Sequence;
+
+/*! @brief Gets the address of one of the log banks.
+ *
+ *  @param bank The bank number, NB_BANKS and up for the mirrored copies.
+ *  @return uint32_t - the address of the start of the bank.
+ */
+static uint32_t BankAddress(const uint8_t bank)
+{
+  uint32_t address = FLASH_DATA_START + ((bank % NB_BANKS) * SECTORS_PER_BANK * FLASH_SECTOR_SIZE);
+  if (bank >= NB_BANKS)
+    {
+      address -= FLASH_MIRROR_OFFSET;
+    }
+  return address;
+}
+
+/*! @brief Calculates the CRC of a record.
+ *
+ *  @param record The record.
+ *  @return uint16_t - the CRC of the key and the value.
+ */
+static uint16_t RecordCRC(const TLogRecord * const record)
+{
+  uint16_t crc = CRC_16(CRC_16_INIT, &record->s.key, sizeof(record->s.key));
+  return CRC_16(crc, &record->s.value, sizeof(record->s.value));
+}
+
+/*! @brief Checks that a record was completely programmed.
+ *
+ *  @param record The record read back from Flash.
+ *  @return bool - TRUE if the record holds a key and its CRC matches.
+ */
+static bool RecordValid(const TLogRecord * const record)
+{
+  return (record->s.key != KEY_ERASED) && (record->s.crc == RecordCRC(record));
+}
+
+/*! @brief Programs a record into the next free phrase of the active bank.
+ *
+ *  @param key The key of the record.
+ *  @param value The value of the record.
+ *  @return bool - TRUE if the record was programmed.
+ */
+static bool Append(const uint16_t key, const uint32_t value)
+{
+  TLogRecord record;
+
+  if (Fill >= RECORDS_PER_BANK)
+    {
+      return 0;
+    }
+
+  record.s.key = key;
+  record.s.value = value;
+  record.s.crc = RecordCRC(&record);
+
+  if (!Flash_ProgramPhrase(BankAddress(Active) + (Fill * sizeof(uint64_t)), record.l))
+    {
+      return 0;
+    }
+  Fill++;
+  return 1;
+}
+
+/*! @brief Moves the live values into the next bank, which becomes the active one.
+ *
+ *  The header is programmed last, so if power fails part way the old bank is still the newest valid one.
+ *  @return bool - TRUE if the compaction succeeded.
+ */
+static bool Compact(void)
+{
+  Active = (Active + 1) % NB_BANKS;
+  Fill = 1;
+
+  for (uint8_t sector = 0; sector < SECTORS_PER_BANK; sector++)
+    {
+      if (!Flash_EraseSector(BankAddress(Active) + (sector * FLASH_SECTOR_SIZE)))
+	{
+	  return 0;
+	}
+    }
+
+  for (uint16_t key = 0; key < FLASHLOG_NB_KEYS; key++)
+    {
+      if ((Index[key] != FLASHLOG_BLANK) && !Append(key, Index[key]))
+	{
+	  return 0;
+	}
+    }
+
+  TLogRecord header;
+  header.s.key = KEY_HEADER;
+  header.s.value = ++Sequence;
+  header.s.crc = RecordCRC(&header);
+
+  return Flash_ProgramPhrase(BankAddress(Active), header.l);
+}
+
+/*! @brief Rebuilds the RAM index from the log.
+ *
+ *  @return bool - TRUE if the store is ready for use.
+ *  @note Assumes Flash has been initialized.
+ */
+bool FlashLog_Init(void)
+{
+  bool found = 0;
+
+  for (uint16_t key = 0; key < FLASHLOG_NB_KEYS; key++)
+    {
+      Index[key] = FLASHLOG_BLANK;
+    }
+
+  // The newest valid header marks the active bank. After a block swap it is one of the mirrored copies.
+  for (uint8_t bank = 0; bank < NB_SCANNED_BANKS; bank++)
+    {
+      TLogRecord header;
+      header.l = _FP(BankAddress(bank));
+      if ((header.s.key == KEY_HEADER) && RecordValid(&header) && (!found || (header.s.value > Sequence)))
+	{
+	  found = 1;
+	  Active = bank;
+	  Sequence = header.s.value;
+	}
+    }
+
+  if (!found)
+    {
+      // Nothing usable, so start an empty log in the first bank
+      Active = NB_BANKS - 1;
+      Sequence = 0;
+      return Compact();
+    }
+
+  // Replay the records in order so later values replace earlier ones
+  Fill = 1;
+  for (uint16_t i = 1; i < RECORDS_PER_BANK; i++)
+    {
+      TLogRecord record;
+      record.l = _FP(BankAddress(Active) + (i * sizeof(uint64_t)));
+      if (record.l != UINT64_MAX)
+	{
+	  // A torn record is skipped, but its phrase can't be programmed again
+	  Fill = i + 1;
+	  if (RecordValid(&record) && (record.s.key < FLASHLOG_NB_KEYS))
+	    {
+	      Index[record.s.key] = record.s.value;
+	    }
+	}
+    }
+
+  if (Active >= NB_BANKS)
+    {
+      // Bring the values back into the data region
+      return Compact();
+    }
+  return 1;
+}
+
+/*! @brief Gets the current value of a key from the RAM index.
+ *
+ *  @param key The key to look up.
+ *  @return uint32_t - the value, or FLASHLOG_BLANK if the key is out of range or has never been written.
+ */
+uint32_t FlashLog_Get(const uint16_t key)
+{
+  if (key >= FLASHLOG_NB_KEYS)
+    {
+      return FLASHLOG_BLANK;
+    }
+  return Index[key];
+}
+
+/*! @brief Appends a new value for a key.
+ *
+ *  @param key The key to write.
+ *  @param value The new value.
+ *  @return bool - TRUE if the value was stored.
+ *  @note Assumes FlashLog_Init has been called.
+ */
+bool FlashLog_Put(const uint16_t key, const uint32_t value)
+{
+  if (key >= FLASHLOG_NB_KEYS)
+    {
+      return 0;
+    }
+  if (Index[key] == value)
+    {
+      return 1;
+    }
+  if ((Fill >= RECORDS_PER_BANK) && !Compact())
+    {
+      return 0;
+    }
+  if (!Append(key, value))
+    {
+      return 0;
+    }
+  Index[key] = value;
+  return 1;
+}
+
+/*! @brief Forgets every value in the store.
+ *
+ *  @return bool - TRUE if the store was cleared.
+ *  @note Assumes FlashLog_Init has been called.
+ */
+bool FlashLog_Clear(void)
+{
+  for (uint16_t key = 0; key < FLASHLOG_NB_KEYS; key++)
+    {
+      Index[key] = FLASHLOG_BLANK;
+    }
+  return Compact();
+}
+
+/* END FlashLog */
+/*!
+** @}
+*/
@@ -0,0 +1,61 @@
+/*! @file
+ *
+ *  @brief Log-structured key-value store in the Flash data sectors.
+ *
+ *  Values are appended as (key, CRC, value) records into erased phrases, so a write never erases.
+ *  The two halves of the data region are used in turn: when the active half fills up, the live values are
+ *  compacted into the other half, which is the only time sectors are erased.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef FLASHLOG_H
+#define FLASHLOG_H
+
+// new types
+#include "types.h"
+#include "Flash.h"
+
+// Number of keys in the store - one per 32-bit word of the non-volatile data area
+#define FLASHLOG_NB_KEYS (FLASH_DATA_SIZE / 4)
+
+// Value of a key that has never been written, matching erased Flash
+#define FLASHLOG_BLANK 0xFFFFFFFFLU
+
+/*! @brief Rebuilds the RAM index from the log.
+ *
+ *  Selects the half with the newest valid header, replays its records and finds the first free phrase.
+ *  The copy of the data region that a block swap leaves in block 0 is searched too, and migrated back if it is newer.
+ *  If no half holds a valid log, one is formatted.
+ *  @return bool - TRUE if the store is ready for use.
+ *  @note Assumes Flash has been initialized.
+ */
+bool FlashLog_Init(void);
+
+/*! @brief Gets the current value of a key from the RAM index.
+ *
+ *  @param key The key to look up.
+ *  @return uint32_t - the value, or FLASHLOG_BLANK if the key is out of range or has never been written.
+ */
+uint32_t FlashLog_Get(const uint16_t key);
+
+/*! @brief Appends a new value for a key.
+ *
+ *  Nothing is written if the value is unchanged. The active half is compacted first if it is full.
+ *  @param key The key to write.
+ *  @param value The new value.
+ *  @return bool - TRUE if the value was stored.
+ *  @note Assumes FlashLog_Init has been called.
+ */
+bool FlashLog_Put(const uint16_t key, const uint32_t value);
+
+/*! @brief Forgets every value in the store.
+ *
+ *  Starts a fresh, empty log in the other half.
+ *  @return bool - TRUE if the store was cleared.
+ *  @note Assumes FlashLog_Init has been called.
+ */
+bool FlashLog_Clear(void);
+
+#endif
@@ -0,0 +1,216 @@
+/*! @file
+ *  Loopback.c
+ *
+ *  @brief Low-latency loopback of analog inputs to the DAC outputs
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Loopback_module Loopback module documentation
+**  @{
+ */
+
+#include "Loopback.h"
+#include "Sampler.h"
+#include "MK70F12.h"
+#include "PE_Types.h"
+#include "CPU.h"
+
+// Largest DAC output
+#define DAC_MAX 0xFFF
+
+/*!
+ * @brief The pipeline of one output.
+ */
+typedef struct
+{
+  uint8_t channelNb;        /*!< The Sampler channel, or LOOPBACK_OFF. */
+  TLoopbackConfig config;   /*!< The gain, offset and filter. */
+  int32_t filter;           /*!< The filter output, as x·gain. */
+  bool primed;              /*!< FALSE until the filter has been started from a first sample. */
+} TOutput;
+
+static TOutput Outputs[LOOPBACK_NB_OUTPUTS];
+
+static TLoopbackStats Stats;
+// Sampler_RowsMissed when the statistics were last reset
+static uint32_t MissedBase;
+
+/*! @brief Writes a value to a DAC.
+ *
+ *  @param outputNb The DAC.
+ *  @param value The value, in DAC counts.
+ */
+static void Write(const uint8_t outputNb, const uint16_t value)
+{
+  // The data buffer is off, so the output follows the first data register as soon as the high byte is written
+  if (outputNb == 0)
+    {
+      DAC0_DAT0L = DAC_DATL_DATA(value);
+      DAC0_DAT0H = DAC_DATH_DATA(value >> 8);
+    }
+  else
+    {
+      DAC1_DAT0L = DAC_DATL_DATA(value);
+      DAC1_DAT0H = DAC_DATH_DATA(value >> 8);
+    }
+}
+
+/*! @brief Runs the pipelines on the samples of the row just finished.
+ *
+ *  @param arguments Unused.
+ *  @note Called from the Sampler's row interrupt.
+ */
+static void RowCallback(void *arguments)
+{
+  bool written = 0;
+
+  for (uint8_t outputNb = 0; outputNb < LOOPBACK_NB_OUTPUTS; outputNb++)
+    {
+      TOutput *output = &Outputs[outputNb];
+      int16_t sample;
+
+      if ((output->channelNb != LOOPBACK_OFF) && Sampler_RowSample(output->channelNb, &sample))
+	{
+	  int32_t input = sample;
+	  if (!output->primed)
+	    {
+	      // Start the filter at the first input, rather than ramping up from 0
+	      output->filter = input * output->config.gain;
+	      output->primed = 1;
+	    }
+	  Write(outputNb, Loopback_Transfer(&output->config, &output->filter, input));
+	  written = 1;
+	}
+    }
+
+  if (written)
+    {
+      uint32_t latency = Sampler_SampleAge();
+      Stats.totalLatency += latency;
+      Stats.count++;
+      if (latency < Stats.minLatency)
+	{
+	  Stats.minLatency = latency;
+	}
+      if (latency > Stats.maxLatency)
+	{
+	  Stats.maxLatency = latency;
+	}
+    }
+}
+
+/*! @brief Powers up the DACs with every output off, and hooks the pipeline into the Sampler.
+ *
+ *  @return bool - TRUE if the loopback was successfully initialized.
+ *  @note Assumes the Sampler has been initialized.
+ */
+bool Loopback_Init(void)
+{
+  SIM_SCGC2 |= SIM_SCGC2_DAC0_MASK | SIM_SCGC2_DAC1_MASK;
+
+  // Referenced to VDDA, with the data buffer off so writes go straight to the output
+  DAC0_C1 = 0;
+  DAC1_C1 = 0;
+  DAC0_C0 = DAC_C0_DACEN_MASK | DAC_C0_DACRFS_MASK;
+  DAC1_C0 = DAC_C0_DACEN_MASK | DAC_C0_DACRFS_MASK;
+
+  for (uint8_t outputNb = 0; outputNb < LOOPBACK_NB_OUTPUTS; outputNb++)
+    {
+      Outputs[outputNb].channelNb = LOOPBACK_OFF;
+      Write(outputNb, 0);
+    }
+
+  Loopback_ResetStats();
+  return Sampler_SetRowCallback(&RowCallback, (void *)0);
+}
+
+/*! @brief Sets which input an output follows, and how.
+ *
+ *  @param outputNb The DAC.
+ *  @param channelNb The Sampler channel, or LOOPBACK_OFF to stop driving the output.
+ *  @param config The gain, offset and filter.
+ *  @return bool - TRUE if the output was set.
+ */
+bool Loopback_Set(const uint8_t outputNb, const uint8_t channelNb, const TLoopbackConfig * const config)
+{
+  if ((outputNb >= LOOPBACK_NB_OUTPUTS) || ((channelNb != LOOPBACK_OFF) && (channelNb >= SAMPLER_NB_CHANNELS))
+      || ((channelNb != LOOPBACK_OFF) && (config->alpha > INT16_MAX)))
+    {
+      return 0;
+    }
+
+  // The row interrupt mustn't see half a setting
+  EnterCritical();
+  Outputs[outputNb].channelNb = channelNb;
+  if (channelNb != LOOPBACK_OFF)
+    {
+      Outputs[outputNb].config = *config;
+      Outputs[outputNb].primed = 0;
+    }
+  ExitCritical();
+  return 1;
+}
+
+/*! @brief Works out the next output of a pipeline from its input.
+ *
+ *  @param config The gain, offset and filter.
+ *  @param filter The filter state, updated.
+ *  @param input The input, in ADC counts.
+ *  @return uint16_t - the output, in DAC counts.
+ */
+uint16_t Loopback_Transfer(const TLoopbackConfig * const config, int32_t * const filter, const int32_t input)
+{
+  // At most 65535 x 32768, so it fits
+  int32_t value = input * config->gain;
+
+  if (config->alpha)
+    {
+      *filter += (int32_t) ((((int64_t) value - *filter) * config->alpha) >> 15);
+      value = *filter;
+    }
+
+  int32_t output = (value >> 16) + config->offset;
+  if (output < 0)
+    {
+      return 0;
+    }
+  if (output > DAC_MAX)
+    {
+      return DAC_MAX;
+    }
+  return (uint16_t) output;
+}
+
+/*! @brief Gets the latency statistics.
+ *
+ *  @param stats Set to the statistics.
+ *  @return bool - TRUE if a sample has been output since they were last reset.
+ */
+bool Loopback_GetStats(TLoopbackStats * const stats)
+{
+  EnterCritical();
+  *stats = Stats;
+  stats->missed = Sampler_RowsMissed() - MissedBase;
+  ExitCritical();
+  return (stats->count != 0);
+}
+
+/*! @brief Clears the latency statistics.
+ */
+void Loopback_ResetStats(void)
+{
+  EnterCritical();
+  Stats.totalLatency = 0;
+  Stats.count = 0;
+  Stats.minLatency = UINT32_MAX;
+  Stats.maxLatency = 0;
+  Stats.missed = 0;
+  MissedBase = Sampler_RowsMissed();
+  ExitCritical();
+}
+
+/* END Loopback */
+/*!
+** @}
+*/
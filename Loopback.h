@@ -0,0 +1,93 @@
+/*! @file
+ *
+ *  @brief Low-latency loopback of analog inputs to the DAC outputs.
+ *
+ *  Each of the two on-chip DACs can follow one Sampler channel through a gain, an offset and an optional
+ *  first-order low-pass filter. The pipeline runs in the Sampler's row interrupt, as soon as the conversions of a
+ *  sample time are in, so the output is always updated within the sample time it was taken in.
+ *  The latency from the start of the sample time to the DAC write is measured on every sample off the PDB counter.
+ *  All the arithmetic is integer, so an output can be predicted bit for bit from its input.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef LOOPBACK_H
+#define LOOPBACK_H
+
+// new types
+#include "types.h"
+
+// Number of outputs, DAC0 and DAC1
+#define LOOPBACK_NB_OUTPUTS 2
+
+// Input channel of an output which isn't looped back
+#define LOOPBACK_OFF 0xFF
+
+// Gain which maps the ADC's full scale onto the DAC's full scale
+#define LOOPBACK_UNITY_GAIN 4096
+
+/*!
+ * @brief How an output follows its input.
+ *
+ * The output is ((x·gain) filtered >> 16) + offset in DAC counts, clipped to the DAC's 12 bits,
+ * where x is the input in the two's complement counts the Sampler reads.
+ * The filter is y += ((x·gain - y)·alpha) >> 15, with alpha 0 meaning no filter.
+ */
+typedef struct
+{
+  int16_t gain;         /*!< Q12, so LOOPBACK_UNITY_GAIN is full scale to full scale. Negative inverts. */
+  int16_t offset;       /*!< Added to the output, in DAC counts. 2048 centres the input. */
+  uint16_t alpha;       /*!< The filter coefficient in Q15, from 1 (slowest) to 32767, or 0 for no filter. */
+} TLoopbackConfig;
+
+/*!
+ * @brief The latency from the start of a sample time to its DAC write.
+ */
+typedef struct
+{
+  uint64_t totalLatency;    /*!< The sum of the latencies, in ns, for the mean. */
+  uint32_t count;           /*!< The number of samples output. */
+  uint32_t minLatency;      /*!< The shortest latency, in ns. */
+  uint32_t maxLatency;      /*!< The longest latency, in ns. */
+  uint32_t missed;          /*!< The number of samples which were never output, because the last one took too long. */
+} TLoopbackStats;
+
+/*! @brief Powers up the DACs with every output off, and hooks the pipeline into the Sampler.
+ *
+ *  @return bool - TRUE if the loopback was successfully initialized.
+ *  @note Assumes the Sampler has been initialized.
+ */
+bool Loopback_Init(void);
+
+/*! @brief Sets which input an output follows, and how.
+ *
+ *  @param outputNb The DAC.
+ *  @param channelNb The Sampler channel, or LOOPBACK_OFF to stop driving the output.
+ *  @param config The gain, offset and filter. Ignored if channelNb is LOOPBACK_OFF.
+ *  @return bool - TRUE if the output was set.
+ *  @note The filter starts again from the next sample.
+ */
+bool Loopback_Set(const uint8_t outputNb, const uint8_t channelNb, const TLoopbackConfig* const config);
+
+/*! @brief Works out the next output of a pipeline from its input.
+ *
+ *  @param config The gain, offset and filter.
+ *  @param filter The filter state, updated.
+ *  @param input The input, in ADC counts.
+ *  @return uint16_t - the output, in DAC counts.
+ */
+uint16_t Loopback_Transfer(const TLoopbackConfig* const config, int32_t* const filter, const int32_t input);
+
+/*! @brief Gets the latency statistics.
+ *
+ *  @param stats Set to the statistics.
+ *  @return bool - TRUE if a sample has been output since they were last reset.
+ */
+bool Loopback_GetStats(TLoopbackStats* const stats);
+
+/*! @brief Clears the latency statistics.
+ */
+void Loopback_ResetStats(void);
+
+#endif
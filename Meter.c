@@ -0,0 +1,299 @@
+/*! @file
+ *  Meter.c
+ *
+ *  @brief Power and energy metering on the voltage and current channels
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Meter_module Meter module documentation
+**  @{
+ */
+
+#include "Meter.h"
+#include "Sampler.h"
+#include "Flash.h"
+#include "Event.h"
+#include "Time.h"
+
+// Sample pairs taken from the Sampler at a time
+#define CHUNK_SIZE 32
+
+// The voltage has to go this far negative before the next rising zero crossing counts, so noise can't add cycles
+#define CROSSING_HYSTERESIS 256
+
+// The energy total in Flash, low word first
+static volatile uint32_t *NvEnergy;
+
+static uint32_t SampleRate;
+// The Sampler count of the next sample pair
+static uint32_t Cursor;
+
+// Running sums of the current window
+static uint64_t SumV2;
+static uint64_t SumI2;
+static int64_t SumP;
+static uint32_t NbSamples;
+
+// Zero crossing tracking of the current window
+static bool Armed;
+static bool Crossed;
+static uint32_t FirstCrossing;
+static uint32_t LastCrossing;
+static uint16_t Cycles;
+
+// The energy total, and the part of a count² second not yet added to it, in counts² samples
+static int64_t Energy;
+static int64_t EnergyRemainder;
+// Sample pairs since the energy was last saved
+static uint32_t SinceSave;
+
+static TMeterResult Result;
+
+/*! @brief Works out an integer square root.
+ *
+ *  @param x The value.
+ *  @return uint16_t - the square root of x, rounded down.
+ */
+static uint16_t Sqrt(const uint32_t x)
+{
+  uint32_t remainder = x;
+  uint32_t root = 0;
+  uint32_t bit = 1LU << 30;
+
+  while (bit > remainder)
+    {
+      bit >>= 2;
+    }
+  while (bit)
+    {
+      if (remainder >= root + bit)
+	{
+	  remainder -= root + bit;
+	  root = (root >> 1) + bit;
+	}
+      else
+	{
+	  root >>= 1;
+	}
+      bit >>= 2;
+    }
+  return (uint16_t) root;
+}
+
+/*! @brief Writes the energy total to Flash, and asks for it to be committed.
+ *
+ *  @return bool - TRUE if the write was queued.
+ */
+static bool Save(void)
+{
+  SinceSave = 0;
+  if (!Flash_Write32(&NvEnergy[0], (uint32_t) Energy) || !Flash_Write32(&NvEnergy[1], (uint32_t) ((uint64_t) Energy >> 32)))
+    {
+      return 0;
+    }
+  Event_Set(EVENT_COMMIT);
+  return 1;
+}
+
+/*! @brief Works out the measurements of the current window from its sums, and starts the next one.
+ *
+ *  @param crossing TRUE if the window is closed by a zero crossing, which then starts the next window.
+ */
+static void Close(const bool crossing)
+{
+  uint32_t n = NbSamples;
+
+  Result.vrms = Sqrt((uint32_t) (SumV2 / n));
+  Result.irms = Sqrt((uint32_t) (SumI2 / n));
+  Result.realPower = (int32_t) (SumP / (int32_t) n);
+  Result.apparentPower = (uint32_t) Result.vrms * Result.irms;
+
+  int32_t powerFactor = 0;
+  if (Result.apparentPower)
+    {
+      powerFactor = (int32_t) (((int64_t) Result.realPower << 15) / Result.apparentPower);
+      // Rounding can put |P| a little over S
+      if (powerFactor > INT16_MAX)
+	{
+	  powerFactor = INT16_MAX;
+	}
+      else if (powerFactor < -INT16_MAX)
+	{
+	  powerFactor = -INT16_MAX;
+	}
+    }
+  Result.powerFactor = (int16_t) powerFactor;
+
+  Result.frequency = 0;
+  if (Cycles && (LastCrossing > FirstCrossing))
+    {
+      Result.frequency = (uint16_t) (((uint64_t) Cycles * SampleRate * 100) / (LastCrossing - FirstCrossing));
+    }
+
+  // Carry the fraction of a second over, so no energy is lost to rounding
+  int64_t energy = SumP + EnergyRemainder;
+  Energy += energy / (int32_t) SampleRate;
+  EnergyRemainder = energy % (int32_t) SampleRate;
+
+  Result.energy = Energy;
+  Result.nbSamples = n;
+  Result.timestamp = Time_Now();
+  Result.sequence++;
+
+  SinceSave += n;
+  if (SinceSave >= METER_SAVE_INTERVAL * SampleRate)
+    {
+      (void) Save();
+    }
+
+  SumV2 = 0;
+  SumI2 = 0;
+  SumP = 0;
+  NbSamples = 0;
+  Cycles = 0;
+  // The crossing that closed this window is where the next one's cycles start
+  Crossed = crossing;
+  FirstCrossing = 0;
+  LastCrossing = 0;
+}
+
+/*! @brief Loads the energy total from Flash and starts metering at the newest sample.
+ *
+ *  @param sampleRate The rate the Sampler takes samples at, in Hz.
+ *  @return bool - TRUE if the meter was successfully initialized.
+ *  @note Assumes Flash and the Sampler have been initialized.
+ */
+bool Meter_Init(const uint32_t sampleRate)
+{
+  if ((sampleRate == 0) || !Flash_AllocateVar((volatile void **) &NvEnergy, 2 * sizeof(uint32_t)))
+    {
+      return 0;
+    }
+
+  Energy = 0;
+  // Erased Flash means the energy was never saved
+  if ((NvEnergy[0] != 0xFFFFFFFFLU) || (NvEnergy[1] != 0xFFFFFFFFLU))
+    {
+      Energy = (int64_t) (((uint64_t) NvEnergy[1] << 32) | NvEnergy[0]);
+    }
+  EnergyRemainder = 0;
+  SinceSave = 0;
+
+  SampleRate = sampleRate;
+  Cursor = Sampler_Count();
+  SumV2 = 0;
+  SumI2 = 0;
+  SumP = 0;
+  NbSamples = 0;
+  Armed = 0;
+  Crossed = 0;
+  Cycles = 0;
+  Result.sequence = 0;
+  return 1;
+}
+
+/*! @brief Consumes the samples taken since the last call.
+ *
+ *  @return bool - TRUE if a window closed, so there is a new result.
+ *  @note Assumes Meter_Init has been called.
+ */
+bool Meter_Update(void)
+{
+  int16_t voltage[CHUNK_SIZE];
+  int16_t current[CHUNK_SIZE];
+  bool closed = 0;
+
+  for (;;)
+    {
+      // Read the two channels from the same start, so the samples of each pair were taken together
+      uint32_t cursor = Cursor;
+      uint16_t nbSamples = Sampler_Read(METER_VOLTAGE_CHANNEL, &cursor, voltage, CHUNK_SIZE);
+      uint32_t start = cursor - nbSamples;
+      cursor = start;
+      nbSamples = Sampler_Read(METER_CURRENT_CHANNEL, &cursor, current, nbSamples);
+      if (nbSamples == 0)
+	{
+	  break;
+	}
+      if (cursor - nbSamples != start)
+	{
+	  // The ring wrapped between the two reads, so read both again from the oldest sample left
+	  Cursor = cursor - nbSamples;
+	  continue;
+	}
+      Cursor = cursor;
+
+      for (uint16_t i = 0; i < nbSamples; i++)
+	{
+	  int32_t v = voltage[i];
+	  int32_t c = current[i];
+
+	  if (v < -CROSSING_HYSTERESIS)
+	    {
+	      Armed = 1;
+	    }
+	  else if (Armed && (v >= 0))
+	    {
+	      // A rising zero crossing: the window closes on one once it is long enough, so it holds whole cycles
+	      Armed = 0;
+	      if (Crossed)
+		{
+		  Cycles++;
+		  LastCrossing = NbSamples;
+		}
+	      else
+		{
+		  Crossed = 1;
+		  FirstCrossing = NbSamples;
+		}
+	      if (NbSamples >= SampleRate)
+		{
+		  Close(1);
+		  closed = 1;
+		}
+	    }
+
+	  SumV2 += (uint32_t) (v * v);
+	  SumI2 += (uint32_t) (c * c);
+	  SumP += v * c;
+	  NbSamples++;
+
+	  if (NbSamples >= METER_MAX_WINDOW * SampleRate)
+	    {
+	      Close(0);
+	      closed = 1;
+	    }
+	}
+    }
+  return closed;
+}
+
+/*! @brief Gets the measurements of the last window closed.
+ *
+ *  @param result Set to the measurements.
+ *  @return bool - TRUE if a window has closed since Meter_Init.
+ */
+bool Meter_Get(TMeterResult * const result)
+{
+  *result = Result;
+  return (Result.sequence != 0);
+}
+
+/*! @brief Sets the energy total back to zero, in Flash too.
+ *
+ *  @return bool - TRUE if the energy was cleared.
+ *  @note Assumes Meter_Init has been called.
+ */
+bool Meter_ClearEnergy(void)
+{
+  Energy = 0;
+  EnergyRemainder = 0;
+  Result.energy = 0;
+  return Save();
+}
+
+/* END Meter */
+/*!
+** @}
+*/
@@ -0,0 +1,79 @@
+/*! @file
+ *
+ *  @brief Power and energy metering on the voltage and current channels.
+ *
+ *  Every voltage and current sample pair is read from the Sampler once, and folded into running sums of
+ *  v², i² and v·i. A measurement window closes on the first rising voltage zero crossing after a second of
+ *  samples, so it always spans whole line cycles; without a crossing it closes after METER_MAX_WINDOW seconds.
+ *  Only then are the RMS values, powers and power factor worked out from the sums.
+ *  All values are in ADC counts: volts and amps are left to the PC, which knows the front end scaling.
+ *  The energy total is saved to Flash every METER_SAVE_INTERVAL seconds, so a reset loses at most that much.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef METER_H
+#define METER_H
+
+// new types
+#include "types.h"
+
+// Sampler channels of the meter inputs
+#define METER_VOLTAGE_CHANNEL 0
+#define METER_CURRENT_CHANNEL 1
+
+// Longest window in seconds, used when the voltage has no zero crossings
+#define METER_MAX_WINDOW 2
+
+// Seconds between saves of the energy total
+#define METER_SAVE_INTERVAL 300
+
+/*!
+ * @brief The measurements of one window.
+ */
+typedef struct
+{
+  int64_t energy;           /*!< The energy since it was last cleared, in counts² seconds. Negative when exporting. */
+  uint64_t timestamp;       /*!< Time_Now when the window closed. */
+  int32_t realPower;        /*!< The mean of v·i, in counts². */
+  uint32_t apparentPower;   /*!< Vrms·Irms, in counts². */
+  uint32_t nbSamples;       /*!< The number of sample pairs in the window. */
+  uint32_t sequence;        /*!< The number of windows closed since Meter_Init, so a repeated result can be told apart. */
+  uint16_t vrms;            /*!< The RMS voltage, in counts. */
+  uint16_t irms;            /*!< The RMS current, in counts. */
+  int16_t powerFactor;      /*!< Real over apparent power, in Q15. */
+  uint16_t frequency;       /*!< The line frequency in hundredths of a Hz, or 0 if it couldn't be measured. */
+} TMeterResult;
+
+/*! @brief Loads the energy total from Flash and starts metering at the newest sample.
+ *
+ *  @param sampleRate The rate the Sampler takes samples at, in Hz.
+ *  @return bool - TRUE if the meter was successfully initialized.
+ *  @note Assumes Flash and the Sampler have been initialized.
+ */
+bool Meter_Init(const uint32_t sampleRate);
+
+/*! @brief Consumes the samples taken since the last call.
+ *
+ *  Must be called at least once per Sampler ring, or samples are lost.
+ *  @return bool - TRUE if a window closed, so there is a new result.
+ *  @note Assumes Meter_Init has been called.
+ */
+bool Meter_Update(void);
+
+/*! @brief Gets the measurements of the last window closed.
+ *
+ *  @param result Set to the measurements.
+ *  @return bool - TRUE if a window has closed since Meter_Init.
+ */
+bool Meter_Get(TMeterResult* const result);
+
+/*! @brief Sets the energy total back to zero, in Flash too.
+ *
+ *  @return bool - TRUE if the energy was cleared.
+ *  @note Assumes Meter_Init has been called.
+ */
+bool Meter_ClearEnergy(void);
+
+#endif
@@ -0,0 +1,542 @@
+/*! @file
+ *  OS.c
+ *
+ *  @brief A small preemptive kernel with prioritized threads and counting semaphores
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup OS_module OS module documentation
+**  @{
+ */
+
+#include "OS.h"
+#include "MK70F12.h"
+#include "PE_Types.h"
+#include "CPU.h"
+
+// Interrupt priority of PendSV and SysTick, the lowest the NVIC implements
+#define LOWEST_PRIORITY 0xF0
+
+// Words of stack for the idle thread, enough for the exception frames and the idle hook
+#define IDLE_STACK_SIZE 128
+
+// Words saved by the PendSV handler: R4-R11 and EXC_RETURN, then S16-S31 if the thread uses the FPU
+#define SOFTWARE_FRAME_SIZE 9
+#define FPU_FRAME_SIZE 16
+
+// EXC_RETURN to thread mode on the process stack, with no FPU state
+#define EXC_RETURN_THREAD_PSP 0xFFFFFFFDu
+// xPSR of a new thread, with only the Thumb bit set
+#define INITIAL_XPSR 0x01000000u
+
+// The bit of a priority in the ready and waiting bitmaps, the highest priority in the most significant bit
+// so that count leading zeros gives the highest priority set
+#define PRIORITY_BIT(priority) (0x80000000u >> (priority))
+
+/*!
+ * @brief The state of a thread while it isn't running.
+ */
+typedef struct
+{
+  uint32_t *sp;           /*!< The stack pointer, below the registers saved by the PendSV handler. */
+  OS_ECB *semaphore;      /*!< The semaphore the thread is waiting on, or NULL. */
+  uint32_t delay;         /*!< The ticks left of the thread's delay or timeout. */
+  OS_ERROR result;        /*!< What the thread's wait ended with. */
+} TTCB;
+
+/*!
+ * @brief A counting semaphore.
+ */
+struct OS_ECB
+{
+  uint32_t count;         /*!< The number of signals not yet taken. */
+  uint32_t waiting;       /*!< A bit for each thread waiting, by priority. */
+};
+
+// One thread per priority, so a thread is found by its priority
+static TTCB Threads[OS_NB_PRIORITIES];
+// The threads that exist, that can run, and whose delay is counting down
+static uint32_t Created;
+static uint32_t Ready;
+static uint32_t Delayed;
+
+static OS_ECB Semaphores[OS_NB_SEMAPHORES];
+static uint8_t NbSemaphores;
+
+// The running thread, NULL until the first switch
+static TTCB *Current;
+// Set once OS_Start has handed over to the threads
+static bool Started;
+// Depth of the interrupts between OS_ISREnter and OS_ISRExit
+static uint8_t ISRNesting;
+
+static volatile uint32_t Ticks;
+
+OS_THREAD_STACK(IdleStack, IDLE_STACK_SIZE);
+
+#if defined(__arm__)
+// Takes main's registers on the first switch, as main is never switched back to
+// (one word over, so its top stays 8-byte aligned)
+OS_THREAD_STACK(StartStack, SOFTWARE_FRAME_SIZE + FPU_FRAME_SIZE + 1);
+
+/*! @brief Checks whether the processor is handling an exception.
+ *
+ *  @return bool - TRUE if called from an interrupt.
+ */
+static inline bool InISR(void)
+{
+  uint32_t ipsr;
+
+  __asm volatile ("mrs %0, ipsr" : "=r" (ipsr));
+  return (ipsr != 0);
+}
+#else
+// The host port (test/host/OSPort.c) includes this file, and stands in for the parts in assembly:
+// InISR, OS_Start and the PendSV handler
+static bool InISR(void);
+#endif
+
+/*! @brief Requests a switch if the highest priority ready thread isn't the one running.
+ *
+ *  @note Assumes interrupts are disabled. The switch happens once they are enabled again and every interrupt has returned.
+ */
+static void Schedule(void)
+{
+  // The idle thread is always ready, so Ready is never 0
+  if (Started && (ISRNesting == 0) && (&Threads[__builtin_clz(Ready)] != Current))
+    {
+      SCB_ICSR = SCB_ICSR_PENDSVSET_MASK;
+    }
+}
+
+/*! @brief Ends a thread's wait, making it ready.
+ *
+ *  @param priority The thread.
+ *  @param result What the wait ended with.
+ *  @note Assumes interrupts are disabled.
+ */
+static void Wake(const uint8_t priority, const OS_ERROR result)
+{
+  TTCB *tcb = &Threads[priority];
+
+  if (tcb->semaphore)
+    {
+      tcb->semaphore->waiting &= ~PRIORITY_BIT(priority);
+      tcb->semaphore = NULL;
+    }
+  Delayed &= ~PRIORITY_BIT(priority);
+  tcb->result = result;
+  Ready |= PRIORITY_BIT(priority);
+}
+
+/*! @brief Takes the running thread off the ready list until a semaphore is signalled or a number of ticks have passed.
+ *
+ *  @param semaphore The semaphore to wait on, or NULL.
+ *  @param ticks The ticks to wait, or 0 to wait for ever.
+ *  @return TTCB* - the running thread, whose result is set once it runs again.
+ *  @note Assumes interrupts are disabled. The thread is switched out once they are enabled again.
+ */
+static TTCB *Block(OS_ECB * const semaphore, const uint32_t ticks)
+{
+  TTCB *tcb = Current;
+  uint8_t priority = tcb - Threads;
+
+  Ready &= ~PRIORITY_BIT(priority);
+  tcb->semaphore = semaphore;
+  if (semaphore)
+    {
+      semaphore->waiting |= PRIORITY_BIT(priority);
+    }
+  tcb->delay = ticks;
+  if (ticks)
+    {
+      Delayed |= PRIORITY_BIT(priority);
+    }
+  tcb->result = OS_NO_ERROR;
+  Schedule();
+  return tcb;
+}
+
+/*! @brief Saves the stack pointer of the thread being switched out, and picks the one to switch in.
+ *
+ *  @param sp The stack pointer of the running thread, below its saved registers.
+ *  @return uint32_t* - the stack pointer of the highest priority ready thread.
+ *  @note Called from the PendSV handler with interrupts disabled.
+ */
+static uint32_t * __attribute__ ((used, noinline)) Switch(uint32_t * const sp)
+{
+  if (Current)
+    {
+      Current->sp = sp;
+    }
+  Current = &Threads[__builtin_clz(Ready)];
+  return Current->sp;
+}
+
+/*! @brief Deletes a thread which has returned from its function.
+ */
+static void ThreadExit(void)
+{
+  (void) OS_ThreadDelete(OS_PRIORITY_SELF);
+}
+
+/*! @brief Sleeps whenever no other thread is ready.
+ *
+ *  @param pData Unused.
+ */
+static void IdleThread(void *pData)
+{
+  for (;;)
+    {
+      // With interrupts masked, an interrupt that comes in during the hook still ends a WFI in it
+      __DI();
+      OS_IdleHook();
+      __EI();
+    }
+}
+
+/*! @brief Lays out a new thread's stack as if it had been switched out, and makes it ready.
+ *
+ *  @param thread The thread's function.
+ *  @param pData The argument to pass to the thread's function.
+ *  @param pStack The last word of the thread's stack.
+ *  @param priority The thread's priority.
+ *  @return OS_ERROR - OS_NO_ERROR if the thread was created.
+ */
+static OS_ERROR Create(void (*thread)(void*), void * const pData, void * const pStack, const uint8_t priority)
+{
+  // Exception entry keeps the stack 8-byte aligned
+  uint32_t *sp = (uint32_t *) (((uint32_t) pStack + sizeof(uint32_t)) & ~7u);
+
+  EnterCritical();
+  if (Created & PRIORITY_BIT(priority))
+    {
+      ExitCritical();
+      return OS_PRIORITY_EXISTS;
+    }
+
+  // The frame the hardware unstacks: xPSR, PC, LR, R12, R3-R0
+  *--sp = INITIAL_XPSR;
+  *--sp = (uint32_t) thread & ~1u;
+  *--sp = (uint32_t) &ThreadExit;
+  for (uint8_t i = 0; i < 4; i++)
+    {
+      *--sp = 0;
+    }
+  *--sp = (uint32_t) pData;
+  // The frame the PendSV handler unstacks: EXC_RETURN, R11-R4
+  *--sp = EXC_RETURN_THREAD_PSP;
+  for (uint8_t i = 0; i < 8; i++)
+    {
+      *--sp = 0;
+    }
+
+  Threads[priority].sp = sp;
+  Threads[priority].semaphore = NULL;
+  Threads[priority].delay = 0;
+  Created |= PRIORITY_BIT(priority);
+  Ready |= PRIORITY_BIT(priority);
+  Schedule();
+  ExitCritical();
+  return OS_NO_ERROR;
+}
+
+/*! @brief Sets up the kernel, and creates the idle thread.
+ *
+ *  @param cpuCoreClkHz The frequency of the core clock.
+ *  @param useSysTick TRUE to run the tick.
+ *  @return OS_ERROR - OS_NO_ERROR if the kernel was successfully initialized.
+ */
+OS_ERROR OS_Init(const uint32_t cpuCoreClkHz, const bool useSysTick)
+{
+  Created = 0;
+  Ready = 0;
+  Delayed = 0;
+  NbSemaphores = 0;
+  Current = NULL;
+  Started = 0;
+  ISRNesting = 0;
+  Ticks = 0;
+
+  // PendSV only runs once every other interrupt has returned
+  SCB_SHPR3 = (SCB_SHPR3 & ~(SCB_SHPR3_PRI_14_MASK | SCB_SHPR3_PRI_15_MASK))
+      | SCB_SHPR3_PRI_14(LOWEST_PRIORITY) | SCB_SHPR3_PRI_15(LOWEST_PRIORITY);
+
+  if (useSysTick)
+    {
+      SYST_CSR = 0;
+      SYST_RVR = SysTick_RVR_RELOAD((cpuCoreClkHz / OS_TICKS_PER_SECOND) - 1);
+      SYST_CVR = 0;
+      SYST_CSR = SysTick_CSR_CLKSOURCE_MASK | SysTick_CSR_TICKINT_MASK | SysTick_CSR_ENABLE_MASK;
+    }
+
+  return Create(&IdleThread, NULL, &IdleStack[IDLE_STACK_SIZE - 1], OS_PRIORITY_IDLE);
+}
+
+/*! @brief Creates a thread, ready to run.
+ *
+ *  @param thread The thread's function.
+ *  @param pData The argument to pass to the thread's function.
+ *  @param pStack The last word of the thread's stack.
+ *  @param priority The thread's priority.
+ *  @return OS_ERROR - OS_NO_ERROR if the thread was created.
+ */
+OS_ERROR OS_ThreadCreate(void (*thread)(void*), void * const pData, void * const pStack, const uint8_t priority)
+{
+  if (priority >= OS_PRIORITY_IDLE)
+    {
+      return OS_PRIORITY_INVALID;
+    }
+  if (!thread || !pStack)
+    {
+      return OS_ERROR_PARAMETER;
+    }
+  return Create(thread, pData, pStack, priority);
+}
+
+/*! @brief Deletes a thread.
+ *
+ *  @param priority The thread's priority, or OS_PRIORITY_SELF for the calling thread.
+ *  @return OS_ERROR - OS_NO_ERROR if the thread was deleted.
+ */
+OS_ERROR OS_ThreadDelete(const uint8_t priority)
+{
+  uint8_t target = priority;
+
+  EnterCritical();
+  if ((target == OS_PRIORITY_SELF) && Current && !InISR())
+    {
+      target = Current - Threads;
+    }
+  if ((target >= OS_PRIORITY_IDLE) || !(Created & PRIORITY_BIT(target)))
+    {
+      ExitCritical();
+      return OS_PRIORITY_INVALID;
+    }
+
+  if (Threads[target].semaphore)
+    {
+      Threads[target].semaphore->waiting &= ~PRIORITY_BIT(target);
+      Threads[target].semaphore = NULL;
+    }
+  Created &= ~PRIORITY_BIT(target);
+  Ready &= ~PRIORITY_BIT(target);
+  Delayed &= ~PRIORITY_BIT(target);
+  Schedule();
+  // A thread deleting itself is switched out here for good
+  ExitCritical();
+  return OS_NO_ERROR;
+}
+
+#if defined(__arm__)
+/*! @brief Starts running the highest priority thread, with interrupts enabled.
+ */
+void OS_Start(void)
+{
+  __DI();
+  // The first switch saves main's registers here, then forgets them
+  __asm volatile ("msr psp, %0" : : "r" (&StartStack[SOFTWARE_FRAME_SIZE + FPU_FRAME_SIZE + 1]));
+  Current = NULL;
+  Started = 1;
+  SCB_ICSR = SCB_ICSR_PENDSVSET_MASK;
+  __EI();
+
+  for (;;)
+    ;
+}
+#endif
+
+/*! @brief Creates a semaphore.
+ *
+ *  @param count The initial count.
+ *  @return OS_ECB* - the semaphore, or NULL if all OS_NB_SEMAPHORES have been created.
+ */
+OS_ECB *OS_SemaphoreCreate(const uint32_t count)
+{
+  OS_ECB *semaphore = NULL;
+
+  EnterCritical();
+  if (NbSemaphores < OS_NB_SEMAPHORES)
+    {
+      semaphore = &Semaphores[NbSemaphores++];
+      semaphore->count = count;
+      semaphore->waiting = 0;
+    }
+  ExitCritical();
+  return semaphore;
+}
+
+/*! @brief Takes one from a semaphore's count, waiting for it to be signalled if the count is 0.
+ *
+ *  @param semaphore The semaphore.
+ *  @param timeout The most ticks to wait, or 0 to wait for ever.
+ *  @return OS_ERROR - OS_NO_ERROR if the count was taken, OS_TIMEOUT if the timeout ran out first.
+ */
+OS_ERROR OS_SemaphoreWait(OS_ECB * const semaphore, const uint32_t timeout)
+{
+  if (!semaphore)
+    {
+      return OS_ERROR_PARAMETER;
+    }
+
+  EnterCritical();
+  if (semaphore->count > 0)
+    {
+      semaphore->count--;
+      ExitCritical();
+      return OS_NO_ERROR;
+    }
+  if (!Current || InISR())
+    {
+      ExitCritical();
+      return OS_ERROR_CONTEXT;
+    }
+
+  TTCB *tcb = Block(semaphore, timeout);
+  // Switched out here until the semaphore is signalled or the timeout runs out
+  ExitCritical();
+  return tcb->result;
+}
+
+/*! @brief Signals a semaphore, which wakes the highest priority thread waiting on it or else adds one to its count.
+ *
+ *  @param semaphore The semaphore.
+ *  @return OS_ERROR - OS_NO_ERROR if the semaphore was signalled.
+ */
+OS_ERROR OS_SemaphoreSignal(OS_ECB * const semaphore)
+{
+  OS_ERROR error = OS_NO_ERROR;
+
+  if (!semaphore)
+    {
+      return OS_ERROR_PARAMETER;
+    }
+
+  EnterCritical();
+  if (semaphore->waiting)
+    {
+      // The signal goes straight to the waiting thread, so the count stays at 0
+      Wake(__builtin_clz(semaphore->waiting), OS_NO_ERROR);
+      Schedule();
+    }
+  else if (semaphore->count == UINT32_MAX)
+    {
+      error = OS_SEMAPHORE_OVERFLOW;
+    }
+  else
+    {
+      semaphore->count++;
+    }
+  ExitCritical();
+  return error;
+}
+
+/*! @brief Suspends the calling thread.
+ *
+ *  @param ticks The number of ticks to wait.
+ *  @return OS_ERROR - OS_NO_ERROR once the time is up.
+ */
+OS_ERROR OS_TimeDelay(const uint32_t ticks)
+{
+  EnterCritical();
+  if (!Current || InISR())
+    {
+      ExitCritical();
+      return OS_ERROR_CONTEXT;
+    }
+
+  TTCB *tcb = Block(NULL, ticks ? ticks : 1);
+  ExitCritical();
+  return tcb->result;
+}
+
+/*! @brief Gets the number of ticks since OS_Start.
+ *
+ *  @return uint32_t - the current tick.
+ */
+uint32_t OS_TimeGet(void)
+{
+  return Ticks;
+}
+
+/*! @brief Marks the start of an interrupt that calls the kernel.
+ */
+void OS_ISREnter(void)
+{
+  EnterCritical();
+  ISRNesting++;
+  ExitCritical();
+}
+
+/*! @brief Marks the end of an interrupt that calls the kernel, switching threads if it has made a higher priority one ready.
+ */
+void OS_ISRExit(void)
+{
+  EnterCritical();
+  if (--ISRNesting == 0)
+    {
+      Schedule();
+    }
+  ExitCritical();
+}
+
+/*! @brief Interrupt service routine for the SysTick timer.
+ *
+ *  Counts the tick, and wakes the threads whose delay or timeout has run out.
+ */
+void __attribute__ ((interrupt)) OS_SysTick_ISR(void)
+{
+  OS_ISREnter();
+  EnterCritical();
+  Ticks++;
+
+  uint32_t delayed = Delayed;
+  while (delayed)
+    {
+      uint8_t priority = __builtin_clz(delayed);
+      delayed &= ~PRIORITY_BIT(priority);
+      if (--Threads[priority].delay == 0)
+	{
+	  Wake(priority, Threads[priority].semaphore ? OS_TIMEOUT : OS_NO_ERROR);
+	}
+    }
+  ExitCritical();
+  OS_ISRExit();
+}
+
+#if defined(__arm__)
+/*! @brief Interrupt service routine for PendSV, which switches to the highest priority ready thread.
+ *
+ *  The hardware has already stacked R0-R3, R12, LR, PC and xPSR (and S0-S15 and FPSCR, lazily) on the thread's stack.
+ *  The rest of its registers go on top, and the new thread's come off its own stack the same way.
+ */
+void __attribute__ ((naked)) OS_PendSV_ISR(void)
+{
+  __asm volatile (
+    "  cpsid i                 \n"  // the bitmaps are shared with the interrupts
+    "  mrs r0, psp             \n"
+#ifdef __ARM_FP
+    "  tst lr, #0x10           \n"  // EXC_RETURN bit 4 is clear if the thread has used the FPU
+    "  it eq                   \n"
+    "  vstmdbeq r0!, {s16-s31} \n"
+#endif
+    "  stmdb r0!, {r4-r11, lr} \n"
+    "  bl Switch               \n"
+    "  ldmia r0!, {r4-r11, lr} \n"
+#ifdef __ARM_FP
+    "  tst lr, #0x10           \n"
+    "  it eq                   \n"
+    "  vldmiaeq r0!, {s16-s31} \n"
+#endif
+    "  msr psp, r0             \n"
+    "  cpsie i                 \n"
+    "  bx lr                   \n"
+  );
+}
+#endif
+
+/* END OS */
+/*!
+** @}
+*/
@@ -0,0 +1,159 @@
+/*! @file
+ *
+ *  @brief A small preemptive kernel with prioritized threads and counting semaphores.
+ *
+ *  Every thread has its own priority, from 0 (the highest) to OS_NB_PRIORITIES - 2; the lowest is the kernel's idle thread.
+ *  The highest priority ready thread always runs. The threads ready to run are kept as a bitmap, so the next thread
+ *  is found with a single count leading zeros, and a semaphore keeps the threads waiting on it the same way.
+ *  The context switch is done in PendSV, at the lowest interrupt priority, so it never holds off an interrupt
+ *  and happens once the last nested interrupt returns. The FPU registers are only saved for threads that use them.
+ *  Interrupts signal threads with OS_SemaphoreSignal. They may not wait.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef OS_H
+#define OS_H
+
+// new types
+#include "types.h"
+
+// Number of thread priorities, including the idle thread's
+#define OS_NB_PRIORITIES 32
+
+// Priority of the idle thread, below every other thread
+#define OS_PRIORITY_IDLE (OS_NB_PRIORITIES - 1)
+
+// Priority meaning the calling thread
+#define OS_PRIORITY_SELF 0xFF
+
+// Number of semaphores OS_SemaphoreCreate can hand out
+#define OS_NB_SEMAPHORES 32
+
+// Number of SysTick ticks per second, the unit of timeouts and delays
+#define OS_TICKS_PER_SECOND 1000
+
+// Declares a thread stack, aligned as the Cortex-M4 procedure call standard requires
+#define OS_THREAD_STACK(stack, size) static uint32_t stack[(size)] __attribute__ ((aligned(0x08)))
+
+/*!
+ * @brief The result of a kernel call.
+ */
+typedef enum
+{
+  OS_NO_ERROR,              /*!< The call succeeded. */
+  OS_PRIORITY_EXISTS,       /*!< A thread already has the priority. */
+  OS_PRIORITY_INVALID,      /*!< The priority is out of range, or no thread has it. */
+  OS_TIMEOUT,               /*!< The semaphore wasn't signalled in time. */
+  OS_SEMAPHORE_OVERFLOW,    /*!< The semaphore's count is already at its maximum. */
+  OS_ERROR_CONTEXT,         /*!< The call would block, and wasn't made from a thread. */
+  OS_ERROR_PARAMETER        /*!< A pointer was NULL. */
+} OS_ERROR;
+
+/*!
+ * @brief A semaphore, handed out by OS_SemaphoreCreate.
+ */
+typedef struct OS_ECB OS_ECB;
+
+/*! @brief Sets up the kernel, and creates the idle thread.
+ *
+ *  @param cpuCoreClkHz The frequency of the core clock, which SysTick counts.
+ *  @param useSysTick TRUE to run the OS_TICKS_PER_SECOND tick that timeouts and delays need.
+ *  @return OS_ERROR - OS_NO_ERROR if the kernel was successfully initialized.
+ *  @note Call before any other kernel function, with interrupts disabled.
+ */
+OS_ERROR OS_Init(const uint32_t cpuCoreClkHz, const bool useSysTick);
+
+/*! @brief Creates a thread, ready to run.
+ *
+ *  If it has a higher priority than the calling thread, it runs straight away.
+ *  A thread which returns is deleted.
+ *  @param thread The thread's function.
+ *  @param pData The argument to pass to the thread's function.
+ *  @param pStack The last word of the thread's stack, which grows down from there.
+ *  @param priority The thread's priority, which no other thread may have.
+ *  @return OS_ERROR - OS_NO_ERROR if the thread was created.
+ */
+OS_ERROR OS_ThreadCreate(void (*thread)(void*), void* const pData, void* const pStack, const uint8_t priority);
+
+/*! @brief Deletes a thread.
+ *
+ *  @param priority The thread's priority, or OS_PRIORITY_SELF for the calling thread.
+ *  @return OS_ERROR - OS_NO_ERROR if the thread was deleted. Does not return when a thread deletes itself.
+ *  @note A thread waiting on a semaphore is taken off it.
+ */
+OS_ERROR OS_ThreadDelete(const uint8_t priority);
+
+/*! @brief Starts running the highest priority thread, with interrupts enabled.
+ *
+ *  @note Does not return. Assumes at least one thread has been created.
+ */
+void OS_Start(void);
+
+/*! @brief Creates a semaphore.
+ *
+ *  @param count The initial count. 1 makes a lock, 0 an event for a thread to wait on.
+ *  @return OS_ECB* - the semaphore, or NULL if all OS_NB_SEMAPHORES have been created.
+ */
+OS_ECB* OS_SemaphoreCreate(const uint32_t count);
+
+/*! @brief Takes one from a semaphore's count, waiting for it to be signalled if the count is 0.
+ *
+ *  @param semaphore The semaphore.
+ *  @param timeout The most ticks to wait, or 0 to wait for ever.
+ *  @return OS_ERROR - OS_NO_ERROR if the count was taken, OS_TIMEOUT if the timeout ran out first.
+ *  @note Only call from a thread.
+ */
+OS_ERROR OS_SemaphoreWait(OS_ECB* const semaphore, const uint32_t timeout);
+
+/*! @brief Signals a semaphore, which wakes the highest priority thread waiting on it or else adds one to its count.
+ *
+ *  @param semaphore The semaphore.
+ *  @return OS_ERROR - OS_NO_ERROR if the semaphore was signalled.
+ *  @note Safe to call from any interrupt.
+ */
+OS_ERROR OS_SemaphoreSignal(OS_ECB* const semaphore);
+
+/*! @brief Suspends the calling thread.
+ *
+ *  @param ticks The number of ticks to wait, at least 1.
+ *  @return OS_ERROR - OS_NO_ERROR once the time is up.
+ *  @note Only call from a thread.
+ */
+OS_ERROR OS_TimeDelay(const uint32_t ticks);
+
+/*! @brief Gets the number of ticks since OS_Start.
+ *
+ *  @return uint32_t - the current tick, which wraps after about 49 days.
+ */
+uint32_t OS_TimeGet(void);
+
+/*! @brief Marks the start of an interrupt that calls the kernel.
+ *
+ *  Nested calls to the kernel then leave the context switch to the outermost OS_ISRExit.
+ */
+void OS_ISREnter(void);
+
+/*! @brief Marks the end of an interrupt that calls the kernel, switching threads if it has made a higher priority one ready.
+ */
+void OS_ISRExit(void);
+
+/*! @brief Called over and over from the idle thread, with interrupts disabled.
+ *
+ *  Defined by the application, e.g. to sleep until the next interrupt. It must return with interrupts still disabled,
+ *  and may not call the kernel. The interrupts that came in are let through between calls.
+ */
+void OS_IdleHook(void);
+
+/*! @brief Interrupt service routine for the SysTick timer.
+ *
+ *  Counts the tick, and wakes the threads whose delay or timeout has run out.
+ */
+void __attribute__ ((interrupt)) OS_SysTick_ISR(void);
+
+/*! @brief Interrupt service routine for PendSV, which switches to the highest priority ready thread.
+ */
+void __attribute__ ((naked)) OS_PendSV_ISR(void);
+
+#endif
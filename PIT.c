@@ -10,57 +10,134 @@
  */
 
 #include "PIT.h"
+#include "Profile.h"
 #include "MK70F12.h"
 
 #define NS_IN_1_SEC 1000000000
 
-#define NANO_SECONDS_IN_A_SECOND 1000000000
-#define NANO_SECONDS_IN_10_MS 10000000
-
-#define VOLTAGE_CHANNEL 1
-#define CURRENT_CHANNEL 2
+/*!
+ * @brief The callback of one PIT channel.
+ */
+typedef struct
+{
+  void (*function)(void *);   /*!< The user callback function, or NULL. */
+  void *arguments;            /*!< The user arguments to use with the user callback function. */
+} TPITCallback;
 
-static void (*Callback)(void *);
-static void *Arguments;
+static TPITCallback Callback[PIT_NB_CHANNELS];
 static bool Initialised = 0;
 static uint32_t Clock;
-
-int16_t Meter_Voltage;
-int16_t Meter_Current;
+// Set while the timebase channels are chained
+static bool TimebaseRunning = 0;
 
 /*! @brief Sets up the PIT before first use.
  *
  *  Enables the PIT and freezes the timer when debugging.
  *  @param moduleClk The module clock rate in Hz.
- *  @param userFunction is a pointer to a user callback function.
+ *  @param userFunction is a pointer to a user callback function for channel 0.
  *  @param userArguments is a pointer to the user arguments to use with the user callback function.
  *  @return bool - TRUE if the PIT was successfully initialized.
- *  @note Assumes that moduleClk has a period which can be expressed as an integral number of nanoseconds.
  */
 bool PIT_Init(const uint32_t moduleClk, void (*userFunction)(void*), void* userArguments)
 {
-  Callback = userFunction;
-  Arguments = userArguments;
   Clock = moduleClk;
 
+  for (uint8_t channelNb = 0; channelNb < PIT_NB_CHANNELS; channelNb++)
+    {
+      Callback[channelNb].function = NULL;
+      Callback[channelNb].arguments = NULL;
+    }
   Initialised = 1;
 
   SIM_SCGC6 |= SIM_SCGC6_PIT_MASK; // enable PIT clock gate control
 
   PIT_MCR = PIT_MCR_FRZ_MASK;  // allows timers to freeze during debug session
 
-  PIT_TCTRL0 |= PIT_TCTRL_TIE_MASK; // Timer Interrupt Enable
+  PIT_SetCallback(0, userFunction, userArguments);
 
   // Setting up NVIC for PIT see K70 manual pg 97, 99
-  // Vector=84, IRQ=68
+  // Vector=84-87, IRQ=68-71, one per channel
   // NVIC non-IPR=2 IPR=17
   // Clear any pending interrupts on PIT
-  NVICICPR2 = (1 << 4);
-  // Enable Interrupts for PIT0
-  NVICISER2 = (1 << 4);
+  NVICICPR2 = (0xF << 4);
+  // Enable Interrupts for PIT0-3. Each channel only interrupts once its TIE is set.
+  NVICISER2 = (0xF << 4);
+  return 1;
 }
 
-/*! @brief Sets the value of the desired period of the PIT.
+/*! @brief Sets the callback of a PIT channel.
+ *
+ *  @param channelNb The PIT channel.
+ *  @param userFunction is a pointer to a user callback function, or NULL for none.
+ *  @param userArguments is a pointer to the user arguments to use with the user callback function.
+ *  @return bool - TRUE if the callback was set.
+ */
+bool PIT_SetCallback(const uint8_t channelNb, void (*userFunction)(void*), void* userArguments)
+{
+  if (channelNb >= PIT_NB_CHANNELS)
+    {
+      return 0;
+    }
+  // Keep the ISR from seeing a new function with the old arguments
+  PIT_TCTRL(channelNb) &= ~PIT_TCTRL_TIE_MASK;
+  Callback[channelNb].function = userFunction;
+  Callback[channelNb].arguments = userArguments;
+  if (userFunction)
+    {
+      PIT_TCTRL(channelNb) |= PIT_TCTRL_TIE_MASK;
+    }
+  return 1;
+}
+
+/*! @brief Sets the period of a PIT channel as a number of module clock cycles.
+ *
+ *  @param channelNb The PIT channel.
+ *  @param cycles The number of module clock cycles between interrupts, at least 1.
+ *  @param restart TRUE if the channel is disabled, the new value set, and then enabled.
+ *  @return bool - TRUE if the period was set.
+ */
+bool PIT_SetCycles(const uint8_t channelNb, const uint32_t cycles, const bool restart)
+{
+  if ((channelNb >= PIT_NB_CHANNELS) || (cycles == 0))
+    {
+      return 0;
+    }
+  if (TimebaseRunning && ((channelNb == PIT_TIMEBASE_LOW) || (channelNb == PIT_TIMEBASE_HIGH)))
+    {
+      return 0;
+    }
+
+  // The timer counts down from LDVAL to 0 inclusive
+  PIT_LDVAL(channelNb) = PIT_LDVAL_TSV(cycles - 1);
+
+  if (restart)
+    {
+      PIT_TCTRL(channelNb) &= ~PIT_TCTRL_TEN_MASK; // reset all bits in register
+      PIT_TCTRL(channelNb) |= PIT_TCTRL_TEN_MASK; // Timer Enable TEN in register
+    }
+  return 1;
+}
+
+/*! @brief Sets the period of a PIT channel in nanoseconds.
+ *
+ *  @param channelNb The PIT channel.
+ *  @param period The desired value of the timer period in nanoseconds.
+ *  @param restart TRUE if the channel is disabled, the new value set, and then enabled.
+ *  @return bool - TRUE if the period was set.
+ */
+bool PIT_SetChannel(const uint8_t channelNb, const uint32_t period, const bool restart)
+{
+  // period * Clock overflows 32 bits for anything over a few ms, so work in 64 bits and round to nearest
+  uint64_t cycles = (((uint64_t) period * Clock) + (NS_IN_1_SEC / 2)) / NS_IN_1_SEC;
+
+  if (cycles > UINT32_MAX)
+    {
+      return 0;
+    }
+  return PIT_SetCycles(channelNb, (uint32_t) cycles, restart);
+}
+
+/*! @brief Sets the value of the desired period of PIT channel 0.
  *
  *  @param period The desired value of the timer period in nanoseconds.
  *  @param restart TRUE if the PIT is disabled, a new value set, and then enabled.
@@ -69,36 +146,108 @@ bool PIT_Init(const uint32_t moduleClk, void (*userFunction)(void*), void* userA
  */
 void PIT_Set(const uint32_t period, const bool restart)
 {
-  uint32_t Hz = NS_IN_1_SEC / period;
-  uint32_t cycleCount = Clock / Hz;
-  uint32_t Trigger = cycleCount - 1;
-
-  PIT_LDVAL0 = PIT_LDVAL_TSV(Trigger);
+  PIT_SetChannel(0, period, restart);
+}
 
-  if (restart)
+/*! @brief Enables or disables a PIT channel.
+ *
+ *  @param channelNb The PIT channel.
+ *  @param enable - TRUE if the channel is to be enabled, FALSE if the channel is to be disabled.
+ *  @return bool - TRUE if the channel was changed.
+ */
+bool PIT_EnableChannel(const uint8_t channelNb, const bool enable)
+{
+  if (channelNb >= PIT_NB_CHANNELS)
+    {
+      return 0;
+    }
+  if (enable)
     {
-      PIT_TCTRL0 &= ~PIT_TCTRL_TEN_MASK; // reset all bits in register
-      PIT_TCTRL0 |= PIT_TCTRL_TEN_MASK; // Timer Enable TEN in register
+      PIT_TCTRL(channelNb) |= PIT_TCTRL_TEN_MASK;
     }
+  else
+    {
+      PIT_TCTRL(channelNb) &= ~PIT_TCTRL_TEN_MASK;
+    }
+  return 1;
 }
 
-/*! @brief Enables or disables the PIT.
+/*! @brief Enables or disables PIT channel 0.
  *
  *  @param enable - TRUE if the PIT is to be enabled, FALSE if the PIT is to be disabled.
  */
 void PIT_Enable(const bool enable)
 {
-  if (enable)
+  PIT_EnableChannel(0, enable);
+}
+
+/*! @brief Starts the free-running 64-bit timebase.
+ *
+ *  @return bool - TRUE if the timebase was started.
+ *  @note Assumes the PIT has been initialized.
+ */
+bool PIT_TimebaseStart(void)
+{
+  if (!Initialised)
     {
-      PIT_TCTRL0 |= PIT_TCTRL_TEN_MASK;  // Enable PIT0
+      return 0;
     }
-  else
+
+  // Both halves count the full 32 bits. The upper one only decrements when the lower one reaches 0.
+  PIT_TCTRL(PIT_TIMEBASE_HIGH) = 0;
+  PIT_TCTRL(PIT_TIMEBASE_LOW) = 0;
+  PIT_LDVAL(PIT_TIMEBASE_HIGH) = UINT32_MAX;
+  PIT_LDVAL(PIT_TIMEBASE_LOW) = UINT32_MAX;
+  PIT_TCTRL(PIT_TIMEBASE_HIGH) = PIT_TCTRL_CHN_MASK | PIT_TCTRL_TEN_MASK;
+  PIT_TCTRL(PIT_TIMEBASE_LOW) = PIT_TCTRL_TEN_MASK;
+  TimebaseRunning = 1;
+  return 1;
+}
+
+/*! @brief Reads the 64-bit timebase.
+ *
+ *  @return uint64_t - the number of module clock cycles since PIT_TimebaseStart.
+ */
+uint64_t PIT_Timebase(void)
+{
+  uint32_t high = PIT_CVAL(PIT_TIMEBASE_HIGH);
+  uint32_t low = PIT_CVAL(PIT_TIMEBASE_LOW);
+  uint32_t check = PIT_CVAL(PIT_TIMEBASE_HIGH);
+
+  // The lower half wrapped between the reads, so read it again against the new upper half
+  if (check != high)
+    {
+      high = check;
+      low = PIT_CVAL(PIT_TIMEBASE_LOW);
+    }
+
+  // Both halves count down from all ones
+  return ~(((uint64_t) high << 32) | low);
+}
+
+/*! @brief Gets the module clock rate the PIT counts.
+ *
+ *  @return uint32_t - the module clock rate in Hz.
+ */
+uint32_t PIT_Clock(void)
+{
+  return Clock;
+}
+
+/*! @brief Acknowledges a PIT channel's interrupt and calls its callback.
+ *
+ *  @param channelNb The PIT channel.
+ */
+static void Handle(const uint8_t channelNb)
+{
+  PIT_TFLG(channelNb) = PIT_TFLG_TIF_MASK;
+  if (Initialised && Callback[channelNb].function)
     {
-      PIT_TCTRL0 &= ~PIT_TCTRL_TEN_MASK;  // Disable PIT0
+      (*Callback[channelNb].function)(Callback[channelNb].arguments);
     }
 }
 
-/*! @brief Interrupt service routine for the PIT.
+/*! @brief Interrupt service routine for PIT channel 0.
  *
  *  The periodic interrupt timer has timed out.
  *  The user callback function will be called.
@@ -110,11 +259,38 @@ void __attribute__ ((interrupt)) PIT_ISR(void)
 	{
 	  return;
 	}
-      (*Callback)(Arguments);
-      PIT_TFLG0 = PIT_TFLG_TIF_MASK;
+      PROFILE_ENTER(PROFILE_PIT);
+      // The timer reloaded from LDVAL when it triggered, and has counted down since
+      PROFILE_LATENCY(PROFILE_PIT, PIT_LDVAL(0) - PIT_CVAL(0), Clock);
+      Handle(0);
+      PROFILE_EXIT(PROFILE_PIT);
+    }
+
+/*! @brief Interrupt service routine for PIT channel 1.
+ *
+ *  @note Assumes the PIT has been initialized.
+ */
+void __attribute__ ((interrupt)) PIT1_ISR(void)
+    {
+      Handle(1);
+    }
+
+/*! @brief Interrupt service routine for PIT channel 2.
+ *
+ *  @note Assumes the PIT has been initialized.
+ */
+void __attribute__ ((interrupt)) PIT2_ISR(void)
+    {
+      Handle(2);
+    }
 
-      Analog_Get(VOLTAGE_CHANNEL, &Meter_Voltage);
-      Analog_Get(CURRENT_CHANNEL, &Meter_Current);
+/*! @brief Interrupt service routine for PIT channel 3.
+ *
+ *  @note Assumes the PIT has been initialized.
+ */
+void __attribute__ ((interrupt)) PIT3_ISR(void)
+    {
+      Handle(3);
     }
 /*  END pit  */
 /*!
@@ -14,18 +14,57 @@
 // new types
 #include "types.h"
 
+// Number of PIT channels
+#define PIT_NB_CHANNELS 4
+
+// The channels chained into the 64-bit timebase: the lower one counts cycles, the upper one counts its wraps
+#define PIT_TIMEBASE_LOW  2
+#define PIT_TIMEBASE_HIGH 3
+
 /*! @brief Sets up the PIT before first use.
  *
  *  Enables the PIT and freezes the timer when debugging.
  *  @param moduleClk The module clock rate in Hz.
- *  @param userFunction is a pointer to a user callback function.
+ *  @param userFunction is a pointer to a user callback function for channel 0.
  *  @param userArguments is a pointer to the user arguments to use with the user callback function.
  *  @return bool - TRUE if the PIT was successfully initialized.
- *  @note Assumes that moduleClk has a period which can be expressed as an integral number of nanoseconds.
  */
 bool PIT_Init(const uint32_t moduleClk, void (*userFunction)(void*), void* userArguments);
 
-/*! @brief Sets the value of the desired period of the PIT.
+/*! @brief Sets the callback of a PIT channel.
+ *
+ *  @param channelNb The PIT channel.
+ *  @param userFunction is a pointer to a user callback function, or NULL for none.
+ *  @param userArguments is a pointer to the user arguments to use with the user callback function.
+ *  @return bool - TRUE if the callback was set.
+ *  @note Assumes the PIT has been initialized.
+ */
+bool PIT_SetCallback(const uint8_t channelNb, void (*userFunction)(void*), void* userArguments);
+
+/*! @brief Sets the period of a PIT channel as a number of module clock cycles.
+ *
+ *  @param channelNb The PIT channel.
+ *  @param cycles The number of module clock cycles between interrupts, at least 1.
+ *  @param restart TRUE if the channel is disabled, the new value set, and then enabled.
+ *                 FALSE if the channel will use the new value after a trigger event.
+ *  @return bool - TRUE if the period was set. The timebase channels can't be set while the timebase runs.
+ *  @note Assumes the PIT has been initialized.
+ */
+bool PIT_SetCycles(const uint8_t channelNb, const uint32_t cycles, const bool restart);
+
+/*! @brief Sets the period of a PIT channel in nanoseconds.
+ *
+ *  The number of cycles is worked out in 64 bits and rounded to the nearest cycle, so any period is exact to one cycle.
+ *  @param channelNb The PIT channel.
+ *  @param period The desired value of the timer period in nanoseconds.
+ *  @param restart TRUE if the channel is disabled, the new value set, and then enabled.
+ *                 FALSE if the channel will use the new value after a trigger event.
+ *  @return bool - TRUE if the period was set.
+ *  @note Assumes the PIT has been initialized.
+ */
+bool PIT_SetChannel(const uint8_t channelNb, const uint32_t period, const bool restart);
+
+/*! @brief Sets the value of the desired period of PIT channel 0.
  *
  *  @param period The desired value of the timer period in nanoseconds.
  *  @param restart TRUE if the PIT is disabled, a new value set, and then enabled.
@@ -34,13 +73,42 @@ bool PIT_Init(const uint32_t moduleClk, void (*userFunction)(void*), void* userA
  */
 void PIT_Set(const uint32_t period, const bool restart);
 
-/*! @brief Enables or disables the PIT.
+/*! @brief Enables or disables a PIT channel.
+ *
+ *  @param channelNb The PIT channel.
+ *  @param enable - TRUE if the channel is to be enabled, FALSE if the channel is to be disabled.
+ *  @return bool - TRUE if the channel was changed.
+ */
+bool PIT_EnableChannel(const uint8_t channelNb, const bool enable);
+
+/*! @brief Enables or disables PIT channel 0.
  *
  *  @param enable - TRUE if the PIT is to be enabled, FALSE if the PIT is to be disabled.
  */
 void PIT_Enable(const bool enable);
 
-/*! @brief Interrupt service routine for the PIT.
+/*! @brief Starts the free-running 64-bit timebase.
+ *
+ *  Chains PIT_TIMEBASE_HIGH to PIT_TIMEBASE_LOW, so together they count module clock cycles for thousands of years.
+ *  @return bool - TRUE if the timebase was started.
+ *  @note Assumes the PIT has been initialized. Takes over both channels.
+ */
+bool PIT_TimebaseStart(void);
+
+/*! @brief Reads the 64-bit timebase.
+ *
+ *  @return uint64_t - the number of module clock cycles since PIT_TimebaseStart.
+ *  @note Safe to call from any context.
+ */
+uint64_t PIT_Timebase(void);
+
+/*! @brief Gets the module clock rate the PIT counts.
+ *
+ *  @return uint32_t - the module clock rate in Hz.
+ */
+uint32_t PIT_Clock(void);
+
+/*! @brief Interrupt service routine for PIT channel 0.
  *
  *  The periodic interrupt timer has timed out.
  *  The user callback function will be called.
@@ -48,4 +116,22 @@ void PIT_Enable(const bool enable);
  */
 void __attribute__ ((interrupt)) PIT_ISR(void);
 
+/*! @brief Interrupt service routine for PIT channel 1.
+ *
+ *  @note Assumes the PIT has been initialized.
+ */
+void __attribute__ ((interrupt)) PIT1_ISR(void);
+
+/*! @brief Interrupt service routine for PIT channel 2.
+ *
+ *  @note Assumes the PIT has been initialized.
+ */
+void __attribute__ ((interrupt)) PIT2_ISR(void);
+
+/*! @brief Interrupt service routine for PIT channel 3.
+ *
+ *  @note Assumes the PIT has been initialized.
+ */
+void __attribute__ ((interrupt)) PIT3_ISR(void);
+
 #endif
@@ -0,0 +1,259 @@
+/*! @file
+ *  Profile.c
+ *
+ *  @brief Interrupt service time and jitter measurement
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Profile_module Profile module documentation
+**  @{
+ */
+
+#include "Profile.h"
+
+#ifdef PROFILE_ENABLED
+
+#include "MK70F12.h"
+#include "PE_Types.h"
+#include "CPU.h"
+
+// Debug Exception and Monitor Control Register, whose TRCENA bit powers the DWT
+#define DEMCR (*(volatile uint32_t *) 0xE000EDFCu)
+#define DEMCR_TRCENA_MASK 0x01000000u
+
+static TProfileStats Stats[PROFILE_NB_ISRS];
+// Cycle count at the latest entry of each ISR
+static uint32_t Entry[PROFILE_NB_ISRS];
+
+// Entry latencies, in ticks of the clock each ISR measures them with. They are only converted to ns when read.
+static TProfileLatency Latency[PROFILE_NB_ISRS];
+static uint32_t LatencyClock[PROFILE_NB_ISRS];
+
+/*! @brief Clears the statistics of an ISR.
+ *
+ *  @param stats The statistics.
+ */
+static void Clear(TProfileStats * const stats)
+{
+  stats->totalCycles = 0;
+  stats->totalPeriod = 0;
+  stats->count = 0;
+  stats->minCycles = UINT32_MAX;
+  stats->maxCycles = 0;
+  stats->minPeriod = UINT32_MAX;
+  stats->maxPeriod = 0;
+  for (uint8_t i = 0; i < PROFILE_HISTOGRAM_SIZE; i++)
+    {
+      stats->histogram[i] = 0;
+    }
+}
+
+/*! @brief Clears the entry latency of an ISR.
+ *
+ *  @param latency The latency statistics.
+ */
+static void ClearLatency(TProfileLatency * const latency)
+{
+  latency->total = 0;
+  latency->count = 0;
+  latency->min = UINT32_MAX;
+  latency->max = 0;
+}
+
+/*! @brief Converts ticks of a peripheral clock to ns.
+ *
+ *  @param ticks The number of ticks.
+ *  @param clockHz The clock rate, in Hz.
+ *  @return uint64_t - the time in ns.
+ */
+static uint64_t Nanoseconds(const uint64_t ticks, const uint32_t clockHz)
+{
+  // Whole seconds first, so a long total can't overflow
+  return ((ticks / clockHz) * 1000000000u) + (((ticks % clockHz) * 1000000000u) / clockHz);
+}
+
+/*! @brief Starts the cycle counter and clears the statistics.
+ *
+ *  @return bool - TRUE if profiling was successfully initialized.
+ */
+bool Profile_Init(void)
+{
+  for (uint8_t isr = 0; isr < PROFILE_NB_ISRS; isr++)
+    {
+      Clear(&Stats[isr]);
+      ClearLatency(&Latency[isr]);
+    }
+
+  DEMCR |= DEMCR_TRCENA_MASK;
+  DWT_CYCCNT = 0;
+  DWT_CTRL |= DWT_CTRL_CYCCNTENA_MASK;
+  return 1;
+}
+
+/*! @brief Stamps the entry of an ISR.
+ *
+ *  @param isr The PROFILE_ number of the ISR.
+ */
+void Profile_Enter(const uint8_t isr)
+{
+  uint32_t now = DWT_CYCCNT;
+  TProfileStats *stats = &Stats[isr];
+
+  if (stats->count > 0)
+    {
+      // The counter wraps every few tens of seconds, which the unsigned difference absorbs
+      uint32_t period = now - Entry[isr];
+      stats->totalPeriod += period;
+      if (period < stats->minPeriod)
+	{
+	  stats->minPeriod = period;
+	}
+      if (period > stats->maxPeriod)
+	{
+	  stats->maxPeriod = period;
+	}
+    }
+  Entry[isr] = now;
+}
+
+/*! @brief Stamps the exit of an ISR and updates its statistics.
+ *
+ *  @param isr The PROFILE_ number of the ISR.
+ */
+void Profile_Exit(const uint8_t isr)
+{
+  uint32_t cycles = DWT_CYCCNT - Entry[isr];
+  TProfileStats *stats = &Stats[isr];
+
+  stats->count++;
+  stats->totalCycles += cycles;
+  if (cycles < stats->minCycles)
+    {
+      stats->minCycles = cycles;
+    }
+  if (cycles > stats->maxCycles)
+    {
+      stats->maxCycles = cycles;
+    }
+
+  uint8_t bucket = 0;
+  if (cycles >= 32)
+    {
+      bucket = 31 - __builtin_clz(cycles) - 4;
+      if (bucket >= PROFILE_HISTOGRAM_SIZE)
+	{
+	  bucket = PROFILE_HISTOGRAM_SIZE - 1;
+	}
+    }
+  // Saturate rather than wrap, so a full bucket still reads as the largest
+  if (stats->histogram[bucket] < UINT16_MAX)
+    {
+      stats->histogram[bucket]++;
+    }
+}
+
+/*! @brief Records the entry latency of an ISR.
+ *
+ *  @param isr The PROFILE_ number of the ISR.
+ *  @param ticks The time since the interrupt was triggered, read from the peripheral that triggered it.
+ *  @param clockHz The clock rate of the peripheral's counter, in Hz.
+ */
+void Profile_Latency(const uint8_t isr, const uint32_t ticks, const uint32_t clockHz)
+{
+  TProfileLatency *latency = &Latency[isr];
+
+  // Kept in ticks, as dividing here would add to the service time being measured
+  LatencyClock[isr] = clockHz;
+  latency->count++;
+  latency->total += ticks;
+  if (ticks < latency->min)
+    {
+      latency->min = ticks;
+    }
+  if (ticks > latency->max)
+    {
+      latency->max = ticks;
+    }
+}
+
+/*! @brief Gets the statistics of an ISR.
+ *
+ *  @param isr The PROFILE_ number of the ISR.
+ *  @param stats Set to the statistics.
+ *  @return bool - TRUE if isr is valid.
+ */
+bool Profile_Get(const uint8_t isr, TProfileStats * const stats)
+{
+  if (isr >= PROFILE_NB_ISRS)
+    {
+      return 0;
+    }
+
+  // Copy in one go, so the ISR can't update it half way
+  EnterCritical();
+  *stats = Stats[isr];
+  ExitCritical();
+  return 1;
+}
+
+/*! @brief Gets the entry latency of an ISR.
+ *
+ *  @param isr The PROFILE_ number of the ISR.
+ *  @param latency Set to the latency statistics. The count is 0 for an ISR that can't measure its latency.
+ *  @return bool - TRUE if isr is valid.
+ */
+bool Profile_GetLatency(const uint8_t isr, TProfileLatency * const latency)
+{
+  TProfileLatency ticks;
+  uint32_t clockHz;
+
+  if (isr >= PROFILE_NB_ISRS)
+    {
+      return 0;
+    }
+
+  EnterCritical();
+  ticks = Latency[isr];
+  clockHz = LatencyClock[isr];
+  ExitCritical();
+
+  latency->count = ticks.count;
+  if (ticks.count == 0)
+    {
+      latency->total = 0;
+      latency->min = 0;
+      latency->max = 0;
+      return 1;
+    }
+  latency->total = Nanoseconds(ticks.total, clockHz);
+  latency->min = (uint32_t) Nanoseconds(ticks.min, clockHz);
+  latency->max = (uint32_t) Nanoseconds(ticks.max, clockHz);
+  return 1;
+}
+
+/*! @brief Clears the statistics of an ISR.
+ *
+ *  @param isr The PROFILE_ number of the ISR.
+ *  @return bool - TRUE if isr is valid.
+ */
+bool Profile_Reset(const uint8_t isr)
+{
+  if (isr >= PROFILE_NB_ISRS)
+    {
+      return 0;
+    }
+
+  EnterCritical();
+  Clear(&Stats[isr]);
+  ClearLatency(&Latency[isr]);
+  ExitCritical();
+  return 1;
+}
+
+#endif
+
+/* END Profile */
+/*!
+** @}
+*/
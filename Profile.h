@@ -0,0 +1,133 @@
+/*! @file
+ *
+ *  @brief Interrupt service time and jitter measurement.
+ *
+ *  Each instrumented ISR stamps the DWT cycle counter on entry and exit.
+ *  The service time (min, max, mean and a log2 histogram) and the time between entries (min, max and mean period)
+ *  are kept in RAM and can be dumped over the link.
+ *  ISRs whose peripheral counts on from the trigger (PIT, RTC, FTM and LPTMR) also report their entry latency,
+ *  the time from the trigger to the handler, in the resolution of that peripheral's clock.
+ *  Build with PROFILE_ENABLED defined (e.g. -DPROFILE_ENABLED) to include it. Otherwise the hooks compile to nothing.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// new types
+#include "types.h"
+
+// The instrumented ISRs
+#define PROFILE_UART  0
+#define PROFILE_PIT   1
+#define PROFILE_RTC   2
+#define PROFILE_FTM   3
+#define PROFILE_LPTMR 4
+#define PROFILE_SAMPLER 5
+#define PROFILE_NB_ISRS 6
+
+// Number of service time histogram buckets. Bucket 0 counts services under 32 cycles,
+// bucket n those of 2^(n+4) to 2^(n+5) cycles, and the last bucket everything longer.
+#define PROFILE_HISTOGRAM_SIZE 12
+
+/*!
+ * @brief The statistics of one ISR, in core clock cycles.
+ */
+typedef struct
+{
+  uint64_t totalCycles;     /*!< Total service time, for the mean. */
+  uint64_t totalPeriod;     /*!< Total time between entries, for the mean. */
+  uint32_t count;           /*!< Number of times the ISR ran. */
+  uint32_t minCycles;       /*!< Shortest service time. */
+  uint32_t maxCycles;       /*!< Longest service time. */
+  uint32_t minPeriod;       /*!< Shortest time between two entries. */
+  uint32_t maxPeriod;       /*!< Longest time between two entries. The jitter is maxPeriod - minPeriod. */
+  uint16_t histogram[PROFILE_HISTOGRAM_SIZE];  /*!< Service times, in log2 buckets. */
+} TProfileStats;
+
+/*!
+ * @brief The entry latency of one ISR, in ns.
+ */
+typedef struct
+{
+  uint64_t total;   /*!< Total latency, for the mean. */
+  uint32_t count;   /*!< Number of latencies measured. */
+  uint32_t min;     /*!< Shortest latency. */
+  uint32_t max;     /*!< Longest latency. */
+} TProfileLatency;
+
+#ifdef PROFILE_ENABLED
+
+/*! @brief Starts the cycle counter and clears the statistics.
+ *
+ *  @return bool - TRUE if profiling was successfully initialized.
+ */
+bool Profile_Init(void);
+
+/*! @brief Stamps the entry of an ISR.
+ *
+ *  @param isr The PROFILE_ number of the ISR.
+ */
+void Profile_Enter(const uint8_t isr);
+
+/*! @brief Stamps the exit of an ISR and updates its statistics.
+ *
+ *  @param isr The PROFILE_ number of the ISR.
+ */
+void Profile_Exit(const uint8_t isr);
+
+/*! @brief Records the entry latency of an ISR.
+ *
+ *  @param isr The PROFILE_ number of the ISR.
+ *  @param ticks The time since the interrupt was triggered, read from the peripheral that triggered it.
+ *  @param clockHz The clock rate of the peripheral's counter, in Hz.
+ */
+void Profile_Latency(const uint8_t isr, const uint32_t ticks, const uint32_t clockHz);
+
+/*! @brief Gets the statistics of an ISR.
+ *
+ *  @param isr The PROFILE_ number of the ISR.
+ *  @param stats Set to the statistics.
+ *  @return bool - TRUE if isr is valid.
+ */
+bool Profile_Get(const uint8_t isr, TProfileStats* const stats);
+
+/*! @brief Gets the entry latency of an ISR.
+ *
+ *  @param isr The PROFILE_ number of the ISR.
+ *  @param latency Set to the latency statistics. The count is 0 for an ISR that can't measure its latency.
+ *  @return bool - TRUE if isr is valid.
+ */
+bool Profile_GetLatency(const uint8_t isr, TProfileLatency* const latency);
+
+/*! @brief Clears the statistics of an ISR.
+ *
+ *  @param isr The PROFILE_ number of the ISR.
+ *  @return bool - TRUE if isr is valid.
+ */
+bool Profile_Reset(const uint8_t isr);
+
+#define PROFILE_ENTER(isr) Profile_Enter(isr)
+#define PROFILE_EXIT(isr)  Profile_Exit(isr)
+#define PROFILE_LATENCY(isr, ticks, clockHz) Profile_Latency(isr, ticks, clockHz)
+
+#else
+
+/*! @brief Does nothing, as profiling isn't built in.
+ *
+ *  @return bool - always TRUE.
+ */
+static inline bool Profile_Init(void)
+{
+  return 1;
+}
+
+#define PROFILE_ENTER(isr) ((void) 0)
+#define PROFILE_EXIT(isr)  ((void) 0)
+#define PROFILE_LATENCY(isr, ticks, clockHz) ((void) 0)
+
+#endif
+
+#endif
@@ -15,6 +15,7 @@
 #include <types.h>
 #include "RTC.h"
 #include "LEDs.h"
+#include "Profile.h"
 
 
 static void (*Callback)(void *);
@@ -112,7 +113,11 @@ void __attribute__ ((interrupt)) RTC_ISR(void)
 	 {
 	   return;
 	 }
+       PROFILE_ENTER(PROFILE_RTC);
+       // The seconds counter ticked when the 32.768 kHz prescaler wrapped, and the prescaler has counted on since
+       PROFILE_LATENCY(PROFILE_RTC, RTC_TPR & 0x7FFF, 32768);
        (*Callback)(Arguments);
+       PROFILE_EXIT(PROFILE_RTC);
     }
 
 
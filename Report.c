@@ -0,0 +1,226 @@
+/*! @file
+ *  Report.c
+ *
+ *  @brief Deciding when an analog channel's value is worth reporting
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Report_module Report module documentation
+**  @{
+ */
+
+#include "Report.h"
+#include "Sampler.h"
+#include "Flash.h"
+#include "Time.h"
+
+/*!
+ * @brief The reporting state of a channel.
+ */
+typedef struct
+{
+  TReportConfig config;   /*!< The settings in use. */
+  int16_t last;           /*!< The last value reported. */
+  int8_t direction;       /*!< The sign of the last change reported. */
+  bool reported;          /*!< Set once a value has been reported. */
+  bool configured;        /*!< Set once the channel has been set up. Until then every change is sent whole. */
+  uint64_t lastTime;      /*!< Time_Now of the last report. */
+} TReportChannel;
+
+static TReportChannel Channels[SAMPLER_NB_CHANNELS];
+
+// A delta waiting for a second one to share its packet
+static bool Held = 0;
+static TReportDelta HeldDelta;
+
+// The settings in Flash. Erased Flash reads as all ones.
+static volatile TReportConfig *NvConfig[SAMPLER_NB_CHANNELS];
+
+/*! @brief Loads the settings of every channel from Flash.
+ *
+ *  @return bool - TRUE if the settings were loaded.
+ */
+bool Report_Init(void)
+{
+  for (uint8_t channelNb = 0; channelNb < SAMPLER_NB_CHANNELS; channelNb++)
+    {
+      if (!Flash_AllocateVar((volatile void **) &NvConfig[channelNb], sizeof(TReportConfig)))
+	{
+	  return 0;
+	}
+
+      TReportChannel *channel = &Channels[channelNb];
+      channel->config = *(TReportConfig *) NvConfig[channelNb];
+      channel->configured = (channel->config.deadband != 0xFFFF);
+      if (!channel->configured)
+	{
+	  // Never set up, so report every change as a whole value as before
+	  channel->config.deadband = 0;
+	  channel->config.hysteresis = 0;
+	  channel->config.minInterval = 0;
+	  channel->config.maxInterval = 0;
+	}
+      channel->reported = 0;
+    }
+  return 1;
+}
+
+/*! @brief Changes the settings of a channel, and saves them to Flash on the next commit.
+ *
+ *  @param channelNb The Sampler channel.
+ *  @param config The new settings.
+ *  @return bool - TRUE if the settings were changed.
+ */
+bool Report_Set(const uint8_t channelNb, const TReportConfig * const config)
+{
+  if ((channelNb >= SAMPLER_NB_CHANNELS) || (config->deadband == 0xFFFF)
+      || (config->maxInterval && (config->maxInterval < config->minInterval)))
+    {
+      return 0;
+    }
+
+  volatile TReportConfig *nv = NvConfig[channelNb];
+  if (!Flash_Write16(&nv->deadband, config->deadband) || !Flash_Write16(&nv->hysteresis, config->hysteresis)
+      || !Flash_Write16(&nv->minInterval, config->minInterval) || !Flash_Write16(&nv->maxInterval, config->maxInterval))
+    {
+      return 0;
+    }
+
+  Channels[channelNb].config = *config;
+  Channels[channelNb].configured = 1;
+  Channels[channelNb].reported = 0;  // start again from a whole value
+  return 1;
+}
+
+/*! @brief Decides whether a new value of a channel is to be reported, and how.
+ *
+ *  @param channelNb The Sampler channel.
+ *  @param value The new value.
+ *  @param delta Set to the change since the last value reported, for REPORT_DELTA.
+ *  @return TReportKind - what to send.
+ */
+TReportKind Report_Check(const uint8_t channelNb, const int16_t value, int8_t * const delta)
+{
+  if (channelNb >= SAMPLER_NB_CHANNELS)
+    {
+      return REPORT_NONE;
+    }
+
+  TReportChannel *channel = &Channels[channelNb];
+
+  if (channel->reported)
+    {
+      uint64_t elapsed = Time_ToMs(Time_Now() - channel->lastTime);
+      int32_t change = (int32_t) value - channel->last;
+      int8_t direction = (change > 0) - (change < 0);
+
+      // Turning back needs the hysteresis as well. After a whole value there is no way back yet.
+      uint32_t threshold = channel->config.deadband;
+      if (direction && channel->direction && (direction != channel->direction))
+	{
+	  threshold += channel->config.hysteresis;
+	}
+
+      bool refresh = channel->config.maxInterval && (elapsed >= channel->config.maxInterval);
+      bool moved = (uint32_t) ((change < 0) ? -change : change) > threshold;
+      if ((!moved && !refresh) || (!refresh && (elapsed < channel->config.minInterval)))
+	{
+	  return REPORT_NONE;
+	}
+
+      if (channel->configured && !refresh && (change >= INT8_MIN) && (change <= INT8_MAX))
+	{
+	  *delta = (int8_t) change;
+	  return REPORT_DELTA;
+	}
+    }
+  return REPORT_VALUE;
+}
+
+/*! @brief Records a value of a channel once it has been sent.
+ *
+ *  @param channelNb The Sampler channel.
+ *  @param value The value sent.
+ */
+void Report_Sent(const uint8_t channelNb, const int16_t value)
+{
+  if (channelNb >= SAMPLER_NB_CHANNELS)
+    {
+      return;
+    }
+
+  TReportChannel *channel = &Channels[channelNb];
+  if (!channel->reported)
+    {
+      channel->direction = 0;
+    }
+  else if (value != channel->last)
+    {
+      // The sign of the last change, which the hysteresis works from
+      channel->direction = (value > channel->last) ? 1 : -1;
+    }
+  channel->last = value;
+  channel->lastTime = Time_Now();
+  channel->reported = 1;
+}
+
+/*! @brief Holds back a delta to share a packet with the next one.
+ *
+ *  @param channelNb The Sampler channel.
+ *  @param value The new value.
+ *  @param delta The change given by Report_Check.
+ *  @param pair Set to the two deltas to send in one packet, when there are two.
+ *  @return bool - TRUE if pair is to be sent, FALSE if the delta is held back.
+ */
+bool Report_Pair(const uint8_t channelNb, const int16_t value, const int8_t delta, TReportDelta pair[2])
+{
+  // A second delta of the same channel would be taken from the value before the one held back, so it takes its place
+  if (!Held || (HeldDelta.channelNb == channelNb))
+    {
+      HeldDelta.channelNb = channelNb;
+      HeldDelta.delta = delta;
+      HeldDelta.value = value;
+      Held = 1;
+      return 0;
+    }
+
+  pair[0] = HeldDelta;
+  pair[1].channelNb = channelNb;
+  pair[1].delta = delta;
+  pair[1].value = value;
+  return 1;
+}
+
+/*! @brief Gets the delta held back, to send on its own.
+ *
+ *  @param pair Set to the delta held back, followed by no change of the same channel.
+ *  @return bool - TRUE if a delta is held back.
+ */
+bool Report_Unpaired(TReportDelta pair[2])
+{
+  if (!Held)
+    {
+      return 0;
+    }
+  pair[0] = HeldDelta;
+  pair[1] = HeldDelta;
+  pair[1].delta = 0;
+  return 1;
+}
+
+/*! @brief Records a pair of deltas once their packet has been sent.
+ *
+ *  @param pair The deltas sent.
+ */
+void Report_PairSent(const TReportDelta pair[2])
+{
+  Report_Sent(pair[0].channelNb, pair[0].value);
+  Report_Sent(pair[1].channelNb, pair[1].value);
+  Held = 0;
+}
+
+/* END Report */
+/*!
+** @}
+*/
@@ -0,0 +1,112 @@
+/*! @file
+ *
+ *  @brief Deciding when an analog channel's value is worth reporting.
+ *
+ *  In asynchronous mode a value is only reported once it has moved more than the channel's deadband from the last
+ *  value reported. Moving back the other way takes the hysteresis on top, so noise around a level isn't reported.
+ *  Reports are held back to at most one per minimum interval, and one is sent anyway after the maximum interval.
+ *  The settings are kept in Flash.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef REPORT_H
+#define REPORT_H
+
+// new types
+#include "types.h"
+
+/*!
+ * @brief The reporting settings of a channel.
+ */
+typedef struct
+{
+  uint16_t deadband;      /*!< The change needed for a report, in ADC counts. */
+  uint16_t hysteresis;    /*!< The extra change needed when the value turns back, in ADC counts. */
+  uint16_t minInterval;   /*!< The shortest time between reports in ms, or 0 for no limit. */
+  uint16_t maxInterval;   /*!< The longest time between reports in ms, or 0 to only report changes. */
+} TReportConfig;
+
+/*!
+ * @brief What to report for a new value.
+ */
+typedef enum
+{
+  REPORT_NONE,    /*!< Nothing. */
+  REPORT_DELTA,   /*!< The change since the last value reported. */
+  REPORT_VALUE    /*!< The whole value, as the change is too large for a delta or it is the periodic refresh. */
+} TReportKind;
+
+/*!
+ * @brief A delta to send, and the value it leads to.
+ */
+typedef struct
+{
+  uint8_t channelNb;  /*!< The Sampler channel. */
+  int8_t delta;       /*!< The change from the last value the PC has. */
+  int16_t value;      /*!< The value the change leads to, recorded once it is sent. */
+} TReportDelta;
+
+/*! @brief Loads the settings of every channel from Flash.
+ *
+ *  Channels never set up report every change, as a whole value.
+ *  @return bool - TRUE if the settings were loaded.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Report_Init(void);
+
+/*! @brief Changes the settings of a channel, and saves them to Flash on the next commit.
+ *
+ *  @param channelNb The Sampler channel.
+ *  @param config The new settings.
+ *  @return bool - TRUE if the settings were changed.
+ */
+bool Report_Set(const uint8_t channelNb, const TReportConfig* const config);
+
+/*! @brief Decides whether a new value of a channel is to be reported, and how.
+ *
+ *  Nothing is recorded until the value is passed to Report_Sent, so a report that couldn't be sent
+ *  is tried again from the last value the PC has.
+ *  @param channelNb The Sampler channel.
+ *  @param value The new value.
+ *  @param delta Set to the change since the last value reported, for REPORT_DELTA.
+ *  @return TReportKind - what to send.
+ */
+TReportKind Report_Check(const uint8_t channelNb, const int16_t value, int8_t* const delta);
+
+/*! @brief Records a value of a channel once it has been sent, whether checked by Report_Check or sent regardless, e.g. in synchronous mode.
+ *
+ *  Later deltas are taken from it.
+ *  @param channelNb The Sampler channel.
+ *  @param value The value sent.
+ */
+void Report_Sent(const uint8_t channelNb, const int16_t value);
+
+/*! @brief Holds back a delta from Report_Check to share a packet with the next one.
+ *
+ *  The PC applies the two deltas of a packet one after the other. A delta of the channel already held back replaces it,
+ *  as both are taken from the last value the PC has.
+ *  @param channelNb The Sampler channel.
+ *  @param value The new value.
+ *  @param delta The change given by Report_Check.
+ *  @param pair Set to the two deltas to send in one packet, when there are two.
+ *  @return bool - TRUE if pair is to be sent, FALSE if the delta is held back.
+ *  @note The delta held back is kept until Report_PairSent.
+ */
+bool Report_Pair(const uint8_t channelNb, const int16_t value, const int8_t delta, TReportDelta pair[2]);
+
+/*! @brief Gets the delta held back, to send on its own.
+ *
+ *  @param pair Set to the delta held back, followed by no change of the same channel.
+ *  @return bool - TRUE if a delta is held back.
+ */
+bool Report_Unpaired(TReportDelta pair[2]);
+
+/*! @brief Records a pair of deltas once their packet has been sent, and lets go of the delta held back.
+ *
+ *  @param pair The deltas sent.
+ */
+void Report_PairSent(const TReportDelta pair[2]);
+
+#endif
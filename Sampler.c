@@ -0,0 +1,619 @@
+/*! @file
+ *  Sampler.c
+ *
+ *  @brief Hardware-timed ADC scanning into a ring buffer
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Sampler_module Sampler module documentation
+**  @{
+ */
+
+#include "Sampler.h"
+#include "Profile.h"
+#include "MK70F12.h"
+#include "PE_Types.h"
+#include "CPU.h"
+
+// DMA channels: moving results, starting conversions, and moving on to the next row
+#define DMA_RESULT 0
+#define DMA_SCAN 1
+#define DMA_ROW 2
+
+// DMA request sources
+#define DMAMUX_SOURCE_ADC0 40
+#define DMAMUX_SOURCE_PDB 48
+
+// The largest PDB prescaler, dividing by 2^7
+#define PDB_MAX_PRESCALER 7
+
+// SC1 setting that stops the ADC
+#define ADCH_DISABLED 0x1F
+
+// Flipping the sign bit of a single-ended result turns 0 to 65535 into -32768 to 32767 from mid-scale
+#define SINGLE_ENDED_FLIP 0x8000
+
+// The bits a channel's results are read with flipped
+#define FLIP(channelNb) (((channelNb) < SAMPLER_NB_DIFFERENTIAL) ? 0 : SINGLE_ENDED_FLIP)
+
+// The samples, one array per enabled channel, in channel order. They are kept as the ADC gives them.
+static int16_t Samples[SAMPLER_NB_CHANNELS][SAMPLER_RING_SIZE];
+
+// The SC1A setting of each enabled channel, in scan order
+static uint32_t ScanList[SAMPLER_NB_CHANNELS];
+
+// The start of the row after each row, loaded into the result channel's destination as each row completes
+static uint32_t RowAddress[SAMPLER_RING_SIZE];
+
+// The array in Samples of each channel, or NOT_SAMPLED
+#define NOT_SAMPLED 0xFF
+static uint8_t Slot[SAMPLER_NB_CHANNELS];
+
+static uint16_t ChannelMask;
+static uint8_t NbChannels;
+
+// The bus clock and scan rate, to go back to after a burst
+static uint32_t Clock;
+static uint32_t SampleRate;
+// The PDB prescaler in use, as a power of 2
+static uint8_t Prescaler;
+
+// Called at the end of every row
+static void (*RowCallback)(void *);
+static void *RowArguments;
+// The row which finished last, and the rows missed
+static uint16_t LastRow;
+static uint32_t RowsMissed;
+
+// The burst buffer, while a burst is running
+static int16_t *BurstBuffer;
+
+// Times the DMA has wrapped round the ring since the channels were last set
+static volatile uint32_t Wraps;
+// Sample count when the channels were last set, so the count carries on across changes
+static uint32_t Base;
+
+/*! @brief Calibrates ADC0, as recommended after every reset.
+ *
+ *  @return bool - TRUE if calibration succeeded.
+ */
+static bool Calibrate(void)
+{
+  // Calibrate with the maximum hardware averaging, using the software trigger
+  ADC0_SC2 = 0;
+  ADC0_SC3 = ADC_SC3_AVGE_MASK | ADC_SC3_AVGS(3) | ADC_SC3_CAL_MASK;
+  while (ADC0_SC3 & ADC_SC3_CAL_MASK)
+    ;
+  if (ADC0_SC3 & ADC_SC3_CALF_MASK)
+    {
+      return 0;
+    }
+
+  ADC0_PG = ((ADC0_CLP0 + ADC0_CLP1 + ADC0_CLP2 + ADC0_CLP3 + ADC0_CLP4 + ADC0_CLPS) >> 1) | 0x8000;
+  ADC0_MG = ((ADC0_CLM0 + ADC0_CLM1 + ADC0_CLM2 + ADC0_CLM3 + ADC0_CLM4 + ADC0_CLMS) >> 1) | 0x8000;
+  ADC0_SC3 = 0;
+  return 1;
+}
+
+/*! @brief Sets the PDB to request a scan once per sample time.
+ *
+ *  @param moduleClk The bus clock rate in Hz.
+ *  @param sampleRate The number of sample times per second.
+ *  @return bool - TRUE if the rate can be reached.
+ */
+static bool SetRate(const uint32_t moduleClk, const uint32_t sampleRate)
+{
+  uint32_t counts = moduleClk / sampleRate;
+  uint8_t prescaler = 0;
+
+  while ((counts >> prescaler) > 0xFFFF)
+    {
+      if (++prescaler > PDB_MAX_PRESCALER)
+	{
+	  return 0;
+	}
+    }
+
+  // The PDB's interrupt flag is turned into a DMA request for the scan channel
+  PDB0_SC = PDB_SC_PRESCALER(prescaler) | PDB_SC_TRGSEL(15) | PDB_SC_CONT_MASK | PDB_SC_PDBIE_MASK | PDB_SC_DMAEN_MASK;
+  PDB0_MOD = (counts >> prescaler) - 1;
+  Prescaler = prescaler;
+  PDB0_IDLY = 0;
+  PDB0_SC |= PDB_SC_LDOK_MASK;
+  return 1;
+}
+
+/*! @brief Stops the scan, leaving the ADC and DMA idle.
+ */
+static void Stop(void)
+{
+  PDB0_SC &= ~(PDB_SC_PDBEN_MASK | PDB_SC_PDBIF_MASK);
+  DMA_CERQ = DMA_CERQ_CERQ(DMA_SCAN);
+  DMA_CERQ = DMA_CERQ_CERQ(DMA_RESULT);
+  while ((DMA_TCD0_CSR | DMA_TCD1_CSR | DMA_TCD2_CSR) & DMA_CSR_ACTIVE_MASK)
+    ;
+  // Writing SC1A aborts any conversion in progress, and reading the result drops a request left over
+  ADC0_SC1A = ADC_SC1_ADCH(ADCH_DISABLED);
+  (void) ADC0_RA;
+}
+
+/*! @brief Programs the DMA for the enabled channels and starts scanning.
+ *
+ *  @note Assumes the scan is stopped and ChannelMask isn't empty.
+ */
+static void Start(void)
+{
+  uint8_t nbChannels = 0;
+
+  for (uint8_t channelNb = 0; channelNb < SAMPLER_NB_CHANNELS; channelNb++)
+    {
+      Slot[channelNb] = NOT_SAMPLED;
+      if (ChannelMask & (1 << channelNb))
+	{
+	  Slot[channelNb] = nbChannels;
+	  ScanList[nbChannels++] = ADC_SC1_ADCH(channelNb) | ((channelNb < SAMPLER_NB_DIFFERENTIAL) ? ADC_SC1_DIFF_MASK : 0);
+	}
+    }
+  NbChannels = nbChannels;
+
+  // Scan: one SC1A write per request, from the PDB for the first channel and linked from the result channel for the rest
+  DMA_TCD1_SADDR = (uint32_t) ScanList;
+  DMA_TCD1_SOFF = sizeof(uint32_t);
+  DMA_TCD1_ATTR = DMA_ATTR_SSIZE(2) | DMA_ATTR_DSIZE(2);
+  DMA_TCD1_NBYTES_MLNO = sizeof(uint32_t);
+  DMA_TCD1_SLAST = -(int32_t) (nbChannels * sizeof(uint32_t));
+  DMA_TCD1_DADDR = (uint32_t) &ADC0_SC1A;
+  DMA_TCD1_DOFF = 0;
+  DMA_TCD1_CITER_ELINKNO = nbChannels;
+  DMA_TCD1_BITER_ELINKNO = nbChannels;
+  DMA_TCD1_DLASTSGA = 0;
+  DMA_TCD1_CSR = 0;
+
+  // Result: each conversion goes to the next channel's array, then the scan channel starts the next conversion.
+  // A row ends the major loop, which links to the row channel instead.
+  DMA_TCD0_SADDR = (uint32_t) &ADC0_RA;
+  DMA_TCD0_SOFF = 0;
+  DMA_TCD0_ATTR = DMA_ATTR_SSIZE(1) | DMA_ATTR_DSIZE(1);
+  DMA_TCD0_NBYTES_MLNO = sizeof(int16_t);
+  DMA_TCD0_SLAST = 0;
+  DMA_TCD0_DADDR = (uint32_t) &Samples[0][0];
+  DMA_TCD0_DOFF = sizeof(Samples[0]);
+  DMA_TCD0_CITER_ELINKYES = DMA_CITER_ELINKYES_ELINK_MASK | DMA_CITER_ELINKYES_LINKCH(DMA_SCAN) | DMA_CITER_ELINKYES_CITER(nbChannels);
+  DMA_TCD0_BITER_ELINKYES = DMA_BITER_ELINKYES_ELINK_MASK | DMA_BITER_ELINKYES_LINKCH(DMA_SCAN) | DMA_BITER_ELINKYES_BITER(nbChannels);
+  DMA_TCD0_DLASTSGA = 0;
+  DMA_TCD0_CSR = DMA_CSR_MAJORELINK_MASK | DMA_CSR_MAJORLINKCH(DMA_ROW) | (RowCallback ? DMA_CSR_INTMAJOR_MASK : 0);
+
+  // Row: writes the start of the next row into the result channel's destination, and interrupts once per ring
+  for (uint16_t row = 0; row < SAMPLER_RING_SIZE; row++)
+    {
+      RowAddress[row] = (uint32_t) &Samples[0][(row + 1) % SAMPLER_RING_SIZE];
+    }
+  DMA_TCD2_SADDR = (uint32_t) RowAddress;
+  DMA_TCD2_SOFF = sizeof(uint32_t);
+  DMA_TCD2_ATTR = DMA_ATTR_SSIZE(2) | DMA_ATTR_DSIZE(2);
+  DMA_TCD2_NBYTES_MLNO = sizeof(uint32_t);
+  DMA_TCD2_SLAST = -(int32_t) sizeof(RowAddress);
+  DMA_TCD2_DADDR = (uint32_t) &DMA_TCD0_DADDR;
+  DMA_TCD2_DOFF = 0;
+  DMA_TCD2_CITER_ELINKNO = SAMPLER_RING_SIZE;
+  DMA_TCD2_BITER_ELINKNO = SAMPLER_RING_SIZE;
+  DMA_TCD2_DLASTSGA = 0;
+  DMA_TCD2_CSR = DMA_CSR_INTMAJOR_MASK;
+
+  // Forget a wrap of the previous scan that hasn't been counted
+  DMA_CINT = DMA_CINT_CINT(DMA_ROW);
+  NVICICPR0 = (1 << 2);
+  Wraps = 0;
+  // And a row of the previous scan that hasn't been called back
+  DMA_CINT = DMA_CINT_CINT(DMA_RESULT);
+  NVICICPR0 = (1 << 0);
+  LastRow = SAMPLER_RING_SIZE - 1;
+  DMA_SERQ = DMA_SERQ_SERQ(DMA_RESULT);
+  DMA_SERQ = DMA_SERQ_SERQ(DMA_SCAN);
+
+  // Software trigger once; the PDB then runs continuously
+  PDB0_SC |= PDB_SC_PDBEN_MASK;
+  PDB0_SC |= PDB_SC_SWTRIG_MASK;
+}
+
+/*! @brief Sets up the ADC, PDB and DMA and starts sampling.
+ *
+ *  @param moduleClk The bus clock rate in Hz.
+ *  @param sampleRate The number of samples of each channel per second.
+ *  @param channelMask A bit for each channel to sample.
+ *  @return bool - TRUE if sampling was started.
+ */
+bool Sampler_Init(const uint32_t moduleClk, const uint32_t sampleRate, const uint16_t channelMask)
+{
+  if ((sampleRate == 0) || (sampleRate > moduleClk) || (channelMask == 0))
+    {
+      return 0;
+    }
+
+  SIM_SCGC6 |= SIM_SCGC6_ADC0_MASK | SIM_SCGC6_PDB_MASK | SIM_SCGC6_DMAMUX0_MASK;
+  SIM_SCGC7 |= SIM_SCGC7_DMA_MASK;
+
+  // 16-bit conversions from the bus clock / 4
+  ADC0_CFG1 = ADC_CFG1_ADIV(2) | ADC_CFG1_MODE(3) | ADC_CFG1_ADICLK(0);
+  ADC0_CFG2 = 0;
+  if (!Calibrate())
+    {
+      return 0;
+    }
+
+  // Each write to SC1A starts a conversion, and each result raises a DMA request instead of an interrupt
+  ADC0_SC2 = ADC_SC2_DMAEN_MASK;
+
+  DMAMUX0_CHCFG0 = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(DMAMUX_SOURCE_ADC0);
+  DMAMUX0_CHCFG1 = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(DMAMUX_SOURCE_PDB);
+
+  // Setting up NVIC for DMA channel 2
+  // Vector=18 IRQ=2
+  // NVIC non-IPR=0 IPR=0
+  NVICICPR0 = (1 << 2);
+  NVICISER0 = (1 << 2);
+
+  // Setting up NVIC for DMA channel 0
+  // Vector=16 IRQ=0
+  // NVIC non-IPR=0 IPR=0
+  NVICICPR0 = (1 << 0);
+  NVICISER0 = (1 << 0);
+
+  if (!SetRate(moduleClk, sampleRate))
+    {
+      return 0;
+    }
+  Clock = moduleClk;
+  SampleRate = sampleRate;
+  BurstBuffer = NULL;
+  RowCallback = NULL;
+  RowsMissed = 0;
+  Base = 0;
+  ChannelMask = channelMask;
+  Start();
+  return 1;
+}
+
+/*! @brief Changes the channels sampled.
+ *
+ *  @param channelMask A bit for each channel to sample.
+ *  @return bool - TRUE if sampling was restarted.
+ */
+bool Sampler_SetChannels(const uint16_t channelMask)
+{
+  if (channelMask == 0)
+    {
+      return 0;
+    }
+
+  // The row interrupt and readers mustn't see the channels half changed
+  EnterCritical();
+  ChannelMask = channelMask;
+  // A burst has the hardware; the new channels are scanned once it is over
+  if (!BurstBuffer)
+    {
+      Stop();
+      Base = Sampler_Count();
+      Start();
+    }
+  ExitCritical();
+  return 1;
+}
+
+/*! @brief Gets the channels sampled.
+ *
+ *  @return uint16_t - a bit for each channel sampled.
+ */
+uint16_t Sampler_Channels(void)
+{
+  return ChannelMask;
+}
+
+/*! @brief Gets the number of samples of each channel taken so far.
+ *
+ *  @return uint32_t - a free-running count.
+ */
+uint32_t Sampler_Count(void)
+{
+  uint32_t wraps, row;
+  bool pending;
+
+  if (BurstBuffer)
+    {
+      return Base;
+    }
+
+  // Read the wraps either side of the row, in case the DMA wraps in between
+  do
+    {
+      wraps = Wraps;
+      row = (DMA_TCD2_SADDR - (uint32_t) RowAddress) / sizeof(uint32_t);
+      pending = (DMA_INT & (1 << DMA_ROW)) != 0;
+    }
+  while (wraps != Wraps);
+
+  // The DMA has wrapped but the interrupt hasn't counted it yet, e.g. because interrupts are disabled.
+  // If the row was read just before the wrap it is still near the end, so then it isn't counted twice.
+  if (pending && (row < SAMPLER_RING_SIZE / 2))
+    {
+      wraps++;
+    }
+
+  return Base + (wraps * SAMPLER_RING_SIZE) + row;
+}
+
+/*! @brief Gets the newest sample of a channel.
+ *
+ *  @param channelNb The channel.
+ *  @param value Set to the sample.
+ *  @return bool - TRUE if channelNb is sampled and a sample has been taken.
+ */
+bool Sampler_Latest(const uint8_t channelNb, int16_t * const value)
+{
+  uint32_t count = Sampler_Count();
+
+  if ((channelNb >= SAMPLER_NB_CHANNELS) || (Slot[channelNb] == NOT_SAMPLED) || (count == Base))
+    {
+      return 0;
+    }
+  *value = (int16_t) (Samples[Slot[channelNb]][(count - Base - 1) % SAMPLER_RING_SIZE] ^ FLIP(channelNb));
+  return 1;
+}
+
+/*! @brief Converts a result as the ADC gives it to the two's complement counts the Sampler reads.
+ *
+ *  @param channelNb The channel the result is from.
+ *  @param raw The result.
+ *  @return int16_t - the sample.
+ */
+int16_t Sampler_Convert(const uint8_t channelNb, const int16_t raw)
+{
+  return (int16_t) (raw ^ FLIP(channelNb));
+}
+
+/*! @brief Copies the samples of a channel taken since a cursor.
+ *
+ *  @param channelNb The channel.
+ *  @param cursor The sample count to read from, advanced past the samples read.
+ *  @param buffer Where to put the samples.
+ *  @param maxSamples The size of the buffer.
+ *  @return uint16_t - the number of samples copied.
+ */
+uint16_t Sampler_Read(const uint8_t channelNb, uint32_t * const cursor, int16_t * const buffer, const uint16_t maxSamples)
+{
+  uint32_t count = Sampler_Count();
+  uint16_t nbRead = 0;
+
+  if ((channelNb >= SAMPLER_NB_CHANNELS) || (Slot[channelNb] == NOT_SAMPLED))
+    {
+      return 0;
+    }
+
+  // Samples from before the last change of channels are gone
+  if (count - *cursor > count - Base)
+    {
+      *cursor = Base;
+    }
+  // The oldest row is the one the DMA writes next, so leave it out
+  if (count - *cursor > SAMPLER_RING_SIZE - 1)
+    {
+      *cursor = count - (SAMPLER_RING_SIZE - 1);
+    }
+
+  const int16_t *samples = Samples[Slot[channelNb]];
+  const uint16_t flip = FLIP(channelNb);
+  while ((*cursor != count) && (nbRead < maxSamples))
+    {
+      buffer[nbRead++] = (int16_t) (samples[(*cursor - Base) % SAMPLER_RING_SIZE] ^ flip);
+      (*cursor)++;
+    }
+  return nbRead;
+}
+
+/*! @brief Sets a function to call from the interrupt at the end of every row, restarting the scan.
+ *
+ *  @param userFunction The function, or NULL for none.
+ *  @param userArguments The user arguments to use with the function.
+ *  @return bool - TRUE if the callback was set.
+ *  @note Assumes Sampler_Init has been called.
+ */
+bool Sampler_SetRowCallback(void (*userFunction)(void *), void * userArguments)
+{
+  // The interrupt is part of the result channel's setup, so it only changes while the scan is stopped
+  EnterCritical();
+  if (!BurstBuffer)
+    {
+      Stop();
+      Base = Sampler_Count();
+    }
+  RowArguments = userArguments;
+  RowCallback = userFunction;
+  if (!BurstBuffer)
+    {
+      Start();
+    }
+  ExitCritical();
+  return 1;
+}
+
+/*! @brief Gets a channel's sample from the row just finished.
+ *
+ *  @param channelNb The channel.
+ *  @param value Set to the sample.
+ *  @return bool - TRUE if channelNb is sampled.
+ *  @note Only valid in the row callback.
+ */
+bool Sampler_RowSample(const uint8_t channelNb, int16_t * const value)
+{
+  if ((channelNb >= SAMPLER_NB_CHANNELS) || (Slot[channelNb] == NOT_SAMPLED))
+    {
+      return 0;
+    }
+  *value = (int16_t) (Samples[Slot[channelNb]][LastRow] ^ FLIP(channelNb));
+  return 1;
+}
+
+/*! @brief Gets how long ago the current sample time started.
+ *
+ *  @return uint32_t - the time since the PDB started the row, in ns.
+ */
+uint32_t Sampler_SampleAge(void)
+{
+  uint32_t counts = PDB0_CNT << Prescaler;
+  return (uint32_t) (((uint64_t) counts * 1000000000LU) / Clock);
+}
+
+/*! @brief Gets the number of rows which finished before the callback of the row before had run.
+ *
+ *  @return uint32_t - the number of rows missed.
+ */
+uint32_t Sampler_RowsMissed(void)
+{
+  return RowsMissed;
+}
+
+/*! @brief Parks the scan and samples one channel into a buffer instead.
+ *
+ *  @param channelNb The channel.
+ *  @param sampleRate The number of samples per second.
+ *  @param buffer The buffer.
+ *  @param length The number of samples the buffer holds.
+ *  @return bool - TRUE if the burst was started.
+ *  @note Assumes Sampler_Init has been called.
+ */
+bool Sampler_StartBurst(const uint8_t channelNb, const uint32_t sampleRate, int16_t * const buffer, const uint16_t length)
+{
+  if ((channelNb >= SAMPLER_NB_CHANNELS) || (sampleRate == 0) || (sampleRate > SAMPLER_BURST_MAX_RATE)
+      || (length == 0) || (length > SAMPLER_BURST_MAX_LENGTH))
+    {
+      return 0;
+    }
+
+  if (BurstBuffer)
+    {
+      (void) Sampler_StopBurst();
+    }
+  EnterCritical();
+  Stop();
+  Base = Sampler_Count();
+  if (!SetRate(Clock, sampleRate))
+    {
+      // Carry on scanning as before
+      Start();
+      ExitCritical();
+      return 0;
+    }
+  // The count stands still at Base from here
+  BurstBuffer = buffer;
+
+  // Scan: the PDB request writes the one channel's setup into SC1A every time
+  ScanList[0] = ADC_SC1_ADCH(channelNb) | ((channelNb < SAMPLER_NB_DIFFERENTIAL) ? ADC_SC1_DIFF_MASK : 0);
+  DMA_TCD1_SADDR = (uint32_t) ScanList;
+  DMA_TCD1_SOFF = 0;
+  DMA_TCD1_ATTR = DMA_ATTR_SSIZE(2) | DMA_ATTR_DSIZE(2);
+  DMA_TCD1_NBYTES_MLNO = sizeof(uint32_t);
+  DMA_TCD1_SLAST = 0;
+  DMA_TCD1_DADDR = (uint32_t) &ADC0_SC1A;
+  DMA_TCD1_DOFF = 0;
+  DMA_TCD1_CITER_ELINKNO = 1;
+  DMA_TCD1_BITER_ELINKNO = 1;
+  DMA_TCD1_DLASTSGA = 0;
+  DMA_TCD1_CSR = 0;
+
+  // Result: straight into the buffer, going back to its start at the end of the major loop
+  DMA_TCD0_SADDR = (uint32_t) &ADC0_RA;
+  DMA_TCD0_SOFF = 0;
+  DMA_TCD0_ATTR = DMA_ATTR_SSIZE(1) | DMA_ATTR_DSIZE(1);
+  DMA_TCD0_NBYTES_MLNO = sizeof(int16_t);
+  DMA_TCD0_SLAST = 0;
+  DMA_TCD0_DADDR = (uint32_t) buffer;
+  DMA_TCD0_DOFF = sizeof(int16_t);
+  DMA_TCD0_CITER_ELINKNO = length;
+  DMA_TCD0_BITER_ELINKNO = length;
+  DMA_TCD0_DLASTSGA = -(int32_t) (length * sizeof(int16_t));
+  DMA_TCD0_CSR = 0;
+
+  DMA_SERQ = DMA_SERQ_SERQ(DMA_RESULT);
+  DMA_SERQ = DMA_SERQ_SERQ(DMA_SCAN);
+  PDB0_SC |= PDB_SC_PDBEN_MASK;
+  PDB0_SC |= PDB_SC_SWTRIG_MASK;
+  ExitCritical();
+  return 1;
+}
+
+/*! @brief Gets where the burst is up to.
+ *
+ *  @return uint16_t - the index in the buffer of the next sample.
+ */
+uint16_t Sampler_BurstPosition(void)
+{
+  if (!BurstBuffer)
+    {
+      return 0;
+    }
+  return (DMA_TCD0_DADDR - (uint32_t) BurstBuffer) / sizeof(int16_t);
+}
+
+/*! @brief Stops a burst and goes back to scanning.
+ *
+ *  @return uint16_t - the index in the buffer after the last sample.
+ */
+uint16_t Sampler_StopBurst(void)
+{
+  if (!BurstBuffer)
+    {
+      return 0;
+    }
+
+  EnterCritical();
+  Stop();
+  uint16_t position = Sampler_BurstPosition();
+  BurstBuffer = NULL;
+  (void) SetRate(Clock, SampleRate);
+  Start();
+  ExitCritical();
+  return position;
+}
+
+/*! @brief Interrupt service routine for DMA channel 2.
+ *
+ *  The sampler has filled the ring and wrapped round.
+ */
+void __attribute__ ((interrupt)) DMA2_ISR(void)
+{
+  DMA_CINT = DMA_CINT_CINT(DMA_ROW);
+  Wraps++;
+}
+
+/*! @brief Interrupt service routine for DMA channel 0.
+ *
+ *  A row has finished, so the row callback is called.
+ */
+void __attribute__ ((interrupt)) DMA0_ISR(void)
+{
+  PROFILE_ENTER(PROFILE_SAMPLER);
+  DMA_CINT = DMA_CINT_CINT(DMA_RESULT);
+
+  // The result channel ends a row pointing past the last array. Once the row channel has moved it on it points
+  // at the next row of the first array, or further on if the next row has started.
+  uint32_t offset = DMA_TCD0_DADDR - (uint32_t) &Samples[0][0];
+  uint16_t row = (offset % sizeof(Samples[0])) / sizeof(int16_t);
+  if (offset / sizeof(Samples[0]) < NbChannels)
+    {
+      row = (row + SAMPLER_RING_SIZE - 1) % SAMPLER_RING_SIZE;
+    }
+  RowsMissed += (row + SAMPLER_RING_SIZE - LastRow - 1) % SAMPLER_RING_SIZE;
+  LastRow = row;
+
+  if (RowCallback)
+    {
+      (*RowCallback)(RowArguments);
+    }
+  PROFILE_EXIT(PROFILE_SAMPLER);
+}
+
+/* END Sampler */
+/*!
+** @}
+*/
@@ -0,0 +1,168 @@
+/*! @file
+ *
+ *  @brief Hardware-timed ADC scanning into a ring buffer.
+ *
+ *  The PDB starts a scan of the enabled channels at a fixed rate. The scan runs entirely in DMA:
+ *  one channel writes each channel's setup into ADC0_SC1A to start its conversion, a second moves the result into
+ *  the ring and links back to the first, and at the end of the row a third points the second at the next row.
+ *  The CPU does no work per sample or per row; the only interrupt is a count of ring wraps.
+ *  The ring is a structure of arrays, one array of SAMPLER_RING_SIZE samples per enabled channel.
+ *  Readers keep their own cursor, so several consumers can read the same samples at their own pace.
+ *  For short bursts the scan can be parked while one channel is sampled much faster into a separate buffer.
+ *  Work that has to keep up with every sample, like driving an output, can run in a callback at the end of each row.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+// new types
+#include "types.h"
+
+// Number of channels that can be sampled. Channels 0 to 3 are ADC0 differential pairs 0 to 3,
+// and channels 4 to 15 are single-ended ADC0 inputs 4 to 15.
+// Every channel reads in two's complement counts. The ADC gives single-ended results unsigned, so they are read with
+// the sign bit flipped: counts from mid-scale, which filter and add up like the differential channels.
+#define SAMPLER_NB_CHANNELS 16
+
+// Number of differential channels, at the start
+#define SAMPLER_NB_DIFFERENTIAL 4
+
+// Number of samples of each channel held. Must be a power of 2.
+#define SAMPLER_RING_SIZE 128
+
+// Fastest burst sample rate, limited by the 16-bit conversion time
+#define SAMPLER_BURST_MAX_RATE 200000
+
+// Largest burst buffer, in samples
+#define SAMPLER_BURST_MAX_LENGTH 0x7FFF
+
+/*! @brief Sets up the ADC, PDB and DMA and starts sampling.
+ *
+ *  @param moduleClk The bus clock rate in Hz.
+ *  @param sampleRate The number of samples of each channel per second.
+ *  @param channelMask A bit for each channel to sample.
+ *  @return bool - TRUE if sampling was started.
+ */
+bool Sampler_Init(const uint32_t moduleClk, const uint32_t sampleRate, const uint16_t channelMask);
+
+/*! @brief Changes the channels sampled.
+ *
+ *  Samples taken before the change can no longer be read. The scan is restarted with interrupts disabled,
+ *  so the row interrupt never sees the channels half changed.
+ *  @param channelMask A bit for each channel to sample.
+ *  @return bool - TRUE if sampling was restarted.
+ *  @note Assumes Sampler_Init has been called.
+ */
+bool Sampler_SetChannels(const uint16_t channelMask);
+
+/*! @brief Gets the channels sampled.
+ *
+ *  @return uint16_t - a bit for each channel sampled.
+ */
+uint16_t Sampler_Channels(void);
+
+/*! @brief Gets the number of samples of each channel taken so far.
+ *
+ *  @return uint32_t - a free-running count, which wraps. It is the cursor of the next sample.
+ */
+uint32_t Sampler_Count(void);
+
+/*! @brief Gets the newest sample of a channel.
+ *
+ *  @param channelNb The channel.
+ *  @param value Set to the sample, in ADC counts.
+ *  @return bool - TRUE if channelNb is sampled and a sample has been taken.
+ */
+bool Sampler_Latest(const uint8_t channelNb, int16_t* const value);
+
+/*! @brief Converts a result as the ADC gives it, e.g. in a burst buffer, to the two's complement counts the Sampler reads.
+ *
+ *  @param channelNb The channel the result is from.
+ *  @param raw The result.
+ *  @return int16_t - the sample, in two's complement counts.
+ */
+int16_t Sampler_Convert(const uint8_t channelNb, const int16_t raw);
+
+/*! @brief Copies the samples of a channel taken since a cursor.
+ *
+ *  @param channelNb The channel.
+ *  @param cursor The sample count to read from, advanced past the samples read.
+ *    If the reader has fallen a whole ring behind, it skips to the oldest sample still held.
+ *  @param buffer Where to put the samples.
+ *  @param maxSamples The size of the buffer.
+ *  @return uint16_t - the number of samples copied.
+ */
+uint16_t Sampler_Read(const uint8_t channelNb, uint32_t* const cursor, int16_t* const buffer, const uint16_t maxSamples);
+
+/*! @brief Sets a function to call from the interrupt at the end of every row, restarting the scan.
+ *
+ *  The callback must be done before the next row is, or rows are missed.
+ *  @param userFunction The function, or NULL for none, which turns the interrupt off.
+ *  @param userArguments The user arguments to use with the function.
+ *  @return bool - TRUE if the callback was set.
+ *  @note Assumes Sampler_Init has been called. There is no callback during a burst.
+ */
+bool Sampler_SetRowCallback(void (*userFunction)(void*), void* userArguments);
+
+/*! @brief Gets a channel's sample from the row just finished.
+ *
+ *  @param channelNb The channel.
+ *  @param value Set to the sample, in ADC counts.
+ *  @return bool - TRUE if channelNb is sampled.
+ *  @note Only valid in the row callback.
+ */
+bool Sampler_RowSample(const uint8_t channelNb, int16_t* const value);
+
+/*! @brief Gets how long ago the current sample time started.
+ *
+ *  @return uint32_t - the time since the PDB started the row, in ns.
+ */
+uint32_t Sampler_SampleAge(void);
+
+/*! @brief Gets the number of rows which finished before the callback of the row before had run.
+ *
+ *  @return uint32_t - the number of rows missed since Sampler_Init.
+ */
+uint32_t Sampler_RowsMissed(void);
+
+/*! @brief Parks the scan and samples one channel into a buffer instead, round and round until Sampler_StopBurst.
+ *
+ *  While the burst runs the sample count stands still, so readers just see no new samples.
+ *  @param channelNb The channel.
+ *  @param sampleRate The number of samples per second, up to SAMPLER_BURST_MAX_RATE.
+ *  @param buffer The buffer, which the DMA writes from the start. It holds results as the ADC gives them, see Sampler_Convert.
+ *  @param length The number of samples the buffer holds, up to SAMPLER_BURST_MAX_LENGTH.
+ *  @return bool - TRUE if the burst was started.
+ *  @note Assumes Sampler_Init has been called.
+ */
+bool Sampler_StartBurst(const uint8_t channelNb, const uint32_t sampleRate, int16_t* const buffer, const uint16_t length);
+
+/*! @brief Gets where the burst is up to.
+ *
+ *  @return uint16_t - the index in the buffer of the next sample.
+ */
+uint16_t Sampler_BurstPosition(void);
+
+/*! @brief Stops a burst and goes back to scanning.
+ *
+ *  @return uint16_t - the index in the buffer after the last sample.
+ *  @note The samples in the buffer are left as they are.
+ */
+uint16_t Sampler_StopBurst(void);
+
+/*! @brief Interrupt service routine for DMA channel 2.
+ *
+ *  The sampler has filled the ring and wrapped round.
+ */
+void __attribute__ ((interrupt)) DMA2_ISR(void);
+
+/*! @brief Interrupt service routine for DMA channel 0.
+ *
+ *  A row has finished, so the row callback is called.
+ */
+void __attribute__ ((interrupt)) DMA0_ISR(void);
+
+#endif
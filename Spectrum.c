@@ -0,0 +1,571 @@
+/*! @file
+ *  Spectrum.c
+ *
+ *  @brief Harmonic analysis of the sampled analog channels
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Spectrum_module Spectrum module documentation
+**  @{
+ */
+
+#include "Spectrum.h"
+#include "Sampler.h"
+
+#if defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#endif
+
+// Samples taken from the Sampler at a time
+#define CHUNK_SIZE 32
+
+// Number of CORDIC iterations, one per bit of the angles
+#define CORDIC_STEPS 31
+
+// 1 / the CORDIC gain, in Q30
+#define CORDIC_GAIN 652032874L
+
+// Angles are in 1/2^32 turns
+#define HALF_TURN 0x80000000LU
+#define QUARTER_TURN 0x40000000LU
+
+/*!
+ * @brief The state of one Goertzel bin.
+ */
+typedef struct
+{
+  uint32_t cursor;        /*!< The Sampler count of the next sample. */
+  uint32_t step;          /*!< The frequency, in 1/2^32 turns per sample. */
+  int32_t cosine;         /*!< The cosine of the step in Q30, which is also 2cos in Q29. */
+  int32_t sine;           /*!< The sine of the step in Q30. */
+  int32_t s1;             /*!< The last output of the resonator. */
+  int32_t s2;             /*!< The output before that. */
+  uint16_t blockLength;   /*!< The number of samples in a block. */
+  uint16_t count;         /*!< The number of samples in the current block. */
+  uint8_t channelNb;      /*!< The Sampler channel. */
+  uint8_t shift;          /*!< The right shift of the samples which keeps the resonator from overflowing. */
+  bool enabled;           /*!< TRUE if the bin is running. */
+  bool done;              /*!< TRUE once a block has finished. */
+  TSpectrumValue value;   /*!< The result of the last block. */
+} TBin;
+
+/*!
+ * @brief Where the FFT is up to.
+ */
+typedef enum
+{
+  FFT_IDLE,
+  FFT_COLLECTING,
+  FFT_DONE
+} TFFTState;
+
+// atan(2^-i), in 1/2^32 turns
+static const uint32_t Atan[CORDIC_STEPS] =
+{
+  0x20000000LU, 0x12E4051ELU, 0x09FB385BLU, 0x051111D4LU, 0x028B0D43LU, 0x0145D7E1LU,
+  0x00A2F61ELU, 0x00517C55LU, 0x0028BE53LU, 0x00145F2FLU, 0x000A2F98LU, 0x000517CCLU,
+  0x00028BE6LU, 0x000145F3LU, 0x0000A2FALU, 0x0000517DLU, 0x000028BELU, 0x0000145FLU,
+  0x00000A30LU, 0x00000518LU, 0x0000028CLU, 0x00000146LU, 0x000000A3LU, 0x00000051LU,
+  0x00000029LU, 0x00000014LU, 0x0000000ALU, 0x00000005LU, 0x00000003LU, 0x00000001LU,
+  0x00000001LU
+};
+
+static uint32_t SampleRate;
+static TBin Bins[SPECTRUM_MAX_BINS];
+
+// e^(j2πk/SPECTRUM_FFT_SIZE) as Q15 (cos, sin) pairs, cos in the low half. The butterflies only go up to 3/4 of a turn.
+static uint32_t Twiddles[3 * SPECTRUM_FFT_SIZE / 4];
+
+// The FFT, as complex Q15 (real, imaginary) pairs, real in the low half
+static uint32_t FFT[SPECTRUM_FFT_SIZE];
+static TFFTState FFTState;
+static uint8_t FFTChannel;
+static uint32_t FFTCursor;
+static uint16_t FFTCount;
+
+/*! @brief Works out the cosine and sine of an angle with CORDIC.
+ *
+ *  @param angle The angle, in 1/2^32 turns.
+ *  @param cosine Set to the cosine, in Q30.
+ *  @param sine Set to the sine, in Q30.
+ */
+static void Rotate(uint32_t angle, int32_t * const cosine, int32_t * const sine)
+{
+  // CORDIC only converges within a quarter turn of 0, so turn the other half round first
+  bool flip = ((angle + QUARTER_TURN) & HALF_TURN) != 0;
+  if (flip)
+    {
+      angle += HALF_TURN;
+    }
+
+  int32_t z = (int32_t) angle;
+  int32_t x = CORDIC_GAIN;
+  int32_t y = 0;
+  for (uint8_t i = 0; i < CORDIC_STEPS; i++)
+    {
+      int32_t x0 = x;
+      if (z >= 0)
+	{
+	  x -= y >> i;
+	  y += x0 >> i;
+	  z -= Atan[i];
+	}
+      else
+	{
+	  x += y >> i;
+	  y -= x0 >> i;
+	  z += Atan[i];
+	}
+    }
+
+  *cosine = flip ? -x : x;
+  *sine = flip ? -y : y;
+}
+
+/*! @brief Works out the magnitude and angle of a complex number with CORDIC.
+ *
+ *  @param re The real part, no larger than 2^32 either way.
+ *  @param im The imaginary part, no larger than 2^32 either way.
+ *  @param angle Set to the angle, in 1/2^32 turns.
+ *  @return uint64_t - the magnitude.
+ */
+static uint64_t Polar(int64_t re, int64_t im, uint32_t * const angle)
+{
+  uint32_t z = 0;
+
+  if (re < 0)
+    {
+      re = -re;
+      im = -im;
+      z = HALF_TURN;
+    }
+  for (uint8_t i = 0; i < CORDIC_STEPS; i++)
+    {
+      int64_t re0 = re;
+      if (im > 0)
+	{
+	  re += im >> i;
+	  im -= re0 >> i;
+	  z += Atan[i];
+	}
+      else
+	{
+	  re -= im >> i;
+	  im += re0 >> i;
+	  z -= Atan[i];
+	}
+    }
+
+  *angle = z;
+  return ((uint64_t) re * CORDIC_GAIN) >> 30;
+}
+
+/*! @brief Makes a spectrum value, saturating the amplitude.
+ *
+ *  @param amplitude The amplitude, in ADC counts.
+ *  @param angle The phase, in 1/2^32 turns.
+ *  @return TSpectrumValue - the value.
+ */
+static TSpectrumValue Value(const uint64_t amplitude, const uint32_t angle)
+{
+  TSpectrumValue value;
+
+  value.amplitude = (amplitude > 0xFFFF) ? 0xFFFF : (uint16_t) amplitude;
+  value.phase = (int16_t) (angle >> 16);
+  return value;
+}
+
+/*! @brief Packs a complex number into a word.
+ *
+ *  @param re The real part.
+ *  @param im The imaginary part.
+ *  @return uint32_t - the real part in the low half, the imaginary in the high half.
+ */
+static inline uint32_t Pack(const int32_t re, const int32_t im)
+{
+  return (uint16_t) re | ((uint32_t) (uint16_t) im << 16);
+}
+
+static inline int32_t Re(const uint32_t x)
+{
+  return (int16_t) x;
+}
+
+static inline int32_t Im(const uint32_t x)
+{
+  return (int16_t) (x >> 16);
+}
+
+/*! @brief (x + y) / 2 of two packed complex numbers. */
+static inline uint32_t HalfAdd(const uint32_t x, const uint32_t y)
+{
+#if defined(__ARM_FEATURE_DSP)
+  return __shadd16(x, y);
+#else
+  return Pack((Re(x) + Re(y)) >> 1, (Im(x) + Im(y)) >> 1);
+#endif
+}
+
+/*! @brief (x - y) / 2 of two packed complex numbers. */
+static inline uint32_t HalfSub(const uint32_t x, const uint32_t y)
+{
+#if defined(__ARM_FEATURE_DSP)
+  return __shsub16(x, y);
+#else
+  return Pack((Re(x) - Re(y)) >> 1, (Im(x) - Im(y)) >> 1);
+#endif
+}
+
+/*! @brief (x + jy) / 2 of two packed complex numbers. */
+static inline uint32_t HalfAddJ(const uint32_t x, const uint32_t y)
+{
+#if defined(__ARM_FEATURE_DSP)
+  return __shasx(x, y);
+#else
+  return Pack((Re(x) - Im(y)) >> 1, (Im(x) + Re(y)) >> 1);
+#endif
+}
+
+/*! @brief (x - jy) / 2 of two packed complex numbers. */
+static inline uint32_t HalfSubJ(const uint32_t x, const uint32_t y)
+{
+#if defined(__ARM_FEATURE_DSP)
+  return __shsax(x, y);
+#else
+  return Pack((Re(x) + Im(y)) >> 1, (Im(x) - Re(y)) >> 1);
+#endif
+}
+
+/*! @brief Rotates a packed complex number back by a twiddle factor, x·conj(w). */
+static inline uint32_t Twiddle(const uint32_t x, const uint32_t w)
+{
+#if defined(__ARM_FEATURE_DSP)
+  return Pack(__smuad(x, w) >> 15, __smusdx(w, x) >> 15);
+#else
+  return Pack(((Re(x) * Re(w)) + (Im(x) * Im(w))) >> 15, ((Re(w) * Im(x)) - (Im(w) * Re(x))) >> 15);
+#endif
+}
+
+/*! @brief Gets the position of an FFT output in the butterfly order, which has its base 4 digits reversed.
+ *
+ *  @param index The output.
+ *  @return uint16_t - where the butterflies leave it.
+ */
+static uint16_t DigitReverse(uint16_t index)
+{
+  uint16_t reversed = 0;
+
+  for (uint16_t n = SPECTRUM_FFT_SIZE; n > 1; n >>= 2)
+    {
+      reversed = (reversed << 2) | (index & 3);
+      index >>= 2;
+    }
+  return reversed;
+}
+
+/*! @brief Transforms the samples in FFT in place, into their spectrum in natural order.
+ *
+ *  Radix-4 decimation in frequency. Each stage halves twice as it adds, so the output is scaled by 1/SPECTRUM_FFT_SIZE
+ *  and can't overflow.
+ */
+static void Transform(void)
+{
+  for (uint16_t span = SPECTRUM_FFT_SIZE; span > 1; span >>= 2)
+    {
+      uint16_t quarter = span / 4;
+      uint16_t stride = SPECTRUM_FFT_SIZE / span;
+
+      for (uint16_t j = 0; j < quarter; j++)
+	{
+	  uint32_t w1 = Twiddles[j * stride];
+	  uint32_t w2 = Twiddles[2 * j * stride];
+	  uint32_t w3 = Twiddles[3 * j * stride];
+
+	  for (uint16_t i = j; i < SPECTRUM_FFT_SIZE; i += span)
+	    {
+	      uint32_t t0 = HalfAdd(FFT[i], FFT[i + (2 * quarter)]);
+	      uint32_t t1 = HalfSub(FFT[i], FFT[i + (2 * quarter)]);
+	      uint32_t t2 = HalfAdd(FFT[i + quarter], FFT[i + (3 * quarter)]);
+	      uint32_t t3 = HalfSub(FFT[i + quarter], FFT[i + (3 * quarter)]);
+
+	      FFT[i] = HalfAdd(t0, t2);
+	      FFT[i + quarter] = HalfSubJ(t1, t3);
+	      FFT[i + (2 * quarter)] = HalfSub(t0, t2);
+	      FFT[i + (3 * quarter)] = HalfAddJ(t1, t3);
+	      // The first butterfly of each group has no twiddle, and Q15 can't hold 1 exactly
+	      if (j)
+		{
+		  FFT[i + quarter] = Twiddle(FFT[i + quarter], w1);
+		  FFT[i + (2 * quarter)] = Twiddle(FFT[i + (2 * quarter)], w2);
+		  FFT[i + (3 * quarter)] = Twiddle(FFT[i + (3 * quarter)], w3);
+		}
+	    }
+	}
+    }
+
+  for (uint16_t i = 0; i < SPECTRUM_FFT_SIZE; i++)
+    {
+      uint16_t reversed = DigitReverse(i);
+      if (reversed > i)
+	{
+	  uint32_t swap = FFT[i];
+	  FFT[i] = FFT[reversed];
+	  FFT[reversed] = swap;
+	}
+    }
+}
+
+/*! @brief Works out the amplitude and phase of a bin at the end of a block, and starts the next one.
+ *
+ *  @param bin The bin.
+ */
+static void Finish(TBin * const bin)
+{
+  uint32_t angle;
+
+  // y = s1 - e^-jw s2, which is the DFT of the block turned on by the w of the last sample
+  int64_t re = (int64_t) bin->s1 - (((int64_t) bin->s2 * bin->cosine) >> 30);
+  int64_t im = ((int64_t) bin->s2 * bin->sine) >> 30;
+  uint64_t magnitude = Polar(re, im, &angle) << bin->shift;
+
+  bin->value = Value((2 * magnitude) / bin->blockLength, angle - (bin->step * (uint32_t) (bin->blockLength - 1)));
+  bin->done = 1;
+  bin->s1 = 0;
+  bin->s2 = 0;
+  bin->count = 0;
+}
+
+/*! @brief Turns every bin off and cancels any FFT.
+ *
+ *  @param sampleRate The rate the Sampler takes samples at, in Hz.
+ *  @return bool - TRUE if the spectral analysis was successfully initialized.
+ *  @note Assumes the Sampler has been initialized.
+ */
+bool Spectrum_Init(const uint32_t sampleRate)
+{
+  if (sampleRate == 0)
+    {
+      return 0;
+    }
+  SampleRate = sampleRate;
+
+  for (uint8_t binNb = 0; binNb < SPECTRUM_MAX_BINS; binNb++)
+    {
+      Bins[binNb].enabled = 0;
+      Bins[binNb].done = 0;
+    }
+
+  for (uint16_t k = 0; k < sizeof(Twiddles) / sizeof(Twiddles[0]); k++)
+    {
+      int32_t cosine, sine;
+      Rotate(k * (uint32_t) (0x100000000ULL / SPECTRUM_FFT_SIZE), &cosine, &sine);
+      // Round Q30 to Q15, where 1.0 only just doesn't fit
+      cosine = (cosine + (1L << 14)) >> 15;
+      sine = (sine + (1L << 14)) >> 15;
+      Twiddles[k] = Pack((cosine > INT16_MAX) ? INT16_MAX : cosine, (sine > INT16_MAX) ? INT16_MAX : sine);
+    }
+
+  FFTState = FFT_IDLE;
+  return 1;
+}
+
+/*! @brief Sets the frequency a bin tracks, starting a new block from the newest sample.
+ *
+ *  @param binNb The bin.
+ *  @param channelNb The Sampler channel.
+ *  @param frequency The frequency in tenths of a Hz, or 0 to turn the bin off.
+ *  @param blockLength The number of samples in a block.
+ *  @return bool - TRUE if the bin was set.
+ */
+bool Spectrum_SetBin(const uint8_t binNb, const uint8_t channelNb, const uint16_t frequency, const uint16_t blockLength)
+{
+  if (binNb >= SPECTRUM_MAX_BINS)
+    {
+      return 0;
+    }
+
+  TBin *bin = &Bins[binNb];
+  if (frequency == 0)
+    {
+      bin->enabled = 0;
+      bin->done = 0;
+      return 1;
+    }
+  if ((channelNb >= SAMPLER_NB_CHANNELS) || (blockLength == 0) || (blockLength > SPECTRUM_MAX_BLOCK)
+      || ((2 * (uint32_t) frequency) >= (10 * SampleRate)))
+    {
+      return 0;
+    }
+
+  bin->enabled = 0;
+  bin->channelNb = channelNb;
+  bin->blockLength = blockLength;
+  bin->step = (uint32_t) (((uint64_t) frequency << 32) / (10 * SampleRate));
+  Rotate(bin->step, &bin->cosine, &bin->sine);
+
+  // A full scale tone at the bin's frequency grows the resonator by up to 1/sin(w) each sample
+  uint32_t sine = (bin->sine < 0) ? -bin->sine : bin->sine;
+  bin->shift = 0;
+  while (((uint64_t) sine << bin->shift) < ((uint64_t) blockLength << 15))
+    {
+      bin->shift++;
+    }
+
+  bin->cursor = Sampler_Count();
+  bin->s1 = 0;
+  bin->s2 = 0;
+  bin->count = 0;
+  bin->done = 0;
+  bin->enabled = 1;
+  return 1;
+}
+
+/*! @brief Starts an FFT on the next SPECTRUM_FFT_SIZE samples of a channel, replacing any earlier one.
+ *
+ *  @param channelNb The Sampler channel.
+ *  @return bool - TRUE if the FFT was started.
+ */
+bool Spectrum_StartFFT(const uint8_t channelNb)
+{
+  if (channelNb >= SAMPLER_NB_CHANNELS)
+    {
+      return 0;
+    }
+
+  FFTChannel = channelNb;
+  FFTCursor = Sampler_Count();
+  FFTCount = 0;
+  FFTState = FFT_COLLECTING;
+  return 1;
+}
+
+/*! @brief Runs the bins, and the FFT, over the samples taken since the last call.
+ *
+ *  @return uint8_t - a bit for each bin which finished a block.
+ *  @note Assumes Spectrum_Init has been called.
+ */
+uint8_t Spectrum_Update(void)
+{
+  int16_t samples[CHUNK_SIZE];
+  uint8_t finished = 0;
+
+  for (uint8_t binNb = 0; binNb < SPECTRUM_MAX_BINS; binNb++)
+    {
+      TBin *bin = &Bins[binNb];
+      if (!bin->enabled)
+	{
+	  continue;
+	}
+
+      uint16_t nbSamples;
+      do
+	{
+	  // Stop at the end of the block, so each block is finished as soon as it is in
+	  uint16_t wanted = bin->blockLength - bin->count;
+	  nbSamples = Sampler_Read(bin->channelNb, &bin->cursor, samples, (wanted < CHUNK_SIZE) ? wanted : CHUNK_SIZE);
+
+	  int32_t s1 = bin->s1;
+	  int32_t s2 = bin->s2;
+	  for (uint16_t i = 0; i < nbSamples; i++)
+	    {
+	      int32_t s0 = (int32_t) ((samples[i] >> bin->shift) + (((int64_t) bin->cosine * s1) >> 29) - s2);
+	      s2 = s1;
+	      s1 = s0;
+	    }
+	  bin->s1 = s1;
+	  bin->s2 = s2;
+
+	  bin->count += nbSamples;
+	  if (bin->count == bin->blockLength)
+	    {
+	      Finish(bin);
+	      finished |= (1 << binNb);
+	    }
+	}
+      while (nbSamples);
+    }
+
+  while (FFTState == FFT_COLLECTING)
+    {
+      uint16_t wanted = SPECTRUM_FFT_SIZE - FFTCount;
+      uint16_t nbSamples = Sampler_Read(FFTChannel, &FFTCursor, samples, (wanted < CHUNK_SIZE) ? wanted : CHUNK_SIZE);
+      if (nbSamples == 0)
+	{
+	  break;
+	}
+      for (uint16_t i = 0; i < nbSamples; i++)
+	{
+	  FFT[FFTCount++] = Pack(samples[i], 0);
+	}
+      if (FFTCount == SPECTRUM_FFT_SIZE)
+	{
+	  Transform();
+	  FFTState = FFT_DONE;
+	}
+    }
+
+  return finished;
+}
+
+/*! @brief Gets the result of the last block of a bin.
+ *
+ *  @param binNb The bin.
+ *  @param value Set to the amplitude and phase of the bin's frequency.
+ *  @return bool - TRUE if the bin has finished a block.
+ */
+bool Spectrum_GetBin(const uint8_t binNb, TSpectrumValue * const value)
+{
+  if ((binNb >= SPECTRUM_MAX_BINS) || !Bins[binNb].done)
+    {
+      return 0;
+    }
+  *value = Bins[binNb].value;
+  return 1;
+}
+
+/*! @brief Checks whether the FFT started last has finished.
+ *
+ *  @return bool - TRUE if its values can be read.
+ */
+bool Spectrum_FFTDone(void)
+{
+  return (FFTState == FFT_DONE);
+}
+
+/*! @brief Gets values of the FFT started last.
+ *
+ *  @param first The first value.
+ *  @param values Where to put the values.
+ *  @param nbValues The number of values wanted.
+ *  @return uint8_t - the number of values copied, 0 if the FFT hasn't finished.
+ */
+uint8_t Spectrum_ReadFFT(const uint8_t first, TSpectrumValue * const values, const uint8_t nbValues)
+{
+  uint8_t nbRead = 0;
+
+  if (FFTState != FFT_DONE)
+    {
+      return 0;
+    }
+
+  for (uint16_t k = first; (k < SPECTRUM_FFT_NB_VALUES) && (nbRead < nbValues); k++)
+    {
+      uint32_t angle;
+      uint64_t magnitude = Polar(Re(FFT[k]), Im(FFT[k]), &angle);
+
+      // The output is already divided by the number of points. Away from DC and half the sample rate,
+      // the other half of each tone's amplitude is in the mirror image above half the sample rate.
+      if ((k != 0) && (k != SPECTRUM_FFT_SIZE / 2))
+	{
+	  magnitude *= 2;
+	}
+      values[nbRead++] = Value(magnitude, angle);
+    }
+  return nbRead;
+}
+
+/* END Spectrum */
+/*!
+** @}
+*/
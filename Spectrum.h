@@ -0,0 +1,99 @@
+/*! @file
+ *
+ *  @brief Harmonic analysis of the sampled analog channels.
+ *
+ *  Up to SPECTRUM_MAX_BINS Goertzel filters each track one frequency on one channel, over consecutive blocks
+ *  of samples, and only their amplitude and phase is passed on once a block is done.
+ *  A SPECTRUM_FFT_SIZE point radix-4 FFT of one block of a channel can also be taken on request.
+ *  Everything is fixed point: the FFT uses the Cortex-M4 SIMD instructions when the DSP extension is available,
+ *  and portable C otherwise, with bit-identical results.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+// new types
+#include "types.h"
+
+// Number of Goertzel bins
+#define SPECTRUM_MAX_BINS 8
+
+// Longest Goertzel block, in samples
+#define SPECTRUM_MAX_BLOCK 4096
+
+// Number of points of the FFT. Must be a power of 4.
+#define SPECTRUM_FFT_SIZE 256
+
+// Number of FFT values, from DC up to half the sample rate
+#define SPECTRUM_FFT_NB_VALUES (SPECTRUM_FFT_SIZE / 2 + 1)
+
+/*!
+ * @brief One frequency component of a signal.
+ */
+typedef struct
+{
+  uint16_t amplitude;   /*!< The peak amplitude, in ADC counts. */
+  int16_t phase;        /*!< The phase of its cosine at the start of the block, in 1/65536 turns. */
+} TSpectrumValue;
+
+/*! @brief Turns every bin off and cancels any FFT.
+ *
+ *  @param sampleRate The rate the Sampler takes samples at, in Hz.
+ *  @return bool - TRUE if the spectral analysis was successfully initialized.
+ *  @note Assumes the Sampler has been initialized.
+ */
+bool Spectrum_Init(const uint32_t sampleRate);
+
+/*! @brief Sets the frequency a bin tracks, starting a new block from the newest sample.
+ *
+ *  @param binNb The bin.
+ *  @param channelNb The Sampler channel.
+ *  @param frequency The frequency in tenths of a Hz, strictly between 0 and half the sample rate, or 0 to turn the bin off.
+ *  @param blockLength The number of samples in a block, from 1 to SPECTRUM_MAX_BLOCK.
+ *    Frequencies less than sampleRate / blockLength apart can't be told apart.
+ *  @return bool - TRUE if the bin was set.
+ */
+bool Spectrum_SetBin(const uint8_t binNb, const uint8_t channelNb, const uint16_t frequency, const uint16_t blockLength);
+
+/*! @brief Starts an FFT on the next SPECTRUM_FFT_SIZE samples of a channel, replacing any earlier one.
+ *
+ *  @param channelNb The Sampler channel.
+ *  @return bool - TRUE if the FFT was started.
+ */
+bool Spectrum_StartFFT(const uint8_t channelNb);
+
+/*! @brief Runs the bins, and the FFT, over the samples taken since the last call.
+ *
+ *  Must be called at least once per Sampler ring, or samples are lost.
+ *  @return uint8_t - a bit for each bin which finished a block.
+ *  @note Assumes Spectrum_Init has been called.
+ */
+uint8_t Spectrum_Update(void);
+
+/*! @brief Gets the result of the last block of a bin.
+ *
+ *  @param binNb The bin.
+ *  @param value Set to the amplitude and phase of the bin's frequency.
+ *  @return bool - TRUE if the bin has finished a block.
+ */
+bool Spectrum_GetBin(const uint8_t binNb, TSpectrumValue* const value);
+
+/*! @brief Checks whether the FFT started last has finished.
+ *
+ *  @return bool - TRUE if its values can be read.
+ */
+bool Spectrum_FFTDone(void);
+
+/*! @brief Gets values of the FFT started last.
+ *
+ *  @param first The first value, where value k is at k / SPECTRUM_FFT_SIZE of the sample rate.
+ *  @param values Where to put the values.
+ *  @param nbValues The number of values wanted. Values past SPECTRUM_FFT_NB_VALUES are left out.
+ *  @return uint8_t - the number of values copied, 0 if the FFT hasn't finished.
+ */
+uint8_t Spectrum_ReadFFT(const uint8_t first, TSpectrumValue* const values, const uint8_t nbValues);
+
+#endif
@@ -0,0 +1,102 @@
+/*! @file
+ *  Time.c
+ *
+ *  @brief Monotonic high-resolution timestamps
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Time_module Time module documentation
+**  @{
+ */
+
+#include "Time.h"
+#include "PIT.h"
+
+/*! @brief Scales ticks to another unit without overflowing 64 bits.
+ *
+ *  @param ticks A number of ticks.
+ *  @param unitsPerSecond The number of units in a second.
+ *  @return uint64_t - the time in units, rounded down.
+ */
+static uint64_t ToUnits(const uint64_t ticks, const uint32_t unitsPerSecond)
+{
+  uint32_t clock = PIT_Clock();
+
+  // Whole seconds and the remainder separately, as ticks * unitsPerSecond overflows after a few minutes
+  return ((ticks / clock) * unitsPerSecond) + (((ticks % clock) * unitsPerSecond) / clock);
+}
+
+/*! @brief Starts the timestamp counter.
+ *
+ *  @return bool - TRUE if the counter was started.
+ *  @note Assumes the PIT has been initialized.
+ */
+bool Time_Init(void)
+{
+  return PIT_TimebaseStart();
+}
+
+/*! @brief Gets the current time.
+ *
+ *  @return uint64_t - the number of ticks since Time_Init.
+ */
+uint64_t Time_Now(void)
+{
+  return PIT_Timebase();
+}
+
+/*! @brief Gets the number of ticks in a second.
+ *
+ *  @return uint32_t - the tick rate in Hz.
+ */
+uint32_t Time_TicksPerSecond(void)
+{
+  return PIT_Clock();
+}
+
+/*! @brief Converts ticks to nanoseconds.
+ *
+ *  @param ticks A number of ticks.
+ *  @return uint64_t - the time in nanoseconds, rounded down.
+ */
+uint64_t Time_ToNs(const uint64_t ticks)
+{
+  return ToUnits(ticks, 1000000000);
+}
+
+/*! @brief Converts ticks to microseconds.
+ *
+ *  @param ticks A number of ticks.
+ *  @return uint64_t - the time in microseconds, rounded down.
+ */
+uint64_t Time_ToUs(const uint64_t ticks)
+{
+  return ToUnits(ticks, 1000000);
+}
+
+/*! @brief Converts ticks to milliseconds.
+ *
+ *  @param ticks A number of ticks.
+ *  @return uint64_t - the time in milliseconds, rounded down.
+ */
+uint64_t Time_ToMs(const uint64_t ticks)
+{
+  return ToUnits(ticks, 1000);
+}
+
+/*! @brief Converts microseconds to ticks.
+ *
+ *  @param us A time in microseconds.
+ *  @return uint64_t - the number of ticks, rounded down.
+ */
+uint64_t Time_FromUs(const uint64_t us)
+{
+  uint32_t clock = PIT_Clock();
+  return ((us / 1000000) * clock) + (((us % 1000000) * clock) / 1000000);
+}
+
+/* END Time */
+/*!
+** @}
+*/
@@ -0,0 +1,65 @@
+/*! @file
+ *
+ *  @brief Monotonic high-resolution timestamps.
+ *
+ *  Time_Now counts bus clock cycles since Time_Init on the chained 64-bit PIT timebase, so it never wraps in practice.
+ *  A read is three register loads and takes no lock, so it can be used from any interrupt.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef TIME_H
+#define TIME_H
+
+// new types
+#include "types.h"
+
+/*! @brief Starts the timestamp counter.
+ *
+ *  @return bool - TRUE if the counter was started.
+ *  @note Assumes the PIT has been initialized. Takes over the PIT timebase channels.
+ */
+bool Time_Init(void);
+
+/*! @brief Gets the current time.
+ *
+ *  @return uint64_t - the number of ticks since Time_Init.
+ */
+uint64_t Time_Now(void);
+
+/*! @brief Gets the number of ticks in a second.
+ *
+ *  @return uint32_t - the tick rate in Hz.
+ */
+uint32_t Time_TicksPerSecond(void);
+
+/*! @brief Converts ticks to nanoseconds.
+ *
+ *  @param ticks A number of ticks, e.g. the difference of two timestamps.
+ *  @return uint64_t - the time in nanoseconds, rounded down.
+ */
+uint64_t Time_ToNs(const uint64_t ticks);
+
+/*! @brief Converts ticks to microseconds.
+ *
+ *  @param ticks A number of ticks.
+ *  @return uint64_t - the time in microseconds, rounded down.
+ */
+uint64_t Time_ToUs(const uint64_t ticks);
+
+/*! @brief Converts ticks to milliseconds.
+ *
+ *  @param ticks A number of ticks.
+ *  @return uint64_t - the time in milliseconds, rounded down.
+ */
+uint64_t Time_ToMs(const uint64_t ticks);
+
+/*! @brief Converts microseconds to ticks.
+ *
+ *  @param us A time in microseconds.
+ *  @return uint64_t - the number of ticks, rounded down.
+ */
+uint64_t Time_FromUs(const uint64_t us);
+
+#endif
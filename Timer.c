@@ -0,0 +1,280 @@
+/*! @file
+ *  Timer.c
+ *
+ *  @brief Software timers multiplexed on one FTM channel
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Timer_module Timer module documentation
+**  @{
+ */
+
+#include "Timer.h"
+#include "FTM.h"
+#include "PE_Types.h"
+#include "CPU.h"
+
+// Whole FTM counts per tick, and the counts left over every TIMER_TICKS_PER_SECOND ticks
+#define TICK_COUNTS (FTM_CLOCK_HZ / TIMER_TICKS_PER_SECOND)
+#define TICK_REMAINDER (FTM_CLOCK_HZ % TIMER_TICKS_PER_SECOND)
+
+// Wheel geometry: each level has 64 slots and turns 64 times slower than the one below
+#define LEVEL_BITS 6
+#define NB_SLOTS (1 << LEVEL_BITS)
+#define SLOT_MASK (NB_SLOTS - 1)
+#define NB_LEVELS 4
+
+// Longest delay the wheel can hold. Longer timers are parked at the top and re-placed as the wheel turns.
+#define MAX_DELTA ((1LU << (LEVEL_BITS * NB_LEVELS)) - 1)
+
+// Slot number of a timer that isn't running
+#define SLOT_NONE 0xFFFF
+
+// The timers in each slot, as doubly linked lists so they can be removed in O(1)
+static TTimer *Wheel[NB_LEVELS * NB_SLOTS];
+// A bit for every slot of each level that holds a timer
+static uint64_t Occupied[NB_LEVELS];
+
+// The current tick
+static volatile uint32_t Now;
+// Fraction of an FTM count carried over between ticks, in 1/TIMER_TICKS_PER_SECOND counts
+static uint16_t Carry;
+
+static void TickCallback(void *arguments);
+
+// The FTM channel driving the tick
+static TFTMChannel TickChannel = {0, TICK_COUNTS, TIMER_FUNCTION_OUTPUT_COMPARE, {TIMER_OUTPUT_DISCONNECT}, &TickCallback, (void *)0};
+
+/*! @brief Adds a running timer to the slot its expiry falls in.
+ *
+ *  @param timer The timer, with its expiry set.
+ *  @note Assumes interrupts are disabled.
+ */
+static void Insert(TTimer * const timer)
+{
+  uint32_t delta = timer->expiry - Now;
+  uint32_t when = timer->expiry;
+  uint8_t level = 0;
+
+  if (delta > MAX_DELTA)
+    {
+      when = Now + MAX_DELTA;
+    }
+  // The lowest level whose range covers the delay
+  while ((level < NB_LEVELS - 1) && ((when - Now) >> (LEVEL_BITS * (level + 1))))
+    {
+      level++;
+    }
+
+  uint8_t index = (when >> (LEVEL_BITS * level)) & SLOT_MASK;
+  timer->slot = (level * NB_SLOTS) + index;
+  timer->prev = NULL;
+  timer->next = Wheel[timer->slot];
+  if (timer->next)
+    {
+      timer->next->prev = timer;
+    }
+  Wheel[timer->slot] = timer;
+  Occupied[level] |= (1ULL << index);
+}
+
+/*! @brief Takes a running timer out of its slot.
+ *
+ *  @param timer The timer.
+ *  @note Assumes interrupts are disabled.
+ */
+static void Remove(TTimer * const timer)
+{
+  if (timer->prev)
+    {
+      timer->prev->next = timer->next;
+    }
+  else
+    {
+      Wheel[timer->slot] = timer->next;
+      if (!timer->next)
+	{
+	  Occupied[timer->slot / NB_SLOTS] &= ~(1ULL << (timer->slot % NB_SLOTS));
+	}
+    }
+  if (timer->next)
+    {
+      timer->next->prev = timer->prev;
+    }
+  timer->slot = SLOT_NONE;
+}
+
+/*! @brief Moves the timers of one slot down to the levels below, now that they are close enough.
+ *
+ *  @param level The level of the slot.
+ *  @param index The slot within the level.
+ *  @note Assumes interrupts are disabled.
+ */
+static void Cascade(const uint8_t level, const uint8_t index)
+{
+  TTimer *timer;
+
+  while ((timer = Wheel[(level * NB_SLOTS) + index]) != NULL)
+    {
+      Remove(timer);
+      Insert(timer);
+    }
+}
+
+/*! @brief Advances the wheel by one tick and runs the timers that expire.
+ *
+ *  @note Assumes interrupts are disabled.
+ */
+static void Tick(void)
+{
+  uint32_t now = ++Now;
+  uint8_t index = now & SLOT_MASK;
+
+  // Every time a level wraps, the next slot of the level above comes within its range
+  for (uint8_t level = 1; (level < NB_LEVELS) && !((now >> (LEVEL_BITS * (level - 1))) & SLOT_MASK); level++)
+    {
+      uint8_t upper = (now >> (LEVEL_BITS * level)) & SLOT_MASK;
+      if (Occupied[level] & (1ULL << upper))
+	{
+	  Cascade(level, upper);
+	}
+    }
+
+  if (!(Occupied[0] & (1ULL << index)))
+    {
+      return;
+    }
+
+  // Callbacks may start and stop timers, so take them one at a time
+  TTimer *timer;
+  while ((timer = Wheel[index]) != NULL)
+    {
+      Remove(timer);
+      if (timer->period)
+	{
+	  timer->expiry += timer->period;
+	  Insert(timer);
+	}
+      timer->callbackFunction(timer->callbackArguments);
+    }
+}
+
+/*! @brief FTM callback for the tick channel.
+ *
+ *  Moves the compare point on by exactly one tick, catching up if the interrupt was held off for longer than that.
+ *  @param arguments Unused.
+ */
+static void TickCallback(void *arguments)
+{
+  uint16_t counts;
+
+  do
+    {
+      Tick();
+
+      // Spread the fractional counts over the second so the tick doesn't drift
+      counts = TICK_COUNTS;
+      Carry += TICK_REMAINDER;
+      if (Carry >= TIMER_TICKS_PER_SECOND)
+	{
+	  Carry -= TIMER_TICKS_PER_SECOND;
+	  counts++;
+	}
+    }
+  while (!FTM_Advance(&TickChannel, counts));
+}
+
+/*! @brief Sets up the timer wheel and starts the tick.
+ *
+ *  @param channelNb The FTM channel to take over for the tick.
+ *  @return bool - TRUE if the timer wheel was successfully initialized.
+ *  @note Assumes the FTM has been initialized.
+ */
+bool Timer_Init(const uint8_t channelNb)
+{
+  for (uint16_t i = 0; i < NB_LEVELS * NB_SLOTS; i++)
+    {
+      Wheel[i] = NULL;
+    }
+  for (uint8_t level = 0; level < NB_LEVELS; level++)
+    {
+      Occupied[level] = 0;
+    }
+  Now = 0;
+  Carry = 0;
+
+  TickChannel.channelNb = channelNb;
+  return FTM_Set(&TickChannel) && FTM_StartTimer(&TickChannel);
+}
+
+/*! @brief Starts a timer, restarting it if it is already running.
+ *
+ *  @param timer The timer to start.
+ *  @param delay The number of ticks until the first expiry.
+ *  @param period The number of ticks between later expiries, or 0 for a one-shot timer.
+ *  @return bool - TRUE if the timer was started.
+ *  @note Assumes Timer_Init has been called.
+ */
+bool Timer_Start(TTimer * const timer, const uint32_t delay, const uint32_t period)
+{
+  if (!timer->callbackFunction)
+    {
+      return 0;
+    }
+
+  EnterCritical();
+  if (Timer_IsRunning(timer))
+    {
+      Remove(timer);
+    }
+  timer->expiry = Now + (delay ? delay : 1);
+  timer->period = period;
+  Insert(timer);
+  ExitCritical();
+  return 1;
+}
+
+/*! @brief Stops a timer if it is running.
+ *
+ *  @param timer The timer to stop.
+ *  @return bool - TRUE if the timer was running.
+ */
+bool Timer_Stop(TTimer * const timer)
+{
+  bool running;
+
+  EnterCritical();
+  running = Timer_IsRunning(timer);
+  if (running)
+    {
+      Remove(timer);
+    }
+  ExitCritical();
+  return running;
+}
+
+/*! @brief Checks whether a timer is running.
+ *
+ *  @param timer The timer to check.
+ *  @return bool - TRUE if the timer will expire.
+ */
+bool Timer_IsRunning(const TTimer * const timer)
+{
+  // A zero-initialized timer has never been started
+  return (timer->slot != SLOT_NONE) && (timer->next || timer->prev || (Wheel[timer->slot] == timer));
+}
+
+/*! @brief Gets the number of ticks since Timer_Init.
+ *
+ *  @return uint32_t - the current tick.
+ */
+uint32_t Timer_Now(void)
+{
+  return Now;
+}
+
+/* END Timer */
+/*!
+** @}
+*/
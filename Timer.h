@@ -0,0 +1,81 @@
+/*! @file
+ *
+ *  @brief Software timers multiplexed on one FTM channel.
+ *
+ *  Any number of one-shot and periodic timers run off a 1 ms tick, kept in a hierarchical timer wheel:
+ *  four levels of 64 slots, each level counting 64 times slower than the one below.
+ *  Starting and stopping a timer is O(1), and a tick only does work for the timers that expire on it
+ *  (plus moving timers down a level every 64 ticks).
+ *  Callbacks run in the FTM interrupt.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+// new types
+#include "types.h"
+
+/*!
+ * @brief A software timer.
+ *
+ * Only the callback needs to be set before the timer is started, e.g.
+ * static TTimer LedTimer = {&LedOff, (void *)0};
+ */
+typedef struct TTimer
+{
+  void (*callbackFunction)(void*);  /*!< Called in the FTM interrupt when the timer expires. */
+  void *callbackArguments;          /*!< The user arguments to use with the callback function. */
+  struct TTimer *next;              /*!< Private: the next timer in the same slot. */
+  struct TTimer *prev;              /*!< Private: the previous timer in the same slot. */
+  uint32_t expiry;                  /*!< Private: the tick the timer expires on. */
+  uint32_t period;                  /*!< Private: the ticks between expiries, or 0 for a one-shot timer. */
+  uint16_t slot;                    /*!< Private: the wheel slot holding the timer, while it is running. */
+} TTimer;
+
+// Number of timer ticks per second
+#define TIMER_TICKS_PER_SECOND 1000
+
+/*! @brief Sets up the timer wheel and starts the tick.
+ *
+ *  @param channelNb The FTM channel to take over for the tick.
+ *  @return bool - TRUE if the timer wheel was successfully initialized.
+ *  @note Assumes the FTM has been initialized.
+ */
+bool Timer_Init(const uint8_t channelNb);
+
+/*! @brief Starts a timer, restarting it if it is already running.
+ *
+ *  @param timer The timer to start.
+ *  @param delay The number of ticks until the first expiry. A delay of 0 expires on the next tick.
+ *  @param period The number of ticks between later expiries, or 0 for a one-shot timer.
+ *    Periodic timers are re-armed from their expiry tick, so they don't drift.
+ *  @return bool - TRUE if the timer was started.
+ *  @note Assumes Timer_Init has been called. May be called from a timer callback.
+ */
+bool Timer_Start(TTimer* const timer, const uint32_t delay, const uint32_t period);
+
+/*! @brief Stops a timer if it is running.
+ *
+ *  @param timer The timer to stop.
+ *  @return bool - TRUE if the timer was running.
+ *  @note May be called from a timer callback.
+ */
+bool Timer_Stop(TTimer* const timer);
+
+/*! @brief Checks whether a timer is running.
+ *
+ *  @param timer The timer to check.
+ *  @return bool - TRUE if the timer will expire.
+ */
+bool Timer_IsRunning(const TTimer* const timer);
+
+/*! @brief Gets the number of ticks since Timer_Init.
+ *
+ *  @return uint32_t - the current tick, which wraps after about 49 days.
+ */
+uint32_t Timer_Now(void);
+
+#endif
@@ -13,6 +13,8 @@
  */
 #include "UART.h"
 #include "FIFO.h"
+#include "Event.h"
+#include "Profile.h"
 #include "types.h"
 #include "MK70F12.h"
 
@@ -108,23 +110,45 @@ bool UART_OutChar(const uint8_t data)
 
 }
 
+/* get the free space in the transmit FIFO
+ * assumes UART_Init has been called
+ * output: integer - the number of bytes that can be placed in the transmit FIFO
+ */
+uint16_t UART_OutSpace(void)
+{
+  return FIFO_Space(&TxFIFO);
+}
+
+/* get the number of bytes waiting in the receive FIFO
+ * assumes UART_Init has been called
+ * output: integer - the number of bytes UART_InChar can take
+ */
+uint16_t UART_InCount(void)
+{
+  return FIFO_SIZE - FIFO_Space(&RxFIFO);
+}
+
 /*! @brief Interrupt service routine for the UART.
  *
  *  @note Assumes the transmit and receive FIFOs have been initialized.
  */
 void __attribute__ ((interrupt)) UART_ISR(void)
     {
+      PROFILE_ENTER(PROFILE_UART);
       if (UART2_S1 & UART_S1_TDRE_MASK)
 	{
 	  if (FIFO_Get(&TxFIFO, &UART2_D) == 0)
 	    {
 	      UART2_C2 &= ~UART_C2_TIE_MASK;
+	      Event_Set(EVENT_UART_TX);
 	    }
 	}
       if (UART2_S1 & UART_S1_RDRF_MASK)
 	{
 	  FIFO_Put(&RxFIFO, UART2_D);
+	  Event_Set(EVENT_PACKET);
 	}
+      PROFILE_EXIT(PROFILE_UART);
     }
 
 /* polls the UART status register to attempt send/receive one character
@@ -41,6 +41,20 @@ bool UART_InChar(uint8_t* const dataPtr);
  */
 bool UART_OutChar(const uint8_t data);
 
+/*! @brief Gets the free space in the transmit FIFO.
+ *
+ *  @return uint16_t - the number of bytes that can be placed in the transmit FIFO.
+ *  @note Assumes that UART_Init has been called.
+ */
+uint16_t UART_OutSpace(void);
+
+/*! @brief Gets the number of bytes waiting in the receive FIFO.
+ *
+ *  @return uint16_t - the number of bytes UART_InChar can take.
+ *  @note Assumes that UART_Init has been called.
+ */
+uint16_t UART_InCount(void);
+
 /*! @brief Poll the UART status register to try and receive and/or transmit one character.
  *
  *  @return void
@@ -0,0 +1,290 @@
+/*! @file
+ *  Update.c
+ *
+ *  @brief Fail-safe firmware update using the program flash block swap
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Update_module Update module documentation
+**  @{
+ */
+
+#include "Update.h"
+#include "Flash.h"
+#include "CRC.h"
+#include "MK70F12.h"
+
+
+// Address the new image is received at, the start of block 1
+#define IMAGE_START FLASH_BLOCK_SIZE
+
+// Bytes staged in RAM before they are programmed. Divides the sector size.
+#define STAGING_SIZE 1024
+
+// Upper half of the trial variable while an image is on trial. The lower half counts its boots.
+#define TRIAL_MAGIC 0x7E570000LU
+#define TRIAL_MAGIC_MASK 0xFFFF0000LU
+// Value of the trial variable when no image is on trial
+#define TRIAL_NONE 0xFFFFFFFFLU
+
+// Boot count of the image on trial
+static volatile uint32_t *Trial;
+// Set when this boot was counted as a trial of the running image, so only it can confirm the image
+static bool OnTrial;
+
+// One buffer is filled from the link while the other is being programmed
+static uint8_t Staging[2][STAGING_SIZE] __attribute__((aligned(8)));
+// Buffer being filled
+static uint8_t Current;
+// Number of bytes in the buffer being filled
+static uint16_t Fill;
+
+// Size and CRC-32 of the image being received
+static uint32_t ImageLength;
+static uint32_t ImageCRC;
+// Number of bytes of the image received so far
+static uint32_t Received;
+// Sequence number of the next chunk
+static uint16_t Sequence;
+// Set between Update_Start and Update_Finish
+static bool Receiving;
+
+/*! @brief Records the state of the trial, and waits for it to reach the Flash.
+ *
+ *  @param value The new value of the trial variable.
+ *  @return bool - TRUE if the value was committed.
+ */
+static bool SetTrial(const uint32_t value)
+{
+  return Flash_Write32(Trial, value) && Flash_Flush() && Flash_Wait();
+}
+
+/*! @brief Steps the swap system through to the complete state, so the blocks are exchanged on the next reset.
+ *
+ *  @return bool - TRUE if the swap is armed.
+ */
+static bool Swap(void)
+{
+  uint8_t state;
+
+  if (!Flash_SwapControl(FLASH_SWAP_REPORT, &state))
+    {
+      return 0;
+    }
+  if ((state == FLASH_SWAP_UNINITIALIZED) && !Flash_SwapControl(FLASH_SWAP_INITIALIZE, &state))
+    {
+      return 0;
+    }
+  if ((state == FLASH_SWAP_READY) && !Flash_SwapControl(FLASH_SWAP_SET_UPDATE, &state))
+    {
+      return 0;
+    }
+  if (state == FLASH_SWAP_UPDATE)
+    {
+      // The indicator copy in the inactive block must be erased before the swap can complete
+      if (!Flash_EraseSector(FLASH_SWAP_INDICATOR + FLASH_MIRROR_OFFSET) || !Flash_SwapControl(FLASH_SWAP_REPORT, &state))
+	{
+	  return 0;
+	}
+    }
+  if ((state == FLASH_SWAP_UPDATE_ERASED) && !Flash_SwapControl(FLASH_SWAP_SET_COMPLETE, &state))
+    {
+      return 0;
+    }
+  return (state == FLASH_SWAP_COMPLETE);
+}
+
+/*! @brief Programs the buffer being filled into block 1 and switches to the other buffer.
+ *
+ *  @return bool - TRUE if the buffer was queued.
+ */
+static bool Program(void)
+{
+  uint32_t address = IMAGE_START + Received - Fill;
+
+  // Pad the last block out to a whole phrase
+  while (Fill % 8)
+    {
+      Staging[Current][Fill++] = 0xFF;
+    }
+
+  // The other buffer has been programming while this one filled, so it is normally finished already
+  if (!Flash_Wait())
+    {
+      return 0;
+    }
+  if ((address % FLASH_SECTOR_SIZE == 0) && !Flash_EraseSector(address))
+    {
+      return 0;
+    }
+  if (!Flash_WriteBlock(address, Staging[Current], Fill))
+    {
+      return 0;
+    }
+
+  Current ^= 1;
+  Fill = 0;
+  return 1;
+}
+
+/*! @brief Checks for an unconfirmed image at boot.
+ *
+ *  @return bool - TRUE if the update module is ready. Does not return if the image is rolled back.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Update_Init(void)
+{
+  if (!Flash_AllocateVar((volatile void **) &Trial, sizeof(*Trial)))
+    {
+      return 0;
+    }
+
+  if ((*Trial & TRIAL_MAGIC_MASK) != TRIAL_MAGIC)
+    {
+      return 1;
+    }
+
+  uint32_t attempts = (*Trial & ~TRIAL_MAGIC_MASK) + 1;
+  if (attempts > UPDATE_MAX_BOOT_ATTEMPTS)
+    {
+      // The image never confirmed itself, so go back to the previous one, which is still in block 1
+      if (SetTrial(TRIAL_NONE) && Swap())
+	{
+	  SCB_AIRCR = SCB_AIRCR_VECTKEY(0x5FA) | SCB_AIRCR_SYSRESETREQ_MASK;
+	  for (;;)
+	    ;
+	}
+      return 0;
+    }
+
+  // Count this boot before anything else can crash
+  if (!SetTrial(TRIAL_MAGIC | attempts))
+    {
+      return 0;
+    }
+  OnTrial = 1;
+  return 1;
+}
+
+/*! @brief Marks the running image as good, ending its trial.
+ *
+ *  @return bool - TRUE if the running image is confirmed.
+ *  @note Assumes Update_Init has been called.
+ *  @note Does nothing unless this boot is a trial of the running image. In particular, the image armed by
+ *        Update_Finish keeps its trial until it confirms itself after the swap.
+ */
+bool Update_Confirm(void)
+{
+  if (!OnTrial)
+    {
+      return 1;
+    }
+  if (!SetTrial(TRIAL_NONE))
+    {
+      return 0;
+    }
+  OnTrial = 0;
+  return 1;
+}
+
+/*! @brief Starts receiving a new image.
+ *
+ *  @param length The number of bytes in the image.
+ *  @param crc The standard CRC-32 of the image.
+ *  @return bool - TRUE if the transfer was started.
+ *  @note Assumes Update_Init has been called.
+ */
+bool Update_Start(const uint32_t length, const uint32_t crc)
+{
+  if ((length == 0) || (length > FLASH_IMAGE_MAX_SIZE))
+    {
+      return 0;
+    }
+  // Block 1 is about to be overwritten, so there is nothing to roll back to
+  if ((*Trial != TRIAL_NONE) && !SetTrial(TRIAL_NONE))
+    {
+      return 0;
+    }
+  OnTrial = 0;
+
+  ImageLength = length;
+  ImageCRC = crc;
+  Received = 0;
+  Sequence = 0;
+  Current = 0;
+  Fill = 0;
+  Receiving = 1;
+  return 1;
+}
+
+/*! @brief Gets the sequence number of the next chunk expected.
+ *
+ *  @return uint16_t - the sequence number Update_Data will accept.
+ */
+uint16_t Update_NextSequence(void)
+{
+  return Sequence;
+}
+
+/*! @brief Adds the next chunk of the image.
+ *
+ *  @param sequence The chunk's sequence number.
+ *  @param data The chunk.
+ *  @param length The number of bytes in the chunk.
+ *  @return bool - TRUE if the chunk was accepted.
+ *  @note Assumes Update_Start has been called.
+ */
+bool Update_Data(const uint16_t sequence, const uint8_t * const data, const uint8_t length)
+{
+  if (!Receiving || (sequence != Sequence) || (length > (ImageLength - Received)))
+    {
+      return 0;
+    }
+
+  for (uint8_t i = 0; i < length; i++)
+    {
+      Staging[Current][Fill++] = data[i];
+      Received++;
+      if ((Fill == STAGING_SIZE) && !Program())
+	{
+	  Receiving = 0;
+	  return 0;
+	}
+    }
+  Sequence++;
+  return 1;
+}
+
+/*! @brief Finishes the transfer, then verifies the image and arms the block swap.
+ *
+ *  @return bool - TRUE if the image will run after the next reset.
+ *  @note Assumes Update_Start has been called.
+ */
+bool Update_Finish(void)
+{
+  if (!Receiving || (Received != ImageLength))
+    {
+      return 0;
+    }
+  Receiving = 0;
+
+  if (((Fill > 0) && !Program()) || !Flash_Wait())
+    {
+      return 0;
+    }
+
+  // Check what actually got programmed, not what was received
+  if (~CRC_32(CRC_32_INIT, (const void *) IMAGE_START, ImageLength) != ImageCRC)
+    {
+      return 0;
+    }
+
+  // The trial starts before the swap is armed, so the new image can never run untracked
+  return SetTrial(TRIAL_MAGIC) && Swap();
+}
+
+/* END Update */
+/*!
+** @}
+*/
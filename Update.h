@@ -0,0 +1,71 @@
+/*! @file
+ *
+ *  @brief Fail-safe firmware update using the program flash block swap.
+ *
+ *  A new image is received into block 1 while the current firmware keeps running from block 0.
+ *  Once its CRC-32 checks out the swap system is armed, so the blocks are exchanged on the next reset.
+ *  The new firmware then runs on trial: if it resets UPDATE_MAX_BOOT_ATTEMPTS times without calling
+ *  Update_Confirm, the blocks are swapped back to the previous firmware.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef UPDATE_H
+#define UPDATE_H
+
+// new types
+#include "types.h"
+
+// Number of boots a new image gets to confirm itself before it is rolled back
+#define UPDATE_MAX_BOOT_ATTEMPTS 3
+
+/*! @brief Checks for an unconfirmed image at boot.
+ *
+ *  Counts the boot against a trial image, and swaps back to the previous image (and resets) once the trial has run out.
+ *  @return bool - TRUE if the update module is ready. Does not return if the image is rolled back.
+ *  @note Assumes Flash has been initialized. Call before any other module allocates non-volatile variables.
+ */
+bool Update_Init(void);
+
+/*! @brief Marks the running image as good, ending its trial.
+ *
+ *  @return bool - TRUE if the running image is confirmed.
+ *  @note Assumes Update_Init has been called.
+ */
+bool Update_Confirm(void);
+
+/*! @brief Starts receiving a new image.
+ *
+ *  @param length The number of bytes in the image, up to FLASH_IMAGE_MAX_SIZE.
+ *  @param crc The standard CRC-32 of the image.
+ *  @return bool - TRUE if the transfer was started.
+ *  @note Assumes Update_Init has been called.
+ */
+bool Update_Start(const uint32_t length, const uint32_t crc);
+
+/*! @brief Gets the sequence number of the next chunk expected.
+ *
+ *  @return uint16_t - the sequence number Update_Data will accept.
+ */
+uint16_t Update_NextSequence(void);
+
+/*! @brief Adds the next chunk of the image.
+ *
+ *  Chunks are staged in RAM and programmed into block 1 a block at a time, while the next block is received.
+ *  @param sequence The chunk's sequence number, which must be Update_NextSequence.
+ *  @param data The chunk.
+ *  @param length The number of bytes in the chunk.
+ *  @return bool - TRUE if the chunk was accepted.
+ *  @note Assumes Update_Start has been called.
+ */
+bool Update_Data(const uint16_t sequence, const uint8_t* const data, const uint8_t length);
+
+/*! @brief Finishes the transfer, then verifies the image and arms the block swap.
+ *
+ *  @return bool - TRUE if the whole image was received, its CRC matches, and it will run after the next reset.
+ *  @note Assumes Update_Start has been called.
+ */
+bool Update_Finish(void);
+
+#endif
@@ -10,48 +10,91 @@
 */
 #include "cmd.h"
 
+#include "Config.h"
 #include "Flash.h"
+#include "Update.h"
+#include "FTM.h"
 #include "packet.h"
 #include "RTC.h"
+#include "UART.h"
+#include "Event.h"
+#include "Profile.h"
+#include "Sampler.h"
+#include "Filter.h"
+#include "Report.h"
+#include "Meter.h"
+#include "Spectrum.h"
+#include "Burst.h"
+#include "Loopback.h"
 #include "types.h"
 #include "analog.h"
 //#include "SPI.h"
 
+#include <string.h>
+
 /*
  * Tower software version V1.0
  */
 const uint8_t TOWER_VERSION_H = 1;
 const uint8_t TOWER_VERISON_L = 0;
 
-static uint16union_t volatile *TowerNumber;
-static uint16union_t volatile *TowerMode;
 
 
 
+// Number of bytes readable with CMD_RX_READ_BLOCK: the data region and the configuration slots
+#define READ_REGION_SIZE ((FLASH_CONFIG_START + (FLASH_CONFIG_NB_SECTORS * FLASH_SECTOR_SIZE)) - FLASH_DATA_START)
+
+// Number of bytes the PC can program and read one at a time
+#define USER_NB_BYTES 8
+
+// The bytes programmed by CMD_RX_PROGRAM_BYTE, kept clear of other modules' non-volatile variables
+static volatile uint8_t *UserBytes;
+
+// Offset of the next byte of the block being streamed
+static uint16_t ReadOffset;
+// Number of bytes of the block left to stream
+static uint16_t ReadRemaining;
+
+// Input capture channel being streamed to the PC
+static TFTMChannel CaptureChannel = {0, 0, TIMER_FUNCTION_INPUT_CAPTURE, TIMER_INPUT_OFF, 0, (void *)0};
+
+// Set while the meter measurements are sent every window
+static bool MeterStream = 0;
+
+// Set from a CMD_RX_SPECTRUM_FFT until all its values are sent
+static bool SpectrumPending = 0;
+// Index of the next FFT value to send
+static uint8_t SpectrumOffset;
+
+// Set from a CMD_RX_BURST_ARM until the capture is sent
+static bool BurstPending = 0;
+static bool BurstInfoSent;
+// Index of the next burst sample to send
+static uint16_t BurstOffset;
+
 // holds TAnalogInput for each channel in an array
 TAnalogInput Analog_Input[ANALOG_NB_INPUTS];
 
 /*!
- * @brief Set up the tower number and mode flash allocation.
+ * @brief Load the committed tower number and mode.
  * @note Requires the flash module to be started.
  */
 bool CMD_Init()
 {
-  bool allocNumber = Flash_AllocateVar((volatile void **) &TowerNumber, sizeof(uint16union_t));
-  bool allocMode = Flash_AllocateVar((volatile void **) &TowerMode, sizeof(uint16union_t));
-  if (allocNumber == 1 && allocMode == 1)
+  TConfig defaults;
+  defaults.towerNumber.l = CMD_ID;
+  defaults.towerMode.l = 0x01;
+
+  if (!Config_Init(&defaults) || !Flash_AllocateVar((volatile void **) &UserBytes, USER_NB_BYTES))
     {
-      if (TowerNumber->l == 0xFFFF)
-	{
-	  Flash_Write16((uint16_t volatile *) TowerNumber, CMD_ID);
-	}
-      if (TowerMode->l == 0xFFFF)
-	{
-	  Flash_Write16((uint16_t volatile *) TowerMode, 0x01);
-	}
-      return 1;
+      return 0;
     }
-  return 0;
+  if (!Report_Init())
+    {
+      return 0;
+    }
+  // Only a blank or corrupted device has anything to commit
+  return Config_Commit();
 }
 
 /*!
@@ -68,11 +111,11 @@ bool CMD_GetStartupValues()
     {
       return 0;
     }
-  if (!Packet_Put(CMD_TX_TOWER_NUMBER, 1, TowerNumber->s.Lo, TowerNumber->s.Hi))
+  if (!Packet_Put(CMD_TX_TOWER_NUMBER, 1, Config_Get()->towerNumber.s.Lo, Config_Get()->towerNumber.s.Hi))
     {
       return 0;
     }
-  if (!Packet_Put(CMD_TX_TOWER_MODE, 0x1, TowerMode->s.Lo, TowerMode->s.Hi))
+  if (!Packet_Put(CMD_TX_TOWER_MODE, 0x1, Config_Get()->towerMode.s.Lo, Config_Get()->towerMode.s.Hi))
     {
       return 0;
     }
@@ -92,16 +135,16 @@ bool CMD_GetStartupValues()
  */
 bool CMD_FlashProgramByte(const uint8_t offset, const uint8_t data)
 {
-  if (offset > 8)// Change 8 to FLASH_DATA_SIZE for dynamicness
+  if (offset > USER_NB_BYTES)
     {
       return 0;
     }
-  if (offset == 8)// Change 8 to FLASH_DATA_SIZE for dynamicness
+  if (offset == USER_NB_BYTES)
     {
-      return Flash_Erase();
+      // Only the PC's bytes are erased, so the other non-volatile variables survive
+      return Flash_Write32((volatile uint32_t *) UserBytes, 0xFFFFFFFF) && Flash_Write32((volatile uint32_t *) (UserBytes + 4), 0xFFFFFFFF);
     }
-  uint8_t *address = (uint8_t *)(FLASH_DATA_START + offset);
-  return Flash_Write8(address, data);
+  return Flash_Write8(&UserBytes[offset], data);
 }
 
 /*!
@@ -112,14 +155,200 @@ bool CMD_FlashProgramByte(const uint8_t offset, const uint8_t data)
  */
 bool CMD_FlashReadByte(const uint8_t offset)
 {
-  if (offset > (FLASH_DATA_SIZE - 1))
+  if (offset >= USER_NB_BYTES)
   {
   	return 0;
   }
-  uint8_t data = _FB(FLASH_DATA_START + offset);
+  uint8_t data = UserBytes[offset];
   return Packet_Put(CMD_TX_READ_BYTE, offset, 0x0, data);
 }
 
+/*!
+ * @brief Starts streaming a block of the flash data region to the PC.
+ * @param offset Offset of the first byte from the start of the data region.
+ * @param nbPackets The number of full extended packets to send.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_FlashReadBlock(const uint16_t offset, const uint8_t nbPackets)
+{
+  if (offset >= READ_REGION_SIZE)
+    {
+      return 0;
+    }
+  uint32_t length = (uint32_t) nbPackets * PACKET_EXTENDED_MAX_DATA;
+  if (length > (READ_REGION_SIZE - offset))
+    {
+      length = READ_REGION_SIZE - offset;
+    }
+  ReadOffset = offset;
+  ReadRemaining = length;
+  return 1;
+}
+
+/*!
+ * @brief Sends the next packets of a block read while there is room in the transmit FIFO.
+ */
+void CMD_FlashReadPoll(void)
+{
+  // The data region can't be read while the FTFE is working on it
+  while ((ReadRemaining > 0) && !Flash_IsBusy())
+    {
+      uint8_t length = PACKET_EXTENDED_MAX_DATA;
+      if (ReadRemaining < length)
+	{
+	  length = ReadRemaining;
+	}
+      if (UART_OutSpace() < (length + PACKET_EXTENDED_OVERHEAD))
+	{
+	  return;  // carry on once the UART has drained
+	}
+      if (!Packet_PutExtended(CMD_TX_READ_BLOCK, ReadOffset, (const uint8_t *) (FLASH_DATA_START + ReadOffset), length))
+	{
+	  return;  // another thread took the room, so try again later
+	}
+      ReadOffset += length;
+      ReadRemaining -= length;
+    }
+}
+
+/*!
+ * @brief Starts or stops streaming input captures from an FTM channel.
+ * @param channelNb The FTM channel.
+ * @param edges The TTimerInputDetection edges to capture, or TIMER_INPUT_OFF to stop.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_Capture(const uint8_t channelNb, const uint8_t edges)
+{
+  if ((channelNb == 0) || (channelNb >= 8) || (edges > TIMER_INPUT_ANY))
+    {
+      return 0;
+    }
+
+  // Only the streamed channel can be stopped, any other may belong to someone else
+  if ((edges == TIMER_INPUT_OFF) && ((CaptureChannel.ioType.inputDetection == TIMER_INPUT_OFF) || (channelNb != CaptureChannel.channelNb)))
+    {
+      return 0;
+    }
+
+  // Release the channel being streamed before taking another
+  if (CaptureChannel.ioType.inputDetection != TIMER_INPUT_OFF)
+    {
+      CaptureChannel.ioType.inputDetection = TIMER_INPUT_OFF;
+      FTM_Set(&CaptureChannel);
+    }
+
+  CaptureChannel.channelNb = channelNb;
+  CaptureChannel.ioType.inputDetection = (TTimerInputDetection) edges;
+  return FTM_Set(&CaptureChannel);
+}
+
+/*!
+ * @brief Sends the captures waiting on the streamed channel while there is room in the transmit FIFO.
+ */
+void CMD_CapturePoll(void)
+{
+  uint8_t payload[PACKET_EXTENDED_MAX_DATA];
+  uint8_t length = 0;
+
+  if (CaptureChannel.ioType.inputDetection == TIMER_INPUT_OFF)
+    {
+      return;
+    }
+
+  while (UART_OutSpace() >= (PACKET_EXTENDED_MAX_DATA + PACKET_EXTENDED_OVERHEAD))
+    {
+      uint32_t timestamp;
+      bool rising;
+      bool first = FTM_CaptureRising(CaptureChannel.channelNb);
+      bool expected = first;
+
+      // With both edges captured, a packet ends where an edge was missed, so the directions alternate from the first
+      for (length = 0; (length < PACKET_EXTENDED_MAX_DATA) && (FTM_CaptureRising(CaptureChannel.channelNb) == expected)
+	  && FTM_CaptureGet(CaptureChannel.channelNb, &timestamp, &rising); length += sizeof(timestamp))
+	{
+	  memcpy(&payload[length], &timestamp, sizeof(timestamp));
+	  if (CaptureChannel.ioType.inputDetection == TIMER_INPUT_ANY)
+	    {
+	      expected = !rising;
+	    }
+	}
+      if (length == 0)
+	{
+	  return;
+	}
+      Packet_PutExtended(CMD_TX_CAPTURES, CaptureChannel.channelNb | ((uint16_t) first << 8), payload, length);
+    }
+}
+
+/*!
+ * @brief Reports the progress of a firmware update.
+ * @param status One of the CMD_UPDATE_ status values.
+ * @param sequence The sequence number the status refers to.
+ * @return bool TRUE if the operation succeeded.
+ */
+static bool UpdateReply(const uint8_t status, const uint16_t sequence)
+{
+  uint16union_t temp;
+  temp.l = sequence;
+  return Packet_Put(CMD_TX_UPDATE, status, temp.s.Lo, temp.s.Hi);
+}
+
+/*!
+ * @brief Starts a firmware update from the extended packet in PacketExtended.
+ * @return bool TRUE if the update was started.
+ */
+bool CMD_UpdateStart(void)
+{
+  uint32_t header[2];
+
+  if (PacketExtended.length == sizeof(header))
+    {
+      memcpy(header, PacketExtended.data, sizeof(header));
+    }
+  if ((PacketExtended.length != sizeof(header)) || !Update_Start(header[0], header[1]))
+    {
+      UpdateReply(CMD_UPDATE_FAIL, 0);
+      return 0;
+    }
+  return UpdateReply(CMD_UPDATE_ACK, 0);
+}
+
+/*!
+ * @brief Adds the chunk in PacketExtended to the firmware update and acknowledges it.
+ * @return bool TRUE if the chunk was accepted.
+ */
+bool CMD_UpdateData(void)
+{
+  uint16_t expected = Update_NextSequence();
+
+  if (PacketExtended.offset != expected)
+    {
+      // Go back N: everything from the missing chunk is resent
+      UpdateReply(CMD_UPDATE_NAK, expected);
+      return 0;
+    }
+  if (!Update_Data(PacketExtended.offset, PacketExtended.data, PacketExtended.length))
+    {
+      UpdateReply(CMD_UPDATE_FAIL, expected);
+      return 0;
+    }
+  return UpdateReply(CMD_UPDATE_ACK, expected);
+}
+
+/*!
+ * @brief Finishes a firmware update, verifying the image and arming the block swap.
+ * @return bool TRUE if the new image runs after the next reset.
+ */
+bool CMD_UpdateFinish(void)
+{
+  if (!Update_Finish())
+    {
+      UpdateReply(CMD_UPDATE_FAIL, Update_NextSequence());
+      return 0;
+    }
+  return UpdateReply(CMD_UPDATE_DONE, Update_NextSequence());
+}
+
 /*!
  * @brief check the protocol mode of data being sent.
  * @param offset Offset of the byte from the start of the sector.
@@ -143,14 +372,14 @@ bool CMD_TowerNumber(uint8_t mode, uint8_t lsb, uint8_t msb)
 {
   if (mode == CMD_TOWER_NUMBER_GET)
     {
-      return Packet_Put(CMD_TX_TOWER_NUMBER, 1, TowerNumber->s.Lo, TowerNumber->s.Hi);
+      return Packet_Put(CMD_TX_TOWER_NUMBER, 1, Config_Get()->towerNumber.s.Lo, Config_Get()->towerNumber.s.Hi);
     }
   else if (mode == CMD_TOWER_NUMBER_SET)
     {
-      uint16union_t temp;
-      temp.s.Hi = msb;
-      temp.s.Lo = lsb;
-      return Flash_Write16((uint16_t volatile *) TowerNumber, temp.l);
+      TConfig config = *Config_Get();
+      config.towerNumber.s.Hi = msb;
+      config.towerNumber.s.Lo = lsb;
+      return Config_Set(&config);
     }
   return 0;
 }
@@ -166,14 +395,14 @@ bool CMD_TowerMode(const uint8_t mode, const uint8_t lsb, const uint8_t msb)
 {
   if (mode == CMD_TOWER_MODE_GET)
     {
-      return Packet_Put(CMD_TX_TOWER_MODE, 0x1, TowerMode->s.Lo, TowerMode->s.Hi);
+      return Packet_Put(CMD_TX_TOWER_MODE, 0x1, Config_Get()->towerMode.s.Lo, Config_Get()->towerMode.s.Hi);
     }
   else if (mode == CMD_TOWER_NUMBER_SET)
     {
-      uint16union_t temp;
-      temp.s.Hi = msb;
-      temp.s.Lo = lsb;
-      return Flash_Write16((uint16_t volatile *) TowerMode, temp.l);
+      TConfig config = *Config_Get();
+      config.towerMode.s.Hi = msb;
+      config.towerMode.s.Lo = lsb;
+      return Config_Set(&config);
     }
   return 0;
 }
@@ -225,6 +454,19 @@ bool CMD_SetTime(const uint8_t hours, const uint8_t minutes, const uint8_t secon
   return 1;
 }
 
+/*!
+ * @brief Sends the whole value of an analog channel.
+ * @param channelNb The channel.
+ * @param value The value.
+ * @return bool TRUE if the operation succeeded.
+ */
+static bool AnalogValue(const uint8_t channelNb, const int16_t value)
+{
+  int16union_t sample;
+  sample.l = value;
+  return Packet_Put(CMD_RX_ANALOG_INPUT, channelNb, sample.s.Lo, sample.s.Hi);
+}
+
 /*!
  * @brief check the value of the analog signal.
  * @param hours The count of hours which has occurred.
@@ -234,11 +476,441 @@ bool CMD_SetTime(const uint8_t hours, const uint8_t minutes, const uint8_t secon
  */
 bool CMD_AnalogValue(const uint8_t channelNb)
 {
-  if (channelNb > 1 | channelNb < 0)
+  int16_t sample;
+  if (!Sampler_Latest(channelNb, &sample))
+    {
+      return 0;
+    }
+  return AnalogValue(channelNb, sample);
+}
+
+/*!
+ * @brief Sends the fraction of the time the CPU was busy since the last report.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_CpuLoad(void)
+{
+  uint16union_t load;
+  load.l = Event_Load();
+  return Packet_Put(CMD_TX_CPU_LOAD, load.s.Lo, load.s.Hi, 0);
+}
+
+/*!
+ * @brief Configures an analog channel's filter from the extended packet in PacketExtended.
+ * @return bool TRUE if the filter was configured.
+ */
+bool CMD_Filter(void)
+{
+  int16_t taps[FILTER_MAX_TAPS];
+  uint16union_t offset;
+
+  if ((PacketExtended.length % sizeof(int16_t)) || (PacketExtended.length > sizeof(taps)))
+    {
+      return 0;
+    }
+  memcpy(taps, PacketExtended.data, PacketExtended.length);
+  offset.l = PacketExtended.offset;
+  return Filter_Set(offset.s.Lo, offset.s.Hi, taps, PacketExtended.length / sizeof(int16_t));
+}
+
+/*!
+ * @brief Changes the analog channels sampled.
+ * @param channelMask A bit for each channel to sample.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_AnalogChannels(const uint16_t channelMask)
+{
+  return Sampler_SetChannels(channelMask);
+}
+
+/*!
+ * @brief Sets how an analog channel is reported from the extended packet in PacketExtended.
+ * @return bool TRUE if the settings were changed.
+ */
+bool CMD_ReportConfig(void)
+{
+  TReportConfig config;
+
+  if (PacketExtended.length != sizeof(config))
     {
+      return 0;
+    }
+  memcpy(&config, PacketExtended.data, sizeof(config));
+  return Report_Set(PacketExtended.offset, &config);
+}
+
+/*!
+ * @brief Reports a new value of an analog channel.
+ * @param channelNb The channel.
+ * @param value The new value.
+ * @param isSync TRUE to always send the whole value.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_AnalogReport(const uint8_t channelNb, const int16_t value, const bool isSync)
+{
+  int8_t delta;
+  TReportDelta pair[2];
+
+  if (isSync)
+    {
+      if (!CMD_AnalogFlush() || !AnalogValue(channelNb, value))
+	{
+	  return 0;
+	}
+      Report_Sent(channelNb, value);
       return 1;
     }
-  return Packet_Put(CMD_RX_ANALOG_INPUT, channelNb, Analog_Input[channelNb].value.s.Lo, Analog_Input[channelNb].value.s.Hi);
+
+  // Values are only recorded as reported once their packet is in the transmit FIFO,
+  // so a report that didn't fit is sent again from the last value the PC has
+  switch (Report_Check(channelNb, value, &delta))
+    {
+      case REPORT_DELTA:
+	if (!Report_Pair(channelNb, value, delta, pair))
+	  {
+	    return 1;  // held back to share a packet with the next one
+	  }
+	// Left held back if it doesn't fit
+	if (!Packet_Put(CMD_TX_ANALOG_DELTA, pair[0].channelNb | (pair[1].channelNb << 4), pair[0].delta, pair[1].delta))
+	  {
+	    return 0;
+	  }
+	Report_PairSent(pair);
+	return 1;
+
+      case REPORT_VALUE:
+	// The held back delta goes first, so the PC applies the changes in order
+	if (!CMD_AnalogFlush() || !AnalogValue(channelNb, value))
+	  {
+	    return 0;
+	  }
+	Report_Sent(channelNb, value);
+	return 1;
+
+      default:
+	return 1;
+    }
+}
+
+/*!
+ * @brief Sends a delta held back to share a packet with the next one.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_AnalogFlush(void)
+{
+  TReportDelta pair[2];
+
+  if (!Report_Unpaired(pair))
+    {
+      return 1;
+    }
+  if (!Packet_Put(CMD_TX_ANALOG_DELTA, pair[0].channelNb | (pair[1].channelNb << 4), pair[0].delta, pair[1].delta))
+    {
+      return 0;
+    }
+  Report_PairSent(pair);
+  return 1;
+}
+
+/*!
+ * @brief Sends the service time, jitter and entry latency statistics of an ISR.
+ * @param isr The PROFILE_ number of the ISR.
+ * @param reset 1 to clear the statistics once they are sent.
+ * @return bool TRUE if the operation succeeded. Always FALSE if profiling isn't built in.
+ */
+bool CMD_Profile(const uint8_t isr, const uint8_t reset)
+{
+#ifdef PROFILE_ENABLED
+  TProfileStats stats;
+  TProfileLatency latency;
+
+  if (!Profile_Get(isr, &stats) || !Profile_GetLatency(isr, &latency))
+    {
+      return 0;
+    }
+  if (!Packet_PutExtended(CMD_TX_PROFILE, isr, (const uint8_t *) &stats, sizeof(stats))
+      || !Packet_PutExtended(CMD_TX_PROFILE_LATENCY, isr, (const uint8_t *) &latency, sizeof(latency)))
+    {
+      return 0;
+    }
+  return (reset != 1) || Profile_Reset(isr);
+#else
+  return 0;
+#endif
+}
+
+/*!
+ * @brief Sends the meter measurements, and sets whether they are streamed.
+ * @param stream 1 to send the measurements of every window from now on, 0 to stop.
+ * @param clear 1 to clear the energy total before sending.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_Meter(const uint8_t stream, const uint8_t clear)
+{
+  TMeterResult result;
+
+  if ((stream > 1) || (clear > 1))
+    {
+      return 0;
+    }
+  if (clear && !Meter_ClearEnergy())
+    {
+      return 0;
+    }
+  MeterStream = stream;
+  (void) Meter_Get(&result);
+  return Packet_PutExtended(CMD_TX_METER, 0, (const uint8_t *) &result, sizeof(result));
+}
+
+/*!
+ * @brief Sends the measurements of a window that has just closed, if they are streamed.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_MeterReport(void)
+{
+  TMeterResult result;
+
+  if (!MeterStream || !Meter_Get(&result))
+    {
+      return 1;
+    }
+  return Packet_PutExtended(CMD_TX_METER, 0, (const uint8_t *) &result, sizeof(result));
+}
+
+/*!
+ * @brief Sets the frequency of a Goertzel bin from the extended packet in PacketExtended.
+ * @return bool TRUE if the bin was set.
+ */
+bool CMD_SpectrumBin(void)
+{
+  uint16union_t offset, frequency, blockLength;
+
+  if (PacketExtended.length != 4)
+    {
+      return 0;
+    }
+  offset.l = PacketExtended.offset;
+  frequency.s.Lo = PacketExtended.data[0];
+  frequency.s.Hi = PacketExtended.data[1];
+  blockLength.s.Lo = PacketExtended.data[2];
+  blockLength.s.Hi = PacketExtended.data[3];
+  return Spectrum_SetBin(offset.s.Lo, offset.s.Hi, frequency.l, blockLength.l);
+}
+
+/*!
+ * @brief Sends the results of the Goertzel bins which just finished a block.
+ * @param binMask A bit for each bin to send.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_SpectrumReport(const uint8_t binMask)
+{
+  TSpectrumValue values[SPECTRUM_MAX_BINS];
+  uint8_t nbValues = 0;
+
+  for (uint8_t binNb = 0; binNb < SPECTRUM_MAX_BINS; binNb++)
+    {
+      if ((binMask & (1 << binNb)) && !Spectrum_GetBin(binNb, &values[nbValues++]))
+	{
+	  return 0;
+	}
+    }
+  return (nbValues == 0) || Packet_PutExtended(CMD_TX_SPECTRUM, binMask, (const uint8_t *) values, nbValues * sizeof(TSpectrumValue));
+}
+
+/*!
+ * @brief Takes an FFT of an analog channel.
+ * @param channelNb The Sampler channel.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_SpectrumFFT(const uint8_t channelNb)
+{
+  if (!Spectrum_StartFFT(channelNb))
+    {
+      return 0;
+    }
+  SpectrumOffset = 0;
+  SpectrumPending = 1;
+  return 1;
+}
+
+/*!
+ * @brief Sends the values of a finished FFT while there is room in the transmit FIFO.
+ */
+void CMD_SpectrumPoll(void)
+{
+  TSpectrumValue values[PACKET_EXTENDED_MAX_DATA / sizeof(TSpectrumValue)];
+
+  if (!SpectrumPending || !Spectrum_FFTDone())
+    {
+      return;
+    }
+
+  while (SpectrumOffset < SPECTRUM_FFT_NB_VALUES)
+    {
+      uint8_t nbValues = sizeof(values) / sizeof(values[0]);
+      if (SPECTRUM_FFT_NB_VALUES - SpectrumOffset < nbValues)
+	{
+	  nbValues = SPECTRUM_FFT_NB_VALUES - SpectrumOffset;
+	}
+      if (UART_OutSpace() < ((nbValues * sizeof(TSpectrumValue)) + PACKET_EXTENDED_OVERHEAD))
+	{
+	  return;  // carry on once the UART has drained
+	}
+      nbValues = Spectrum_ReadFFT(SpectrumOffset, values, nbValues);
+      if (!Packet_PutExtended(CMD_TX_SPECTRUM_FFT, SpectrumOffset, (const uint8_t *) values, nbValues * sizeof(TSpectrumValue)))
+	{
+	  return;  // another thread took the room, so try again later
+	}
+      SpectrumOffset += nbValues;
+    }
+  SpectrumPending = 0;
+}
+
+/*!
+ * @brief Arms a burst capture from the extended packet in PacketExtended.
+ * @return bool TRUE if the capture was armed.
+ */
+bool CMD_BurstArm(void)
+{
+  uint32union_t sampleRate;
+  uint16union_t offset, nbSamples, preTrigger, level;
+
+  if (PacketExtended.length != 10)
+    {
+      return 0;
+    }
+  offset.l = PacketExtended.offset;
+  memcpy(&sampleRate.l, &PacketExtended.data[0], sizeof(sampleRate.l));
+  nbSamples.s.Lo = PacketExtended.data[4];
+  nbSamples.s.Hi = PacketExtended.data[5];
+  preTrigger.s.Lo = PacketExtended.data[6];
+  preTrigger.s.Hi = PacketExtended.data[7];
+  level.s.Lo = PacketExtended.data[8];
+  level.s.Hi = PacketExtended.data[9];
+
+  BurstPending = 0;
+  if (!Burst_Arm(offset.s.Lo, sampleRate.l, nbSamples.l, preTrigger.l, (TBurstTrigger) offset.s.Hi, (int16_t) level.l))
+    {
+      return 0;
+    }
+  BurstInfoSent = 0;
+  BurstOffset = 0;
+  BurstPending = 1;
+  return 1;
+}
+
+/*!
+ * @brief Cancels or triggers a burst capture.
+ * @param action 0 to cancel, 1 to trigger now.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_Burst(const uint8_t action)
+{
+  switch (action)
+  {
+    case 0:
+      Burst_Cancel();
+      BurstPending = 0;
+      return 1;
+    case 1:
+      return Burst_Trigger();
+    default:
+      return 0;
+  }
+}
+
+/*!
+ * @brief Moves a burst capture along, and sends it while there is room in the transmit FIFO once it is done.
+ */
+void CMD_BurstPoll(void)
+{
+  int16_t samples[PACKET_EXTENDED_MAX_DATA / sizeof(int16_t)];
+  TBurstInfo info;
+
+  if (!BurstPending || (Burst_Poll() != BURST_DONE) || !Burst_Info(&info))
+    {
+      return;
+    }
+
+  if (!BurstInfoSent)
+    {
+      if (UART_OutSpace() < (sizeof(info) + PACKET_EXTENDED_OVERHEAD))
+	{
+	  return;
+	}
+      if (!Packet_PutExtended(CMD_TX_BURST_INFO, 0, (const uint8_t *) &info, sizeof(info)))
+	{
+	  return;
+	}
+      BurstInfoSent = 1;
+    }
+
+  while (BurstOffset < info.nbSamples)
+    {
+      if (UART_OutSpace() < (sizeof(samples) + PACKET_EXTENDED_OVERHEAD))
+	{
+	  return;  // carry on once the UART has drained
+	}
+      uint16_t nbSamples = Burst_Read(BurstOffset, samples, sizeof(samples) / sizeof(samples[0]));
+      if (!Packet_PutExtended(CMD_TX_BURST, BurstOffset, (const uint8_t *) samples, nbSamples * sizeof(int16_t)))
+	{
+	  return;  // another thread took the room, so try again later
+	}
+      BurstOffset += nbSamples;
+    }
+  BurstPending = 0;
+}
+
+/*!
+ * @brief Sets the loopback of a DAC from the extended packet in PacketExtended.
+ * @return bool TRUE if the loopback was set.
+ */
+bool CMD_Loopback(void)
+{
+  uint16union_t offset, gain, dacOffset, alpha;
+  TLoopbackConfig config;
+
+  if (PacketExtended.length != 6)
+    {
+      return 0;
+    }
+  offset.l = PacketExtended.offset;
+  gain.s.Lo = PacketExtended.data[0];
+  gain.s.Hi = PacketExtended.data[1];
+  dacOffset.s.Lo = PacketExtended.data[2];
+  dacOffset.s.Hi = PacketExtended.data[3];
+  alpha.s.Lo = PacketExtended.data[4];
+  alpha.s.Hi = PacketExtended.data[5];
+
+  config.gain = (int16_t) gain.l;
+  config.offset = (int16_t) dacOffset.l;
+  config.alpha = alpha.l;
+  return Loopback_Set(offset.s.Lo, offset.s.Hi, &config);
+}
+
+/*!
+ * @brief Sends the loopback latency statistics.
+ * @param clear 1 to clear them once they are sent.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_LoopbackLatency(const uint8_t clear)
+{
+  TLoopbackStats stats;
+
+  if (clear > 1)
+    {
+      return 0;
+    }
+  (void) Loopback_GetStats(&stats);
+  if (!Packet_PutExtended(CMD_TX_LOOPBACK_LATENCY, 0, (const uint8_t *) &stats, sizeof(stats)))
+    {
+      return 0;
+    }
+  if (clear)
+    {
+      Loopback_ResetStats();
+    }
+  return 1;
 }
 
 /*  END OF COMMAND MODULE */
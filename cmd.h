@@ -55,6 +55,87 @@
  */
 #define CMD_TX_TOWER_MODE 0x0D
 
+/*!
+ * Command Macro of the extended packets streaming back a block of flash
+ */
+#define CMD_TX_READ_BLOCK 0x0E
+
+/*!
+ * Command Macro which reports the progress of a firmware update.
+ * Parameter 1 is one of the CMD_UPDATE_ status values, parameters 2 and 3 the sequence number (LSB first).
+ */
+#define CMD_TX_UPDATE 0x0F
+
+/*!
+ * Extended packet streaming input capture timestamps to the PC.
+ * The offset LSB is the channel number, and the offset MSB is 1 if the first capture is a rising edge.
+ * The payload is 32-bit timestamps LSB first, in FTM_CLOCK_HZ counts. When both edges are captured,
+ * the edges in one packet alternate from the first, so rising and falling edges pair up for the duty cycle.
+ */
+#define CMD_TX_CAPTURES 0x10
+
+/*!
+ * Command Macro which reports the CPU load.
+ * Parameters 1 and 2 are the load since the last report in tenths of a percent (LSB first).
+ */
+#define CMD_TX_CPU_LOAD 0x11
+
+/*!
+ * Extended packet dumping the statistics of one ISR.
+ * The offset is the PROFILE_ number of the ISR, the payload its TProfileStats (little endian).
+ */
+#define CMD_TX_PROFILE 0x12
+
+/*!
+ * Extended packet carrying the meter measurements of the last window.
+ * The offset is 0, the payload its TMeterResult (little endian).
+ */
+#define CMD_TX_METER 0x14
+
+/*!
+ * Extended packet carrying the Goertzel bins which just finished a block.
+ * The offset has a bit per bin sent, the payload their TSpectrumValue in bin order: amplitude in ADC counts,
+ * then phase in 1/65536 turns, each 16 bits LSB first.
+ */
+#define CMD_TX_SPECTRUM 0x15
+
+/*!
+ * Extended packet carrying values of an FFT, as the same TSpectrumValue pairs.
+ * The offset is the first value's index k, at k / SPECTRUM_FFT_SIZE of the sample rate.
+ */
+#define CMD_TX_SPECTRUM_FFT 0x16
+
+/*!
+ * Extended packet describing a finished burst capture, sent before its samples.
+ * The offset is 0, the payload its TBurstInfo (little endian).
+ */
+#define CMD_TX_BURST_INFO 0x17
+
+/*!
+ * Extended packet carrying the samples of a burst capture.
+ * The offset is the index of the first sample, the payload 16-bit two's complement samples LSB first.
+ */
+#define CMD_TX_BURST 0x18
+
+/*!
+ * Extended packet carrying the loopback latency statistics.
+ * The offset is 0, the payload its TLoopbackStats (little endian).
+ */
+#define CMD_TX_LOOPBACK_LATENCY 0x19
+
+/*!
+ * Extended packet dumping the entry latency of one ISR, sent after its CMD_TX_PROFILE.
+ * The offset is the PROFILE_ number of the ISR, the payload its TProfileLatency (little endian).
+ */
+#define CMD_TX_PROFILE_LATENCY 0x1A
+
+/*!
+ * Command Macro carrying the changes of up to two analog channels since their last report.
+ * Parameter 1 is the first channel (low nibble) and the second (high nibble),
+ * parameters 2 and 3 the signed changes. A single change repeats its channel with a second change of 0.
+ */
+#define CMD_TX_ANALOG_DELTA 0x51
+
 /*****************************************
  * Packets Transmitted from PC to Tower
  */
@@ -100,6 +181,111 @@
  */
 #define CMD_RX_TOWER_MODE 0x0D
 
+/*!
+ * Command Macro to stream back a block of flash
+ */
+#define CMD_RX_READ_BLOCK 0x0E
+
+/*!
+ * Command Macro to start or stop streaming input captures.
+ * Parameter 1 is the FTM channel, parameter 2 the TTimerInputDetection edges (TIMER_INPUT_OFF stops).
+ */
+#define CMD_RX_CAPTURE 0x10
+
+/*!
+ * Command Macro to get the CPU load.
+ */
+#define CMD_RX_CPU_LOAD 0x11
+
+/*!
+ * Command Macro to dump the statistics and entry latency of an ISR. Only answered in builds with PROFILE_ENABLED.
+ * Parameter 1 is the PROFILE_ number of the ISR, parameter 2 is 1 to clear the statistics once they are sent.
+ */
+#define CMD_RX_PROFILE 0x12
+
+/*!
+ * Command Macro to choose the analog channels sampled.
+ * Parameters 1 and 2 are the channel mask (LSB first), a bit per Sampler channel.
+ */
+#define CMD_RX_ANALOG_CHANNELS 0x13
+
+/*!
+ * Command Macro to get the meter measurements.
+ * Parameter 1 is 1 to also send them every time a window closes, 0 to stop. Parameter 2 is 1 to clear the energy total first.
+ */
+#define CMD_RX_METER 0x14
+
+/*!
+ * Command Macro to take an FFT of the next SPECTRUM_FFT_SIZE samples of an analog channel.
+ * Parameter 1 is the Sampler channel. The values come back as CMD_TX_SPECTRUM_FFT packets.
+ */
+#define CMD_RX_SPECTRUM_FFT 0x16
+
+/*!
+ * Command Macro to control a burst capture.
+ * Parameter 1 is 0 to cancel it, 1 to trigger it now.
+ */
+#define CMD_RX_BURST 0x17
+
+/*!
+ * Command Macro to get the loopback latency statistics, as a CMD_TX_LOOPBACK_LATENCY packet.
+ * Parameter 1 is 1 to clear them once they are sent.
+ */
+#define CMD_RX_LOOPBACK_LATENCY 0x19
+
+/*!
+ * Extended packet which starts a firmware update.
+ * The payload is the image length and its CRC-32, both 32 bits LSB first.
+ */
+#define CMD_RX_UPDATE_START 0x20
+
+/*!
+ * Extended packet which configures the decimating filter of an analog channel.
+ * The offset is the channel (LSB) and the decimation factor (MSB),
+ * the payload the Q15 FIR coefficients, 16 bits LSB first, or nothing for a plain average.
+ */
+#define CMD_RX_FILTER 0x23
+
+/*!
+ * Extended packet which sets how an analog channel is reported in asynchronous mode.
+ * The offset is the channel, the payload its TReportConfig: deadband, hysteresis,
+ * minimum and maximum interval in ms, each 16 bits LSB first.
+ */
+#define CMD_RX_REPORT_CONFIG 0x24
+
+/*!
+ * Extended packet which sets the frequency a Goertzel bin tracks.
+ * The offset is the bin (LSB) and the Sampler channel (MSB), the payload the frequency in tenths of a Hz
+ * (0 turns the bin off) and the block length in samples, each 16 bits LSB first.
+ */
+#define CMD_RX_SPECTRUM_BIN 0x25
+
+/*!
+ * Extended packet which arms a burst capture.
+ * The offset is the Sampler channel (LSB) and the TBurstTrigger (MSB), the payload the sample rate (32 bits),
+ * the number of samples, the number of them before the trigger and the two's complement trigger level (16 bits each), all LSB first.
+ */
+#define CMD_RX_BURST_ARM 0x26
+
+/*!
+ * Extended packet which loops an analog channel back to a DAC.
+ * The offset is the DAC (LSB) and the Sampler channel (MSB), 0xFF to turn the output off,
+ * the payload its TLoopbackConfig: gain, offset and filter coefficient, each 16 bits LSB first.
+ */
+#define CMD_RX_LOOPBACK 0x27
+
+/*!
+ * Extended packet carrying the next chunk of a firmware update.
+ * The offset is the chunk's sequence number, starting from 0.
+ * Up to CMD_UPDATE_WINDOW chunks may be sent before their acknowledgements come back.
+ */
+#define CMD_RX_UPDATE_DATA 0x21
+
+/*!
+ * Extended packet which ends a firmware update, with an empty payload.
+ */
+#define CMD_RX_UPDATE_FINISH 0x22
+
 /*
  * Command Macro to get analog inpu
  */
@@ -125,6 +311,31 @@
  */
 #define CMD_TOWER_MODE_SET 2
 
+/*!
+ * Update status: the chunk with the given sequence number was accepted, or the update was started.
+ */
+#define CMD_UPDATE_ACK 0
+
+/*!
+ * Update status: a chunk was out of order or corrupted. Resend from the given sequence number.
+ */
+#define CMD_UPDATE_NAK 1
+
+/*!
+ * Update status: the image is verified and runs after the next reset.
+ */
+#define CMD_UPDATE_DONE 2
+
+/*!
+ * Update status: the update failed and must be started again.
+ */
+#define CMD_UPDATE_FAIL 3
+
+/*!
+ * Number of update chunks that fit in the receive FIFO, and so may be in flight at once.
+ */
+#define CMD_UPDATE_WINDOW 3
+
 /*!
  * The lower 2 bytes of 12011146.
  */
@@ -168,6 +379,55 @@ bool CMD_ProtocolMode(const uint8_t mode, bool isSync);
  * @return bool TRUE if the operation succeeded.
  */
 
+/*!
+ * @brief Starts streaming a block of the flash data region to the PC.
+ * @param offset Offset of the first byte from the start of the data region.
+ * @param nbPackets The number of full extended packets to send. The block is cut short at the end of the region.
+ * @note Replaces any block still being streamed. The packets go out from CMD_FlashReadPoll.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_FlashReadBlock(const uint16_t offset, const uint8_t nbPackets);
+
+/*!
+ * @brief Sends the next packets of a block read while there is room in the transmit FIFO.
+ * @note Call from the packet thread. Does nothing while the flash is being erased or programmed.
+ */
+void CMD_FlashReadPoll(void);
+
+/*!
+ * @brief Starts or stops streaming input captures from an FTM channel.
+ * @param channelNb The FTM channel. Channel 0 drives the software timers and can't be used.
+ * @param edges The TTimerInputDetection edges to capture, or TIMER_INPUT_OFF to stop streaming channelNb.
+ * @note Only one channel is streamed at a time. The packets go out from CMD_CapturePoll.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_Capture(const uint8_t channelNb, const uint8_t edges);
+
+/*!
+ * @brief Sends the captures waiting on the streamed channel while there is room in the transmit FIFO.
+ * @note Call from the packet thread.
+ */
+void CMD_CapturePoll(void);
+
+/*!
+ * @brief Starts a firmware update from the extended packet in PacketExtended.
+ * @return bool TRUE if the update was started.
+ */
+bool CMD_UpdateStart(void);
+
+/*!
+ * @brief Adds the chunk in PacketExtended to the firmware update and acknowledges it.
+ * @note A chunk out of sequence is answered with a NAK carrying the sequence number expected.
+ * @return bool TRUE if the chunk was accepted.
+ */
+bool CMD_UpdateData(void);
+
+/*!
+ * @brief Finishes a firmware update, verifying the image and arming the block swap.
+ * @return bool TRUE if the new image runs after the next reset.
+ */
+bool CMD_UpdateFinish(void);
+
 /*!
  * @brief Saves the tower number to a buffer.
  * @param mode Getting or setting.
@@ -225,6 +485,129 @@ bool CMD_SetTime(const uint8_t hours, const uint8_t minutes, const uint8_t secon
  */
 bool CMD_AnalogValue(const uint8_t channelNb);
 
+/*!
+ * @brief Sends the fraction of the time the CPU was busy since the last report.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_CpuLoad(void);
+
+/*!
+ * @brief Configures an analog channel's filter from the extended packet in PacketExtended.
+ * @return bool TRUE if the filter was configured.
+ */
+bool CMD_Filter(void);
+
+/*!
+ * @brief Sets how an analog channel is reported from the extended packet in PacketExtended.
+ * @return bool TRUE if the settings were changed.
+ */
+bool CMD_ReportConfig(void);
+
+/*!
+ * @brief Changes the analog channels sampled.
+ * @param channelMask A bit for each channel to sample.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_AnalogChannels(const uint16_t channelMask);
+
+/*!
+ * @brief Reports a new value of an analog channel.
+ * @param channelNb The channel.
+ * @param value The new value.
+ * @param isSync TRUE to always send the whole value, FALSE to only send worthwhile changes, as deltas where they fit.
+ * @note Call CMD_AnalogFlush once all the channels have been reported.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_AnalogReport(const uint8_t channelNb, const int16_t value, const bool isSync);
+
+/*!
+ * @brief Sends a delta held back to share a packet with the next one.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_AnalogFlush(void);
+
+/*!
+ * @brief Sends the service time, jitter and entry latency statistics of an ISR.
+ * @param isr The PROFILE_ number of the ISR.
+ * @param reset 1 to clear the statistics once they are sent.
+ * @return bool TRUE if the operation succeeded. Always FALSE if profiling isn't built in.
+ */
+bool CMD_Profile(const uint8_t isr, const uint8_t reset);
+
+/*!
+ * @brief Sends the meter measurements, and sets whether they are streamed.
+ * @param stream 1 to send the measurements of every window from now on, 0 to stop.
+ * @param clear 1 to clear the energy total before sending.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_Meter(const uint8_t stream, const uint8_t clear);
+
+/*!
+ * @brief Sends the measurements of a window that has just closed, if they are streamed.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_MeterReport(void);
+
+/*!
+ * @brief Sets the frequency of a Goertzel bin from the extended packet in PacketExtended.
+ * @return bool TRUE if the bin was set.
+ */
+bool CMD_SpectrumBin(void);
+
+/*!
+ * @brief Sends the results of the Goertzel bins which just finished a block.
+ * @param binMask A bit for each bin to send.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_SpectrumReport(const uint8_t binMask);
+
+/*!
+ * @brief Takes an FFT of an analog channel.
+ * @param channelNb The Sampler channel.
+ * @note The packets go out from CMD_SpectrumPoll once the FFT is done.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_SpectrumFFT(const uint8_t channelNb);
+
+/*!
+ * @brief Sends the values of a finished FFT while there is room in the transmit FIFO.
+ * @note Call from the packet thread.
+ */
+void CMD_SpectrumPoll(void);
+
+/*!
+ * @brief Arms a burst capture from the extended packet in PacketExtended.
+ * @note The capture goes out from CMD_BurstPoll once it is done.
+ * @return bool TRUE if the capture was armed.
+ */
+bool CMD_BurstArm(void);
+
+/*!
+ * @brief Cancels or triggers a burst capture.
+ * @param action 0 to cancel, 1 to trigger now.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_Burst(const uint8_t action);
+
+/*!
+ * @brief Moves a burst capture along, and sends it while there is room in the transmit FIFO once it is done.
+ * @note Call from the packet thread, often enough to catch the trigger before the buffer fills.
+ */
+void CMD_BurstPoll(void);
+
+/*!
+ * @brief Sets the loopback of a DAC from the extended packet in PacketExtended.
+ * @return bool TRUE if the loopback was set.
+ */
+bool CMD_Loopback(void);
+
+/*!
+ * @brief Sends the loopback latency statistics.
+ * @param clear 1 to clear them once they are sent.
+ * @return bool TRUE if the operation succeeded.
+ */
+bool CMD_LoopbackLatency(const uint8_t clear);
+
 #endif /* SOURCES_CMD_H_ */
 /*!
 ** @}
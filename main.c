@@ -41,10 +41,22 @@
 #include "packet.h"
 #include "LEDs.h"
 #include "Flash.h"
+#include "Config.h"
+#include "Update.h"
 #include "types.h"
 #include "cmd.h"
 #include "RTC.h"
 #include "FTM.h"
+#include "Timer.h"
+#include "Time.h"
+#include "Defer.h"
+#include "Event.h"
+#include "Profile.h"
+#include "Sampler.h"
+#include "Filter.h"
+#include "Meter.h"
+#include "Spectrum.h"
+#include "Loopback.h"
 #include "PIT.h"
 #include "FIFO.h"
 // Analog functions
@@ -78,18 +90,37 @@ TAnalogInput Analog_Input[ANALOG_NB_INPUTS];
 // Thread set up
 // ----------------------------------------
 // Arbitrary thread stack size - big enough for stacking of interrupts and OS use.
-#define THREAD_STACK_SIZE 100
-#define NB_ANALOG_CHANNELS 2
+#define THREAD_STACK_SIZE 256
+// The packet thread runs the commands and the deferred calls, so it needs more
+#define PACKET_THREAD_STACK_SIZE 1024
+// Analog channels processed by their own thread, one per Sampler channel
+#define NB_ANALOG_CHANNELS SAMPLER_NB_CHANNELS
+// Analog channels sampled at startup, a bit per Sampler channel
+#define ANALOG_CHANNEL_MASK 0x0003
+// Samples per second taken of each analog channel
+#define SAMPLE_RATE 1000
+// Samples averaged into each reported value, so reports come at 100 Hz by default
+#define DECIMATION 10
 
 // Thread stacks
 OS_THREAD_STACK(InitModulesThreadStack, THREAD_STACK_SIZE); /*!< The stack for the LED Init thread. */
 static uint32_t AnalogThreadStacks[NB_ANALOG_CHANNELS][THREAD_STACK_SIZE] __attribute__ ((aligned(0x08)));
+OS_THREAD_STACK(PacketThreadStack, PACKET_THREAD_STACK_SIZE); /*!< The stack for the packet thread. */
+OS_THREAD_STACK(FlashThreadStack, THREAD_STACK_SIZE); /*!< The stack for the Flash commit thread. */
 
 // ----------------------------------------
 // Thread priorities
 // 0 = highest priority
 // ----------------------------------------
-const uint8_t ANALOG_THREAD_PRIORITIES[NB_ANALOG_CHANNELS] = {1, 2};
+// Analog threads run just below the init thread, in channel order
+#define ANALOG_THREAD_PRIORITY(channelNb) ((channelNb) + 1)
+// Then the packets, so a command never holds up a report
+#define PACKET_THREAD_PRIORITY ANALOG_THREAD_PRIORITY(NB_ANALOG_CHANNELS)
+// Committing to Flash waits until nothing else needs doing
+#define FLASH_THREAD_PRIORITY (PACKET_THREAD_PRIORITY + 1)
+
+// Events handled by the packet thread
+#define PACKET_THREAD_EVENTS (EVENT_PACKET | EVENT_UART_TX | EVENT_FLASH | EVENT_CAPTURE | EVENT_DEFER)
 
 /*! @brief Data structure used to pass Analog configuration to a user thread
  *
@@ -100,20 +131,17 @@ typedef struct AnalogThreadData
   uint8_t channelNb;
 } TAnalogThreadData;
 
-/*! @brief Analog thread configuration data
+/*! @brief Analog thread configuration data, filled in by InitModulesThread
  *
  */
-static TAnalogThreadData AnalogThreadData[NB_ANALOG_CHANNELS] =
-{
-  {
-    .semaphore = NULL,
-    .channelNb = 0
-  },
-  {
-    .semaphore = NULL,
-    .channelNb = 1
-  }
-};
+static TAnalogThreadData AnalogThreadData[NB_ANALOG_CHANNELS];
+
+// Held while an analog channel is filtered and reported, or reconfigured.
+// Reports of different channels share packets, so they must not interleave.
+static OS_ECB* AnalogLock;
+
+// Held while the pending Flash writes are copied for a commit, or a command or deferred work is handled, as all of them write the Flash
+static OS_ECB* CommitLock;
 
 void LPTMRInit(const uint16_t count)
 {
@@ -152,72 +180,85 @@ void LPTMRInit(const uint16_t count)
   LPTMR0_CSR |= LPTMR_CSR_TEN_MASK;
 }
 
-void __attribute__ ((interrupt)) LPTimer_ISR(void)
+/*! @brief Meters the samples taken since the last update, and sends the measurements of each window closed.
+ *
+ *  @param arguments Unused.
+ *  @note Deferred from LPTimer_ISR.
+ */
+static void MeterUpdate(void *arguments)
 {
-  //OS_ISREnter();
-
-  // Clear interrupt flag
-  LPTMR0_CSR |= LPTMR_CSR_TCF_MASK;
-
-  // Signal the analog channels to take a sample
-  for (uint8_t analogNb = 0; analogNb < NB_ANALOG_CHANNELS; analogNb++)
+  if (Meter_Update())
     {
-      Analog_Get(channelNb);
-      if (isSynchronous)
-	{
-	  Packet_Put(CMD_RX_ANALOG_INPUT, channelNb, Analog_Input[channelNb].value.s.Lo, Analog_Input[channelNb].value.s.Hi);
-	}
-      else
-	{
-	  if (Analog_Input[channelNb].value.l != Analog_Input[channelNb].oldValue.l)
-	    Packet_Put(CMD_RX_ANALOG_INPUT, channelNb, Analog_Input[channelNb].value.s.Lo, Analog_Input[channelNb].value.s.Lo);
-	}
+      CMD_MeterReport();
     }
-
-
-  //OS_ISRExit();
 }
 
-/*! @brief Initialises modules.
+/*! @brief Runs the harmonic analysis on the samples taken since the last update, and sends the bins which finished a block.
  *
+ *  @param arguments Unused.
+ *  @note Deferred from LPTimer_ISR.
  */
-static void InitModulesThread(void* pData)
+static void SpectrumUpdate(void *arguments)
 {
-  // Analog
-  (void)Analog_Init(CPU_BUS_CLK_HZ);
+  CMD_SpectrumReport(Spectrum_Update());
+}
 
-  // Generate the global analog semaphores
-  //for (uint8_t analogNb = 0; analogNb < NB_ANALOG_CHANNELS; analogNb++)
-    //AnalogThreadData[analogNb].semaphore = OS_SemaphoreCreate(0);
+void __attribute__ ((interrupt)) LPTimer_ISR(void)
+{
+  OS_ISREnter();
+  PROFILE_ENTER(PROFILE_LPTMR);
+  // The counter restarted at the compare point and runs on the 1 kHz LPO. It has to be written to latch it for reading.
+  PROFILE_LATENCY(PROFILE_LPTMR, (LPTMR0_CNR = 0, LPTMR0_CNR), 1000);
 
-  // Initialise the low power timer to tick every 10 ms
-  LPTMRInit(10);
+  // Clear interrupt flag
+  LPTMR0_CSR |= LPTMR_CSR_TCF_MASK;
 
-  // We only do this once - therefore delete this thread
-  //OS_ThreadDelete(OS_PRIORITY_SELF);
+  // Signal the analog channels to report their samples
+  uint16_t mask = Sampler_Channels();
+  while (mask)
+    {
+      uint8_t channelNb = __builtin_ctz(mask);
+      mask &= mask - 1;
+      (void)OS_SemaphoreSignal(AnalogThreadData[channelNb].semaphore);
+    }
+  Defer_Post(&MeterUpdate, (void *)0);
+  Defer_Post(&SpectrumUpdate, (void *)0);
+
+  PROFILE_EXIT(PROFILE_LPTMR);
+  OS_ISRExit();
 }
 
-/*! @brief Samples a value on an ADC channel and sends it to the corresponding DAC channel.
+/*! @brief Filters the samples of an analog channel made since its last report, and reports them.
  *
+ *  @param pData The channel's TAnalogThreadData.
+ *  @note Signalled by LPTimer_ISR.
  */
-/*
-void AnalogLoopbackThread(void* pData)
+static void AnalogThread(void* pData)
 {
   // Make the code easier to read by giving a name to the typecast'ed pointer
   #define analogData ((TAnalogThreadData*)pData)
 
   for (;;)
-  {
-    int16_t analogInputValue;
+    {
+      int16_t outputs[4];
 
-    //(void)OS_SemaphoreWait(analogData->semaphore, 0);
-    // Get analog sample
-    Analog_Get(analogData->channelNb, &analogInputValue);
-    // Put analog sample
-    Analog_Put(analogData->channelNb, analogInputValue);
-  }
+      (void)OS_SemaphoreWait(analogData->semaphore, 0);
+      (void)OS_SemaphoreWait(AnalogLock, 0);
+
+      uint16_t nbOutputs = Filter_Read(analogData->channelNb, outputs, sizeof(outputs) / sizeof(outputs[0]));
+      for (uint16_t i = 0; i < nbOutputs; i++)
+	{
+	  CMD_AnalogReport(analogData->channelNb, outputs[i], isSynchronous);
+	}
+      // The threads run in channel order, so the last channel sends any delta still held back
+      if (!(Sampler_Channels() >> (analogData->channelNb + 1)))
+	{
+	  CMD_AnalogFlush();
+	}
+
+      (void)OS_SemaphoreSignal(AnalogLock);
+    }
 }
-*/
 
 
 /*
@@ -228,8 +269,19 @@ void BlueLedOff(void *arguments)
   LEDs_Off(LED_BLUE);
 }
 
-// 1 second Timer for FTM Channel
-const static TFTMChannel PacketTimer = {0, 24414, TIMER_FUNCTION_OUTPUT_COMPARE, TIMER_OUTPUT_DISCONNECT, &BlueLedOff, (void *)0};
+// Turns the blue LED off 1 second after the last packet
+static TTimer PacketTimer = {&BlueLedOff, (void *)0};
+
+/*
+ *  Flags the pending Flash writes for commit by the Flash thread
+ */
+void FlashIdle(void *arguments)
+{
+  Event_Set(EVENT_COMMIT);
+}
+
+// Fires after 1 second of idle link, so pending Flash writes are committed
+static TTimer FlashTimer = {&FlashIdle, (void *)0};
 
 
 
@@ -244,6 +296,7 @@ void PacketHandle()
   switch (Packet_Command & ~PACKET_ACK_MASK)
   {
     case CMD_RX_STARTUP_VALUES:
+      Update_Confirm();  // the PC can talk to this image, so keep it
       error = !CMD_GetStartupValues();
       break;
 
@@ -266,6 +319,64 @@ void PacketHandle()
     case CMD_RX_TOWER_MODE:
       error = !CMD_TowerMode(Packet_Parameter1, Packet_Parameter2, Packet_Parameter3);
     break;
+    case CMD_RX_READ_BLOCK:
+      error = !CMD_FlashReadBlock(Packet_Parameter12, Packet_Parameter3);
+      break;
+    case CMD_RX_CAPTURE:
+      error = !CMD_Capture(Packet_Parameter1, Packet_Parameter2);
+      break;
+    case CMD_RX_CPU_LOAD:
+      error = !CMD_CpuLoad();
+      break;
+    case CMD_RX_PROFILE:
+      error = !CMD_Profile(Packet_Parameter1, Packet_Parameter2);
+      break;
+    case CMD_RX_FILTER:
+      // Analog channels are only reconfigured between their reports
+      (void)OS_SemaphoreWait(AnalogLock, 0);
+      error = !CMD_Filter();
+      (void)OS_SemaphoreSignal(AnalogLock);
+      break;
+    case CMD_RX_REPORT_CONFIG:
+      (void)OS_SemaphoreWait(AnalogLock, 0);
+      error = !CMD_ReportConfig();
+      (void)OS_SemaphoreSignal(AnalogLock);
+      break;
+    case CMD_RX_METER:
+      error = !CMD_Meter(Packet_Parameter1, Packet_Parameter2);
+      break;
+    case CMD_RX_SPECTRUM_BIN:
+      error = !CMD_SpectrumBin();
+      break;
+    case CMD_RX_SPECTRUM_FFT:
+      error = !CMD_SpectrumFFT(Packet_Parameter1);
+      break;
+    case CMD_RX_BURST_ARM:
+      error = !CMD_BurstArm();
+      break;
+    case CMD_RX_BURST:
+      error = !CMD_Burst(Packet_Parameter1);
+      break;
+    case CMD_RX_LOOPBACK:
+      error = !CMD_Loopback();
+      break;
+    case CMD_RX_LOOPBACK_LATENCY:
+      error = !CMD_LoopbackLatency(Packet_Parameter1);
+      break;
+    case CMD_RX_ANALOG_CHANNELS:
+      (void)OS_SemaphoreWait(AnalogLock, 0);
+      error = !CMD_AnalogChannels(Packet_Parameter12);
+      (void)OS_SemaphoreSignal(AnalogLock);
+      break;
+    case CMD_RX_UPDATE_START:
+      error = !CMD_UpdateStart();
+      break;
+    case CMD_RX_UPDATE_DATA:
+      error = !CMD_UpdateData();
+      break;
+    case CMD_RX_UPDATE_FINISH:
+      error = !CMD_UpdateFinish();
+      break;
     case CMD_RX_SET_TIME:
       error = !CMD_SetTime(Packet_Parameter1, Packet_Parameter2, Packet_Parameter3);
       default:
@@ -287,6 +398,18 @@ void PacketHandle()
 	}
 }
 
+/*! @brief Sends the time.
+ *
+ *  @param arguments Unused.
+ *  @note Deferred from RtcCallback.
+ */
+static void SendTime(void *arguments)
+{
+  uint8_t h, m, s;
+  RTC_Get(&h, &m, &s);
+  CMD_SendTime(h, m, s);
+}
+
 /*! @brief User callback function for RTC
  *
  *  @param arguments Pointer to the user argument to use with the user callback function
@@ -294,9 +417,7 @@ void PacketHandle()
  */
 void RtcCallback(void *arguments)
 {
-  uint8_t h, m, s;
-  RTC_Get(&h, &m, &s);
-  CMD_SendTime(h, m, s);
+  Defer_Post(&SendTime, (void *)0);
   LEDs_Toggle(LED_YELLOW);
 }
 
@@ -311,35 +432,104 @@ void PitCallback(void *arguments)
   AnalogIn();
 }
 
-/*lint -save  -e970 Disable MISRA rule (6.3) checking. */
-int main(void)
-/*lint -restore Enable MISRA rule (6.3) checking. */
+/*! @brief Handles the packets from the PC, runs the calls deferred by the interrupts, and streams data out as the UART drains.
+ *
+ *  @param pData Unused.
+ */
+static void PacketThread(void* pData)
 {
-  /* Write your local variable definition here */
-
-  /*** Processor Expert internal initialization. DON'T REMOVE THIS CODE!!! ***/
+  for (;;)
+  {
+      uint32_t events = Event_Wait(PACKET_THREAD_EVENTS);  // blocks until an interrupt hands over some work
 
-  PE_low_level_init();
+      if (events & EVENT_PACKET)
+      {
+	 while (UART_InCount() > 0)
+	 {
+	    if(Packet_Get()) // if we receive a full packet
+	    {
+	       LEDs_On(LED_BLUE);  // Toggle LED HIGH when packet is sent through
+	       Timer_Start(&PacketTimer, TIMER_TICKS_PER_SECOND, 0);  // Update Timer Setting
+	       (void)OS_SemaphoreWait(CommitLock, 0);
+	       PacketHandle(); // handle the packet
+	       (void)OS_SemaphoreSignal(CommitLock);
+	       if (Flash_IsDirty() || Config_IsDirty())
+		 {
+		   Timer_Start(&FlashTimer, TIMER_TICKS_PER_SECOND, 0);  // Restart the idle deadline
+		 }
+	    }
+	 }
+      }
+      if (events & EVENT_DEFER)
+      {
+	 // Deferred work such as the meter saving its energy totals writes non-volatile variables too
+	 (void)OS_SemaphoreWait(CommitLock, 0);
+	 Defer_Run();  // work posted by the interrupts
+	 (void)OS_SemaphoreSignal(CommitLock);
+      }
+      // Every wake-up may have made room in the UART, finished a Flash command or brought in captures
+      CMD_FlashReadPoll();  // stream any block read as the UART drains
+      CMD_CapturePoll();    // and any input captures
+      CMD_SpectrumPoll();   // and any FFT once it is done
+      CMD_BurstPoll();      // look for a burst trigger, and send the capture once it is done
+  }
+}
 
-  /*** End of Processor Expert internal initialization.                    ***/
+/*! @brief Commits the pending Flash writes once the link has gone quiet.
+ *
+ *  @param pData Unused.
+ */
+static void FlashThread(void* pData)
+{
+  for (;;)
+  {
+      (void)Event_Wait(EVENT_COMMIT);
+
+      // Only the copy is taken under the lock. Appending it to the log may wait for sector erases when the log compacts,
+      // and the packets and the deferred work carry on meanwhile.
+      (void)OS_SemaphoreWait(CommitLock, 0);
+      bool changed = Flash_Snapshot();
+      (void)OS_SemaphoreSignal(CommitLock);
+      if (changed)
+	{
+	  (void)Flash_CommitSnapshot();  // append the words changed since the last commit to the log
+	}
+      (void)Config_Commit();
+  }
+}
 
-    __DI();
-  //EnterCritical();
+/*! @brief Initialises modules, then starts the other threads.
+ *
+ *  @param pData Unused.
+ */
+static void InitModulesThread(void* pData)
+{
+  __DI();
 
   LEDs_Init();
 
   PIT_Init(CPU_BUS_CLK_HZ, &PitCallback, (void *)0);
   PIT_Set(500000000, 0);
   PIT_Enable(1);
+  Time_Init();  // timestamps run off PIT channels 2 and 3
+  Defer_Init();
+  Event_Init();
+  Profile_Init();  // compiled out unless PROFILE_ENABLED is defined
 
   Packet_Init(115200, CPU_BUS_CLK_HZ);
   // Initialising UART
   UART_Init(115200, CPU_BUS_CLK_HZ);
   Flash_Init();
+  Update_Init();  // first, as it may roll back to the previous image
   CMD_Init();
 
   FTM_Init();
-  FTM_Set(&PacketTimer);
+  Timer_Init(0);  // software timers all run off FTM channel 0
+  Sampler_Init(CPU_BUS_CLK_HZ, SAMPLE_RATE, ANALOG_CHANNEL_MASK);  // the Sampler owns the ADCs
+  Filter_Init(DECIMATION);
+  Meter_Init(SAMPLE_RATE);  // after the Sampler, and after CMD_Init so the Flash layout doesn't move
+  Spectrum_Init(SAMPLE_RATE);
+  Loopback_Init();  // after the Sampler, whose row interrupt runs the loopback
 
   // Initialise RTC last
   RTC_Init(&RtcCallback, (void *)0);
@@ -355,33 +545,55 @@ int main(void)
       //Flash_Write16((uint16_t* )NvTowerMode, 1);
     //}
   //todo: review above code - may be overwriting
-  //ExitCritical();
 
+  for (uint8_t analogNb = 0; analogNb < NB_ANALOG_CHANNELS; analogNb++)
+    AnalogThreadData[analogNb].channelNb = analogNb;
 
+  // Generate the global analog semaphores
+  for (uint8_t analogNb = 0; analogNb < NB_ANALOG_CHANNELS; analogNb++)
+    AnalogThreadData[analogNb].semaphore = OS_SemaphoreCreate(0);
+  AnalogLock = OS_SemaphoreCreate(1);
+  CommitLock = OS_SemaphoreCreate(1);
 
   __EI();
-  //OS_ERROR error;
-
-  //OS_Init(CPU_CORE_CLK_HZ, true);
 
+  // This thread has the highest priority, so the others only start once it is deleted
+  for (uint8_t analogNb = 0; analogNb < NB_ANALOG_CHANNELS; analogNb++)
+    (void)OS_ThreadCreate(AnalogThread, &AnalogThreadData[analogNb], &AnalogThreadStacks[analogNb][THREAD_STACK_SIZE - 1],
+			  ANALOG_THREAD_PRIORITY(analogNb));
+  (void)OS_ThreadCreate(PacketThread, NULL, &PacketThreadStack[PACKET_THREAD_STACK_SIZE - 1], PACKET_THREAD_PRIORITY);
+  (void)OS_ThreadCreate(FlashThread, NULL, &FlashThreadStack[THREAD_STACK_SIZE - 1], FLASH_THREAD_PRIORITY);
 
   //sending over the 'tower startup', 'tower version' and 'tower number' at startup
   CMD_GetStartupValues();
 
-  /* Write your code here */
-  for (;;)
-  {
-      //UART_Poll(); // poll the UART
-      if(Packet_Get()) // if we receive a full packet
-      {
-	 LEDs_On(LED_BLUE);  // Toggle LED HIGH when packet is sent through
-	 FTM_StartTimer(&PacketTimer);  // Update Timer Setting
- 	 PacketHandle(); // handle the packet
-      }
-      // Start multithreading - never returns!
+  // Initialise the low power timer to tick every 10 ms
+  LPTMRInit(10);
 
-  }
-  //OS_Start();
+  // We only do this once - therefore delete this thread
+  OS_ThreadDelete(OS_PRIORITY_SELF);
+}
+
+/*lint -save  -e970 Disable MISRA rule (6.3) checking. */
+int main(void)
+/*lint -restore Enable MISRA rule (6.3) checking. */
+{
+  /* Write your local variable definition here */
+
+  /*** Processor Expert internal initialization. DON'T REMOVE THIS CODE!!! ***/
+
+  PE_low_level_init();
+
+  /*** End of Processor Expert internal initialization.                    ***/
+
+    __DI();
+
+  // Initialise the RTOS, and the thread that initialises everything else
+  (void)OS_Init(CPU_CORE_CLK_HZ, true);
+  (void)OS_ThreadCreate(InitModulesThread, NULL, &InitModulesThreadStack[THREAD_STACK_SIZE - 1], 0);
+
+  // Start multithreading - never returns!
+  OS_Start();
 
   /*** Don't write any code pass this line, or it will be deleted during code generation. ***/
   /*** RTOS startup code. Macro PEX_RTOS_START is defined by the RTOS component. DON'T MODIFY THIS CODE!!! ***/
@@ -12,6 +12,8 @@
 #include "packet.h"
 #include "types.h"
 #include "UART.h"
+#include "Time.h"
+#include "OS.h"
 
 static uint8_t Position = 0;
 
@@ -30,11 +32,21 @@ static uint8_t Position = 0;
 
 TPacket Packet;
 
+TPacketExtended PacketExtended;
+
+uint64_t Packet_Timestamp;
+
+// Running XOR of the extended packet being received
+static uint8_t ExtendedChecksum;
+
+// Held while a packet goes into the transmit FIFO, so packets from different threads don't interleave
+static OS_ECB *TxLock;
+
 uint8_t PacketTest(void)
 {
   uint8_t calc_checksum = Packet_Command ^ Packet_Parameter1 ^ Packet_Parameter2 ^ Packet_Parameter3; // XOR packet to calculate the checksum
   uint8_t ret_val = calc_checksum == Packet_Checksum;
-
+  return ret_val;
 }
 
 
@@ -45,10 +57,55 @@ uint8_t PacketTest(void)
  */
 bool Packet_Init(const uint32_t baudRate, const uint32_t moduleClk)
 {
-  UART_Init(baudRate, moduleClk);  // Initialising the Baud Rate
+  TxLock = OS_SemaphoreCreate(1);
+  return UART_Init(baudRate, moduleClk) && TxLock;  // Initialising the Baud Rate
+}
+
+/* checks the four header bytes of an extended packet before committing to it
+ * a command with PACKET_EXTENDED_MASK set is only an extended packet if its length byte is in range,
+ * otherwise the command byte is dropped so the following bytes are checked as the start of a packet
+ * assumes the header is in Packet_Command and Packet_Parameter1..3, and Position is 4
+ */
+static void ExtendedStart(void)
+{
+	if (Packet_Parameter3 > PACKET_EXTENDED_MAX_DATA)
+	{
+		Packet_Command = Packet_Parameter1;  // shift the header across for re-alignment
+		Packet_Parameter1 = Packet_Parameter2;
+		Packet_Parameter2 = Packet_Parameter3;
+		Position = 3;
+		return;
+	}
+	PacketExtended.offset = Packet_Parameter1 | ((uint16_t) Packet_Parameter2 << 8);
+	PacketExtended.length = Packet_Parameter3;
+	ExtendedChecksum = Packet_Command ^ Packet_Parameter1 ^ Packet_Parameter2 ^ Packet_Parameter3;
+}
+
+/* collects the payload and checksum of an extended packet once its header has been accepted
+ * input: integer, uartData - the next received byte
+ * output: boolean - true if a full extended packet with a matching checksum has been received
+ */
+static bool ExtendedGet(const uint8_t uartData)
+{
+	if (Position < (PACKET_EXTENDED_OVERHEAD - 1 + PacketExtended.length))
+	{
+		PacketExtended.data[Position - (PACKET_EXTENDED_OVERHEAD - 1)] = uartData;
+		ExtendedChecksum ^= uartData;
+		Position++;
+		return 0;
+	}
+	// Checksum byte. A bad packet is dropped, and the sender recovers from the missing acknowledgement.
+	Position = 0;
+	if (ExtendedChecksum != uartData)
+	{
+		return 0;
+	}
+	Packet_Timestamp = Time_Now();
+	return 1;
 }
 
 /* attempts to receive a full packet from the FIFO
+ * an extended packet shares its first four bytes with a basic one, so both are collected the same way until the length byte
  * assumes Packet_Init has been called
  * output: boolean - true if a full packet has been received, in phase
  */
@@ -58,6 +115,10 @@ bool Packet_Get(void)
   if (!UART_InChar(&uartData))  // Checking if there is any data in the FIFO, if not return 0
   {
       return 0;
+  }
+  if ((Position >= (PACKET_EXTENDED_OVERHEAD - 1)) && (Packet_Command & PACKET_EXTENDED_MASK))
+  {
+      return ExtendedGet(uartData);
   }
 	switch (Position)
 	{
@@ -65,23 +126,28 @@ bool Packet_Get(void)
 		Packet_Command = uartData;
 		Position++;
 		return 0;
-	case 1:	// Parameter 1 byte of packet
+	case 1:	// Parameter 1 byte of packet, or offset LSB of an extended packet
 		Packet_Parameter1 = uartData;
 		Position++;
 		return 0;
-	case 2:	// Parameter 2 byte of packet
+	case 2:	// Parameter 2 byte of packet, or offset MSB of an extended packet
 		Packet_Parameter2 = uartData;
 		Position++;
 		return 0;
-	case 3:	// Parameter 3 byte of packet
+	case 3:	// Parameter 3 byte of packet, or payload length of an extended packet
 		Packet_Parameter3 = uartData;
 		Position++;
+		if (Packet_Command & PACKET_EXTENDED_MASK)
+		{
+			ExtendedStart();
+		}
 		return 0;
 	case 4:	// Checksum byte of packet
 		Packet_Checksum = uartData;
 		if (PacketTest())  // XORing the Checksum
 		{
 			Position = 0;  // if checksum XOR is successful, reset the packet position to 0
+			Packet_Timestamp = Time_Now();
 			return 1;
 		}
                 // If XORing is unsuccessful, moves each byte across for re-alignment
@@ -89,6 +155,10 @@ bool Packet_Get(void)
 		Packet_Parameter1 = Packet_Parameter2;
 		Packet_Parameter2 = Packet_Parameter3;
 		Packet_Parameter3 = Packet_Checksum;
+		if (Packet_Command & PACKET_EXTENDED_MASK)
+		{
+			ExtendedStart();  // the shifted bytes may be the header of an extended packet
+		}
 		return 0;
 	default:
                 //reset the counter
@@ -99,18 +169,16 @@ bool Packet_Get(void)
 }
 
 
-/* sends a packet to the transmit FIFO
- * assumes Packet_Init has been called
- * assumes packet is in phase
+/* places the bytes of a packet in the transmit FIFO
+ * assumes the caller holds TxLock and has checked there is room
  * input: integer, command
  * input: integer, parameter1
  * input: integer, parameter2
  * input: integer, parameter3
- * output: boolean - true if valid packet was sent. always true, this function is only called for valid packets
+ * output: boolean - true if valid packet was sent
  */
-bool Packet_Put(const uint8_t command, const uint8_t parameter1, const uint8_t parameter2, const uint8_t parameter3)
+static bool Put(const uint8_t command, const uint8_t parameter1, const uint8_t parameter2, const uint8_t parameter3)
 {
-	//enter critical
 	if (!UART_OutChar(command)) // if command byte is not valid, failed to put command byte successfully
 	{
 		return 0;           // return 0 - failed to put packet
@@ -134,6 +202,88 @@ bool Packet_Put(const uint8_t command, const uint8_t parameter1, const uint8_t p
 	return 1; // packet is valid, return 1 - success
 }
 
+/* sends a packet to the transmit FIFO
+ * assumes Packet_Init has been called
+ * assumes packet is in phase
+ * input: integer, command
+ * input: integer, parameter1
+ * input: integer, parameter2
+ * input: integer, parameter3
+ * output: boolean - true if valid packet was sent, false (with nothing sent) if the FIFO hasn't room
+ */
+bool Packet_Put(const uint8_t command, const uint8_t parameter1, const uint8_t parameter2, const uint8_t parameter3)
+{
+	bool sent = 0;
+
+	if (OS_SemaphoreWait(TxLock, 0) != OS_NO_ERROR)
+	{
+		return 0;
+	}
+	// Checking the space first means a packet goes in whole or not at all
+	if (UART_OutSpace() >= PACKET_NB_BYTES)
+	{
+		sent = Put(command, parameter1, parameter2, parameter3);
+	}
+	(void) OS_SemaphoreSignal(TxLock);
+	return sent;
+}
+
+/* places the bytes of an extended packet in the transmit FIFO
+ * assumes the caller holds TxLock and has checked there is room
+ * input: integer, command
+ * input: integer, offset - where the payload belongs, sent LSB first
+ * input: pointer, data - the payload
+ * input: integer, length - the number of bytes of payload
+ * output: boolean - true if the whole packet was placed in the transmit FIFO
+ */
+static bool PutExtended(const uint8_t command, const uint16_t offset, const uint8_t * const data, const uint8_t length)
+{
+	uint16union_t position;
+	position.l = offset;
+
+	uint8_t checksum = command ^ position.s.Lo ^ position.s.Hi ^ length;
+	if (!UART_OutChar(command) || !UART_OutChar(position.s.Lo) || !UART_OutChar(position.s.Hi) || !UART_OutChar(length))
+	{
+		return 0;
+	}
+	for (uint8_t i = 0; i < length; i++)
+	{
+		if (!UART_OutChar(data[i]))
+		{
+			return 0;
+		}
+		checksum ^= data[i];
+	}
+	return UART_OutChar(checksum);
+}
+
+/* sends an extended packet to the transmit FIFO
+ * assumes Packet_Init has been called
+ * input: integer, command
+ * input: integer, offset - where the payload belongs, sent LSB first
+ * input: pointer, data - the payload
+ * input: integer, length - the number of bytes of payload
+ * output: boolean - true if the whole packet was placed in the transmit FIFO, false (with nothing sent) if it hasn't room
+ */
+bool Packet_PutExtended(const uint8_t command, const uint16_t offset, const uint8_t * const data, const uint8_t length)
+{
+	bool sent = 0;
+
+	if (length > PACKET_EXTENDED_MAX_DATA)
+	{
+		return 0;
+	}
+	if (OS_SemaphoreWait(TxLock, 0) != OS_NO_ERROR)
+	{
+		return 0;
+	}
+	if (UART_OutSpace() >= (length + PACKET_EXTENDED_OVERHEAD))
+	{
+		sent = PutExtended(command, offset, data, length);
+	}
+	(void) OS_SemaphoreSignal(TxLock);
+	return sent;
+}
 
 /* END packet */
 /*!
@@ -17,6 +17,13 @@
 // Packet structure
 #define PACKET_NB_BYTES 5
 
+// Largest payload of an extended packet
+#define PACKET_EXTENDED_MAX_DATA 64
+// Bytes an extended packet adds around its payload: command, offset (2), length and checksum
+#define PACKET_EXTENDED_OVERHEAD 5
+// Commands with this bit set are received as extended packets
+#define PACKET_EXTENDED_MASK 0x20
+
 #pragma pack(push)
 #pragma pack(1)
 
@@ -51,6 +58,16 @@ typedef union
 
 #pragma pack(pop)
 
+/*!
+ * @brief A received extended packet.
+ */
+typedef struct
+{
+  uint16_t offset;                          /*!< The packet's offset, or sequence number. */
+  uint8_t length;                           /*!< The number of bytes of payload. */
+  uint8_t data[PACKET_EXTENDED_MAX_DATA];   /*!< The payload. */
+} TPacketExtended;
+
 #define Packet_Command     Packet.packetStruct.command
 #define Packet_Parameter1  Packet.packetStruct.parameters.separate.parameter1
 #define Packet_Parameter2  Packet.packetStruct.parameters.separate.parameter2
@@ -61,6 +78,12 @@ typedef union
 
 extern TPacket Packet;
 
+// The payload of the last extended packet received. Its command is in Packet_Command.
+extern TPacketExtended PacketExtended;
+
+// Time_Now when the last byte of the last packet was taken from the receive FIFO
+extern uint64_t Packet_Timestamp;
+
 // Acknowledgment bit mask
 extern const uint8_t PACKET_ACK_MASK;
 
@@ -74,14 +97,29 @@ bool Packet_Init(const uint32_t baudRate, const uint32_t moduleClk);
 
 /*! @brief Attempts to get a packet from the received data.
  *
+ *  A command with PACKET_EXTENDED_MASK set starts an extended packet, which is placed in PacketExtended.
  *  @return bool - TRUE if a valid packet was received.
  */
 bool Packet_Get(void);
 
 /*! @brief Builds a packet and places it in the transmit FIFO buffer.
  *
- *  @return bool - TRUE if a valid packet was sent.
+ *  @return bool - TRUE if a valid packet was sent, FALSE (with nothing sent) if the FIFO hasn't room for all of it.
+ *  @note Only call from a thread. Packets from different threads are never interleaved.
  */
 bool Packet_Put(const uint8_t command, const uint8_t parameter1, const uint8_t parameter2, const uint8_t parameter3);
 
+/*! @brief Builds an extended packet and places it in the transmit FIFO buffer.
+ *
+ *  An extended packet is the command, the offset (LSB first), the payload length, the payload,
+ *  and an XOR checksum of everything before it.
+ *  @param command The packet's command.
+ *  @param offset The offset of the payload, for the receiver to place it.
+ *  @param data The payload.
+ *  @param length The number of bytes of payload, up to PACKET_EXTENDED_MAX_DATA.
+ *  @return bool - TRUE if the whole packet was placed in the transmit FIFO, FALSE (with nothing sent) if it hasn't room.
+ *  @note Only call from a thread. Packets from different threads are never interleaved.
+ */
+bool Packet_PutExtended(const uint8_t command, const uint16_t offset, const uint8_t * const data, const uint8_t length);
+
 #endif
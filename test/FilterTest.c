@@ -0,0 +1,287 @@
+/*! @file
+ *  FilterTest.c
+ *
+ *  @brief Host tests of the decimating filters against a plain reference
+ *
+ *  Built twice: once as it is, and once with __ARM_FEATURE_DSP defined so that the dual multiply-accumulate path
+ *  runs through host/arm_acle.h. Both builds must match the reference bit for bit.
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#include "Test.h"
+#include "SamplerSim.h"
+#include "Filter.h"
+
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP)
+#define TEST_NAME "Filter (DSP)"
+#else
+#define TEST_NAME "Filter"
+#endif
+
+// Number of rows pushed through the filters by each random run
+#define NB_ROWS 20000
+
+/*!
+ * @brief The reference filter of one channel, written the obvious way.
+ */
+typedef struct
+{
+  int32_t sum;
+  uint8_t count;
+  uint8_t decimation;
+  uint8_t nbTaps;
+  int16_t taps[FILTER_MAX_TAPS];
+  int16_t averages[FILTER_MAX_TAPS];  /*!< The block averages, newest first. */
+} TReference;
+
+static TReference References[SAMPLER_NB_CHANNELS];
+
+/*! @brief Sets up the reference of a channel and the filter under test the same way.
+ *
+ *  @param channelNb The channel.
+ *  @param decimation The number of samples in a block.
+ *  @param taps The coefficients, or NULL.
+ *  @param nbTaps The number of coefficients.
+ *  @return bool - TRUE if the filter under test accepted them.
+ */
+static bool Set(const uint8_t channelNb, const uint8_t decimation, const int16_t * const taps, const uint8_t nbTaps)
+{
+  TReference *reference = &References[channelNb];
+
+  memset(reference, 0, sizeof(*reference));
+  reference->decimation = decimation;
+  reference->nbTaps = nbTaps;
+  if (nbTaps)
+    {
+      memcpy(reference->taps, taps, nbTaps * sizeof(int16_t));
+    }
+  return Filter_Set(channelNb, decimation, taps, nbTaps);
+}
+
+/*! @brief Runs a sample through the reference.
+ *
+ *  @param channelNb The channel.
+ *  @param sample The sample.
+ *  @param output Set to the output, if there is one.
+ *  @return bool - TRUE if the sample finished a block.
+ */
+static bool Reference(const uint8_t channelNb, const int16_t sample, int16_t * const output)
+{
+  TReference *reference = &References[channelNb];
+
+  reference->sum += sample;
+  if (++reference->count < reference->decimation)
+    {
+      return 0;
+    }
+
+  // C division truncates towards zero, as the firmware's does
+  int16_t average = (int16_t) (reference->sum / reference->decimation);
+  reference->sum = 0;
+  reference->count = 0;
+  if (reference->nbTaps == 0)
+    {
+      *output = average;
+      return 1;
+    }
+
+  memmove(&reference->averages[1], &reference->averages[0], (FILTER_MAX_TAPS - 1) * sizeof(int16_t));
+  reference->averages[0] = average;
+  int64_t y = 0;
+  for (uint8_t i = 0; i < reference->nbTaps; i++)
+    {
+      y += (int32_t) reference->taps[i] * reference->averages[i];
+    }
+  // Round to nearest, halves upwards, then saturate
+  y = (y + 16384) >> 15;
+  *output = (y > INT16_MAX) ? INT16_MAX : ((y < INT16_MIN) ? INT16_MIN : (int16_t) y);
+  return 1;
+}
+
+/*! @brief Pushes random rows in random batches, reads the filters in random amounts, and compares every output.
+ *
+ *  @param amplitude The largest sample either way.
+ *  @return uint32_t - the number of outputs compared.
+ */
+static uint32_t Run(const int32_t amplitude)
+{
+  // What each channel's filter is still owed by the reference
+  static int16_t expected[SAMPLER_NB_CHANNELS][NB_ROWS];
+  uint32_t nbExpected[SAMPLER_NB_CHANNELS] = { 0 };
+  uint32_t nbRead[SAMPLER_NB_CHANNELS] = { 0 };
+  uint32_t mismatches = 0, total = 0;
+  int16_t row[SAMPLER_NB_CHANNELS];
+  int16_t output[64];
+
+  for (uint32_t rowNb = 0; rowNb < NB_ROWS; )
+    {
+      // Less than a ring at a time, so nothing is lost
+      uint32_t batch = 1 + (rand() % (SAMPLER_RING_SIZE - 1));
+      for (; batch && (rowNb < NB_ROWS); batch--, rowNb++)
+	{
+	  for (uint8_t channelNb = 0; channelNb < SAMPLER_NB_CHANNELS; channelNb++)
+	    {
+	      row[channelNb] = (int16_t) ((rand() % ((2 * amplitude) + 1)) - amplitude);
+	      if (Reference(channelNb, row[channelNb], &expected[channelNb][nbExpected[channelNb]]))
+		{
+		  nbExpected[channelNb]++;
+		}
+	    }
+	  SamplerSim_Row(row);
+	}
+
+      for (uint8_t channelNb = 0; channelNb < SAMPLER_NB_CHANNELS; channelNb++)
+	{
+	  uint16_t nbOutputs;
+	  do
+	    {
+	      nbOutputs = Filter_Read(channelNb, output, 1 + (rand() % (sizeof(output) / sizeof(output[0]))));
+	      for (uint16_t i = 0; i < nbOutputs; i++)
+		{
+		  if ((nbRead[channelNb] >= nbExpected[channelNb]) || (output[i] != expected[channelNb][nbRead[channelNb]]))
+		    {
+		      mismatches++;
+		    }
+		  nbRead[channelNb]++;
+		}
+	    }
+	  while (nbOutputs);
+	}
+    }
+
+  for (uint8_t channelNb = 0; channelNb < SAMPLER_NB_CHANNELS; channelNb++)
+    {
+      CHECK_EQUAL(nbRead[channelNb], nbExpected[channelNb]);
+      total += nbRead[channelNb];
+    }
+  CHECK_EQUAL(mismatches, 0);
+  return total;
+}
+
+/*! @brief Bad settings are refused.
+ */
+static void TestSet(void)
+{
+  int16_t taps[FILTER_MAX_TAPS + 1] = { 0 };
+
+  SamplerSim_Init(0);
+  CHECK(Filter_Init(1));
+  CHECK(!Filter_Init(0));
+  CHECK(!Filter_Set(SAMPLER_NB_CHANNELS, 1, NULL, 0));
+  CHECK(!Filter_Set(0, 0, NULL, 0));
+  CHECK(!Filter_Set(0, 1, NULL, 1));
+  CHECK(!Filter_Set(0, 1, taps, FILTER_MAX_TAPS + 1));
+  CHECK(Filter_Set(0, FILTER_MAX_DECIMATION, taps, FILTER_MAX_TAPS));
+  CHECK_EQUAL(Filter_Read(SAMPLER_NB_CHANNELS, taps, 1), 0);
+}
+
+/*! @brief The boxcar alone averages each block, truncating towards zero, and only takes what the buffer can hold.
+ */
+static void TestBoxcar(void)
+{
+  int16_t row[SAMPLER_NB_CHANNELS] = { 0 };
+  int16_t output[4];
+
+  SamplerSim_Init(0);
+  CHECK(Filter_Init(4));
+
+  // -1 -1 -1 0 sums to -3, which averages to 0 rather than -1
+  static const int16_t samples[] = { -1, -1, -1, 0, 7, 8, 9, 10, -32768, -32768, -32768, -32768 };
+  for (uint8_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++)
+    {
+      row[0] = samples[i];
+      SamplerSim_Row(row);
+    }
+
+  CHECK_EQUAL(Filter_Read(0, output, 1), 1);
+  CHECK_EQUAL(output[0], 0);
+  CHECK_EQUAL(Filter_Read(0, output, 4), 2);
+  CHECK_EQUAL(output[0], 8);
+  CHECK_EQUAL(output[1], -32768);
+  CHECK_EQUAL(Filter_Read(0, output, 4), 0);
+
+  // A part block carries over to the next read
+  row[0] = 100;
+  SamplerSim_Row(row);
+  SamplerSim_Row(row);
+  CHECK_EQUAL(Filter_Read(0, output, 4), 0);
+  SamplerSim_Row(row);
+  SamplerSim_Row(row);
+  CHECK_EQUAL(Filter_Read(0, output, 4), 1);
+  CHECK_EQUAL(output[0], 100);
+}
+
+/*! @brief The FIR saturates at both rails instead of wrapping.
+ */
+static void TestSaturation(void)
+{
+  int16_t row[SAMPLER_NB_CHANNELS] = { 0 };
+  int16_t taps[FILTER_MAX_TAPS];
+  int16_t output[FILTER_MAX_TAPS];
+
+  // A gain of about 16
+  for (uint8_t i = 0; i < FILTER_MAX_TAPS; i++)
+    {
+      taps[i] = INT16_MAX;
+    }
+  SamplerSim_Init(0);
+  CHECK(Filter_Set(0, 1, taps, FILTER_MAX_TAPS));
+  CHECK(Filter_Set(1, 1, taps, FILTER_MAX_TAPS));
+  row[0] = INT16_MAX;
+  row[1] = INT16_MIN;
+  for (uint8_t i = 0; i < FILTER_MAX_TAPS; i++)
+    {
+      SamplerSim_Row(row);
+    }
+
+  CHECK_EQUAL(Filter_Read(0, output, FILTER_MAX_TAPS), FILTER_MAX_TAPS);
+  // One sample in, so one tap's worth, which is just under full scale
+  CHECK_EQUAL(output[0], INT16_MAX - 1);
+  CHECK_EQUAL(output[1], INT16_MAX);
+  CHECK_EQUAL(output[FILTER_MAX_TAPS - 1], INT16_MAX);
+  CHECK_EQUAL(Filter_Read(1, output, FILTER_MAX_TAPS), FILTER_MAX_TAPS);
+  CHECK_EQUAL(output[0], -INT16_MAX);
+  CHECK_EQUAL(output[1], INT16_MIN);
+  CHECK_EQUAL(output[FILTER_MAX_TAPS - 1], INT16_MIN);
+}
+
+/*! @brief Random decimations and taps, odd counts included, match the reference on every output,
+ *  with the count wrapping part way.
+ */
+static void TestRandom(void)
+{
+  int16_t taps[FILTER_MAX_TAPS];
+  uint32_t total = 0;
+
+  srand(1);
+  for (uint8_t run = 0; run < 8; run++)
+    {
+      SamplerSim_Init(UINT32_MAX - (NB_ROWS / 2));
+      for (uint8_t channelNb = 0; channelNb < SAMPLER_NB_CHANNELS; channelNb++)
+	{
+	  uint8_t nbTaps = (channelNb == 0) ? 0 : (uint8_t) (1 + (rand() % FILTER_MAX_TAPS));
+	  for (uint8_t i = 0; i < nbTaps; i++)
+	    {
+	      // Large taps, so the outputs also saturate now and then
+	      taps[i] = (int16_t) ((rand() % 65536) - 32768);
+	    }
+	  CHECK(Set(channelNb, (uint8_t) (1 + (rand() % 12)), taps, nbTaps));
+	}
+      // Full scale, then small signals where the rounding matters most
+      total += Run((run & 1) ? 32767 : 40);
+    }
+  printf("%s: %u outputs matched the reference\n", TEST_NAME, total);
+}
+
+int main(void)
+{
+  TestSet();
+  TestBoxcar();
+  TestSaturation();
+  TestRandom();
+  return Test_Report(TEST_NAME);
+}
@@ -0,0 +1,179 @@
+/*! @file
+ *  FlashLogTest.c
+ *
+ *  @brief Host tests of the log-structured store on the simulated Flash
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#include "Test.h"
+#include "FlashSim.h"
+#include "Flash.h"
+#include "FlashLog.h"
+
+// Number of writes the wear is measured over
+#define NB_WRITES 1000000LU
+
+// The log alternates between two banks of half the data region, each starting with a header
+#define SECTORS_PER_BANK (FLASH_DATA_NB_SECTORS / 2)
+#define RECORDS_PER_BANK ((SECTORS_PER_BANK * FLASH_SECTOR_SIZE) / 8)
+
+/*! @brief Counts the erases of the data region.
+ *
+ *  @param minimum Set to the fewest erases of any data sector.
+ *  @param maximum Set to the most erases of any data sector.
+ *  @return uint32_t - the erases of all the data sectors.
+ */
+static uint32_t DataErases(uint32_t * const minimum, uint32_t * const maximum)
+{
+  uint32_t total = 0;
+
+  *minimum = UINT32_MAX;
+  *maximum = 0;
+  for (uint8_t sector = 0; sector < FLASH_DATA_NB_SECTORS; sector++)
+    {
+      uint32_t erases = FlashSim_SectorErases(FLASH_DATA_START + (sector * FLASH_SECTOR_SIZE));
+      total += erases;
+      if (erases < *minimum)
+	{
+	  *minimum = erases;
+	}
+      if (erases > *maximum)
+	{
+	  *maximum = erases;
+	}
+    }
+  return total;
+}
+
+/*! @brief A fresh store is formatted without erasing, and starts out blank.
+ */
+static void TestFormat(void)
+{
+  TFlashSimStats stats;
+
+  CHECK(FlashSim_Init());
+  CHECK(Flash_Init());
+  FlashSim_GetStats(&stats);
+  CHECK_EQUAL(stats.erases, 0);
+  CHECK_EQUAL(stats.errors, 0);
+  for (uint16_t key = 0; key < FLASHLOG_NB_KEYS; key++)
+    {
+      CHECK_EQUAL(FlashLog_Get(key), FLASHLOG_BLANK);
+    }
+  CHECK_EQUAL(FlashLog_Get(FLASHLOG_NB_KEYS), FLASHLOG_BLANK);
+  CHECK(!FlashLog_Put(FLASHLOG_NB_KEYS, 0));
+}
+
+/*! @brief A million writes only erase each bank once it is full, the banks wear evenly, and the values survive a reboot.
+ */
+static void TestWear(void)
+{
+  TFlashSimStats stats;
+  uint32_t minimum, maximum;
+  uint32_t failed = 0;
+
+  for (uint32_t i = 0; i < NB_WRITES; i++)
+    {
+      if (!FlashLog_Put(i % FLASHLOG_NB_KEYS, i))
+	{
+	  failed++;
+	}
+    }
+  CHECK_EQUAL(failed, 0);
+  CHECK(Flash_Wait());
+
+  // Every compaction erases one bank and carries the live values over
+  uint32_t erases = DataErases(&minimum, &maximum);
+  uint32_t bound = SECTORS_PER_BANK * ((NB_WRITES / (RECORDS_PER_BANK - 1 - FLASHLOG_NB_KEYS)) + 1);
+  printf("FlashLog: %u erases per %lu writes of %u keys (%u to %u per sector), bound %u\n", erases, NB_WRITES,
+      FLASHLOG_NB_KEYS, minimum, maximum, bound);
+  CHECK_RANGE(erases, 1, bound);
+  CHECK_RANGE(maximum - minimum, 0, 1);
+
+  FlashSim_GetStats(&stats);
+  CHECK_EQUAL(stats.overwrites, 0);
+  CHECK_EQUAL(stats.errors, 0);
+
+  // Rebuild the index from the Flash, as at boot
+  CHECK(FlashLog_Init());
+  for (uint16_t key = 0; key < FLASHLOG_NB_KEYS; key++)
+    {
+      CHECK_EQUAL(FlashLog_Get(key), NB_WRITES - FLASHLOG_NB_KEYS + key);
+    }
+
+  // Writing a value that is already stored costs nothing
+  uint32_t phrases = stats.phrases;
+  CHECK(FlashLog_Put(0, FlashLog_Get(0)));
+  FlashSim_GetStats(&stats);
+  CHECK_EQUAL(stats.phrases, phrases);
+}
+
+/*! @brief Losing power part way through a compaction leaves the values from before it.
+ */
+static void TestPowerFail(void)
+{
+  TFlashSimStats stats;
+  uint32_t expected[FLASHLOG_NB_KEYS];
+  uint32_t value = 0;
+  bool compacted = 0;
+
+  FlashSim_GetStats(&stats);
+  for (uint32_t i = 0; (i < RECORDS_PER_BANK) && !compacted; i++)
+    {
+      uint32_t checks = stats.checks;
+
+      for (uint16_t key = 0; key < FLASHLOG_NB_KEYS; key++)
+	{
+	  expected[key] = FlashLog_Get(key);
+	}
+
+      // Enough for a record, but not for a compaction, which checks and erases two sectors first
+      FlashSim_PowerFail(3);
+      (void) FlashLog_Put(i % FLASHLOG_NB_KEYS, value++);
+      (void) Flash_Wait();
+      FlashSim_GetStats(&stats);
+      compacted = (stats.checks != checks);
+    }
+  CHECK(compacted);
+
+  FlashSim_PowerFail(UINT32_MAX);
+  (void) Flash_Status();
+  CHECK(FlashLog_Init());
+  for (uint16_t key = 0; key < FLASHLOG_NB_KEYS; key++)
+    {
+      CHECK_EQUAL(FlashLog_Get(key), expected[key]);
+    }
+
+  // The half-finished bank is simply compacted into again
+  CHECK(FlashLog_Put(1, 0x12345678));
+  CHECK(Flash_Wait());
+  CHECK(FlashLog_Init());
+  CHECK_EQUAL(FlashLog_Get(1), 0x12345678);
+  CHECK_EQUAL(FlashLog_Get(2), expected[2]);
+  FlashSim_GetStats(&stats);
+  CHECK_EQUAL(stats.overwrites, 0);
+}
+
+/*! @brief Clearing the store forgets every value, across a reboot too.
+ */
+static void TestClear(void)
+{
+  CHECK(FlashLog_Clear());
+  CHECK(Flash_Wait());
+  CHECK(FlashLog_Init());
+  for (uint16_t key = 0; key < FLASHLOG_NB_KEYS; key++)
+    {
+      CHECK_EQUAL(FlashLog_Get(key), FLASHLOG_BLANK);
+    }
+}
+
+int main(void)
+{
+  TestFormat();
+  TestWear();
+  TestPowerFail();
+  TestClear();
+  return Test_Report("FlashLog");
+}
@@ -0,0 +1,387 @@
+/*! @file
+ *  FlashTest.c
+ *
+ *  @brief Host tests of the Flash module on the simulated Flash
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#include "Test.h"
+#include "FlashSim.h"
+#include "Flash.h"
+#include "FlashLog.h"
+#include "Defer.h"
+#include "Event.h"
+#include "MK70F12.h"
+
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+// Number of random fills of the variable area the allocator is benchmarked over
+#define NB_FILLS 500
+
+// Bytes written to measure the block write throughput, and the size of each Flash_WriteBlock, as the update uses
+#define THROUGHPUT_BYTES 0x10000LU
+#define THROUGHPUT_BLOCK 1024
+
+// Programming acceleration RAM
+#define ACCEL_RAM ((volatile uint8_t *) 0x14000000LU)
+
+// Most variables allocated in one boot
+#define MAX_VARIABLES FLASH_DATA_SIZE
+
+/*!
+ * @brief What a boot reports back to the test.
+ */
+typedef struct
+{
+  uint16_t nbVariables;                 /*!< The number of variables allocated. */
+  uint16_t offsets[MAX_VARIABLES];      /*!< The offset of each variable in the data area. */
+  uint16_t requested;                   /*!< The bytes asked for by the variables allocated. */
+  uint64_t ns;                          /*!< Host time spent allocating. */
+} TBootResult;
+
+static TBootResult *Result;
+
+// The words of the data area, while a commit is interrupted
+static volatile uint32_t *Words;
+// Set by Interrupt once it has run, and what Flash_Flush gave it
+static bool Interrupted;
+static bool InterruptedFlush;
+
+// Seed of the sizes of the variables in the next fill
+static uint32_t Seed;
+
+/*! @brief Gets the offset of a variable in the data area.
+ *
+ *  @param variable A variable from Flash_AllocateVar.
+ *  @return uint16_t - its offset.
+ */
+static uint16_t Offset(volatile void * const variable)
+{
+  return (uint16_t) ((volatile uint8_t *) variable - Flash_Data(0));
+}
+
+/*! @brief Picks the size of a variable, mostly the scalars that make up the configuration.
+ *
+ *  @return uint16_t - the size, in bytes.
+ */
+static uint16_t RandomSize(void)
+{
+  static const uint16_t sizes[] = { 1, 1, 2, 2, 2, 4, 4, 4, 4, 8, 8, 3, 6, 12, 16, 32 };
+
+  Seed = (Seed * 1103515245u) + 12345u;
+  return sizes[(Seed >> 16) % (sizeof(sizes) / sizeof(sizes[0]))];
+}
+
+/*! @brief Allocates variables until the area is full, recording where they go and how long it takes.
+ */
+static void BootFill(void)
+{
+  volatile void *variable;
+  struct timespec start, end;
+  uint16_t size = RandomSize();
+
+  CHECK(Flash_Init());
+  Result->nbVariables = 0;
+  Result->requested = 0;
+  Result->ns = 0;
+
+  for (;;)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      bool allocated = Flash_AllocateVar(&variable, size);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      Result->ns += ((end.tv_sec - start.tv_sec) * 1000000000LL) + (end.tv_nsec - start.tv_nsec);
+      if (!allocated)
+	{
+	  break;
+	}
+      Result->offsets[Result->nbVariables++] = Offset(variable);
+      Result->requested += size;
+      size = RandomSize();
+    }
+}
+
+/*! @brief Allocates variables of every size, checking each is aligned and clear of the others.
+ */
+static void BootAlignment(void)
+{
+  static const uint16_t sizes[] = { 1, 2, 1, 4, 3, 8, 1, 16, 2, 5, 24, 4, 1, 8 };
+  bool used[FLASH_DATA_SIZE] = { 0 };
+  volatile void *variable;
+
+  CHECK(Flash_Init());
+  CHECK(!Flash_AllocateVar(&variable, 0));
+  CHECK(!Flash_AllocateVar(&variable, FLASH_DATA_SIZE + 1));
+
+  for (uint8_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+      uint16_t alignment = (sizes[i] > 4) ? 8 : (sizes[i] > 2) ? 4 : sizes[i];
+
+      CHECK(Flash_AllocateVar(&variable, sizes[i]));
+      uint16_t offset = Offset(variable);
+      CHECK_EQUAL(offset % alignment, 0);
+      CHECK_RANGE(offset + sizes[i], sizes[i], FLASH_DATA_SIZE);
+      for (uint16_t j = offset; j < offset + sizes[i]; j++)
+	{
+	  CHECK(!used[j]);
+	  used[j] = 1;
+	}
+    }
+
+  // The byte skipped to align the second variable goes to the third
+  CHECK(used[1]);
+}
+
+/*! @brief The whole area can go to one variable, which leaves no room for any other.
+ */
+static void BootWholeArea(void)
+{
+  volatile void *variable;
+
+  CHECK(Flash_Init());
+  CHECK(Flash_AllocateVar(&variable, FLASH_DATA_SIZE));
+  CHECK_EQUAL(Offset(variable), 0);
+  CHECK(!Flash_AllocateVar(&variable, 1));
+}
+
+/*! @brief Variables are aligned, don't overlap, and get the same addresses on every boot.
+ *  The cost of an allocation and how full the area gets before one fails are measured over random fills.
+ */
+static void TestAllocator(void)
+{
+  uint16_t offsets[MAX_VARIABLES];
+  uint16_t nbVariables;
+  uint64_t nbAllocations = 0, ns = 0;
+  uint32_t leastUsed = FLASH_DATA_SIZE, totalUsed = 0;
+
+  CHECK_EQUAL(Test_Boot(&BootAlignment), 0);
+  CHECK_EQUAL(Test_Boot(&BootWholeArea), 0);
+
+  // The same allocations on the next boot give the same addresses
+  Seed = 1;
+  CHECK_EQUAL(Test_Boot(&BootFill), 0);
+  nbVariables = Result->nbVariables;
+  memcpy(offsets, Result->offsets, sizeof(offsets));
+  CHECK_EQUAL(Test_Boot(&BootFill), 0);
+  CHECK_EQUAL(Result->nbVariables, nbVariables);
+  CHECK(memcmp(offsets, Result->offsets, nbVariables * sizeof(offsets[0])) == 0);
+
+  for (uint32_t fill = 0; fill < NB_FILLS; fill++)
+    {
+      Seed = fill;
+      CHECK_EQUAL(Test_Boot(&BootFill), 0);
+      nbAllocations += Result->nbVariables + 1;
+      ns += Result->ns;
+      totalUsed += Result->requested;
+      if (Result->requested < leastUsed)
+	{
+	  leastUsed = Result->requested;
+	}
+    }
+
+  // A fill stops at the first variable that doesn't fit, which can be up to 32 bytes
+  printf("Flash_AllocateVar: %llu ns per allocation on the host, area %u%% full on average and at least %u%% when one fails\n",
+      (unsigned long long) (ns / nbAllocations), (100 * totalUsed) / (NB_FILLS * FLASH_DATA_SIZE),
+      (100 * leastUsed) / FLASH_DATA_SIZE);
+  CHECK_RANGE(leastUsed, FLASH_DATA_SIZE - 32 - 7, FLASH_DATA_SIZE);
+}
+
+/*! @brief Fills a buffer with data that is different at every address.
+ *
+ *  @param buffer The buffer.
+ *  @param length The number of bytes.
+ *  @param seed Makes the data differ between calls.
+ */
+static void Pattern(uint8_t * const buffer, const uint32_t length, const uint32_t seed)
+{
+  for (uint32_t i = 0; i < length; i++)
+    {
+      buffer[i] = (uint8_t) ((i * 131) + (i >> 8) + seed);
+    }
+}
+
+/*! @brief Writes a region a block at a time and measures how long the FTFE takes over it.
+ *
+ *  @param address The start of the region, which must be erased.
+ *  @param data The data.
+ *  @return uint64_t - the bytes written per second of simulated time.
+ */
+static uint64_t WriteRegion(const uint32_t address, const uint8_t * const data)
+{
+  uint64_t start = Host_Ticks;
+
+  for (uint32_t offset = 0; offset < THROUGHPUT_BYTES; offset += THROUGHPUT_BLOCK)
+    {
+      CHECK(Flash_WriteBlock(address + offset, data + offset, THROUGHPUT_BLOCK));
+    }
+  CHECK(Flash_Wait());
+  CHECK(memcmp((const void *) (uintptr_t) address, data, THROUGHPUT_BYTES) == 0);
+  return (THROUGHPUT_BYTES * HOST_TICKS_PER_SECOND) / (Host_Ticks - start);
+}
+
+/*! @brief Block writes go through Program Section, or a phrase at a time while the FlexRAM is unavailable.
+ *  The throughput of each is measured on the simulated Flash.
+ */
+static void TestBlockThroughput(void)
+{
+  static uint8_t data[THROUGHPUT_BYTES];
+  TFlashSimStats before, after;
+
+  CHECK(!Flash_WriteBlock(FLASH_BLOCK_SIZE + 4, data, 8));
+  CHECK(!Flash_WriteBlock(FLASH_BLOCK_SIZE, data, 12));
+
+  Pattern(data, sizeof(data), 1);
+  FlashSim_GetStats(&before);
+  uint64_t section = WriteRegion(FLASH_BLOCK_SIZE, data);
+  FlashSim_GetStats(&after);
+  CHECK_EQUAL(after.sections - before.sections, THROUGHPUT_BYTES / THROUGHPUT_BLOCK);
+  CHECK_EQUAL(after.phrases - before.phrases, 0);
+
+  FTFE_FCNFG &= ~FTFE_FCNFG_RAMRDY_MASK;
+  Pattern(data, sizeof(data), 2);
+  before = after;
+  uint64_t phrase = WriteRegion(FLASH_BLOCK_SIZE + THROUGHPUT_BYTES, data);
+  FlashSim_GetStats(&after);
+  FTFE_FCNFG |= FTFE_FCNFG_RAMRDY_MASK;
+  CHECK_EQUAL(after.sections - before.sections, 0);
+  CHECK_EQUAL(after.phrases - before.phrases, THROUGHPUT_BYTES / 8);
+
+  printf("Flash_WriteBlock: %llu bytes/s with Program Section, %llu bytes/s a phrase at a time (simulated Flash, typical timings)\n",
+      (unsigned long long) section, (unsigned long long) phrase);
+  CHECK(section > phrase);
+
+  // Writing the same data again needs no commands
+  before = after;
+  CHECK(Flash_WriteBlock(FLASH_BLOCK_SIZE + THROUGHPUT_BYTES, data, THROUGHPUT_BLOCK));
+  CHECK(Flash_Wait());
+  FlashSim_GetStats(&after);
+  CHECK_EQUAL(after.phrases + after.sections, before.phrases + before.sections);
+  CHECK_EQUAL(after.overwrites, 0);
+  CHECK_EQUAL(after.errors, 0);
+}
+
+/*! @brief The FTFE interrupt never copies a section into the acceleration RAM; a thread does.
+ */
+static void TestStagingOutsideInterrupt(void)
+{
+  static uint8_t data[2 * FLASH_SECTOR_SIZE];
+  const uint32_t address = FLASH_BLOCK_SIZE + (2 * THROUGHPUT_BYTES);
+
+  Pattern(data, sizeof(data), 3);
+  CHECK(Defer_Init());
+
+  // The erase check runs first, so the block write is started by the interrupt
+  CHECK(Flash_EraseSector(address));
+  CHECK(Flash_WriteBlock(address, data, sizeof(data)));
+  for (uint8_t section = 0; section < 2; section++)
+    {
+      const uint8_t *staged = data + (section * FLASH_SECTOR_SIZE);
+
+      Host_Events = 0;
+      while (FlashSim_Step())
+	;
+      CHECK(Flash_IsBusy());
+      CHECK(Host_Events & EVENT_DEFER);
+      CHECK(memcmp((const void *) ACCEL_RAM, staged, FLASH_SECTOR_SIZE) != 0);
+      CHECK(!(FTFE_FCNFG & FTFE_FCNFG_CCIE_MASK));
+
+      // The deferred call copies the section and starts it
+      CHECK_EQUAL(Defer_Run(), 1);
+      CHECK(memcmp((const void *) ACCEL_RAM, staged, FLASH_SECTOR_SIZE) == 0);
+      CHECK(FTFE_FCNFG & FTFE_FCNFG_CCIE_MASK);
+    }
+  while (FlashSim_Step())
+    ;
+  CHECK(!Flash_IsBusy());
+  CHECK_EQUAL(Flash_Status(), FLASH_STATUS_IDLE);
+  CHECK(memcmp((const void *) (uintptr_t) address, data, sizeof(data)) == 0);
+
+  // A thread waiting for the Flash doesn't need the deferred call
+  Pattern(data, sizeof(data), 4);
+  CHECK(Flash_EraseSector(address));
+  CHECK(Flash_EraseSector(address + FLASH_SECTOR_SIZE));
+  CHECK(Flash_WriteBlock(address, data, sizeof(data)));
+  CHECK(Flash_Wait());
+  CHECK(memcmp((const void *) (uintptr_t) address, data, sizeof(data)) == 0);
+}
+
+/*! @brief Stands in for a thread that preempts the commit: it writes a word not committed yet, then tries to flush.
+ */
+static void Interrupt(void)
+{
+  if (Interrupted)
+    {
+      return;
+    }
+  Interrupted = 1;
+  CHECK(Flash_Write32(&Words[FLASHLOG_NB_KEYS - 1], 0xAAAA));
+  InterruptedFlush = Flash_Flush();
+}
+
+/*! @brief Commits a snapshot of the whole area, which fills the command queue, while another thread writes.
+ */
+static void BootCommitSnapshot(void)
+{
+  CHECK(Flash_Init());
+  CHECK(Flash_AllocateVar((volatile void **) &Words, FLASH_DATA_SIZE));
+  for (uint16_t i = 0; i < FLASHLOG_NB_KEYS; i++)
+    {
+      CHECK(Flash_Write32(&Words[i], i + 1));
+    }
+  CHECK(Flash_Snapshot());
+  CHECK(!Flash_Snapshot());
+
+  Interrupted = 0;
+  Host_SetPendingHandler(&Interrupt);
+  CHECK(Flash_CommitSnapshot());
+  Host_SetPendingHandler(NULL);
+  CHECK(Flash_Wait());
+
+  // The interrupting flush was turned away, and its write left for the next commit
+  CHECK(Interrupted);
+  CHECK(!InterruptedFlush);
+  CHECK(Flash_IsDirty());
+  CHECK_EQUAL(FlashLog_Get(FLASHLOG_NB_KEYS - 1), FLASHLOG_NB_KEYS);
+  CHECK(Flash_Flush());
+  CHECK(Flash_Wait());
+  CHECK(!Flash_IsDirty());
+}
+
+/*! @brief The next boot finds the snapshot and the write made during its commit.
+ */
+static void BootCommitted(void)
+{
+  CHECK(Flash_Init());
+  CHECK(Flash_AllocateVar((volatile void **) &Words, FLASH_DATA_SIZE));
+  for (uint16_t i = 0; i < FLASHLOG_NB_KEYS - 1; i++)
+    {
+      CHECK_EQUAL(Words[i], i + 1);
+    }
+  CHECK_EQUAL(Words[FLASHLOG_NB_KEYS - 1], 0xAAAA);
+}
+
+/*! @brief Writes carry on while a snapshot is committed, and go out on the next commit.
+ */
+static void TestSnapshot(void)
+{
+  CHECK_EQUAL(Test_Boot(&BootCommitSnapshot), 0);
+  CHECK_EQUAL(Test_Boot(&BootCommitted), 0);
+}
+
+int main(void)
+{
+  CHECK(FlashSim_Init());
+  Result = mmap(NULL, sizeof(*Result), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  CHECK(Result != MAP_FAILED);
+
+  TestAllocator();
+  CHECK(Flash_Init());
+  TestBlockThroughput();
+  TestStagingOutsideInterrupt();
+  TestSnapshot();
+  return Test_Report("Flash");
+}
@@ -0,0 +1,268 @@
+/*! @file
+ *  LoopbackTest.c
+ *
+ *  @brief Host tests of the analog loopback transfer function, bit for bit
+ *
+ *  The reference here works in 64 bits with floor division, the way the transfer function is specified in
+ *  Loopback.h, so it doesn't share the shifts and casts of the firmware's version.
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#include "Test.h"
+#include "SamplerSim.h"
+#include "Loopback.h"
+#include "MK70F12.h"
+
+#include <math.h>
+
+// Largest DAC output
+#define DAC_MAX 4095
+
+// Number of random inputs each random check runs over
+#define NB_RANDOM 1000000
+
+/*! @brief Divides, rounding towards minus infinity.
+ *
+ *  @param a The dividend.
+ *  @param b The divisor, which must be positive.
+ *  @return int64_t - the quotient.
+ */
+static int64_t FloorDiv(const int64_t a, const int64_t b)
+{
+  return (a >= 0) ? (a / b) : -((-a + b - 1) / b);
+}
+
+/*! @brief The transfer function as Loopback.h states it.
+ *
+ *  @param config The gain, offset and filter.
+ *  @param filter The filter state, updated.
+ *  @param input The input.
+ *  @return uint16_t - the output.
+ */
+static uint16_t Reference(const TLoopbackConfig * const config, int64_t * const filter, const int32_t input)
+{
+  int64_t value = (int64_t) input * config->gain;
+
+  if (config->alpha)
+    {
+      *filter += FloorDiv((value - *filter) * config->alpha, 32768);
+      value = *filter;
+    }
+
+  int64_t output = FloorDiv(value, 65536) + config->offset;
+  return (output < 0) ? 0 : ((output > DAC_MAX) ? DAC_MAX : (uint16_t) output);
+}
+
+/*! @brief Runs an input through the transfer function with no filter.
+ *
+ *  @param gain The gain.
+ *  @param offset The offset.
+ *  @param input The input.
+ *  @return uint16_t - the output.
+ */
+static uint16_t Transfer(const int16_t gain, const int16_t offset, const int32_t input)
+{
+  TLoopbackConfig config = { gain, offset, 0 };
+  int32_t filter = 0;
+
+  return Loopback_Transfer(&config, &filter, input);
+}
+
+/*! @brief Gets a DAC's output.
+ *
+ *  @param outputNb The DAC.
+ *  @return uint16_t - the value last written to it.
+ */
+static uint16_t DAC(const uint8_t outputNb)
+{
+  return (outputNb == 0) ? (uint16_t) (DAC0_DAT0L | (DAC0_DAT0H << 8)) : (uint16_t) (DAC1_DAT0L | (DAC1_DAT0H << 8));
+}
+
+/*! @brief Unity gain maps the ADC's full scale onto the DAC's, and the offset centres it.
+ */
+static void TestUnity(void)
+{
+  CHECK_EQUAL(Transfer(LOOPBACK_UNITY_GAIN, 2048, INT16_MIN), 0);
+  CHECK_EQUAL(Transfer(LOOPBACK_UNITY_GAIN, 2048, 0), 2048);
+  CHECK_EQUAL(Transfer(LOOPBACK_UNITY_GAIN, 2048, INT16_MAX), DAC_MAX);
+  CHECK_EQUAL(Transfer(LOOPBACK_UNITY_GAIN, 2048, 16), 2049);
+  CHECK_EQUAL(Transfer(LOOPBACK_UNITY_GAIN, 2048, 15), 2048);
+  // The shift rounds down, not towards zero
+  CHECK_EQUAL(Transfer(LOOPBACK_UNITY_GAIN, 2048, -1), 2047);
+  CHECK_EQUAL(Transfer(LOOPBACK_UNITY_GAIN, 2048, -16), 2047);
+  CHECK_EQUAL(Transfer(LOOPBACK_UNITY_GAIN, 2048, -17), 2046);
+  // Inverted
+  CHECK_EQUAL(Transfer(-LOOPBACK_UNITY_GAIN, 2048, INT16_MAX), 0);
+  CHECK_EQUAL(Transfer(-LOOPBACK_UNITY_GAIN, 2048, INT16_MIN), DAC_MAX);
+}
+
+/*! @brief The output is clipped at both rails, whatever the gain, offset and input.
+ */
+static void TestRails(void)
+{
+  CHECK_EQUAL(Transfer(LOOPBACK_UNITY_GAIN, 0, -16), 0);
+  CHECK_EQUAL(Transfer(LOOPBACK_UNITY_GAIN, 0, INT16_MIN), 0);
+  CHECK_EQUAL(Transfer(LOOPBACK_UNITY_GAIN, DAC_MAX, 16), DAC_MAX);
+  CHECK_EQUAL(Transfer(0, -1, 0), 0);
+  CHECK_EQUAL(Transfer(0, DAC_MAX + 1, 0), DAC_MAX);
+  CHECK_EQUAL(Transfer(0, INT16_MAX, 0), DAC_MAX);
+  CHECK_EQUAL(Transfer(0, INT16_MIN, 0), 0);
+
+  // The largest products, either way
+  CHECK_EQUAL(Transfer(INT16_MAX, 0, INT16_MAX), DAC_MAX);
+  CHECK_EQUAL(Transfer(INT16_MIN, 0, INT16_MIN), DAC_MAX);
+  CHECK_EQUAL(Transfer(INT16_MIN, INT16_MIN, INT16_MIN), 0);
+  CHECK_EQUAL(Transfer(INT16_MIN, INT16_MAX, INT16_MAX), DAC_MAX);
+  CHECK_EQUAL(Transfer(INT16_MIN, 0, INT16_MAX), 0);
+}
+
+/*! @brief Random gains, offsets and inputs, without the filter and then with it, match the reference.
+ */
+static void TestRandom(void)
+{
+  uint32_t mismatches = 0, low = 0, high = 0;
+
+  srand(1);
+  for (uint32_t i = 0; i < NB_RANDOM; i++)
+    {
+      TLoopbackConfig config = { (int16_t) ((rand() % 65536) - 32768), (int16_t) ((rand() % 8192) - 2048), 0 };
+      int32_t input = (rand() % 65536) - 32768;
+      int32_t filter = 0;
+      int64_t reference = 0;
+
+      uint16_t output = Loopback_Transfer(&config, &filter, input);
+      mismatches += (output != Reference(&config, &reference, input));
+      low += (output == 0);
+      high += (output == DAC_MAX);
+    }
+  CHECK_EQUAL(mismatches, 0);
+  // Both rails were reached often
+  CHECK(low > NB_RANDOM / 10);
+  CHECK(high > NB_RANDOM / 10);
+
+  // Runs of inputs through the filter, from a random start, for random coefficients including the extremes
+  mismatches = 0;
+  for (uint32_t run = 0; run < NB_RANDOM / 1000; run++)
+    {
+      TLoopbackConfig config = { (int16_t) ((rand() % 65536) - 32768), (int16_t) ((rand() % 4096) - 1024), 0 };
+      config.alpha = (run == 0) ? 1 : ((run == 1) ? INT16_MAX : (uint16_t) (1 + (rand() % INT16_MAX)));
+      int32_t input = (rand() % 65536) - 32768;
+      int32_t filter = input * config.gain;
+      int64_t reference = filter;
+
+      for (uint16_t i = 0; i < 1000; i++)
+	{
+	  // Steps now and then, noise the rest of the time
+	  input = (rand() % 50) ? input + (rand() % 201) - 100 : (rand() % 65536) - 32768;
+	  input = (input > INT16_MAX) ? INT16_MAX : ((input < INT16_MIN) ? INT16_MIN : input);
+	  mismatches += (Loopback_Transfer(&config, &filter, input) != Reference(&config, &reference, input));
+	  mismatches += (filter != reference);
+	}
+    }
+  CHECK_EQUAL(mismatches, 0);
+}
+
+/*! @brief The filter has the time constant its coefficient gives, and settles on the input.
+ */
+static void TestFilter(void)
+{
+  // A time constant of 10 samples
+  TLoopbackConfig config = { LOOPBACK_UNITY_GAIN, 2048, (uint16_t) lround(32768 * (1 - exp(-0.1))) };
+  int32_t filter = 0;
+  uint16_t output = 0;
+
+  for (uint8_t i = 0; i < 10; i++)
+    {
+      output = Loopback_Transfer(&config, &filter, INT16_MAX);
+    }
+  // 1 - 1/e of the way, to within a count or two
+  CHECK_RANGE(output, 2048 + lround(2047 * (1 - exp(-1))) - 2, 2048 + lround(2047 * (1 - exp(-1))) + 2);
+  for (uint16_t i = 0; i < 1000; i++)
+    {
+      output = Loopback_Transfer(&config, &filter, INT16_MAX);
+    }
+  CHECK_EQUAL(output, DAC_MAX);
+  for (uint16_t i = 0; i < 1000; i++)
+    {
+      output = Loopback_Transfer(&config, &filter, INT16_MIN);
+    }
+  CHECK_EQUAL(output, 0);
+}
+
+/*! @brief The pipelines run on each row of samples, start their filters from the first input, and leave the DACs
+ *  alone when off.
+ */
+static void TestPipeline(void)
+{
+  TLoopbackConfig direct = { LOOPBACK_UNITY_GAIN, 2048, 0 };
+  TLoopbackConfig filtered = { -2 * LOOPBACK_UNITY_GAIN, 1000, 5000 };
+  TLoopbackStats stats;
+  int16_t row[SAMPLER_NB_CHANNELS] = { 0 };
+  int64_t reference = 0;
+
+  SamplerSim_Init(0);
+  DAC0_DAT0L = 0xFF;
+  CHECK(Loopback_Init());
+  CHECK(SIM_SCGC2 & SIM_SCGC2_DAC0_MASK);
+  CHECK(SIM_SCGC2 & SIM_SCGC2_DAC1_MASK);
+  CHECK_EQUAL(DAC0_C0, DAC_C0_DACEN_MASK | DAC_C0_DACRFS_MASK);
+  CHECK_EQUAL(DAC1_C0, DAC_C0_DACEN_MASK | DAC_C0_DACRFS_MASK);
+  CHECK_EQUAL(DAC(0), 0);
+  CHECK(!Loopback_GetStats(&stats));
+
+  CHECK(!Loopback_Set(LOOPBACK_NB_OUTPUTS, 2, &direct));
+  CHECK(!Loopback_Set(0, SAMPLER_NB_CHANNELS, &direct));
+  TLoopbackConfig bad = { LOOPBACK_UNITY_GAIN, 0, 32768 };
+  CHECK(!Loopback_Set(0, 2, &bad));
+  CHECK(Loopback_Set(0, 2, &direct));
+  CHECK(Loopback_Set(1, 5, &filtered));
+
+  srand(2);
+  for (uint16_t i = 0; i < 1000; i++)
+    {
+      row[2] = (int16_t) ((rand() % 65536) - 32768);
+      row[5] = (int16_t) ((rand() % 2001) - 1000);
+      if (i == 0)
+	{
+	  reference = (int64_t) row[5] * filtered.gain;
+	}
+      int64_t unused = 0;
+      uint16_t expected0 = Reference(&direct, &unused, row[2]);
+      uint16_t expected1 = Reference(&filtered, &reference, row[5]);
+      SamplerSim_Row(row);
+      CHECK_EQUAL(DAC(0), expected0);
+      CHECK_EQUAL(DAC(1), expected1);
+    }
+  CHECK(Loopback_GetStats(&stats));
+  CHECK_EQUAL(stats.count, 1000);
+  CHECK_EQUAL(stats.missed, 0);
+
+  // Off, the DAC keeps its last value
+  CHECK(Loopback_Set(1, LOOPBACK_OFF, NULL));
+  uint16_t last = DAC(1);
+  row[5] = 1000;
+  SamplerSim_Row(row);
+  CHECK_EQUAL(DAC(1), last);
+
+  // Setting an output again starts its filter again, from the next input
+  CHECK(Loopback_Set(1, 5, &filtered));
+  row[5] = -700;
+  SamplerSim_Row(row);
+  reference = (int64_t) row[5] * filtered.gain;
+  CHECK_EQUAL(DAC(1), Reference(&filtered, &reference, row[5]));
+
+  Loopback_ResetStats();
+  CHECK(!Loopback_GetStats(&stats));
+}
+
+int main(void)
+{
+  TestUnity();
+  TestRails();
+  TestRandom();
+  TestFilter();
+  TestPipeline();
+  return Test_Report("Loopback");
+}
@@ -0,0 +1,339 @@
+/*! @file
+ *  MeterTest.c
+ *
+ *  @brief Host tests of the power and energy meter on synthetic waveforms
+ *
+ *  Each window is checked twice: bit for bit against sums taken here over the same samples, and against
+ *  the values the waveform should give, within what rounding the samples to counts allows.
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#include "Test.h"
+#include "FlashSim.h"
+#include "SamplerSim.h"
+#include "Flash.h"
+#include "Meter.h"
+#include "Event.h"
+
+#include <math.h>
+#include <sys/mman.h>
+
+// As on the device
+#define SAMPLE_RATE 1000
+
+// Rows pushed between updates, well inside the ring
+#define BATCH 64
+
+// Longest run kept for the reference sums, in seconds
+#define MAX_SECONDS (METER_SAVE_INTERVAL + 10)
+
+/*!
+ * @brief The waveform fed to the meter.
+ */
+typedef struct
+{
+  double vPeak;       /*!< The voltage amplitude, in counts. */
+  double iPeak;       /*!< The current amplitude, in counts. */
+  double frequency;   /*!< The line frequency, in Hz, or 0 for DC. */
+  double phase;       /*!< How far the current lags the voltage, in degrees. */
+} TWave;
+
+// Every sample pair fed since Meter_Init, for the reference sums
+static int16_t Voltage[MAX_SECONDS * SAMPLE_RATE];
+static int16_t Current[MAX_SECONDS * SAMPLE_RATE];
+static uint32_t NbFed;
+
+// Where the next window starts, and the sum of v·i over every closed window
+static uint32_t WindowStart;
+static int64_t TotalP;
+
+static TMeterResult Last;
+static uint32_t NbWindows;
+
+/*! @brief Starts the meter, and the reference, at the next sample.
+ */
+static void Start(void)
+{
+  CHECK(Meter_Init(SAMPLE_RATE));
+  NbFed = 0;
+  WindowStart = 0;
+  TotalP = 0;
+  NbWindows = 0;
+}
+
+/*! @brief Checks a closed window against sums over the same samples.
+ *
+ *  @param result The window.
+ */
+static void CheckWindow(const TMeterResult * const result)
+{
+  uint64_t sumV2 = 0, sumI2 = 0;
+  int64_t sumP = 0;
+  uint32_t n = result->nbSamples;
+
+  if (!CHECK(WindowStart + n <= NbFed))
+    {
+      return;
+    }
+  for (uint32_t k = WindowStart; k < WindowStart + n; k++)
+    {
+      sumV2 += (int32_t) Voltage[k] * Voltage[k];
+      sumI2 += (int32_t) Current[k] * Current[k];
+      sumP += (int32_t) Voltage[k] * Current[k];
+    }
+
+  CHECK_EQUAL(result->vrms, (uint16_t) sqrt((double) (sumV2 / n)));
+  CHECK_EQUAL(result->irms, (uint16_t) sqrt((double) (sumI2 / n)));
+  CHECK_EQUAL(result->realPower, sumP / (int64_t) n);
+  CHECK_EQUAL(result->apparentPower, (uint32_t) result->vrms * result->irms);
+  CHECK_EQUAL(result->sequence, NbWindows + 1);
+
+  TotalP += sumP;
+  WindowStart += n;
+  NbWindows++;
+}
+
+/*! @brief Feeds the meter a waveform for a while, checking every window that closes.
+ *
+ *  @param wave The waveform.
+ *  @param seconds How long to feed it for.
+ */
+static void Feed(const TWave * const wave, const uint32_t seconds)
+{
+  int16_t row[SAMPLER_NB_CHANNELS] = { 0 };
+  uint32_t end = NbFed + (seconds * SAMPLE_RATE);
+
+  while (NbFed < end)
+    {
+      for (uint8_t i = 0; (i < BATCH) && (NbFed < end); i++, NbFed++)
+	{
+	  double angle = (2 * M_PI * wave->frequency * NbFed) / SAMPLE_RATE;
+	  if (wave->frequency == 0)
+	    {
+	      row[METER_VOLTAGE_CHANNEL] = (int16_t) wave->vPeak;
+	      row[METER_CURRENT_CHANNEL] = (int16_t) wave->iPeak;
+	    }
+	  else
+	    {
+	      row[METER_VOLTAGE_CHANNEL] = (int16_t) lround(wave->vPeak * sin(angle));
+	      row[METER_CURRENT_CHANNEL] = (int16_t) lround(wave->iPeak * sin(angle - ((wave->phase * M_PI) / 180)));
+	    }
+	  Voltage[NbFed] = row[METER_VOLTAGE_CHANNEL];
+	  Current[NbFed] = row[METER_CURRENT_CHANNEL];
+	  SamplerSim_Row(row);
+	}
+
+      if (Meter_Update())
+	{
+	  CHECK(Meter_Get(&Last));
+	  CheckWindow(&Last);
+	}
+    }
+}
+
+/*! @brief Checks that a window holds whole cycles, from one rising zero crossing to the next.
+ *
+ *  @param result The window, which must be the last one closed.
+ */
+static void CheckWholeCycles(const TMeterResult * const result)
+{
+  uint32_t start = WindowStart - result->nbSamples;
+
+  CHECK((Voltage[start - 1] < 0) && (Voltage[start] >= 0));
+  CHECK((Voltage[WindowStart - 1] < 0) && (Voltage[WindowStart] >= 0));
+  CHECK_RANGE(result->nbSamples, SAMPLE_RATE, SAMPLE_RATE + (SAMPLE_RATE / 40));
+}
+
+/*! @brief Checks the energy total against the power summed over every closed window.
+ *
+ *  @param saved The energy the meter started from.
+ */
+static void CheckEnergy(const int64_t saved)
+{
+  // The meter carries the fraction of a count² second over, so it is never out by a whole one
+  CHECK_RANGE(((Last.energy - saved) * SAMPLE_RATE) - TotalP, -(SAMPLE_RATE - 1), SAMPLE_RATE - 1);
+}
+
+/*! @brief Checks that a value is within a fraction of what it should be, plus a fixed amount.
+ *
+ *  @param actual The value.
+ *  @param expected What it should be.
+ *  @param fraction The fraction of expected it may be out by.
+ *  @param slack The amount it may be out by on top.
+ */
+#define CHECK_NEAR(actual, expected, fraction, slack) \
+  CHECK_RANGE((actual), (long long) ((expected) - (fabs(expected) * (fraction)) - (slack)), \
+      (long long) ((expected) + (fabs(expected) * (fraction)) + (slack)))
+
+/*! @brief Checks the measurements of a sine against the values it should give.
+ *
+ *  @param wave The waveform.
+ */
+static void CheckSine(const TWave * const wave)
+{
+  double cosine = cos((wave->phase * M_PI) / 180);
+
+  // Rounding the samples to counts moves the RMS values by under a count. When a cycle isn't a whole number
+  // of samples the window can also be a sample long or short at either end, which is up to 2 / n of the mean square.
+  double ends = (fmod(SAMPLE_RATE, wave->frequency) == 0) ? 0 : 2.0 / SAMPLE_RATE;
+  CHECK_NEAR(Last.vrms, wave->vPeak / M_SQRT2, ends, 1);
+  CHECK_NEAR(Last.irms, wave->iPeak / M_SQRT2, ends, 1);
+  CHECK_NEAR(Last.realPower, (wave->vPeak * wave->iPeak * cosine) / 2, 0, 20000 + (wave->vPeak * wave->iPeak * ends));
+  CHECK_NEAR(Last.powerFactor, 32768 * cosine, 0, 20 + (32768 * 2 * ends));
+  CHECK_NEAR(Last.frequency, wave->frequency * 100, ends, 2);
+  CheckWholeCycles(&Last);
+}
+
+// The energy total last saved, shared with the boots
+static int64_t *Saved;
+
+/*! @brief Meters until the energy is saved, commits it, then meters on for a while without saving.
+ */
+static void BootSave(void)
+{
+  TWave wave = { 20000, 10000, 50, 0 };
+
+  CHECK(Flash_Init());
+  Start();
+  Host_Events = 0;
+  Feed(&wave, METER_SAVE_INTERVAL - 2);
+  CHECK(!(Host_Events & EVENT_COMMIT));
+  Feed(&wave, 3);
+  CHECK(Host_Events & EVENT_COMMIT);
+  *Saved = Last.energy;
+  CheckEnergy(0);
+  CHECK(Flash_Flush());
+  CHECK(Flash_Wait());
+  Feed(&wave, 2);
+}
+
+/*! @brief The next boot carries on from the energy saved.
+ */
+static void BootRestore(void)
+{
+  TWave wave = { 20000, 10000, 50, 0 };
+
+  CHECK(Flash_Init());
+  Start();
+  Feed(&wave, 2);
+  CHECK(NbWindows > 0);
+  CheckEnergy(*Saved);
+}
+
+/*! @brief The energy total is saved every METER_SAVE_INTERVAL seconds, and what came after is lost on a reset.
+ */
+static void TestSaved(void)
+{
+  Saved = mmap(NULL, sizeof(*Saved), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  CHECK(Saved != MAP_FAILED);
+  CHECK(FlashSim_Init());
+  SamplerSim_Init(0);
+  CHECK_EQUAL(Test_Boot(&BootSave), 0);
+  CHECK(*Saved > 0);
+  FlashSim_Reset();
+  CHECK_EQUAL(Test_Boot(&BootRestore), 0);
+
+  // The rest of the tests run in this process
+  CHECK(Flash_Init());
+  CHECK(Meter_Init(SAMPLE_RATE));
+}
+
+/*! @brief Clearing the energy saves the zero straight away.
+ */
+static void TestClear(void)
+{
+  TWave wave = { 20000, 10000, 50, 0 };
+
+  Host_Events = 0;
+  CHECK(Meter_ClearEnergy());
+  CHECK(Host_Events & EVENT_COMMIT);
+  Start();
+  Feed(&wave, 3);
+  CheckEnergy(0);
+}
+
+/*! @brief Voltage and current in phase, then lagging, in quadrature and reversed.
+ */
+static void TestPhase(void)
+{
+  static const double phases[] = { 0, 60, 90, 180, -30 };
+
+  for (uint8_t i = 0; i < sizeof(phases) / sizeof(phases[0]); i++)
+    {
+      TWave wave = { 20000, 10000, 50, phases[i] };
+
+      Start();
+      Feed(&wave, 10);
+      CHECK_RANGE(NbWindows, 8, 10);
+      CheckSine(&wave);
+      CheckEnergy(0);
+      if (phases[i] == 180)
+	{
+	  // Exporting
+	  CHECK(Last.energy < 0);
+	}
+    }
+}
+
+/*! @brief A line frequency that isn't a whole number of samples per cycle still gives windows of whole cycles.
+ */
+static void TestOffFrequency(void)
+{
+  static const double frequencies[] = { 49.7, 60.3, 47.0 };
+
+  for (uint8_t i = 0; i < sizeof(frequencies) / sizeof(frequencies[0]); i++)
+    {
+      TWave wave = { 30000, 3000, frequencies[i], 25 };
+
+      Start();
+      for (uint8_t second = 0; second < 10; second++)
+	{
+	  uint32_t windows = NbWindows;
+	  Feed(&wave, 1);
+	  // The first window starts wherever the meter did
+	  if ((NbWindows > windows) && (NbWindows > 1))
+	    {
+	      CheckWholeCycles(&Last);
+	    }
+	}
+      CheckSine(&wave);
+      CheckEnergy(0);
+    }
+}
+
+/*! @brief Without zero crossings the windows close after METER_MAX_WINDOW seconds, with no frequency.
+ */
+static void TestNoCrossing(void)
+{
+  TWave wave = { 1000, -500, 0, 0 };
+
+  Start();
+  Feed(&wave, 10);
+  CHECK_EQUAL(NbWindows, 10 / METER_MAX_WINDOW);
+  CHECK_EQUAL(Last.nbSamples, METER_MAX_WINDOW * SAMPLE_RATE);
+  CHECK_EQUAL(Last.frequency, 0);
+  CHECK_EQUAL(Last.vrms, 1000);
+  CHECK_EQUAL(Last.irms, 500);
+  CHECK_EQUAL(Last.realPower, -500000);
+  CHECK_EQUAL(Last.powerFactor, -INT16_MAX);
+  CHECK_EQUAL(Last.energy, -500000LL * 10);
+
+  // Noise around zero smaller than the hysteresis isn't taken for crossings either
+  TWave noise = { 200, 100, 50, 0 };
+  Start();
+  Feed(&noise, 4);
+  CHECK_EQUAL(NbWindows, 4 / METER_MAX_WINDOW);
+  CHECK_EQUAL(Last.frequency, 0);
+}
+
+int main(void)
+{
+  TestSaved();
+  TestClear();
+  TestPhase();
+  TestOffFrequency();
+  TestNoCrossing();
+  return Test_Report("Meter");
+}
@@ -0,0 +1,440 @@
+/*! @file
+ *  OSTest.c
+ *
+ *  @brief Host tests of the kernel's scheduling, semaphores, timeouts and deferred switches
+ *
+ *  The kernel runs on the host port of host/OSPort.c. The threads log what they do, and each test checks the log
+ *  against the order the priorities say they must run in. The idle thread ticks the kernel, so delays and timeouts
+ *  pass as soon as every thread is waiting, and ends the test once every thread has finished.
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#include "Test.h"
+#include "OSPort.h"
+#include "MK70F12.h"
+
+// Core clock the SysTick is set up from
+#define CPU_CORE_CLK_HZ 120000000
+
+// Words of stack for each thread's frame. The threads themselves run on host stacks.
+#define THREAD_STACK_SIZE 32
+
+// Ticks the idle thread lets pass before a test is taken to be stuck
+#define MAX_IDLE_TICKS 1000
+
+// Marks logged by the interrupts, and by threads where they must never get to
+#define MARK_INNER 100
+#define MARK_OUTER 101
+#define MARK_NEVER 102
+
+static uint32_t ThreadStacks[OS_NB_PRIORITIES][THREAD_STACK_SIZE] __attribute__ ((aligned(0x08)));
+
+// What the threads and interrupts did, in order
+static uint8_t Log[32];
+static uint8_t NbLogged;
+
+// The threads that haven't finished yet, and the ticks the idle thread has let pass
+static uint32_t NbRunning;
+static uint32_t IdleTicks;
+
+static OS_ECB *Semaphore;
+static OS_ECB *Other;
+
+// Ticks each waiter delays for before waiting
+static uint32_t Delays[OS_NB_PRIORITIES];
+
+/*! @brief Adds a mark to the log.
+ *
+ *  @param mark A priority, or one of the MARK_ values.
+ */
+static void Record(const uint8_t mark)
+{
+  if (CHECK(NbLogged < sizeof(Log)))
+    {
+      Log[NbLogged++] = mark;
+    }
+}
+
+/*! @brief Checks the log.
+ *
+ *  @param expected The marks that should have been logged.
+ *  @param nbExpected The number of marks.
+ */
+static void CheckLog(const uint8_t expected[], const uint8_t nbExpected)
+{
+  CHECK_EQUAL(NbLogged, nbExpected);
+  for (uint8_t i = 0; (i < nbExpected) && (i < NbLogged); i++)
+    {
+      CHECK_EQUAL(Log[i], expected[i]);
+    }
+}
+
+/*! @brief Lets a tick pass while every thread is waiting, or ends the test once they have all finished.
+ */
+void OS_IdleHook(void)
+{
+  if ((NbRunning == 0) || !CHECK(IdleTicks < MAX_IDLE_TICKS))
+    {
+      OSPort_Stop();
+    }
+  IdleTicks++;
+  OSPort_Interrupt(&OS_SysTick_ISR);
+}
+
+/*! @brief Sets up the kernel and empties the log.
+ */
+static void Start(void)
+{
+  NbLogged = 0;
+  NbRunning = 0;
+  IdleTicks = 0;
+  CHECK_EQUAL(OS_Init(CPU_CORE_CLK_HZ, 0), OS_NO_ERROR);
+  Semaphore = OS_SemaphoreCreate(0);
+  Other = OS_SemaphoreCreate(0);
+  CHECK(Semaphore && Other);
+}
+
+/*! @brief Creates a thread, passing it its priority.
+ *
+ *  @param thread The thread's function.
+ *  @param priority The thread's priority.
+ */
+static void Spawn(void (*thread)(void *), const uint8_t priority)
+{
+  // Counted first, as a higher priority thread runs and may finish before OS_ThreadCreate returns
+  NbRunning++;
+  if (!CHECK_EQUAL(OS_ThreadCreate(thread, (void *) (uintptr_t) priority, &ThreadStacks[priority][THREAD_STACK_SIZE - 1],
+      priority), OS_NO_ERROR))
+    {
+      NbRunning--;
+    }
+}
+
+/*! @brief Logs its priority and returns.
+ *
+ *  @param pData The thread's priority.
+ */
+static void Logger(void *pData)
+{
+  Record((uint8_t) (uintptr_t) pData);
+  NbRunning--;
+}
+
+/*! @brief Creates a higher priority thread, which runs straight away, then a lower priority one, which doesn't.
+ *
+ *  @param pData The thread's priority.
+ */
+static void Creator(void *pData)
+{
+  uint8_t priority = (uint8_t) (uintptr_t) pData;
+
+  Record(priority);
+  Spawn(&Logger, priority - 6);
+  Record(priority);
+  Spawn(&Logger, priority + 15);
+  CHECK_EQUAL(OS_ThreadCreate(&Logger, NULL, &ThreadStacks[0][THREAD_STACK_SIZE - 1], priority), OS_PRIORITY_EXISTS);
+  NbRunning--;
+}
+
+/*! @brief The highest priority ready thread always runs, from either end of the bitmap.
+ */
+static void TestSelection(void)
+{
+  static const uint8_t expected[] = { 0, 3, 7, 10, 4, 10, 12, 20, 25, 30 };
+
+  SCB_SHPR3 = 0x1234;
+  Start();
+  // PendSV and SysTick at the lowest priority, and the tick at OS_TICKS_PER_SECOND
+  CHECK_EQUAL(SCB_SHPR3, 0xF0F01234);
+  CHECK_EQUAL(OS_Init(CPU_CORE_CLK_HZ, 1), OS_NO_ERROR);
+  CHECK_EQUAL(SYST_RVR, (CPU_CORE_CLK_HZ / OS_TICKS_PER_SECOND) - 1);
+  CHECK_EQUAL(SYST_CSR, SysTick_CSR_CLKSOURCE_MASK | SysTick_CSR_TICKINT_MASK | SysTick_CSR_ENABLE_MASK);
+
+  CHECK_EQUAL(OS_ThreadCreate(&Logger, NULL, &ThreadStacks[0][THREAD_STACK_SIZE - 1], OS_PRIORITY_IDLE), OS_PRIORITY_INVALID);
+  CHECK_EQUAL(OS_ThreadCreate(NULL, NULL, &ThreadStacks[0][THREAD_STACK_SIZE - 1], 0), OS_ERROR_PARAMETER);
+  CHECK_EQUAL(OS_ThreadCreate(&Logger, NULL, NULL, 0), OS_ERROR_PARAMETER);
+
+  Spawn(&Logger, 7);
+  Spawn(&Logger, 3);
+  Spawn(&Logger, 30);
+  Spawn(&Logger, 20);
+  Spawn(&Logger, 0);
+  Spawn(&Creator, 10);
+  Spawn(&Logger, 12);
+  OS_Start();
+  CheckLog(expected, sizeof(expected));
+}
+
+/*! @brief Delays, logs, then waits on the semaphore and logs again.
+ *
+ *  @param pData The thread's priority.
+ */
+static void Waiter(void *pData)
+{
+  uint8_t priority = (uint8_t) (uintptr_t) pData;
+
+  CHECK_EQUAL(OS_TimeDelay(Delays[priority]), OS_NO_ERROR);
+  Record(priority);
+  CHECK_EQUAL(OS_SemaphoreWait(Semaphore, 0), OS_NO_ERROR);
+  Record(priority);
+  NbRunning--;
+}
+
+/*! @brief Once the waiters are waiting, signals the semaphore once for each, then once more.
+ *
+ *  @param pData The thread's priority.
+ */
+static void Signaller(void *pData)
+{
+  uint8_t priority = (uint8_t) (uintptr_t) pData;
+
+  CHECK_EQUAL(OS_TimeDelay(5), OS_NO_ERROR);
+  for (uint8_t i = 0; i < 3; i++)
+    {
+      Record(priority);
+      CHECK_EQUAL(OS_SemaphoreSignal(Semaphore), OS_NO_ERROR);
+    }
+  // No one is left waiting, so this one is counted
+  Record(priority);
+  CHECK_EQUAL(OS_SemaphoreSignal(Semaphore), OS_NO_ERROR);
+  CHECK_EQUAL(OS_SemaphoreWait(Semaphore, 1), OS_NO_ERROR);
+  CHECK_EQUAL(OS_TimeGet(), 5);
+  NbRunning--;
+}
+
+/*! @brief A signal wakes the highest priority waiter, whatever order they started waiting in.
+ */
+static void TestWakeOrder(void)
+{
+  static const uint8_t expected[] = { 9, 15, 4, 20, 4, 20, 9, 20, 15, 20 };
+
+  Start();
+  Delays[4] = 3;
+  Delays[9] = 1;
+  Delays[15] = 2;
+  Spawn(&Waiter, 9);
+  Spawn(&Waiter, 15);
+  Spawn(&Waiter, 4);
+  Spawn(&Signaller, 20);
+  OS_Start();
+  CheckLog(expected, sizeof(expected));
+}
+
+/*! @brief Waits in an interrupt, which isn't allowed.
+ */
+static void WaitInISR(void)
+{
+  OS_ISREnter();
+  CHECK_EQUAL(OS_SemaphoreWait(Semaphore, 1), OS_ERROR_CONTEXT);
+  CHECK_EQUAL(OS_TimeDelay(1), OS_ERROR_CONTEXT);
+  OS_ISRExit();
+}
+
+/*! @brief Times out on the semaphore, then is signalled before the timeout, then delays.
+ *
+ *  @param pData The thread's priority.
+ */
+static void TimedWaiter(void *pData)
+{
+  uint32_t start = OS_TimeGet();
+
+  CHECK_EQUAL(OS_SemaphoreWait(Semaphore, 10), OS_TIMEOUT);
+  CHECK_EQUAL(OS_TimeGet() - start, 10);
+  start = OS_TimeGet();
+  CHECK_EQUAL(OS_SemaphoreWait(Semaphore, 10), OS_NO_ERROR);
+  CHECK_EQUAL(OS_TimeGet() - start, 3);
+
+  // A delay of 0 is still one tick
+  start = OS_TimeGet();
+  CHECK_EQUAL(OS_TimeDelay(0), OS_NO_ERROR);
+  CHECK_EQUAL(OS_TimeGet() - start, 1);
+  CHECK_EQUAL(OS_TimeDelay(5), OS_NO_ERROR);
+  CHECK_EQUAL(OS_TimeGet() - start, 6);
+
+  OSPort_Interrupt(&WaitInISR);
+  Record((uint8_t) (uintptr_t) pData);
+  NbRunning--;
+}
+
+/*! @brief Signals the semaphore 3 ticks into the second wait.
+ *
+ *  @param pData The thread's priority.
+ */
+static void LateSignaller(void *pData)
+{
+  CHECK_EQUAL(OS_TimeDelay(13), OS_NO_ERROR);
+  Record((uint8_t) (uintptr_t) pData);
+  CHECK_EQUAL(OS_SemaphoreSignal(Semaphore), OS_NO_ERROR);
+  // The waiter timed out the first time, so it was taken off the semaphore and this signal was its only one
+  CHECK_EQUAL(OS_SemaphoreWait(Semaphore, 1), OS_TIMEOUT);
+  Record((uint8_t) (uintptr_t) pData);
+  NbRunning--;
+}
+
+/*! @brief A wait that times out says so, a wait that is signalled in time doesn't, and delays last as long as asked.
+ */
+static void TestTimeout(void)
+{
+  static const uint8_t expected[] = { 8, 8, 5 };
+
+  Start();
+  CHECK_EQUAL(OS_SemaphoreWait(NULL, 0), OS_ERROR_PARAMETER);
+  CHECK_EQUAL(OS_SemaphoreSignal(NULL), OS_ERROR_PARAMETER);
+  // Before OS_Start there is no thread to wait
+  CHECK_EQUAL(OS_SemaphoreWait(Semaphore, 0), OS_ERROR_CONTEXT);
+  CHECK_EQUAL(OS_TimeDelay(1), OS_ERROR_CONTEXT);
+
+  Spawn(&TimedWaiter, 5);
+  Spawn(&LateSignaller, 8);
+  OS_Start();
+  CheckLog(expected, sizeof(expected));
+}
+
+/*! @brief Logs, then deletes itself.
+ *
+ *  @param pData The thread's priority.
+ */
+static void Quitter(void *pData)
+{
+  Record((uint8_t) (uintptr_t) pData);
+  NbRunning--;
+  (void) OS_ThreadDelete(OS_PRIORITY_SELF);
+  Record(MARK_NEVER);
+}
+
+/*! @brief Waits on the semaphore for ever.
+ *
+ *  @param pData The thread's priority.
+ */
+static void Forever(void *pData)
+{
+  Record((uint8_t) (uintptr_t) pData);
+  (void) OS_SemaphoreWait(Semaphore, 0);
+  Record(MARK_NEVER);
+}
+
+/*! @brief Deletes a thread from an interrupt, giving OS_PRIORITY_SELF, which means no thread there.
+ */
+static void DeleteInISR(void)
+{
+  OS_ISREnter();
+  CHECK_EQUAL(OS_ThreadDelete(OS_PRIORITY_SELF), OS_PRIORITY_INVALID);
+  OS_ISRExit();
+}
+
+/*! @brief Deletes the waiting thread, then creates the deleted one again with the same stack.
+ *
+ *  @param pData The thread's priority.
+ */
+static void Deleter(void *pData)
+{
+  uint8_t priority = (uint8_t) (uintptr_t) pData;
+
+  Record(priority);
+  CHECK_EQUAL(OS_ThreadDelete(3), OS_NO_ERROR);
+  NbRunning--;
+  CHECK_EQUAL(OS_ThreadDelete(3), OS_PRIORITY_INVALID);
+  CHECK_EQUAL(OS_ThreadDelete(OS_PRIORITY_IDLE), OS_PRIORITY_INVALID);
+  OSPort_Interrupt(&DeleteInISR);
+
+  // The deleted thread was taken off the semaphore, so the signal is counted
+  CHECK_EQUAL(OS_SemaphoreSignal(Semaphore), OS_NO_ERROR);
+  CHECK_EQUAL(OS_SemaphoreWait(Semaphore, 1), OS_NO_ERROR);
+
+  // The priority is free again, and the new thread starts from the beginning
+  Spawn(&Quitter, 6);
+  Record(priority);
+  NbRunning--;
+}
+
+/*! @brief A thread deleting itself never comes back, and a deleted thread is taken off its semaphore.
+ */
+static void TestDeleteSelf(void)
+{
+  static const uint8_t expected[] = { 3, 6, 9, 6, 9 };
+
+  Start();
+  Spawn(&Forever, 3);
+  Spawn(&Quitter, 6);
+  Spawn(&Deleter, 9);
+  OS_Start();
+  CheckLog(expected, sizeof(expected));
+}
+
+/*! @brief Waits on a semaphore, then logs.
+ *
+ *  @param pData The thread's priority.
+ */
+static void Woken(void *pData)
+{
+  uint8_t priority = (uint8_t) (uintptr_t) pData;
+
+  CHECK_EQUAL(OS_SemaphoreWait((priority == 2) ? Semaphore : Other, 0), OS_NO_ERROR);
+  Record(priority);
+  NbRunning--;
+}
+
+/*! @brief The nested interrupt, which wakes the lower of the two waiters.
+ */
+static void InnerISR(void)
+{
+  OS_ISREnter();
+  CHECK_EQUAL(OS_SemaphoreSignal(Other), OS_NO_ERROR);
+  Record(MARK_INNER);
+  OS_ISRExit();
+  CHECK(!(SCB_ICSR & SCB_ICSR_PENDSVSET_MASK));
+}
+
+/*! @brief The outer interrupt, which wakes the higher of the two waiters then is interrupted itself.
+ */
+static void OuterISR(void)
+{
+  OS_ISREnter();
+  CHECK_EQUAL(OS_SemaphoreSignal(Semaphore), OS_NO_ERROR);
+  CHECK(!(SCB_ICSR & SCB_ICSR_PENDSVSET_MASK));
+  OSPort_Interrupt(&InnerISR);
+  Record(MARK_OUTER);
+  OS_ISRExit();
+  // Pended by the outermost exit, but not taken until the interrupt returns
+  CHECK(SCB_ICSR & SCB_ICSR_PENDSVSET_MASK);
+}
+
+/*! @brief Takes the interrupts.
+ *
+ *  @param pData The thread's priority.
+ */
+static void Interrupted(void *pData)
+{
+  uint8_t priority = (uint8_t) (uintptr_t) pData;
+
+  Record(priority);
+  OSPort_Interrupt(&OuterISR);
+  Record(priority);
+  NbRunning--;
+}
+
+/*! @brief Threads woken by nested interrupts only run once the outermost one has returned.
+ */
+static void TestISRNesting(void)
+{
+  static const uint8_t expected[] = { 10, MARK_INNER, MARK_OUTER, 2, 5, 10 };
+
+  Start();
+  Spawn(&Woken, 2);
+  Spawn(&Woken, 5);
+  Spawn(&Interrupted, 10);
+  OS_Start();
+  CheckLog(expected, sizeof(expected));
+}
+
+int main(void)
+{
+  TestSelection();
+  TestWakeOrder();
+  TestTimeout();
+  TestDeleteSelf();
+  TestISRNesting();
+  return Test_Report("OS");
+}
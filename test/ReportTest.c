@@ -0,0 +1,295 @@
+/*! @file
+ *  ReportTest.c
+ *
+ *  @brief Host tests of when analog values are reported, and of what the PC rebuilds from them
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#include "Test.h"
+#include "FlashSim.h"
+#include "Flash.h"
+#include "Report.h"
+#include "Sampler.h"
+
+// Simulated time is in ns
+#define MS 1000000LLU
+
+// The channel whose settings are kept across boots
+#define SAVED_CHANNEL 15
+
+// Number of values in the random walk, and the percentage of reports that don't get sent
+#define NB_STEPS 100000
+#define DROPPED_PERCENT 30
+
+/*! @brief Sets up a channel.
+ *
+ *  @return bool - TRUE if the settings were taken.
+ */
+static bool Set(const uint8_t channelNb, const uint16_t deadband, const uint16_t hysteresis,
+    const uint16_t minInterval, const uint16_t maxInterval)
+{
+  TReportConfig config = { deadband, hysteresis, minInterval, maxInterval };
+
+  return Report_Set(channelNb, &config);
+}
+
+/*! @brief Checks a value and, if it is to be reported as a delta, gets the delta.
+ *
+ *  @param channelNb The channel.
+ *  @param value The value.
+ *  @param expected The delta expected.
+ *  @return TReportKind - what Report_Check decided.
+ */
+static TReportKind Delta(const uint8_t channelNb, const int16_t value, const int8_t expected)
+{
+  int8_t delta = 0;
+  TReportKind kind = Report_Check(channelNb, value, &delta);
+
+  if (kind == REPORT_DELTA)
+    {
+      CHECK_EQUAL(delta, expected);
+    }
+  return kind;
+}
+
+/*! @brief Sets up a channel and commits it, as one boot.
+ */
+static void BootConfigure(void)
+{
+  CHECK(Flash_Init());
+  CHECK(Report_Init());
+  CHECK(Set(SAVED_CHANNEL, 10, 0, 0, 0));
+  CHECK(Flash_Flush());
+  CHECK(Flash_Wait());
+}
+
+/*! @brief The next boot picks up the settings from Flash.
+ */
+static void BootConfigured(void)
+{
+  CHECK(Flash_Init());
+  CHECK(Report_Init());
+  CHECK_EQUAL(Delta(SAVED_CHANNEL, 0, 0), REPORT_VALUE);
+  Report_Sent(SAVED_CHANNEL, 0);
+  CHECK_EQUAL(Delta(SAVED_CHANNEL, 10, 0), REPORT_NONE);
+  CHECK_EQUAL(Delta(SAVED_CHANNEL, 11, 11), REPORT_DELTA);
+}
+
+/*! @brief Settings survive a reset.
+ */
+static void TestSaved(void)
+{
+  CHECK(FlashSim_Init());
+  CHECK_EQUAL(Test_Boot(&BootConfigure), 0);
+  FlashSim_Reset();
+  CHECK_EQUAL(Test_Boot(&BootConfigured), 0);
+
+  // The rest of the tests run in this process
+  CHECK(Flash_Init());
+  CHECK(Report_Init());
+}
+
+/*! @brief Bad settings are refused.
+ */
+static void TestSet(void)
+{
+  int8_t delta;
+
+  CHECK(!Set(SAMPLER_NB_CHANNELS, 0, 0, 0, 0));
+  CHECK(!Set(0, 0xFFFF, 0, 0, 0));
+  CHECK(!Set(0, 0, 0, 100, 99));
+  CHECK(Set(0, 0, 0, 100, 0));
+  CHECK_EQUAL(Report_Check(SAMPLER_NB_CHANNELS, 0, &delta), REPORT_NONE);
+}
+
+/*! @brief A channel never set up reports every change as a whole value, and nothing else.
+ */
+static void TestUnconfigured(void)
+{
+  CHECK_EQUAL(Delta(1, 100, 0), REPORT_VALUE);
+  // Not sent, so it is still due
+  CHECK_EQUAL(Delta(1, 100, 0), REPORT_VALUE);
+  Report_Sent(1, 100);
+  CHECK_EQUAL(Delta(1, 100, 0), REPORT_NONE);
+  CHECK_EQUAL(Delta(1, 101, 0), REPORT_VALUE);
+  Host_Ticks += 3600000 * MS;
+  CHECK_EQUAL(Delta(1, 100, 0), REPORT_NONE);
+}
+
+/*! @brief Changes within the deadband aren't reported, turning back takes the hysteresis too,
+ *  and changes too large for a delta are sent whole.
+ */
+static void TestDeadband(void)
+{
+  CHECK(Set(2, 10, 5, 0, 0));
+  CHECK_EQUAL(Delta(2, 1000, 0), REPORT_VALUE);
+  Report_Sent(2, 1000);
+  CHECK_EQUAL(Delta(2, 1010, 0), REPORT_NONE);
+  CHECK_EQUAL(Delta(2, 990, 0), REPORT_NONE);
+  CHECK_EQUAL(Delta(2, 1011, 11), REPORT_DELTA);
+  Report_Sent(2, 1011);
+
+  // Going on up only needs the deadband, coming back down needs 15
+  CHECK_EQUAL(Delta(2, 1022, 11), REPORT_DELTA);
+  CHECK_EQUAL(Delta(2, 996, 0), REPORT_NONE);
+  CHECK_EQUAL(Delta(2, 995, -16), REPORT_DELTA);
+  Report_Sent(2, 995);
+  CHECK_EQUAL(Delta(2, 980, -15), REPORT_DELTA);
+
+  CHECK_EQUAL(Delta(2, 995 + 127, 127), REPORT_DELTA);
+  CHECK_EQUAL(Delta(2, 995 + 128, 0), REPORT_VALUE);
+  CHECK_EQUAL(Delta(2, 995 - 128, -128), REPORT_DELTA);
+  CHECK_EQUAL(Delta(2, 995 - 129, 0), REPORT_VALUE);
+  CHECK_EQUAL(Delta(2, INT16_MIN, 0), REPORT_VALUE);
+
+  // New settings start again from a whole value
+  CHECK(Set(2, 10, 5, 0, 0));
+  CHECK_EQUAL(Delta(2, 995, 0), REPORT_VALUE);
+}
+
+/*! @brief Reports are held back for the minimum interval, and the value is sent whole after the maximum interval.
+ */
+static void TestIntervals(void)
+{
+  CHECK(Set(3, 0, 0, 100, 1000));
+  Report_Sent(3, 0);
+  Host_Ticks += 99 * MS;
+  CHECK_EQUAL(Delta(3, 5, 0), REPORT_NONE);
+  Host_Ticks += 1 * MS;
+  CHECK_EQUAL(Delta(3, 5, 5), REPORT_DELTA);
+  Report_Sent(3, 5);
+
+  Host_Ticks += 999 * MS;
+  CHECK_EQUAL(Delta(3, 5, 0), REPORT_NONE);
+  Host_Ticks += 1 * MS;
+  CHECK_EQUAL(Delta(3, 5, 0), REPORT_VALUE);
+  // The refresh overrides the minimum interval too
+  Report_Sent(3, 5);
+  Host_Ticks += 1000 * MS;
+  CHECK_EQUAL(Delta(3, 6, 0), REPORT_VALUE);
+}
+
+/*! @brief With reports randomly not sent, as when the transmit FIFO is full, the value the PC rebuilds
+ *  still never drifts more than the deadband and hysteresis from the real one.
+ */
+static void TestDropped(void)
+{
+  const uint8_t channelNb = 4;
+  const int32_t tolerance = 4 + 2;
+  int32_t value = 0, rebuilt = 0;
+  uint32_t sent = 0, dropped = 0, wrong = 0, drifted = 0;
+  int8_t delta;
+
+  srand(1);
+  CHECK(Set(channelNb, 4, 2, 0, 0));
+  for (uint32_t step = 0; step < NB_STEPS; step++)
+    {
+      // Mostly small steps, now and then a jump too large for a delta
+      value += (rand() % 100) ? ((rand() % 21) - 10) : ((rand() % 2001) - 1000);
+      value = (value > INT16_MAX) ? INT16_MAX : ((value < INT16_MIN) ? INT16_MIN : value);
+
+      TReportKind kind = Report_Check(channelNb, (int16_t) value, &delta);
+      if (kind == REPORT_NONE)
+	{
+	  if (abs(value - rebuilt) > tolerance)
+	    {
+	      drifted++;
+	    }
+	  continue;
+	}
+      if ((rand() % 100) < DROPPED_PERCENT)
+	{
+	  dropped++;
+	  continue;
+	}
+
+      // What the PC does with the report
+      rebuilt = (kind == REPORT_DELTA) ? rebuilt + delta : value;
+      Report_Sent(channelNb, (int16_t) value);
+      sent++;
+      if (rebuilt != value)
+	{
+	  wrong++;
+	}
+    }
+
+  printf("Report: %u reports sent and %u not sent over %u values\n", sent, dropped, NB_STEPS);
+  CHECK(dropped > 0);
+  CHECK_EQUAL(wrong, 0);
+  CHECK_EQUAL(drifted, 0);
+}
+
+/*! @brief Applies a packet of two deltas as the PC does, one after the other.
+ *
+ *  @param pair The deltas sent.
+ *  @param rebuilt The values the PC has, by channel.
+ */
+static void Apply(const TReportDelta pair[2], int16_t rebuilt[])
+{
+  rebuilt[pair[0].channelNb] += pair[0].delta;
+  rebuilt[pair[1].channelNb] += pair[1].delta;
+}
+
+/*! @brief Deltas share packets, and the PC still rebuilds the values when a channel reports twice in a row
+ *  or a packet doesn't fit.
+ */
+static void TestPaired(void)
+{
+  int16_t rebuilt[SAMPLER_NB_CHANNELS] = {0};
+  TReportDelta pair[2];
+
+  CHECK(Set(5, 0, 0, 0, 0));
+  CHECK(Set(6, 0, 0, 0, 0));
+  Report_Sent(5, 100);
+  Report_Sent(6, 200);
+  rebuilt[5] = 100;
+  rebuilt[6] = 200;
+  CHECK(!Report_Unpaired(pair));
+
+  // Two deltas of the same channel, both taken from the 100 the PC has
+  CHECK_EQUAL(Delta(5, 110, 10), REPORT_DELTA);
+  CHECK(!Report_Pair(5, 110, 10, pair));
+  CHECK_EQUAL(Delta(5, 115, 15), REPORT_DELTA);
+  CHECK(!Report_Pair(5, 115, 15, pair));
+
+  // The packet with the next channel doesn't fit, so the held back delta is kept
+  CHECK_EQUAL(Delta(6, 190, -10), REPORT_DELTA);
+  CHECK(Report_Pair(6, 190, -10, pair));
+  CHECK(Report_Unpaired(pair));
+  CHECK_EQUAL(pair[0].channelNb, 5);
+  CHECK_EQUAL(pair[0].delta, 15);
+
+  CHECK_EQUAL(Delta(6, 195, -5), REPORT_DELTA);
+  CHECK(Report_Pair(6, 195, -5, pair));
+  Apply(pair, rebuilt);
+  Report_PairSent(pair);
+  CHECK_EQUAL(rebuilt[5], 115);
+  CHECK_EQUAL(rebuilt[6], 195);
+  CHECK(!Report_Unpaired(pair));
+
+  // The last channel of a round sends its delta on its own
+  CHECK_EQUAL(Delta(5, 120, 5), REPORT_DELTA);
+  CHECK(!Report_Pair(5, 120, 5, pair));
+  CHECK_EQUAL(Delta(5, 125, 10), REPORT_DELTA);
+  CHECK(!Report_Pair(5, 125, 10, pair));
+  CHECK(Report_Unpaired(pair));
+  Apply(pair, rebuilt);
+  Report_PairSent(pair);
+  CHECK_EQUAL(rebuilt[5], 125);
+  CHECK_EQUAL(Delta(5, 125, 0), REPORT_NONE);
+  CHECK(!Report_Unpaired(pair));
+}
+
+int main(void)
+{
+  TestSaved();
+  TestSet();
+  TestUnconfigured();
+  TestDeadband();
+  TestIntervals();
+  TestDropped();
+  TestPaired();
+  return Test_Report("Report");
+}
@@ -0,0 +1,325 @@
+/*! @file
+ *  SamplerTest.c
+ *
+ *  @brief Host tests of the Sampler against a simulated ADC, PDB and eDMA
+ *
+ *  Sampler.c runs as it is on host/AdcSim.c, which moves the conversions the way the DMA channels are programmed.
+ *  Every channel gets its own pattern of inputs, so a sample that lands in the wrong array or row shows.
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#include "Test.h"
+#include "AdcSim.h"
+#include "Sampler.h"
+#include "MK70F12.h"
+#include "PE_Types.h"
+
+#define BUS_CLOCK 60000000
+#define SAMPLE_RATE 1000
+
+// Differential channels 0 and 3, and single-ended channels 4, 9 and 15
+#define CHANNELS 0x8219
+#define NB_CHANNELS 5
+
+// The inputs of the row being converted, and the number of rows triggered
+static int16_t Row[SAMPLER_NB_CHANNELS];
+static uint32_t NbRows;
+
+// Row callbacks, and samples that didn't match the row
+static uint32_t NbCallbacks;
+static uint32_t CallbackMismatches;
+
+/*! @brief Makes up a channel's input, different for every channel and row and over the whole range.
+ *
+ *  @param channelNb The channel.
+ *  @param rowNb The row.
+ *  @return int16_t - the input, in counts.
+ */
+static int16_t Input(const uint8_t channelNb, const uint32_t rowNb)
+{
+  return (int16_t) (uint16_t) ((rowNb * 1009) + (channelNb * 4099));
+}
+
+/*! @brief Runs PDB periods, each with the next row of inputs.
+ *
+ *  @param nbRows The number of rows.
+ */
+static void Trigger(const uint32_t nbRows)
+{
+  for (uint32_t i = 0; i < nbRows; i++, NbRows++)
+    {
+      for (uint8_t channelNb = 0; channelNb < SAMPLER_NB_CHANNELS; channelNb++)
+	{
+	  Row[channelNb] = Input(channelNb, NbRows);
+	}
+      AdcSim_Trigger(Row);
+    }
+}
+
+/*! @brief Reads a channel from a cursor and checks every sample against the inputs.
+ *
+ *  @param channelNb The channel.
+ *  @param cursor The cursor.
+ *  @param firstRow The row the first sample should be from.
+ *  @param nbExpected The number of samples that should be read.
+ */
+static void CheckRead(const uint8_t channelNb, uint32_t * const cursor, const uint32_t firstRow, const uint16_t nbExpected)
+{
+  int16_t buffer[SAMPLER_RING_SIZE];
+  uint32_t mismatches = 0;
+  uint16_t nbRead = Sampler_Read(channelNb, cursor, buffer, SAMPLER_RING_SIZE);
+
+  CHECK_EQUAL(nbRead, nbExpected);
+  for (uint16_t i = 0; i < nbRead; i++)
+    {
+      mismatches += (buffer[i] != Input(channelNb, firstRow + i));
+    }
+  CHECK_EQUAL(mismatches, 0);
+}
+
+/*! @brief Resets the simulated hardware and starts the Sampler on CHANNELS.
+ */
+static void Start(void)
+{
+  AdcSim_Init();
+  NbRows = 0;
+  CHECK(Sampler_Init(BUS_CLOCK, SAMPLE_RATE, CHANNELS));
+}
+
+/*! @brief Bad settings are refused, and the ADC, PDB and clocks are set up.
+ */
+static void TestInit(void)
+{
+  AdcSim_Init();
+  CHECK(!Sampler_Init(BUS_CLOCK, 0, CHANNELS));
+  CHECK(!Sampler_Init(BUS_CLOCK, BUS_CLOCK + 1, CHANNELS));
+  CHECK(!Sampler_Init(BUS_CLOCK, SAMPLE_RATE, 0));
+  // Too slow even for the largest prescaler
+  CHECK(!Sampler_Init(BUS_CLOCK, 3, CHANNELS));
+  AdcSim_FailCalibration(1);
+  CHECK(!Sampler_Init(BUS_CLOCK, SAMPLE_RATE, CHANNELS));
+  AdcSim_FailCalibration(0);
+
+  // The slowest rate the PDB reaches takes the largest prescaler
+  CHECK(Sampler_Init(BUS_CLOCK, 10, CHANNELS));
+  CHECK_EQUAL(PDB0_MOD, ((BUS_CLOCK / 10) >> 7) - 1);
+  PDB0_CNT = 1000;
+  CHECK_EQUAL(Sampler_SampleAge(), (1000LL * 128 * 1000000000) / BUS_CLOCK);
+
+  Start();
+  CHECK_EQUAL(SIM_SCGC6 & (SIM_SCGC6_ADC0_MASK | SIM_SCGC6_PDB_MASK | SIM_SCGC6_DMAMUX0_MASK),
+      SIM_SCGC6_ADC0_MASK | SIM_SCGC6_PDB_MASK | SIM_SCGC6_DMAMUX0_MASK);
+  CHECK(SIM_SCGC7 & SIM_SCGC7_DMA_MASK);
+  CHECK_EQUAL(ADC0_CFG1 & ADC_CFG1_MODE(3), ADC_CFG1_MODE(3));
+  // Half the sums of the calibration results, with the top bit set
+  CHECK_EQUAL(ADC0_PG, 0x8224);
+  CHECK_EQUAL(ADC0_MG, 0x8229);
+  CHECK_EQUAL(PDB0_MOD, (BUS_CLOCK / SAMPLE_RATE) - 1);
+  CHECK_EQUAL(Sampler_Channels(), CHANNELS);
+  PDB0_CNT = 30000;
+  CHECK_EQUAL(Sampler_SampleAge(), 500000);
+
+  int16_t value;
+  CHECK_EQUAL(Sampler_Count(), 0);
+  CHECK(!Sampler_Latest(0, &value));
+}
+
+/*! @brief Each row converts the sampled channels only, and every sample lands where the readers find it.
+ */
+static void TestScan(void)
+{
+  uint32_t cursor;
+  int16_t value;
+
+  Start();
+  Trigger(100);
+  CHECK_EQUAL(Sampler_Count(), 100);
+  CHECK_EQUAL(AdcSim_Conversions(), 100 * NB_CHANNELS);
+
+  for (uint8_t channelNb = 0; channelNb < SAMPLER_NB_CHANNELS; channelNb++)
+    {
+      bool sampled = (CHANNELS >> channelNb) & 1;
+
+      cursor = 0;
+      CheckRead(channelNb, &cursor, 0, sampled ? 100 : 0);
+      CHECK_EQUAL(cursor, sampled ? 100 : 0);
+      CHECK_EQUAL(Sampler_Latest(channelNb, &value), sampled);
+      if (sampled)
+	{
+	  CHECK_EQUAL(value, Input(channelNb, 99));
+	}
+    }
+  CHECK(!Sampler_Latest(SAMPLER_NB_CHANNELS, &value));
+
+  // Single-ended results come from the ADC unsigned
+  CHECK_EQUAL(Sampler_Convert(3, -5), -5);
+  CHECK_EQUAL(Sampler_Convert(4, (int16_t) 0x8000), 0);
+  CHECK_EQUAL(Sampler_Convert(4, 0), INT16_MIN);
+}
+
+/*! @brief The count carries on round the ring, with or without the wrap interrupt, and a reader that falls a ring
+ *  behind skips to the oldest row still held.
+ */
+static void TestWrap(void)
+{
+  uint32_t cursor = 0;
+
+  Start();
+  srand(1);
+  while (NbRows < 20 * SAMPLER_RING_SIZE)
+    {
+      uint32_t first = cursor;
+      Trigger(1 + (rand() % (SAMPLER_RING_SIZE - 1)));
+      CHECK_EQUAL(Sampler_Count(), NbRows);
+      CheckRead(9, &cursor, first, NbRows - first);
+    }
+
+  // Two rings behind
+  cursor = NbRows;
+  Trigger(2 * SAMPLER_RING_SIZE);
+  CheckRead(15, &cursor, NbRows - (SAMPLER_RING_SIZE - 1), SAMPLER_RING_SIZE - 1);
+
+  // A wrap not yet counted by the interrupt
+  Trigger(SAMPLER_RING_SIZE - 2 - (NbRows % SAMPLER_RING_SIZE));
+  EnterCritical();
+  CHECK_EQUAL(Sampler_Count(), NbRows);
+  Trigger(4);
+  CHECK_EQUAL(Sampler_Count(), NbRows);
+  ExitCritical();
+  CHECK_EQUAL(Sampler_Count(), NbRows);
+}
+
+/*! @brief Checks the samples of the row just finished against its inputs.
+ *
+ *  @param arguments Unused.
+ */
+static void RowCallback(void *arguments)
+{
+  int16_t value;
+
+  NbCallbacks++;
+  for (uint8_t channelNb = 0; channelNb < SAMPLER_NB_CHANNELS; channelNb++)
+    {
+      bool sampled = (CHANNELS >> channelNb) & 1;
+
+      if (Sampler_RowSample(channelNb, &value) != sampled)
+	{
+	  CallbackMismatches++;
+	}
+      else if (sampled && (value != Row[channelNb]))
+	{
+	  CallbackMismatches++;
+	}
+    }
+}
+
+/*! @brief The callback runs at the end of every row, and counts the rows it was too late for.
+ */
+static void TestRowCallback(void)
+{
+  Start();
+  Trigger(10);
+  NbCallbacks = 0;
+  CallbackMismatches = 0;
+  CHECK(Sampler_SetRowCallback(&RowCallback, NULL));
+  CHECK_EQUAL(Sampler_Count(), 10);
+
+  // Round the ring, to check the row is found at either end
+  Trigger(SAMPLER_RING_SIZE + 10);
+  CHECK_EQUAL(NbCallbacks, SAMPLER_RING_SIZE + 10);
+  CHECK_EQUAL(Sampler_RowsMissed(), 0);
+
+  // Three rows with interrupts disabled, so the callback only sees the last
+  EnterCritical();
+  Trigger(3);
+  CHECK_EQUAL(NbCallbacks, SAMPLER_RING_SIZE + 10);
+  ExitCritical();
+  CHECK_EQUAL(NbCallbacks, SAMPLER_RING_SIZE + 11);
+  CHECK_EQUAL(Sampler_RowsMissed(), 2);
+  CHECK_EQUAL(CallbackMismatches, 0);
+
+  CHECK(Sampler_SetRowCallback(NULL, NULL));
+  Trigger(5);
+  CHECK_EQUAL(NbCallbacks, SAMPLER_RING_SIZE + 11);
+  CHECK_EQUAL(Sampler_Count(), NbRows);
+}
+
+/*! @brief Changing the channels carries the count on, and readers skip what was sampled before.
+ */
+static void TestSetChannels(void)
+{
+  int16_t buffer[20];
+  uint32_t cursor4 = 0, cursor1 = 0;
+
+  Start();
+  Trigger(50);
+  CHECK_EQUAL(Sampler_Read(4, &cursor4, buffer, 20), 20);
+
+  CHECK(!Sampler_SetChannels(0));
+  CHECK(Sampler_SetChannels(0x0012));
+  CHECK_EQUAL(Sampler_Channels(), 0x0012);
+  CHECK_EQUAL(Sampler_Count(), 50);
+  uint32_t conversions = AdcSim_Conversions();
+  Trigger(30);
+  CHECK_EQUAL(Sampler_Count(), 80);
+  CHECK_EQUAL(AdcSim_Conversions() - conversions, 30 * 2);
+
+  CheckRead(4, &cursor4, 50, 30);
+  CheckRead(1, &cursor1, 50, 30);
+  uint32_t cursor0 = 0;
+  CheckRead(0, &cursor0, 0, 0);
+}
+
+/*! @brief A burst samples one channel into its buffer, round and round, while the count stands still,
+ *  then the scan carries on with the channels set meanwhile.
+ */
+static void TestBurst(void)
+{
+  static int16_t burst[8];
+  uint32_t cursor = 10;
+
+  Start();
+  Trigger(10);
+  CHECK(!Sampler_StartBurst(SAMPLER_NB_CHANNELS, 100000, burst, 8));
+  CHECK(!Sampler_StartBurst(5, 0, burst, 8));
+  CHECK(!Sampler_StartBurst(5, SAMPLER_BURST_MAX_RATE + 1, burst, 8));
+  CHECK(!Sampler_StartBurst(5, 100000, burst, 0));
+  CHECK_EQUAL(Sampler_BurstPosition(), 0);
+  CHECK_EQUAL(Sampler_StopBurst(), 0);
+
+  CHECK(Sampler_StartBurst(5, 100000, burst, 8));
+  CHECK_EQUAL(PDB0_MOD, (BUS_CLOCK / 100000) - 1);
+  uint32_t conversions = AdcSim_Conversions();
+  uint32_t first = NbRows;
+  Trigger(11);
+  CHECK_EQUAL(AdcSim_Conversions() - conversions, 11);
+  CHECK_EQUAL(Sampler_BurstPosition(), 3);
+  CHECK_EQUAL(Sampler_Count(), 10);
+  // The buffer holds the results as the ADC gave them, and the first 3 have been written over
+  for (uint8_t i = 3; i < 11; i++)
+    {
+      CHECK_EQUAL(Sampler_Convert(5, burst[i % 8]), Input(5, first + i));
+    }
+
+  CHECK(Sampler_SetChannels(0x0030));
+  CHECK_EQUAL(Sampler_Count(), 10);
+  CHECK_EQUAL(Sampler_StopBurst(), 3);
+  CHECK_EQUAL(PDB0_MOD, (BUS_CLOCK / SAMPLE_RATE) - 1);
+  first = NbRows;
+  Trigger(5);
+  CHECK_EQUAL(Sampler_Count(), 15);
+  CheckRead(5, &cursor, first, 5);
+}
+
+int main(void)
+{
+  TestInit();
+  TestScan();
+  TestWrap();
+  TestRowCallback();
+  TestSetChannels();
+  TestBurst();
+  return Test_Report("Sampler");
+}
@@ -0,0 +1,318 @@
+/*! @file
+ *  SpectrumTest.c
+ *
+ *  @brief Host tests of the Goertzel bins and the FFT on synthetic tones
+ *
+ *  Built twice, like FilterTest, so the FFT also runs through the SIMD path with the intrinsics of host/arm_acle.h.
+ *  Each build writes every FFT value it reads to <program>.fft, and make checks that the two files are the same.
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#include "Test.h"
+#include "SamplerSim.h"
+#include "Spectrum.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP)
+#define TEST_NAME "Spectrum (DSP)"
+#else
+#define TEST_NAME "Spectrum"
+#endif
+
+#define SAMPLE_RATE 1000
+
+// Rows pushed between updates, well inside the ring
+#define BATCH 64
+
+// Number of random blocks the FFT is compared with a DFT over
+#define NB_RANDOM_FFTS 50
+
+// How far an FFT amplitude may be from the exact one, in counts
+#define FFT_TOLERANCE 48
+
+/*!
+ * @brief A tone on one channel.
+ */
+typedef struct
+{
+  uint8_t channelNb;
+  double amplitude;   /*!< The peak amplitude, in counts. */
+  double frequency;   /*!< In Hz. */
+  double phase;       /*!< The phase of its cosine at sample 0, in turns. */
+} TTone;
+
+// Where the FFT values are written, for the comparison of the two builds
+static FILE *Dump;
+
+// The number of rows pushed so far
+static uint32_t NbRows;
+
+/*! @brief Gets the difference between two phases.
+ *
+ *  @param actual A phase, in 1/65536 turns.
+ *  @param expected A phase, in turns.
+ *  @return long long - the difference in 1/65536 turns, wrapped to half a turn either way.
+ */
+static long long PhaseError(const int16_t actual, const double expected)
+{
+  double turns = (actual / 65536.0) - expected;
+
+  return llround((turns - round(turns)) * 65536);
+}
+
+/*! @brief Pushes rows of tones, updating the spectrum between batches.
+ *
+ *  @param tones The tones, added together where they share a channel.
+ *  @param nbTones The number of tones.
+ *  @param nbRows The number of rows.
+ *  @return uint8_t - the bins which finished a block.
+ */
+static uint8_t Push(const TTone * const tones, const uint8_t nbTones, const uint32_t nbRows)
+{
+  uint8_t finished = 0;
+
+  for (uint32_t rowNb = 0; rowNb < nbRows; )
+    {
+      for (uint8_t i = 0; (i < BATCH) && (rowNb < nbRows); i++, rowNb++, NbRows++)
+	{
+	  double sums[SAMPLER_NB_CHANNELS] = { 0 };
+	  int16_t row[SAMPLER_NB_CHANNELS];
+
+	  for (uint8_t t = 0; t < nbTones; t++)
+	    {
+	      sums[tones[t].channelNb] +=
+		  tones[t].amplitude * cos(2 * M_PI * ((tones[t].frequency * NbRows / SAMPLE_RATE) + tones[t].phase));
+	    }
+	  for (uint8_t channelNb = 0; channelNb < SAMPLER_NB_CHANNELS; channelNb++)
+	    {
+	      row[channelNb] = (int16_t) lround(sums[channelNb]);
+	    }
+	  SamplerSim_Row(row);
+	}
+      finished |= Spectrum_Update();
+    }
+  return finished;
+}
+
+/*! @brief Checks a spectrum value against a tone.
+ *
+ *  @param value The value.
+ *  @param tone The tone.
+ *  @param start The row the block started at.
+ *  @param tolerance How far out the amplitude may be, in counts.
+ */
+static void CheckTone(const TSpectrumValue * const value, const TTone * const tone, const uint32_t start,
+    const uint16_t tolerance)
+{
+  // The phase has wrapped round many times by the start of the block
+  double phase = fmod((tone->frequency * start) / SAMPLE_RATE, 1) + tone->phase;
+
+  CHECK_RANGE(value->amplitude, (long long) tone->amplitude - tolerance, (long long) tone->amplitude + tolerance);
+  // A hundredth of a turn, when the amplitude is large enough for the phase to mean anything
+  CHECK_RANGE(PhaseError(value->phase, phase), -655, 655);
+}
+
+/*! @brief Bad settings are refused.
+ */
+static void TestSet(void)
+{
+  TSpectrumValue value;
+
+  CHECK(!Spectrum_Init(0));
+  CHECK(Spectrum_Init(SAMPLE_RATE));
+  CHECK(!Spectrum_SetBin(SPECTRUM_MAX_BINS, 0, 500, 100));
+  CHECK(!Spectrum_SetBin(0, SAMPLER_NB_CHANNELS, 500, 100));
+  CHECK(!Spectrum_SetBin(0, 0, 500, 0));
+  CHECK(!Spectrum_SetBin(0, 0, 500, SPECTRUM_MAX_BLOCK + 1));
+  // Half the sample rate, in tenths of a Hz
+  CHECK(!Spectrum_SetBin(0, 0, 5 * SAMPLE_RATE, 100));
+  CHECK(Spectrum_SetBin(0, 0, (5 * SAMPLE_RATE) - 1, 100));
+  CHECK(Spectrum_SetBin(0, 0, 0, 0));
+  CHECK(!Spectrum_GetBin(0, &value));
+  CHECK(!Spectrum_StartFFT(SAMPLER_NB_CHANNELS));
+  CHECK(!Spectrum_FFTDone());
+  CHECK_EQUAL(Spectrum_ReadFFT(0, &value, 1), 0);
+}
+
+/*! @brief Bins on a tone find its amplitude and phase, on every block, while bins off it find next to nothing.
+ */
+static void TestBins(void)
+{
+  const TTone tones[] =
+  {
+    { 0, 20000, 50, 0.1 },
+    { 0, 3000, 150, 0.7 },
+    { 3, 30000, 123.4, 0.25 },
+    { 5, 100, 10, 0 }
+  };
+  TSpectrumValue value;
+  uint32_t start = NbRows;
+
+  CHECK(Spectrum_Init(SAMPLE_RATE));
+  // Whole numbers of cycles in a block, for the tones and between them
+  CHECK(Spectrum_SetBin(0, 0, 500, 1000));
+  CHECK(Spectrum_SetBin(1, 0, 1500, 1000));
+  CHECK(Spectrum_SetBin(2, 0, 1000, 1000));
+  // Not a whole number of cycles, and the longest block
+  CHECK(Spectrum_SetBin(3, 3, 1234, SPECTRUM_MAX_BLOCK));
+  // A small tone, and a block of one cycle
+  CHECK(Spectrum_SetBin(4, 5, 100, 100));
+
+  for (uint8_t blockNb = 0; blockNb < 4; blockNb++)
+    {
+      CHECK_EQUAL(Push(tones, 4, 1000), 0x17);
+      CHECK(Spectrum_GetBin(0, &value));
+      CheckTone(&value, &tones[0], start + (1000 * blockNb), 20);
+      CHECK(Spectrum_GetBin(1, &value));
+      CheckTone(&value, &tones[1], start + (1000 * blockNb), 20);
+      CHECK(Spectrum_GetBin(2, &value));
+      CHECK_RANGE(value.amplitude, 0, 2);
+      CHECK(Spectrum_GetBin(4, &value));
+      CheckTone(&value, &tones[3], start + (1000 * blockNb) + 900, 2);
+    }
+
+  CHECK_EQUAL(Push(tones, 4, SPECTRUM_MAX_BLOCK - 4000), 0x08);
+  CHECK(Spectrum_GetBin(3, &value));
+  // The leakage of a block that isn't a whole number of cycles is well under a percent here
+  CheckTone(&value, &tones[2], start, 300);
+
+  // Turning a bin off forgets its result
+  CHECK(Spectrum_SetBin(0, 0, 0, 0));
+  CHECK(!Spectrum_GetBin(0, &value));
+}
+
+/*! @brief Runs an FFT over the next block of a tone, and writes its values to the dump.
+ *
+ *  @param tones The tones.
+ *  @param nbTones The number of tones.
+ *  @param values Set to the values.
+ *  @return uint32_t - the row the block started at.
+ */
+static uint32_t FFT(const TTone * const tones, const uint8_t nbTones, TSpectrumValue values[SPECTRUM_FFT_NB_VALUES])
+{
+  uint32_t start = NbRows;
+
+  CHECK(Spectrum_StartFFT(tones[0].channelNb));
+  Push(tones, nbTones, SPECTRUM_FFT_SIZE - 1);
+  CHECK(!Spectrum_FFTDone());
+  Push(tones, nbTones, 1);
+  CHECK(Spectrum_FFTDone());
+
+  // In two reads, to check where the second one starts
+  CHECK_EQUAL(Spectrum_ReadFFT(0, values, 100), 100);
+  CHECK_EQUAL(Spectrum_ReadFFT(100, &values[100], 255), SPECTRUM_FFT_NB_VALUES - 100);
+  fwrite(values, sizeof(TSpectrumValue), SPECTRUM_FFT_NB_VALUES, Dump);
+  return start;
+}
+
+/*! @brief Tones on FFT bins come out at their amplitude and phase, with nothing much anywhere else.
+ */
+static void TestFFTTones(void)
+{
+  // Bins are 1000 / 256 Hz apart
+  const TTone tones[] =
+  {
+    { 2, 20000, (16 * SAMPLE_RATE) / 256.0, 0.3 },
+    { 2, 5000, (45 * SAMPLE_RATE) / 256.0, 0.6 },
+    { 2, 1000, 0, 0 },
+  };
+  TSpectrumValue values[SPECTRUM_FFT_NB_VALUES];
+  uint16_t worst = 0;
+
+  CHECK(Spectrum_Init(SAMPLE_RATE));
+  uint32_t start = FFT(tones, 3, values);
+
+  CheckTone(&values[16], &tones[0], start, FFT_TOLERANCE);
+  CheckTone(&values[45], &tones[1], start, FFT_TOLERANCE);
+  CHECK_RANGE(values[0].amplitude, 1000 - FFT_TOLERANCE, 1000 + FFT_TOLERANCE);
+  for (uint16_t k = 1; k < SPECTRUM_FFT_NB_VALUES; k++)
+    {
+      if ((k != 16) && (k != 45) && (values[k].amplitude > worst))
+	{
+	  worst = values[k].amplitude;
+	}
+    }
+  // Each of the four stages halves, rounding down, and the twiddles are Q15, which leaves a noise floor of
+  // a few tens of counts: the values are the DFT divided by the number of points, less its bottom 8 bits
+  CHECK_RANGE(worst, 0, FFT_TOLERANCE);
+
+  // A full scale tone at half the sample rate
+  const TTone nyquist[] = { { 2, 32767, SAMPLE_RATE / 2, 0 } };
+  FFT(nyquist, 1, values);
+  CHECK_RANGE(values[SPECTRUM_FFT_SIZE / 2].amplitude, 32767 - FFT_TOLERANCE, 32767);
+}
+
+/*! @brief Random full scale blocks match a DFT taken in floating point.
+ */
+static void TestFFTRandom(void)
+{
+  TSpectrumValue values[SPECTRUM_FFT_NB_VALUES];
+  int16_t samples[SPECTRUM_FFT_SIZE];
+  uint32_t worst = 0;
+
+  srand(1);
+  CHECK(Spectrum_Init(SAMPLE_RATE));
+  for (uint8_t fftNb = 0; fftNb < NB_RANDOM_FFTS; fftNb++)
+    {
+      int16_t row[SAMPLER_NB_CHANNELS] = { 0 };
+
+      CHECK(Spectrum_StartFFT(7));
+      for (uint16_t i = 0; i < SPECTRUM_FFT_SIZE; i++)
+	{
+	  samples[i] = (int16_t) ((rand() % 65536) - 32768);
+	  row[7] = samples[i];
+	  SamplerSim_Row(row);
+	  NbRows++;
+	  if ((i % BATCH) == BATCH - 1)
+	    {
+	      (void) Spectrum_Update();
+	    }
+	}
+      CHECK(Spectrum_FFTDone());
+      CHECK_EQUAL(Spectrum_ReadFFT(0, values, SPECTRUM_FFT_NB_VALUES), SPECTRUM_FFT_NB_VALUES);
+      fwrite(values, sizeof(TSpectrumValue), SPECTRUM_FFT_NB_VALUES, Dump);
+
+      for (uint16_t k = 0; k < SPECTRUM_FFT_NB_VALUES; k++)
+	{
+	  double re = 0, im = 0;
+	  for (uint16_t n = 0; n < SPECTRUM_FFT_SIZE; n++)
+	    {
+	      re += samples[n] * cos((2 * M_PI * k * n) / SPECTRUM_FFT_SIZE);
+	      im -= samples[n] * sin((2 * M_PI * k * n) / SPECTRUM_FFT_SIZE);
+	    }
+	  double amplitude = (((k == 0) || (k == SPECTRUM_FFT_SIZE / 2)) ? 1 : 2) * hypot(re, im) / SPECTRUM_FFT_SIZE;
+	  uint32_t error = (uint32_t) fabs(values[k].amplitude - amplitude);
+	  if (error > worst)
+	    {
+	      worst = error;
+	    }
+	}
+    }
+  printf("%s: FFT amplitudes within %u counts of a floating point DFT over %u random blocks\n", TEST_NAME, worst,
+      NB_RANDOM_FFTS);
+  CHECK_RANGE(worst, 0, FFT_TOLERANCE);
+}
+
+int main(int argc, char *argv[])
+{
+  char name[256];
+
+  snprintf(name, sizeof(name), "%s.fft", argv[0]);
+  Dump = fopen(name, "wb");
+  if (!CHECK(Dump != NULL))
+    {
+      return Test_Report(TEST_NAME);
+    }
+
+  SamplerSim_Init(0);
+  TestSet();
+  TestBins();
+  TestFFTTones();
+  TestFFTRandom();
+  fclose(Dump);
+  return Test_Report(TEST_NAME);
+}
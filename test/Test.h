@@ -0,0 +1,117 @@
+/*! @file
+ *
+ *  @brief Checks for the host tests.
+ *
+ *  A failed check is reported and the test carries on, so one run shows every failure.
+ *  Each test program ends with Test_Report, which gives its exit status.
+ *  A test can run parts of itself as separate boots of the firmware with Test_Boot.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static uint32_t TestChecks;
+static uint32_t TestFailures;
+
+// Checks that a condition holds
+#define CHECK(condition) Test_Check((condition), #condition, __FILE__, __LINE__)
+
+// Checks that two integers are equal, showing both if they aren't
+#define CHECK_EQUAL(actual, expected) \
+  Test_CheckRange((actual), (expected), (expected), #actual " == " #expected, __FILE__, __LINE__)
+
+// Checks that an integer is within a range, showing it if it isn't
+#define CHECK_RANGE(actual, minimum, maximum) \
+  Test_CheckRange((actual), (minimum), (maximum), #actual " in [" #minimum ", " #maximum "]", __FILE__, __LINE__)
+
+/*! @brief Counts a check, and reports it if it failed.
+ *
+ *  @param passed Whether the check passed.
+ *  @param text The check, as written.
+ *  @param file The file of the check.
+ *  @param line The line of the check.
+ *  @return bool - passed.
+ */
+static inline bool Test_Check(const bool passed, const char * const text, const char * const file, const int line)
+{
+  TestChecks++;
+  if (!passed)
+    {
+      TestFailures++;
+      printf("%s:%d: failed: %s\n", file, line, text);
+    }
+  return passed;
+}
+
+/*! @brief Counts a check that a value is within a range, and reports the value if it isn't.
+ *
+ *  @param actual The value.
+ *  @param minimum The smallest value that passes.
+ *  @param maximum The largest value that passes.
+ *  @param text The check, as written.
+ *  @param file The file of the check.
+ *  @param line The line of the check.
+ *  @return bool - TRUE if the check passed.
+ */
+static inline bool Test_CheckRange(const long long actual, const long long minimum, const long long maximum,
+    const char * const text, const char * const file, const int line)
+{
+  bool passed = (actual >= minimum) && (actual <= maximum);
+
+  TestChecks++;
+  if (!passed)
+    {
+      TestFailures++;
+      printf("%s:%d: failed: %s (got %lld)\n", file, line, text, actual);
+    }
+  return passed;
+}
+
+/*! @brief Runs part of a test in a new process, as a fresh boot of the firmware.
+ *
+ *  The modules start with their variables as they were when the test forked, while the simulated Flash is shared.
+ *  @param boot The part to run. It fails the boot if any of its checks fail.
+ *  @return int - the exit status of the boot: 0 if it returned with every check passed, 1 if a check failed,
+ *    otherwise the status it exited with.
+ */
+static inline int Test_Boot(void (*boot)(void))
+{
+  int status;
+
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0)
+    {
+      boot();
+      fflush(stdout);
+      _exit(TestFailures > 0);
+    }
+  if ((pid < 0) || (waitpid(pid, &status, 0) != pid) || !WIFEXITED(status))
+    {
+      return -1;
+    }
+  return WEXITSTATUS(status);
+}
+
+/*! @brief Reports the number of checks run and failed.
+ *
+ *  @param name The name of the test.
+ *  @return int - the exit status, 0 if every check passed.
+ */
+static inline int Test_Report(const char * const name)
+{
+  printf("%s: %u checks, %u failed\n", name, TestChecks, TestFailures);
+  return (TestFailures > 0);
+}
+
+#endif
@@ -0,0 +1,323 @@
+/*! @file
+ *  TimerTest.c
+ *
+ *  @brief Host tests of the software timers, ticked by a simulated FTM counter
+ *
+ *  Timer.c runs as it is on host/FtmSim.c, so every tick lands on the count of its FTM compare point,
+ *  and each timer is checked against the tick it should expire on.
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#include "Test.h"
+#include "FtmSim.h"
+#include "Timer.h"
+
+// The FTM channel the tick runs on
+#define TICK_CHANNEL 0
+
+// The longest delay the wheel holds, four levels of 64 slots. Longer ones are parked.
+#define MAX_DELTA ((1LU << 24) - 1)
+
+// Number of timers started at once by the cascade test
+#define NB_CASCADE 40
+
+/*!
+ * @brief What a timer has seen of its expiries.
+ */
+typedef struct
+{
+  uint32_t nbExpiries;  /*!< The number of times it expired. */
+  uint32_t tick;        /*!< Timer_Now when it last expired. */
+  uint32_t count;       /*!< FtmSim_Count when it last expired. */
+} TExpiry;
+
+// Ticks that came at the wrong count, and ticks late by more than the interrupt was held off for
+static uint32_t Mistimed;
+static uint32_t TooLate;
+// The longest the interrupt is being held off for, in counts
+static uint32_t Stalled;
+
+/*! @brief Timer callback that records the expiry.
+ *
+ *  @param arguments The timer's TExpiry.
+ */
+static void Expire(void *arguments)
+{
+  TExpiry *expiry = (TExpiry *) arguments;
+
+  expiry->nbExpiries++;
+  expiry->tick = Timer_Now();
+  expiry->count = FtmSim_Count();
+}
+
+/*! @brief Gets the count of the FTM compare point of a tick.
+ *
+ *  The tick is a whole number of counts, plus the counts left over every second spread out over the ticks.
+ *  @param tick The tick, from 1.
+ *  @return uint32_t - the count since Timer_Init.
+ */
+static uint32_t TickCount(const uint32_t tick)
+{
+  return (tick * (FTM_CLOCK_HZ / TIMER_TICKS_PER_SECOND))
+      + (uint32_t) (((uint64_t) (tick - 1) * (FTM_CLOCK_HZ % TIMER_TICKS_PER_SECOND)) / TIMER_TICKS_PER_SECOND);
+}
+
+/*! @brief Timer callback that checks every tick comes at the count of its compare point,
+ *  or no later than the interrupt was held off for.
+ *
+ *  @param arguments Unused.
+ */
+static void CheckTick(void *arguments)
+{
+  uint32_t late = FtmSim_Count() - TickCount(Timer_Now());
+
+  if (late > Stalled)
+    {
+      TooLate++;
+    }
+  if (late && !Stalled)
+    {
+      Mistimed++;
+    }
+}
+
+/*! @brief Restarts the FTM counter and the timer wheel.
+ *
+ *  @param count The count the FTM counter starts from.
+ */
+static void Start(const uint16_t count)
+{
+  FtmSim_Init(count);
+  CHECK(Timer_Init(TICK_CHANNEL));
+  CHECK_EQUAL(Timer_Now(), 0);
+}
+
+/*! @brief Runs the FTM until a number of ticks have gone by.
+ *
+ *  @param nbTicks The number of ticks.
+ *  @return bool - TRUE if the tick kept going.
+ */
+static bool Run(const uint32_t nbTicks)
+{
+  uint32_t end = Timer_Now() + nbTicks;
+
+  while (Timer_Now() != end)
+    {
+      if (!FtmSim_Next())
+	{
+	  return 0;
+	}
+    }
+  return 1;
+}
+
+/*! @brief One-shot timers expire once, on the tick they are due, and stopped ones don't.
+ */
+static void TestOneShot(void)
+{
+  static const uint32_t delays[] = {0, 1, 2, 63, 64, 65, 100};
+  static TTimer timers[sizeof(delays) / sizeof(delays[0])];
+  static TExpiry expiries[sizeof(delays) / sizeof(delays[0])];
+  static TExpiry stoppedExpiry, restartedExpiry;
+  static TTimer stopped = {&Expire, &stoppedExpiry};
+  static TTimer restarted = {&Expire, &restartedExpiry};
+  const uint8_t nbTimers = sizeof(delays) / sizeof(delays[0]);
+
+  // The FTM counter wraps on the first tick
+  Start(0xFFF0);
+  CHECK(Run(10));
+
+  for (uint8_t i = 0; i < nbTimers; i++)
+    {
+      timers[i].callbackFunction = &Expire;
+      timers[i].callbackArguments = &expiries[i];
+      CHECK(Timer_Start(&timers[i], delays[i], 0));
+      CHECK(Timer_IsRunning(&timers[i]));
+    }
+  CHECK(Timer_Start(&stopped, 5, 0));
+  CHECK(Timer_Stop(&stopped));
+  CHECK(!Timer_Stop(&stopped));
+  CHECK(Timer_Start(&restarted, 50, 0));
+  CHECK(Timer_Start(&restarted, 5, 0));
+
+  CHECK(Run(200));
+  for (uint8_t i = 0; i < nbTimers; i++)
+    {
+      uint32_t due = 10 + (delays[i] ? delays[i] : 1);
+
+      CHECK_EQUAL(expiries[i].nbExpiries, 1);
+      CHECK_EQUAL(expiries[i].tick, due);
+      CHECK_EQUAL(expiries[i].count, TickCount(due));
+      CHECK(!Timer_IsRunning(&timers[i]));
+    }
+  CHECK_EQUAL(stoppedExpiry.nbExpiries, 0);
+  CHECK_EQUAL(restartedExpiry.nbExpiries, 1);
+  CHECK_EQUAL(restartedExpiry.tick, 15);
+
+  // A timer without a callback is refused
+  TTimer none = {0};
+  CHECK(!Timer_Start(&none, 1, 0));
+}
+
+/*! @brief A periodic timer expires after its delay, then on every period, until it is stopped.
+ */
+static void TestPeriodic(void)
+{
+  static TExpiry expiry;
+  static TTimer timer = {&Expire, &expiry};
+
+  Start(0);
+  CHECK(Run(3));
+  CHECK(Timer_Start(&timer, 3, 7));
+  CHECK(Run(2));
+  CHECK_EQUAL(expiry.nbExpiries, 0);
+  CHECK(Run(1));
+  CHECK_EQUAL(expiry.nbExpiries, 1);
+  CHECK_EQUAL(expiry.tick, 6);
+
+  for (uint32_t n = 1; n < 10; n++)
+    {
+      CHECK(Run(6));
+      CHECK_EQUAL(expiry.nbExpiries, n);
+      CHECK(Run(1));
+      CHECK_EQUAL(expiry.nbExpiries, n + 1);
+      CHECK_EQUAL(expiry.tick, 6 + (7 * n));
+      CHECK(Timer_IsRunning(&timer));
+    }
+
+  CHECK(Timer_Stop(&timer));
+  CHECK(Run(100));
+  CHECK_EQUAL(expiry.nbExpiries, 10);
+}
+
+/*! @brief Timers at every level of the wheel come down through the levels below and still expire on the tick they are due,
+ *  including those that land on the tick a level wraps.
+ */
+static void TestCascade(void)
+{
+  static TTimer timers[NB_CASCADE];
+  static TExpiry expiries[NB_CASCADE];
+  uint32_t delays[NB_CASCADE];
+  uint8_t nbTimers = 0;
+
+  Start(0);
+  // Not lined up with any level
+  CHECK(Run(1000 + 4096 * 3 + 64 * 5));
+
+  uint32_t now = Timer_Now();
+  for (uint8_t level = 1; level < 4; level++)
+    {
+      uint32_t span = 1LU << (6 * level);
+
+      // Either side of the level's range, and of the next time it wraps
+      for (int8_t offset = -1; offset <= 1; offset++)
+	{
+	  delays[nbTimers++] = span + offset;
+	  delays[nbTimers++] = (span - (now % span)) + offset;
+	}
+    }
+  srand(2);
+  while (nbTimers < NB_CASCADE)
+    {
+      delays[nbTimers++] = 1 + (rand() % 300000);
+    }
+
+  for (uint8_t i = 0; i < NB_CASCADE; i++)
+    {
+      timers[i].callbackFunction = &Expire;
+      timers[i].callbackArguments = &expiries[i];
+      CHECK(Timer_Start(&timers[i], delays[i], 0));
+    }
+  CHECK(Run(300000));
+  for (uint8_t i = 0; i < NB_CASCADE; i++)
+    {
+      CHECK_EQUAL(expiries[i].nbExpiries, 1);
+      CHECK_EQUAL(expiries[i].tick, now + delays[i]);
+    }
+}
+
+/*! @brief Delays longer than the wheel holds are parked at the top, and still expire on the tick they are due.
+ */
+static void TestParking(void)
+{
+  static const uint32_t delays[] = {MAX_DELTA, MAX_DELTA + 1, MAX_DELTA + 64, (2 * MAX_DELTA) + 3};
+  static TTimer timers[sizeof(delays) / sizeof(delays[0])];
+  static TExpiry expiries[sizeof(delays) / sizeof(delays[0])];
+  static TExpiry periodicExpiry;
+  static TTimer periodic = {&Expire, &periodicExpiry};
+  const uint8_t nbTimers = sizeof(delays) / sizeof(delays[0]);
+
+  Start(0);
+  CHECK(Run(5));
+  for (uint8_t i = 0; i < nbTimers; i++)
+    {
+      timers[i].callbackFunction = &Expire;
+      timers[i].callbackArguments = &expiries[i];
+      CHECK(Timer_Start(&timers[i], delays[i], 0));
+    }
+  CHECK(Timer_Start(&periodic, MAX_DELTA + 2, MAX_DELTA + 2));
+
+  CHECK(Run((2 * MAX_DELTA) + 10));
+  for (uint8_t i = 0; i < nbTimers; i++)
+    {
+      CHECK_EQUAL(expiries[i].nbExpiries, 1);
+      CHECK_EQUAL(expiries[i].tick, 5 + delays[i]);
+    }
+  CHECK_EQUAL(periodicExpiry.nbExpiries, 2);
+  CHECK_EQUAL(periodicExpiry.tick, 5 + (2 * (MAX_DELTA + 2)));
+}
+
+/*! @brief The ticks keep to the FTM count over many turns of the counter, with the counts left over every second
+ *  carried from tick to tick, so a periodic timer doesn't drift. When the interrupt is held off, the missed ticks
+ *  are caught up and the ones after are back on time.
+ */
+static void TestDrift(void)
+{
+  static TExpiry secondExpiry;
+  static TTimer second = {&Expire, &secondExpiry};
+  static TTimer everyTick = {&CheckTick, (void *) 0};
+
+  Start(0x8000);
+  Mistimed = 0;
+  TooLate = 0;
+  Stalled = 0;
+  CHECK(Timer_Start(&everyTick, 1, 1));
+  CHECK(Timer_Start(&second, TIMER_TICKS_PER_SECOND, TIMER_TICKS_PER_SECOND));
+
+  CHECK(Run(100 * TIMER_TICKS_PER_SECOND));
+  CHECK_EQUAL(Mistimed, 0);
+  CHECK_EQUAL(secondExpiry.nbExpiries, 100);
+  CHECK_EQUAL(secondExpiry.count, (100 * FTM_CLOCK_HZ) - 1);
+
+  // Hold the interrupt off for up to about 80 ticks at a time
+  srand(3);
+  for (uint32_t i = 0; i < 200; i++)
+    {
+      CHECK(Run(1 + (rand() % 500)));
+      Stalled = 1 + (rand() % 2000);
+      FtmSim_Stall(Stalled);
+      Stalled = 0;
+
+      uint32_t now = Timer_Now();
+      CHECK_RANGE(FtmSim_Count(), TickCount(now), TickCount(now + 1) - 1);
+    }
+  CHECK_EQUAL(TooLate, 0);
+
+  // Back on time, to the count, on the next whole second
+  CHECK(Run((2 * TIMER_TICKS_PER_SECOND) - (Timer_Now() % TIMER_TICKS_PER_SECOND)));
+  CHECK_EQUAL(Mistimed, 0);
+  CHECK_EQUAL(secondExpiry.nbExpiries, Timer_Now() / TIMER_TICKS_PER_SECOND);
+  CHECK_EQUAL(secondExpiry.count, ((Timer_Now() / TIMER_TICKS_PER_SECOND) * FTM_CLOCK_HZ) - 1);
+}
+
+int main(void)
+{
+  TestOneShot();
+  TestPeriodic();
+  TestCascade();
+  TestParking();
+  TestDrift();
+  return Test_Report("Timer");
+}
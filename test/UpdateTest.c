@@ -0,0 +1,207 @@
+/*! @file
+ *  UpdateTest.c
+ *
+ *  @brief Host tests of the firmware update and its rollback, across simulated resets
+ *
+ *  Each boot of the firmware runs in its own process, and between boots the simulated Flash is reset,
+ *  which exchanges the blocks when the swap system has been armed.
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#include "Test.h"
+#include "FlashSim.h"
+#include "Flash.h"
+#include "Update.h"
+#include "CRC.h"
+#include "MK70F12.h"
+
+#include <string.h>
+
+// Exit status of a boot that ended by requesting a reset
+#define BOOT_RESET 2
+
+// Size of the images, not a whole number of phrases, and of the chunks they are sent in
+#define IMAGE_SIZE 20003
+#define CHUNK_SIZE 64
+
+// The part of block 0 the host maps, which is all of it but the first page
+#define MAPPED_START 0x1000LU
+
+// The images
+static uint8_t Old[IMAGE_SIZE];
+static uint8_t New[IMAGE_SIZE];
+
+// The image the next boot receives, and whether it should confirm the running image
+static const uint8_t *Incoming;
+static bool Corrupt;
+static bool Confirm;
+
+/*! @brief Handles the reset requested through SCB_AIRCR, by ending the boot.
+ *
+ *  @return uint32_t* - does not return.
+ */
+volatile uint32_t *Host_Reset(void)
+{
+  fflush(stdout);
+  _exit(TestFailures ? 1 : BOOT_RESET);
+}
+
+/*! @brief Fills an image with data that is different at every address.
+ *
+ *  @param image The image.
+ *  @param seed Makes the images differ.
+ */
+static void Pattern(uint8_t * const image, const uint8_t seed)
+{
+  for (uint32_t i = 0; i < IMAGE_SIZE; i++)
+    {
+      image[i] = (uint8_t) ((i * seed) + (i >> 7) + 1);
+    }
+}
+
+/*! @brief Checks which image is in a block.
+ *
+ *  @param address The start of the block.
+ *  @param image The image expected.
+ *  @return bool - TRUE if the block holds the image, as far as the host maps it.
+ */
+static bool Holds(const uint32_t address, const uint8_t * const image)
+{
+  return memcmp((const void *) (uintptr_t) (address + MAPPED_START), image + MAPPED_START, IMAGE_SIZE - MAPPED_START) == 0;
+}
+
+/*! @brief Sends an image in chunks, as the PC does.
+ *
+ *  @param image The image.
+ */
+static void Send(const uint8_t * const image)
+{
+  uint32_t crc = ~CRC_32(CRC_32_INIT, image, IMAGE_SIZE);
+
+  CHECK(Update_Start(IMAGE_SIZE, crc ^ Corrupt));
+  for (uint32_t offset = 0; offset < IMAGE_SIZE; offset += CHUNK_SIZE)
+    {
+      uint8_t length = ((IMAGE_SIZE - offset) < CHUNK_SIZE) ? (IMAGE_SIZE - offset) : CHUNK_SIZE;
+      uint16_t sequence = Update_NextSequence();
+
+      // A chunk sent again, or one ahead of its turn, is refused
+      if (sequence > 0)
+	{
+	  CHECK(!Update_Data(sequence - 1, image + offset, length));
+	}
+      CHECK(!Update_Data(sequence + 1, image + offset, length));
+      CHECK(Update_Data(sequence, image + offset, length));
+    }
+  CHECK(!Update_Data(Update_NextSequence(), image, 1));
+}
+
+/*! @brief Boots the firmware, receiving an image or confirming the running one if the test asks.
+ */
+static void Boot(void)
+{
+  CHECK(Flash_Init());
+  CHECK(Update_Init());
+
+  if (Confirm)
+    {
+      CHECK(Update_Confirm());
+    }
+  if (Incoming)
+    {
+      Send(Incoming);
+      CHECK(Update_Finish() != Corrupt);
+      CHECK_EQUAL(FlashSim_SwapState() == FLASH_SWAP_COMPLETE, !Corrupt);
+      // The image that armed the swap can't confirm the new one
+      CHECK(Update_Confirm());
+    }
+}
+
+/*! @brief Resets the device and boots it.
+ *
+ *  @param incoming The image to receive, or NULL.
+ *  @param confirm TRUE to confirm the running image.
+ *  @return int - the exit status of the boot.
+ */
+static int Reboot(const uint8_t * const incoming, const bool confirm)
+{
+  FlashSim_Reset();
+  Incoming = incoming;
+  Confirm = confirm;
+  return Test_Boot(&Boot);
+}
+
+/*! @brief A new image runs after a reset, and goes back to the old one if it never confirms itself.
+ */
+static void TestRollback(void)
+{
+  CHECK_EQUAL(Reboot(New, 0), 0);
+  CHECK(Holds(FLASH_BLOCK_SIZE, New));
+
+  // The new image boots on trial
+  CHECK_EQUAL(Reboot(NULL, 0), 0);
+  CHECK(Holds(0, New));
+  CHECK(Holds(FLASH_BLOCK_SIZE, Old));
+
+  for (uint8_t attempt = 2; attempt <= UPDATE_MAX_BOOT_ATTEMPTS; attempt++)
+    {
+      CHECK_EQUAL(Reboot(NULL, 0), 0);
+      CHECK(Holds(0, New));
+    }
+
+  // Then it has run out of boots, so the blocks are swapped back
+  CHECK_EQUAL(Reboot(NULL, 0), BOOT_RESET);
+  CHECK_EQUAL(FlashSim_SwapState(), FLASH_SWAP_COMPLETE);
+  for (uint8_t boot = 0; boot <= UPDATE_MAX_BOOT_ATTEMPTS; boot++)
+    {
+      CHECK_EQUAL(Reboot(NULL, 0), 0);
+      CHECK(Holds(0, Old));
+    }
+}
+
+/*! @brief A new image that confirms itself stays.
+ */
+static void TestConfirm(void)
+{
+  CHECK_EQUAL(Reboot(New, 0), 0);
+  CHECK_EQUAL(Reboot(NULL, 1), 0);
+  CHECK(Holds(0, New));
+  for (uint8_t boot = 0; boot <= UPDATE_MAX_BOOT_ATTEMPTS; boot++)
+    {
+      CHECK_EQUAL(Reboot(NULL, 0), 0);
+      CHECK(Holds(0, New));
+    }
+}
+
+/*! @brief An image that arrives corrupted is never swapped in.
+ */
+static void TestCorrupt(void)
+{
+  Corrupt = 1;
+  CHECK_EQUAL(Reboot(Old, 0), 0);
+  Corrupt = 0;
+  for (uint8_t boot = 0; boot <= UPDATE_MAX_BOOT_ATTEMPTS; boot++)
+    {
+      CHECK_EQUAL(Reboot(NULL, 0), 0);
+      CHECK(Holds(0, New));
+    }
+}
+
+int main(void)
+{
+  TFlashSimStats stats;
+
+  CHECK(FlashSim_Init());
+  Pattern(Old, 3);
+  Pattern(New, 5);
+  memcpy((void *) MAPPED_START, Old + MAPPED_START, IMAGE_SIZE - MAPPED_START);
+
+  TestRollback();
+  TestConfirm();
+  TestCorrupt();
+
+  FlashSim_GetStats(&stats);
+  CHECK_EQUAL(stats.overwrites, 0);
+  return Test_Report("Update");
+}
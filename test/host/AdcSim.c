@@ -0,0 +1,357 @@
+/*! @file
+ *  AdcSim.c
+ *
+ *  @brief A simulation of ADC0, the PDB, the DMA multiplexer and eDMA channels 0 to 2
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup AdcSim_module AdcSim module documentation
+**  @{
+ */
+
+#include "AdcSim.h"
+#include "Sampler.h"
+#include "MK70F12.h"
+#include "PE_Types.h"
+
+#include <string.h>
+
+// DMA request sources
+#define SOURCE_ADC0 40
+#define SOURCE_PDB 48
+
+// ADCH setting that stops the ADC
+#define ADCH_DISABLED 0x1F
+
+// The count of a TCD's CITER or BITER, which is shorter with a channel link
+#define ITER_COUNT(iter) (((iter) & DMA_CITER_ELINKYES_ELINK_MASK) ? ((iter) & 0x1FFu) : ((iter) & 0x7FFFu))
+
+// A value never written to SERQ, CERQ or CINT, left in them once a write has been acted on
+#define NOT_WRITTEN 0xFF
+
+// Plain registers
+volatile uint32_t ADC0_SC1A;
+volatile uint32_t ADC0_SC2;
+volatile uint32_t ADC0_CFG1;
+volatile uint32_t ADC0_CFG2;
+volatile uint32_t ADC0_RA;
+volatile uint32_t ADC0_PG;
+volatile uint32_t ADC0_MG;
+volatile uint32_t ADC0_CLPS;
+volatile uint32_t ADC0_CLP4;
+volatile uint32_t ADC0_CLP3;
+volatile uint32_t ADC0_CLP2;
+volatile uint32_t ADC0_CLP1;
+volatile uint32_t ADC0_CLP0;
+volatile uint32_t ADC0_CLMS;
+volatile uint32_t ADC0_CLM4;
+volatile uint32_t ADC0_CLM3;
+volatile uint32_t ADC0_CLM2;
+volatile uint32_t ADC0_CLM1;
+volatile uint32_t ADC0_CLM0;
+volatile uint32_t PDB0_SC;
+volatile uint32_t PDB0_MOD;
+volatile uint32_t PDB0_CNT;
+volatile uint32_t PDB0_IDLY;
+volatile uint8_t DMAMUX0_CHCFG0;
+volatile uint8_t DMAMUX0_CHCFG1;
+volatile uint8_t DMAMUX0_CHCFG2;
+volatile TAdcSimTCD AdcSim_TCD[ADCSIM_NB_DMA];
+
+static volatile uint32_t SC3;
+static volatile uint8_t SERQ, CERQ, CINT;
+static volatile uint32_t INT;
+// The channels whose hardware requests are enabled
+static uint32_t ERQ;
+
+static bool CalibrationFails;
+static uint32_t Conversions;
+static const int16_t *Inputs;
+
+static void Service(const uint8_t channelNb);
+
+/*! @brief Acts on the writes to SERQ, CERQ and CINT since the last access to them.
+ */
+static void Written(void)
+{
+  if (SERQ != NOT_WRITTEN)
+    {
+      ERQ |= 1u << SERQ;
+    }
+  if (CERQ != NOT_WRITTEN)
+    {
+      ERQ &= ~(1u << CERQ);
+    }
+  if (CINT != NOT_WRITTEN)
+    {
+      INT &= ~(1u << CINT);
+    }
+  SERQ = NOT_WRITTEN;
+  CERQ = NOT_WRITTEN;
+  CINT = NOT_WRITTEN;
+}
+
+/*! @brief Raises a DMA request from a peripheral, which runs the channel it is routed to if its request is enabled.
+ *
+ *  @param source The DMA request source.
+ */
+static void Request(const uint8_t source)
+{
+  const volatile uint8_t * const chcfg[ADCSIM_NB_DMA] = { &DMAMUX0_CHCFG0, &DMAMUX0_CHCFG1, &DMAMUX0_CHCFG2 };
+
+  for (uint8_t channelNb = 0; channelNb < ADCSIM_NB_DMA; channelNb++)
+    {
+      if ((*chcfg[channelNb] == (DMAMUX_CHCFG_ENBL_MASK | source)) && (ERQ & (1u << channelNb)))
+	{
+	  Service(channelNb);
+	}
+    }
+}
+
+/*! @brief Runs a conversion with the setting written to SC1A.
+ */
+static void Convert(void)
+{
+  uint8_t channel = ADC0_SC1A & ADC_SC1_ADCH_MASK;
+
+  if (channel == ADCH_DISABLED)
+    {
+      return;
+    }
+
+  int16_t input = (Inputs && (channel < ADCSIM_NB_INPUTS)) ? Inputs[channel] : 0;
+  // Differential results are signed, single-ended ones go from 0 at the bottom of the range
+  ADC0_RA = (ADC0_SC1A & ADC_SC1_DIFF_MASK) ? (uint32_t) (int32_t) input : (uint16_t) (input + 0x8000);
+  Conversions++;
+  if (ADC0_SC2 & ADC_SC2_DMAEN_MASK)
+    {
+      Request(SOURCE_ADC0);
+    }
+  else
+    {
+      ADC0_SC1A |= ADC_SC1_COCO_MASK;
+    }
+}
+
+/*! @brief Copies a unit of a minor loop.
+ *
+ *  @param destination The address to write.
+ *  @param source The address to read.
+ *  @param size The size of the unit, in bytes.
+ */
+static void Copy(const uint32_t destination, const uint32_t source, const uint8_t size)
+{
+  switch (size)
+    {
+      case 1:
+	*(volatile uint8_t *) (uintptr_t) destination = *(volatile uint8_t *) (uintptr_t) source;
+	break;
+      case 2:
+	*(volatile uint16_t *) (uintptr_t) destination = *(volatile uint16_t *) (uintptr_t) source;
+	break;
+      default:
+	*(volatile uint32_t *) (uintptr_t) destination = *(volatile uint32_t *) (uintptr_t) source;
+	break;
+    }
+}
+
+/*! @brief Runs a channel's minor loop, and the end of its major loop if it was the last, then the links.
+ *
+ *  @param channelNb The channel.
+ */
+static void Service(const uint8_t channelNb)
+{
+  volatile TAdcSimTCD *tcd = &AdcSim_TCD[channelNb];
+  uint8_t size = 1 << (tcd->ATTR & 0x7u);
+  bool converts = 0;
+
+  for (uint32_t done = 0; done < tcd->NBYTES_MLNO; done += size)
+    {
+      Copy(tcd->DADDR, tcd->SADDR, size);
+      converts |= (tcd->DADDR == (uint32_t) &ADC0_SC1A);
+      tcd->SADDR += (int16_t) tcd->SOFF;
+      tcd->DADDR += (int16_t) tcd->DOFF;
+    }
+
+  uint16_t citer = tcd->CITER;
+  int8_t link = -1;
+  if (ITER_COUNT(citer) > 1)
+    {
+      tcd->CITER = citer - 1;
+      if (citer & DMA_CITER_ELINKYES_ELINK_MASK)
+	{
+	  link = (citer >> 9) & 0xF;
+	}
+    }
+  else
+    {
+      tcd->CITER = tcd->BITER;
+      tcd->SADDR += tcd->SLAST;
+      tcd->DADDR += tcd->DLASTSGA;
+      tcd->CSR |= DMA_CSR_DONE_MASK;
+      if (tcd->CSR & DMA_CSR_INTMAJOR_MASK)
+	{
+	  INT |= 1u << channelNb;
+	}
+      if (tcd->CSR & DMA_CSR_MAJORELINK_MASK)
+	{
+	  link = (tcd->CSR >> 8) & 0xF;
+	}
+    }
+
+  if (link >= 0)
+    {
+      Service(link);
+    }
+  if (converts)
+    {
+      Convert();
+    }
+}
+
+/*! @brief Takes the DMA interrupts raised, lowest channel first.
+ */
+static void Interrupts(void)
+{
+  Written();
+  if (INT & (1u << 0))
+    {
+      DMA0_ISR();
+    }
+  Written();
+  if (INT & (1u << 2))
+    {
+      DMA2_ISR();
+    }
+}
+
+/*! @brief Accesses ADC0_SC3, first finishing a calibration that was started.
+ */
+volatile uint32_t *AdcSim_SC3(void)
+{
+  if (SC3 & ADC_SC3_CAL_MASK)
+    {
+      SC3 = (SC3 & ~ADC_SC3_CAL_MASK) | (CalibrationFails ? ADC_SC3_CALF_MASK : 0);
+    }
+  return &SC3;
+}
+
+/*! @brief Accesses DMA_SERQ, first acting on the eDMA register writes not yet acted on.
+ */
+volatile uint8_t *AdcSim_SERQ(void)
+{
+  Written();
+  return &SERQ;
+}
+
+/*! @brief Accesses DMA_CERQ, first acting on the eDMA register writes not yet acted on.
+ */
+volatile uint8_t *AdcSim_CERQ(void)
+{
+  Written();
+  return &CERQ;
+}
+
+/*! @brief Accesses DMA_CINT, first acting on the eDMA register writes not yet acted on.
+ */
+volatile uint8_t *AdcSim_CINT(void)
+{
+  Written();
+  return &CINT;
+}
+
+/*! @brief Accesses DMA_INT, first acting on the eDMA register writes not yet acted on.
+ */
+volatile uint32_t *AdcSim_INT(void)
+{
+  Written();
+  return &INT;
+}
+
+/*! @brief Resets the ADC, the PDB and the eDMA.
+ */
+void AdcSim_Init(void)
+{
+  ADC0_SC1A = ADC_SC1_ADCH(ADCH_DISABLED);
+  ADC0_SC2 = 0;
+  SC3 = 0;
+  ADC0_CFG1 = 0;
+  ADC0_CFG2 = 0;
+  ADC0_RA = 0;
+  ADC0_PG = 0x8200;
+  ADC0_MG = 0x8200;
+  // Calibration values as a device might give them
+  ADC0_CLPS = 0x2A;
+  ADC0_CLP4 = 0x220;
+  ADC0_CLP3 = 0x110;
+  ADC0_CLP2 = 0x88;
+  ADC0_CLP1 = 0x44;
+  ADC0_CLP0 = 0x22;
+  ADC0_CLMS = 0x2B;
+  ADC0_CLM4 = 0x224;
+  ADC0_CLM3 = 0x112;
+  ADC0_CLM2 = 0x89;
+  ADC0_CLM1 = 0x45;
+  ADC0_CLM0 = 0x23;
+  PDB0_SC = 0;
+  PDB0_MOD = 0xFFFF;
+  PDB0_CNT = 0;
+  PDB0_IDLY = 0xFFFF;
+  DMAMUX0_CHCFG0 = 0;
+  DMAMUX0_CHCFG1 = 0;
+  DMAMUX0_CHCFG2 = 0;
+  memset((void *) AdcSim_TCD, 0, sizeof(AdcSim_TCD));
+  SERQ = NOT_WRITTEN;
+  CERQ = NOT_WRITTEN;
+  CINT = NOT_WRITTEN;
+  INT = 0;
+  ERQ = 0;
+  CalibrationFails = 0;
+  Conversions = 0;
+  Inputs = NULL;
+  Host_SetPendingHandler(&Interrupts);
+}
+
+/*! @brief Makes calibrations fail, or succeed again.
+ *
+ *  @param fail TRUE to fail.
+ */
+void AdcSim_FailCalibration(const bool fail)
+{
+  CalibrationFails = fail;
+}
+
+/*! @brief Runs one PDB period, then takes the DMA interrupts raised unless interrupts are disabled.
+ *
+ *  @param inputs The input of each ADC channel.
+ */
+void AdcSim_Trigger(const int16_t inputs[ADCSIM_NB_INPUTS])
+{
+  Written();
+  Inputs = inputs;
+  if ((PDB0_SC & PDB_SC_PDBEN_MASK) && (PDB0_SC & PDB_SC_DMAEN_MASK))
+    {
+      Request(SOURCE_PDB);
+    }
+  Inputs = NULL;
+
+  if (!Host_InCritical())
+    {
+      Interrupts();
+    }
+}
+
+/*! @brief Gets the number of conversions since AdcSim_Init.
+ *
+ *  @return uint32_t - the number of conversions.
+ */
+uint32_t AdcSim_Conversions(void)
+{
+  return Conversions;
+}
+
+/* END AdcSim */
+/*!
+** @}
+*/
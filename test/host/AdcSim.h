@@ -0,0 +1,103 @@
+/*! @file
+ *
+ *  @brief A simulation of ADC0, the PDB, the DMA multiplexer and eDMA channels 0 to 2, for the host tests of the Sampler.
+ *
+ *  The test gives the analog inputs, and each AdcSim_Trigger is one PDB period. The PDB's DMA request, the ADC's
+ *  DMA request after each conversion, and the minor and major loop links run the channels the way the eDMA does:
+ *  a minor loop moves NBYTES from SADDR to DADDR, then the addresses, CITER and the links follow the TCD.
+ *  Conversions take no time, and nor does calibration. The DMA interrupts are taken straight after the trigger,
+ *  or when interrupts are next enabled if they are disabled.
+ *
+ *  Writes to SERQ, CERQ and CINT act on the next access to any of them, or to INT, or on the next trigger.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef ADCSIM_H
+#define ADCSIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Number of eDMA channels simulated
+#define ADCSIM_NB_DMA 3
+
+// Number of ADC channels with an input, from ADCH 0 up
+#define ADCSIM_NB_INPUTS 16
+
+/*!
+ * @brief An eDMA transfer control descriptor.
+ */
+typedef struct
+{
+  uint32_t SADDR;
+  uint16_t SOFF;
+  uint16_t ATTR;
+  uint32_t NBYTES_MLNO;
+  uint32_t SLAST;
+  uint32_t DADDR;
+  uint16_t DOFF;
+  uint16_t CITER;
+  uint32_t DLASTSGA;
+  uint16_t CSR;
+  uint16_t BITER;
+} TAdcSimTCD;
+
+// The registers, for MK70F12.h
+extern volatile TAdcSimTCD AdcSim_TCD[ADCSIM_NB_DMA];
+
+/*! @brief Accesses ADC0_SC3, first finishing a calibration that was started.
+ *
+ *  @return uint32_t* - the register.
+ */
+volatile uint32_t *AdcSim_SC3(void);
+
+/*! @brief Accesses DMA_SERQ, first acting on the eDMA register writes not yet acted on.
+ *
+ *  @return uint8_t* - the register.
+ */
+volatile uint8_t *AdcSim_SERQ(void);
+
+/*! @brief Accesses DMA_CERQ, first acting on the eDMA register writes not yet acted on.
+ *
+ *  @return uint8_t* - the register.
+ */
+volatile uint8_t *AdcSim_CERQ(void);
+
+/*! @brief Accesses DMA_CINT, first acting on the eDMA register writes not yet acted on.
+ *
+ *  @return uint8_t* - the register.
+ */
+volatile uint8_t *AdcSim_CINT(void);
+
+/*! @brief Accesses DMA_INT, first acting on the eDMA register writes not yet acted on.
+ *
+ *  @return uint32_t* - the register.
+ */
+volatile uint32_t *AdcSim_INT(void);
+
+/*! @brief Resets the ADC, the PDB and the eDMA, and takes the DMA interrupts whenever interrupts are enabled again.
+ */
+void AdcSim_Init(void);
+
+/*! @brief Makes calibrations fail, or succeed again.
+ *
+ *  @param fail TRUE to fail.
+ */
+void AdcSim_FailCalibration(const bool fail);
+
+/*! @brief Runs one PDB period, then takes the DMA interrupts raised unless interrupts are disabled.
+ *
+ *  @param inputs The input of each ADC channel, by ADCH, in two's complement counts from mid-scale.
+ *  The channels above them read 0.
+ */
+void AdcSim_Trigger(const int16_t inputs[ADCSIM_NB_INPUTS]);
+
+/*! @brief Gets the number of conversions since AdcSim_Init.
+ *
+ *  @return uint32_t - the number of conversions.
+ */
+uint32_t AdcSim_Conversions(void);
+
+#endif
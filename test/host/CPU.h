@@ -0,0 +1,14 @@
+/*! @file
+ *
+ *  @brief Host version of the Processor Expert CPU bean.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef CPU_H
+#define CPU_H
+
+#include "PE_Types.h"
+
+#endif
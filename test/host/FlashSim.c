@@ -0,0 +1,428 @@
+/*! @file
+ *  FlashSim.c
+ *
+ *  @brief A simulation of the FTFE and the program flash
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup FlashSim_module FlashSim module documentation
+**  @{
+ */
+
+#include "FlashSim.h"
+#include "Flash.h"
+#include "MK70F12.h"
+
+#include <string.h>
+#include <sys/mman.h>
+
+// Both program flash blocks
+#define FLASH_SIZE (2 * FLASH_BLOCK_SIZE)
+#define NB_SECTORS (FLASH_SIZE / FLASH_SECTOR_SIZE)
+
+// The host won't map the first page, so block 0 is mapped from here and its first page is kept aside
+#define MAPPED_START 0x1000LU
+
+// Programming acceleration RAM
+#define ACCEL_RAM_START 0x14000000LU
+#define ACCEL_RAM_SIZE  0x1000LU
+
+#define PHRASE_SIZE 8
+
+// A reserved bit of FSTAT, set in the register after every access so that a write to it can be told from a read
+#define FSTAT_WRITTEN_SENTINEL 0x02u
+
+// Commands
+#define CMD_RD1SEC 0x01
+#define CMD_PGM8   0x07
+#define CMD_ERSSCR 0x09
+#define CMD_PGMSEC 0x0B
+#define CMD_SWAP   0x46
+
+// Typical command times from the K70 data sheet, in ns
+#define TIME_RD1SEC_PER_PHRASE 200LU      // 100 us to check a 4 KB sector
+#define TIME_PGM8              70000LU
+#define TIME_PGMSEC_PER_PHRASE 37500LU    // 4.8 ms for 1 KB
+#define TIME_ERSSCR            14000000LU
+#define TIME_SWAP              70000LU
+
+/*!
+ * @brief The state that outlives a boot, shared with the processes the test forks.
+ */
+typedef struct
+{
+  uint8_t swapState;                    /*!< The swap system state. */
+  uint8_t firstPage[MAPPED_START];      /*!< The first page of block 0. */
+  uint32_t sectorErases[NB_SECTORS];    /*!< Erases of each sector. */
+  uint32_t powerLeft;                   /*!< Commands still to run before the power goes. */
+  TFlashSimStats stats;                 /*!< What the FTFE has done. */
+} TFlashSimState;
+
+volatile uint8_t FlashSim_FCNFG;
+volatile uint8_t FlashSim_FCCOB[12];
+
+static TFlashSimState *State;
+
+// FSTAT as the code sees it, and as the FTFE has it
+static volatile uint8_t Register;
+static uint8_t Status;
+// Set from the launch of a command until it has been run
+static bool Running;
+
+/*! @brief Gets the host address of some of the Flash.
+ *
+ *  @param address The device address.
+ *  @param length The number of bytes.
+ *  @return uint8_t* - the memory, or NULL if the range isn't all mapped Flash.
+ */
+static uint8_t *Memory(const uint32_t address, const uint32_t length)
+{
+  if ((address < MAPPED_START) || (length > FLASH_SIZE) || (address > FLASH_SIZE - length))
+    {
+      return NULL;
+    }
+  return (uint8_t *) (uintptr_t) address;
+}
+
+/*! @brief Programs a phrase, which can only clear bits.
+ *
+ *  @param phrase The phrase in Flash.
+ *  @param data The data to program.
+ *  @return uint8_t - MGSTAT0 if the phrase wasn't erased.
+ */
+static uint8_t Program(uint8_t * const phrase, const uint8_t * const data)
+{
+  uint8_t result = 0;
+
+  for (uint8_t i = 0; i < PHRASE_SIZE; i++)
+    {
+      if (phrase[i] != 0xFF)
+	{
+	  result = FTFE_FSTAT_MGSTAT0_MASK;
+	}
+    }
+  if (result)
+    {
+      State->stats.overwrites++;
+    }
+  for (uint8_t i = 0; i < PHRASE_SIZE; i++)
+    {
+      phrase[i] &= data[i];
+    }
+  return result;
+}
+
+/*! @brief Runs a Swap Control command.
+ *
+ *  @param address The swap indicator address.
+ *  @return uint8_t - the error flags.
+ */
+static uint8_t Swap(const uint32_t address)
+{
+  State->stats.swaps++;
+  if (address != FLASH_SWAP_INDICATOR)
+    {
+      return FTFE_FSTAT_ACCERR_MASK;
+    }
+
+  switch (FlashSim_FCCOB[4])
+    {
+      case FLASH_SWAP_INITIALIZE:
+	if (State->swapState != FLASH_SWAP_UNINITIALIZED)
+	  {
+	    return FTFE_FSTAT_ACCERR_MASK;
+	  }
+	memset(Memory(FLASH_SWAP_INDICATOR, PHRASE_SIZE), 0, PHRASE_SIZE);
+	State->swapState = FLASH_SWAP_UPDATE_ERASED;
+	break;
+      case FLASH_SWAP_SET_UPDATE:
+	if (State->swapState != FLASH_SWAP_READY)
+	  {
+	    return FTFE_FSTAT_ACCERR_MASK;
+	  }
+	// The indicator in the other block is programmed, so it has to be erased before the swap can complete
+	memset(Memory(FLASH_SWAP_INDICATOR + FLASH_BLOCK_SIZE, PHRASE_SIZE), 0, PHRASE_SIZE);
+	State->swapState = FLASH_SWAP_UPDATE;
+	break;
+      case FLASH_SWAP_SET_COMPLETE:
+	if (State->swapState != FLASH_SWAP_UPDATE_ERASED)
+	  {
+	    return FTFE_FSTAT_ACCERR_MASK;
+	  }
+	State->swapState = FLASH_SWAP_COMPLETE;
+	break;
+      case FLASH_SWAP_REPORT:
+	break;
+      default:
+	return FTFE_FSTAT_ACCERR_MASK;
+    }
+  FlashSim_FCCOB[5] = State->swapState;
+  return 0;
+}
+
+/*! @brief Runs the command loaded in the FCCOB registers.
+ *
+ *  @param duration Set to how long the command takes.
+ *  @return uint8_t - the error flags the command ends with.
+ */
+static uint8_t Execute(uint64_t * const duration)
+{
+  uint32_t address = ((uint32_t) FlashSim_FCCOB[1] << 16) | ((uint32_t) FlashSim_FCCOB[2] << 8) | FlashSim_FCCOB[3];
+  uint16_t nbPhrases = ((uint16_t) FlashSim_FCCOB[4] << 8) | FlashSim_FCCOB[5];
+  uint8_t result = 0;
+  uint8_t *memory;
+
+  *duration = 0;
+  if (State->powerLeft == 0)
+    {
+      return FTFE_FSTAT_ACCERR_MASK;
+    }
+  if (State->powerLeft != UINT32_MAX)
+    {
+      State->powerLeft--;
+    }
+
+  switch (FlashSim_FCCOB[0])
+    {
+      case CMD_RD1SEC:
+	State->stats.checks++;
+	*duration = nbPhrases * TIME_RD1SEC_PER_PHRASE;
+	memory = Memory(address, nbPhrases * PHRASE_SIZE);
+	if (!memory || (address % 16))
+	  {
+	    return FTFE_FSTAT_ACCERR_MASK;
+	  }
+	for (uint32_t i = 0; i < nbPhrases * PHRASE_SIZE; i++)
+	  {
+	    if (memory[i] != 0xFF)
+	      {
+		// Not an error: it reports that the section holds data
+		return FTFE_FSTAT_MGSTAT0_MASK;
+	      }
+	  }
+	return 0;
+
+      case CMD_PGM8:
+	{
+	  // FCCOB4-7 hold the first word and FCCOB8-B the second, most significant byte first
+	  const uint8_t data[PHRASE_SIZE] =
+	  {
+	    FlashSim_FCCOB[7], FlashSim_FCCOB[6], FlashSim_FCCOB[5], FlashSim_FCCOB[4],
+	    FlashSim_FCCOB[11], FlashSim_FCCOB[10], FlashSim_FCCOB[9], FlashSim_FCCOB[8]
+	  };
+
+	  State->stats.phrases++;
+	  *duration = TIME_PGM8;
+	  memory = Memory(address, PHRASE_SIZE);
+	  if (!memory || (address % PHRASE_SIZE))
+	    {
+	      result = FTFE_FSTAT_ACCERR_MASK;
+	    }
+	  else
+	    {
+	      result = Program(memory, data);
+	    }
+	  break;
+	}
+
+      case CMD_PGMSEC:
+	State->stats.sections++;
+	*duration = nbPhrases * TIME_PGMSEC_PER_PHRASE;
+	memory = Memory(address, nbPhrases * PHRASE_SIZE);
+	if (!memory || (address % PHRASE_SIZE) || (nbPhrases == 0) || (nbPhrases * PHRASE_SIZE > ACCEL_RAM_SIZE)
+	    || !(FlashSim_FCNFG & FTFE_FCNFG_RAMRDY_MASK)
+	    || ((address / FLASH_SECTOR_SIZE) != ((address + (nbPhrases * PHRASE_SIZE) - 1) / FLASH_SECTOR_SIZE)))
+	  {
+	    result = FTFE_FSTAT_ACCERR_MASK;
+	    break;
+	  }
+	State->stats.sectionBytes += nbPhrases * PHRASE_SIZE;
+	for (uint32_t i = 0; i < nbPhrases; i++)
+	  {
+	    result |= Program(memory + (i * PHRASE_SIZE), (const uint8_t *) (uintptr_t) (ACCEL_RAM_START + (i * PHRASE_SIZE)));
+	  }
+	break;
+
+      case CMD_ERSSCR:
+	*duration = TIME_ERSSCR;
+	memory = Memory(address & ~(FLASH_SECTOR_SIZE - 1), FLASH_SECTOR_SIZE);
+	if (!memory || (address % 16))
+	  {
+	    result = FTFE_FSTAT_ACCERR_MASK;
+	    break;
+	  }
+	State->stats.erases++;
+	State->sectorErases[address / FLASH_SECTOR_SIZE]++;
+	memset(memory, 0xFF, FLASH_SECTOR_SIZE);
+	if ((State->swapState == FLASH_SWAP_UPDATE)
+	    && ((address / FLASH_SECTOR_SIZE) == ((FLASH_SWAP_INDICATOR + FLASH_BLOCK_SIZE) / FLASH_SECTOR_SIZE)))
+	  {
+	    State->swapState = FLASH_SWAP_UPDATE_ERASED;
+	  }
+	break;
+
+      case CMD_SWAP:
+	*duration = TIME_SWAP;
+	result = Swap(address);
+	break;
+
+      default:
+	result = FTFE_FSTAT_ACCERR_MASK;
+	break;
+    }
+
+  if (result)
+    {
+      State->stats.errors++;
+    }
+  return result;
+}
+
+/*! @brief Runs the command in progress, moving the time on to when it completes.
+ */
+static void Complete(void)
+{
+  uint64_t duration;
+
+  Status |= Execute(&duration) | FTFE_FSTAT_CCIF_MASK;
+  Running = 0;
+  Host_Ticks += duration;
+  State->stats.busy += duration;
+}
+
+/*! @brief Accesses FSTAT, first acting on what was last written to it.
+ */
+volatile uint8_t *FlashSim_FSTAT(void)
+{
+  if (!(Register & FSTAT_WRITTEN_SENTINEL))
+    {
+      uint8_t written = Register;
+
+      // The error flags are cleared by writing 1s, and writing CCIF launches the command
+      Status &= ~(written & (FTFE_FSTAT_ACCERR_MASK | FTFE_FSTAT_FPVIOL_MASK));
+      if ((written & FTFE_FSTAT_CCIF_MASK) && !Running && !(Status & (FTFE_FSTAT_ACCERR_MASK | FTFE_FSTAT_FPVIOL_MASK)))
+	{
+	  Status &= ~(FTFE_FSTAT_CCIF_MASK | FTFE_FSTAT_MGSTAT0_MASK);
+	  Running = 1;
+	}
+    }
+  else if (Running)
+    {
+      // Reading the register is waiting for the command
+      Complete();
+    }
+
+  Register = Status | FSTAT_WRITTEN_SENTINEL;
+  return &Register;
+}
+
+/*! @brief Maps the Flash and the FlexRAM, erased, and resets the FTFE and the swap system.
+ */
+bool FlashSim_Init(void)
+{
+  static bool mapped = 0;
+
+  if (!mapped)
+    {
+      void *flash = mmap((void *) MAPPED_START, FLASH_SIZE - MAPPED_START, PROT_READ | PROT_WRITE,
+	  MAP_SHARED | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+      void *ram = mmap((void *) ACCEL_RAM_START, ACCEL_RAM_SIZE, PROT_READ | PROT_WRITE,
+	  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+      void *state = mmap(NULL, sizeof(TFlashSimState), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+      if ((flash != (void *) MAPPED_START) || (ram != (void *) ACCEL_RAM_START) || (state == MAP_FAILED))
+	{
+	  return 0;
+	}
+      State = state;
+      mapped = 1;
+    }
+
+  memset((void *) MAPPED_START, 0xFF, FLASH_SIZE - MAPPED_START);
+  memset(State, 0, sizeof(*State));
+  memset(State->firstPage, 0xFF, sizeof(State->firstPage));
+  State->swapState = FLASH_SWAP_UNINITIALIZED;
+  State->powerLeft = UINT32_MAX;
+  FlashSim_Reset();
+  return 1;
+}
+
+/*! @brief Runs the command in progress to completion, then calls FTFE_ISR if its interrupt is enabled.
+ */
+bool FlashSim_Step(void)
+{
+  // A command launched since FSTAT was last accessed hasn't been seen yet
+  if (!(Register & FSTAT_WRITTEN_SENTINEL))
+    {
+      (void) FlashSim_FSTAT();
+    }
+  if (!Running)
+    {
+      return 0;
+    }
+  Complete();
+  if (FlashSim_FCNFG & FTFE_FCNFG_CCIE_MASK)
+    {
+      FTFE_ISR();
+    }
+  return 1;
+}
+
+/*! @brief Resets the FTFE, exchanging the blocks if the swap system is complete.
+ */
+void FlashSim_Reset(void)
+{
+  if (State->swapState == FLASH_SWAP_COMPLETE)
+    {
+      static uint8_t block[FLASH_BLOCK_SIZE];
+      uint8_t *block0 = (uint8_t *) MAPPED_START;
+      uint8_t *block1 = (uint8_t *) (uintptr_t) FLASH_BLOCK_SIZE;
+
+      memcpy(block, State->firstPage, MAPPED_START);
+      memcpy(block + MAPPED_START, block0, FLASH_BLOCK_SIZE - MAPPED_START);
+      memcpy(State->firstPage, block1, MAPPED_START);
+      memcpy(block0, block1 + MAPPED_START, FLASH_BLOCK_SIZE - MAPPED_START);
+      memcpy(block1, block, FLASH_BLOCK_SIZE);
+      State->swapState = FLASH_SWAP_READY;
+    }
+
+  Running = 0;
+  Status = FTFE_FSTAT_CCIF_MASK;
+  Register = Status | FSTAT_WRITTEN_SENTINEL;
+  FlashSim_FCNFG = FTFE_FCNFG_RAMRDY_MASK;
+  memset((void *) FlashSim_FCCOB, 0, sizeof(FlashSim_FCCOB));
+}
+
+/*! @brief Makes every command after the next few fail without changing the Flash.
+ */
+void FlashSim_PowerFail(const uint32_t nbCommands)
+{
+  State->powerLeft = nbCommands;
+}
+
+/*! @brief Gets the swap state.
+ */
+uint8_t FlashSim_SwapState(void)
+{
+  return State->swapState;
+}
+
+/*! @brief Gets the number of times the sector holding an address has been erased.
+ */
+uint32_t FlashSim_SectorErases(const uint32_t address)
+{
+  return State->sectorErases[(address % FLASH_SIZE) / FLASH_SECTOR_SIZE];
+}
+
+/*! @brief Gets what the FTFE has done.
+ */
+void FlashSim_GetStats(TFlashSimStats * const stats)
+{
+  *stats = State->stats;
+}
+
+/* END FlashSim */
+/*!
+** @}
+*/
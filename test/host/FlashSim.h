@@ -0,0 +1,90 @@
+/*! @file
+ *
+ *  @brief A simulation of the FTFE and the program flash, for the host tests.
+ *
+ *  The two 512 KB blocks are mapped at their device addresses, so Flash.c reads them directly, and so is the FlexRAM.
+ *  The first page of block 0 can't be mapped on the host; commands on it fail with an access error.
+ *  The memory is shared with child processes, so a test can fork a process per boot and the Flash outlives it.
+ *
+ *  The FTFE registers behave as on the device. A command runs from the write of CCIF until FSTAT is next read,
+ *  which jumps the simulated time (Host_Ticks) to the end of the command. The command times are the typical ones
+ *  from the K70 data sheet, so times measured here are estimates, not measurements of the device.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef FLASHSIM_H
+#define FLASHSIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * @brief What the simulated FTFE has done since FlashSim_Init.
+ */
+typedef struct
+{
+  uint32_t erases;      /*!< Sectors erased. */
+  uint32_t phrases;     /*!< Program Phrase commands. */
+  uint32_t sections;    /*!< Program Section commands. */
+  uint32_t sectionBytes;  /*!< Bytes programmed by Program Section. */
+  uint32_t checks;      /*!< Read 1s Section commands. */
+  uint32_t swaps;       /*!< Swap Control commands. */
+  uint32_t errors;      /*!< Commands that ended with ACCERR, FPVIOL or MGSTAT0, other than Read 1s Section finding data. */
+  uint32_t overwrites;  /*!< Attempts to program a phrase that wasn't erased. */
+  uint64_t busy;        /*!< Nanoseconds the FTFE spent running commands. */
+} TFlashSimStats;
+
+// The registers, for MK70F12.h
+extern volatile uint8_t FlashSim_FCNFG;
+extern volatile uint8_t FlashSim_FCCOB[12];
+
+/*! @brief Accesses FSTAT, first acting on what was last written to it.
+ *
+ *  @return uint8_t* - the register.
+ */
+volatile uint8_t *FlashSim_FSTAT(void);
+
+/*! @brief Maps the Flash and the FlexRAM, erased, and resets the FTFE and the swap system.
+ *
+ *  @return bool - TRUE if the memory was mapped.
+ */
+bool FlashSim_Init(void);
+
+/*! @brief Runs the command in progress to completion, then calls FTFE_ISR if its interrupt is enabled.
+ *
+ *  @return bool - TRUE if there was a command to complete.
+ */
+bool FlashSim_Step(void);
+
+/*! @brief Resets the FTFE as a device reset does, exchanging the blocks if the swap system is complete.
+ */
+void FlashSim_Reset(void);
+
+/*! @brief Makes every command after the next few fail without changing the Flash, as if the power had gone.
+ *
+ *  @param nbCommands The number of commands still to run normally, or UINT32_MAX to stop failing.
+ */
+void FlashSim_PowerFail(const uint32_t nbCommands);
+
+/*! @brief Gets the swap state, as Swap Control reports it.
+ *
+ *  @return uint8_t - one of the FLASH_SWAP_ states.
+ */
+uint8_t FlashSim_SwapState(void);
+
+/*! @brief Gets the number of times the sector holding an address has been erased.
+ *
+ *  @param address An address in the sector.
+ *  @return uint32_t - the number of erases.
+ */
+uint32_t FlashSim_SectorErases(const uint32_t address);
+
+/*! @brief Gets what the FTFE has done.
+ *
+ *  @param stats Set to the counts.
+ */
+void FlashSim_GetStats(TFlashSimStats * const stats);
+
+#endif
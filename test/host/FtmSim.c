@@ -0,0 +1,156 @@
+/*! @file
+ *  FtmSim.c
+ *
+ *  @brief A stand-in for the output compare timers of the FTM
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup FtmSim_module FtmSim module documentation
+**  @{
+ */
+
+#include "FtmSim.h"
+
+#include <stddef.h>
+
+// Number of channels of FTM0
+#define NB_CHANNELS 8
+
+// The channels set up, their compare points, and which of them will call back
+static const TFTMChannel *Channels[NB_CHANNELS];
+static uint16_t Compare[NB_CHANNELS];
+static bool Armed[NB_CHANNELS];
+
+// Counts since FtmSim_Init, of which the counter is the low 16 bits
+static uint32_t Count;
+static uint32_t Start;
+
+/*! @brief Gets the number of counts until the counter reaches a channel's compare point.
+ *
+ *  @param channelNb The channel.
+ *  @return uint32_t - the counts, from 1 up to a whole turn of the counter.
+ */
+static uint32_t Distance(const uint8_t channelNb)
+{
+  uint16_t distance = Compare[channelNb] - (uint16_t) Count;
+
+  return distance ? distance : 0x10000;
+}
+
+/*! @brief Calls a channel back, which like the FTM's does not re-arm it.
+ *
+ *  @param channelNb The channel.
+ */
+static void Fire(const uint8_t channelNb)
+{
+  Armed[channelNb] = 0;
+  Channels[channelNb]->callbackFunction(Channels[channelNb]->callbackArguments);
+}
+
+/*! @brief Releases every channel and restarts the counter.
+ *
+ *  @param count The count to start from.
+ */
+void FtmSim_Init(const uint16_t count)
+{
+  for (uint8_t channelNb = 0; channelNb < NB_CHANNELS; channelNb++)
+    {
+      Channels[channelNb] = NULL;
+      Armed[channelNb] = 0;
+    }
+  Count = count;
+  Start = count;
+}
+
+/*! @brief Runs the counter up to the next compare point, and calls the callback of its channel.
+ *
+ *  @return bool - TRUE if a channel was armed.
+ */
+bool FtmSim_Next(void)
+{
+  uint8_t next = NB_CHANNELS;
+
+  for (uint8_t channelNb = 0; channelNb < NB_CHANNELS; channelNb++)
+    {
+      if (Armed[channelNb] && ((next == NB_CHANNELS) || (Distance(channelNb) < Distance(next))))
+	{
+	  next = channelNb;
+	}
+    }
+  if (next == NB_CHANNELS)
+    {
+      return 0;
+    }
+
+  Count += Distance(next);
+  Fire(next);
+  return 1;
+}
+
+/*! @brief Runs the counter with the interrupt held off, then calls the callbacks of the channels that reached their compare point.
+ *
+ *  @param counts The number of counts the interrupt is held off for.
+ */
+void FtmSim_Stall(const uint32_t counts)
+{
+  bool flagged[NB_CHANNELS];
+
+  for (uint8_t channelNb = 0; channelNb < NB_CHANNELS; channelNb++)
+    {
+      flagged[channelNb] = Armed[channelNb] && (Distance(channelNb) <= counts);
+    }
+  Count += counts;
+  for (uint8_t channelNb = 0; channelNb < NB_CHANNELS; channelNb++)
+    {
+      if (flagged[channelNb])
+	{
+	  Fire(channelNb);
+	}
+    }
+}
+
+/*! @brief Gets the number of counts since FtmSim_Init.
+ *
+ *  @return uint32_t - the count.
+ */
+uint32_t FtmSim_Count(void)
+{
+  return Count - Start;
+}
+
+bool FTM_Set(const TFTMChannel* const aFTMChannel)
+{
+  if ((aFTMChannel->channelNb >= NB_CHANNELS) || (aFTMChannel->timerFunction != TIMER_FUNCTION_OUTPUT_COMPARE))
+    {
+      return 0;
+    }
+  Channels[aFTMChannel->channelNb] = aFTMChannel;
+  Armed[aFTMChannel->channelNb] = 0;
+  return 1;
+}
+
+bool FTM_StartTimer(const TFTMChannel* const aFTMChannel)
+{
+  if (Channels[aFTMChannel->channelNb] != aFTMChannel)
+    {
+      return 0;
+    }
+  Compare[aFTMChannel->channelNb] = (uint16_t) Count + aFTMChannel->delayCount;
+  Armed[aFTMChannel->channelNb] = 1;
+  return 1;
+}
+
+bool FTM_Advance(const TFTMChannel* const aFTMChannel, const uint16_t delayCount)
+{
+  uint8_t channelNb = aFTMChannel->channelNb;
+
+  Compare[channelNb] += delayCount;
+  Armed[channelNb] = 1;
+  return ((int16_t) (Compare[channelNb] - (uint16_t) Count) > 0);
+}
+
+/* END FtmSim */
+/*!
+** @}
+*/
@@ -0,0 +1,42 @@
+/*! @file
+ *
+ *  @brief A stand-in for the output compare timers of the FTM, for the host tests of the modules that run off them.
+ *
+ *  The free running 16-bit counter and the channels' compare points behave as they do on FTM0, and a channel's
+ *  callback is called when the counter reaches its compare point, as FTM0_ISR does. The test moves the counter on,
+ *  either to the next compare point or with the interrupt held off for a while.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef FTMSIM_H
+#define FTMSIM_H
+
+#include "FTM.h"
+
+/*! @brief Releases every channel and restarts the counter.
+ *
+ *  @param count The count to start from. Close to 0xFFFF tests the wrap.
+ */
+void FtmSim_Init(const uint16_t count);
+
+/*! @brief Runs the counter up to the next compare point, and calls the callback of its channel.
+ *
+ *  @return bool - TRUE if a channel was armed.
+ */
+bool FtmSim_Next(void);
+
+/*! @brief Runs the counter with the interrupt held off, then calls the callbacks of the channels that reached their compare point.
+ *
+ *  @param counts The number of counts the interrupt is held off for.
+ */
+void FtmSim_Stall(const uint32_t counts);
+
+/*! @brief Gets the number of counts since FtmSim_Init.
+ *
+ *  @return uint32_t - the count, which unlike the counter doesn't wrap at 16 bits.
+ */
+uint32_t FtmSim_Count(void);
+
+#endif
@@ -0,0 +1,162 @@
+/*! @file
+ *  Host.c
+ *
+ *  @brief Host versions of the registers, the interrupt masking, the timestamps and the events
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup Host_module Host module documentation
+**  @{
+ */
+
+#include "PE_Types.h"
+#include "Time.h"
+#include "Event.h"
+#include "MK70F12.h"
+
+// Registers that are only written, or only read as they were written
+volatile uint32_t SIM_SCGC2;
+volatile uint32_t SIM_SCGC3;
+volatile uint32_t SIM_SCGC6;
+volatile uint32_t SIM_SCGC7;
+volatile uint32_t NVICICPR0;
+volatile uint32_t NVICISER0;
+volatile uint8_t DAC0_DAT0L;
+volatile uint8_t DAC0_DAT0H;
+volatile uint8_t DAC0_C0;
+volatile uint8_t DAC0_C1;
+volatile uint8_t DAC1_DAT0L;
+volatile uint8_t DAC1_DAT0H;
+volatile uint8_t DAC1_C0;
+volatile uint8_t DAC1_C1;
+volatile uint32_t SCB_ICSR;
+volatile uint32_t SCB_SHPR3;
+volatile uint32_t SYST_CSR;
+volatile uint32_t SYST_RVR;
+volatile uint32_t SYST_CVR;
+
+volatile uint64_t Host_Ticks;
+volatile uint32_t Host_Events;
+
+// Depth of the critical sections, and whether interrupts were disabled outside them
+static uint32_t Nesting;
+static bool Disabled;
+
+static void (*PendingHandler)(void);
+
+/*! @brief Runs the pending handler if interrupts have just been enabled.
+ */
+static void Enabled(void)
+{
+  if (PendingHandler && (Nesting == 0) && !Disabled)
+    {
+      PendingHandler();
+    }
+}
+
+/*! @brief Disables interrupts, saving whether they were enabled.
+ */
+void Host_EnterCritical(void)
+{
+  Nesting++;
+}
+
+/*! @brief Restores interrupts as they were before the matching Host_EnterCritical.
+ */
+void Host_ExitCritical(void)
+{
+  Nesting--;
+  Enabled();
+}
+
+/*! @brief Disables interrupts.
+ */
+void Host_DisableInterrupts(void)
+{
+  Disabled = 1;
+}
+
+/*! @brief Enables interrupts.
+ */
+void Host_EnableInterrupts(void)
+{
+  Disabled = 0;
+  Enabled();
+}
+
+/*! @brief Sets a function to run when interrupts are enabled again.
+ */
+void Host_SetPendingHandler(void (*handler)(void))
+{
+  PendingHandler = handler;
+}
+
+/*! @brief Checks whether interrupts are disabled.
+ */
+bool Host_InCritical(void)
+{
+  return (Nesting > 0) || Disabled;
+}
+
+/*! @brief Starts the simulated time at 0.
+ */
+bool Time_Init(void)
+{
+  Host_Ticks = 0;
+  return 1;
+}
+
+/*! @brief Gets the simulated time.
+ */
+uint64_t Time_Now(void)
+{
+  return Host_Ticks;
+}
+
+/*! @brief Gets the number of ticks in a second.
+ */
+uint32_t Time_TicksPerSecond(void)
+{
+  return HOST_TICKS_PER_SECOND;
+}
+
+/*! @brief Converts ticks to nanoseconds.
+ */
+uint64_t Time_ToNs(const uint64_t ticks)
+{
+  return ticks;
+}
+
+/*! @brief Converts ticks to microseconds.
+ */
+uint64_t Time_ToUs(const uint64_t ticks)
+{
+  return ticks / 1000;
+}
+
+/*! @brief Converts ticks to milliseconds.
+ */
+uint64_t Time_ToMs(const uint64_t ticks)
+{
+  return ticks / 1000000;
+}
+
+/*! @brief Converts microseconds to ticks.
+ */
+uint64_t Time_FromUs(const uint64_t us)
+{
+  return us * 1000;
+}
+
+/*! @brief Records the flags, for the test to check.
+ */
+void Event_Set(const uint32_t events)
+{
+  Host_Events |= events;
+}
+
+/* END Host */
+/*!
+** @}
+*/
@@ -0,0 +1,46 @@
+/*! @file
+ *
+ *  @brief Included ahead of every file built for the host tests.
+ *
+ *  The firmware's Cortex-M function attributes have no meaning on the host, so they are turned into ones that do nothing.
+ *  The firmware keeps Flash addresses in 32 bits, so the tests are linked at fixed low addresses and the simulated Flash
+ *  is mapped where it is on the device.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Interrupt handlers are plain functions, called by the tests
+#define interrupt unused
+// Functions that run from RAM on the device run from anywhere here
+#define long_call unused
+#define section(name) unused
+
+// Time_Now counts nanoseconds of simulated time
+#define HOST_TICKS_PER_SECOND 1000000000LU
+
+// The time read by Time_Now, advanced by the tests and by the simulated hardware
+extern volatile uint64_t Host_Ticks;
+
+// The flags set with Event_Set since the test last cleared them
+extern volatile uint32_t Host_Events;
+
+/*! @brief Sets a function to run when interrupts are enabled again, standing in for a pending exception.
+ *
+ *  @param handler The function, or NULL for none.
+ */
+void Host_SetPendingHandler(void (*handler)(void));
+
+/*! @brief Checks whether a critical section is open or interrupts are disabled.
+ *
+ *  @return bool - TRUE if interrupts are disabled.
+ */
+bool Host_InCritical(void);
+
+#endif
@@ -0,0 +1,217 @@
+/*! @file
+ *
+ *  @brief Host version of the MK70F12 peripheral registers used by the modules under test.
+ *
+ *  Most registers are plain variables, so a test can see what was written and set what will be read.
+ *  The FTFE is simulated, see FlashSim.h, and so are ADC0, the PDB and the eDMA, see AdcSim.h.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef MK70F12_H
+#define MK70F12_H
+
+#include <stdint.h>
+#include "FlashSim.h"
+#include "AdcSim.h"
+
+// SIM
+extern volatile uint32_t SIM_SCGC2;
+extern volatile uint32_t SIM_SCGC3;
+extern volatile uint32_t SIM_SCGC6;
+extern volatile uint32_t SIM_SCGC7;
+#define SIM_SCGC2_DAC0_MASK 0x1000u
+#define SIM_SCGC2_DAC1_MASK 0x2000u
+#define SIM_SCGC3_NFC_MASK  0x100u
+#define SIM_SCGC6_DMAMUX0_MASK 0x2u
+#define SIM_SCGC6_PDB_MASK  0x400000u
+#define SIM_SCGC6_ADC0_MASK 0x8000000u
+#define SIM_SCGC7_DMA_MASK  0x2u
+
+// DAC. The output of a DAC is its DATnL and DATnH as last written.
+extern volatile uint8_t DAC0_DAT0L;
+extern volatile uint8_t DAC0_DAT0H;
+extern volatile uint8_t DAC0_C0;
+extern volatile uint8_t DAC0_C1;
+extern volatile uint8_t DAC1_DAT0L;
+extern volatile uint8_t DAC1_DAT0H;
+extern volatile uint8_t DAC1_C0;
+extern volatile uint8_t DAC1_C1;
+#define DAC_DATL_DATA(x)    ((uint8_t) (x))
+#define DAC_DATH_DATA(x)    (((uint8_t) (x)) & 0x0Fu)
+#define DAC_C0_DACRFS_MASK  0x40u
+#define DAC_C0_DACEN_MASK   0x80u
+
+// ADC0. A write of SC1A from the eDMA starts a conversion.
+extern volatile uint32_t ADC0_SC1A;
+extern volatile uint32_t ADC0_SC2;
+extern volatile uint32_t ADC0_CFG1;
+extern volatile uint32_t ADC0_CFG2;
+extern volatile uint32_t ADC0_RA;
+extern volatile uint32_t ADC0_PG;
+extern volatile uint32_t ADC0_MG;
+extern volatile uint32_t ADC0_CLPS;
+extern volatile uint32_t ADC0_CLP4;
+extern volatile uint32_t ADC0_CLP3;
+extern volatile uint32_t ADC0_CLP2;
+extern volatile uint32_t ADC0_CLP1;
+extern volatile uint32_t ADC0_CLP0;
+extern volatile uint32_t ADC0_CLMS;
+extern volatile uint32_t ADC0_CLM4;
+extern volatile uint32_t ADC0_CLM3;
+extern volatile uint32_t ADC0_CLM2;
+extern volatile uint32_t ADC0_CLM1;
+extern volatile uint32_t ADC0_CLM0;
+#define ADC0_SC3 (*AdcSim_SC3())
+#define ADC_SC1_ADCH(x)     (((uint32_t) (x)) & 0x1Fu)
+#define ADC_SC1_ADCH_MASK   0x1Fu
+#define ADC_SC1_DIFF_MASK   0x20u
+#define ADC_SC1_COCO_MASK   0x80u
+#define ADC_SC2_DMAEN_MASK  0x4u
+#define ADC_SC3_AVGS(x)     (((uint32_t) (x)) & 0x3u)
+#define ADC_SC3_AVGE_MASK   0x4u
+#define ADC_SC3_CALF_MASK   0x40u
+#define ADC_SC3_CAL_MASK    0x80u
+#define ADC_CFG1_ADICLK(x)  (((uint32_t) (x)) & 0x3u)
+#define ADC_CFG1_MODE(x)    ((((uint32_t) (x)) & 0x3u) << 2)
+#define ADC_CFG1_ADIV(x)    ((((uint32_t) (x)) & 0x3u) << 5)
+
+// PDB0. AdcSim_Trigger is one period of the counter.
+extern volatile uint32_t PDB0_SC;
+extern volatile uint32_t PDB0_MOD;
+extern volatile uint32_t PDB0_CNT;
+extern volatile uint32_t PDB0_IDLY;
+#define PDB_SC_LDOK_MASK    0x1u
+#define PDB_SC_CONT_MASK    0x2u
+#define PDB_SC_PDBIE_MASK   0x20u
+#define PDB_SC_PDBIF_MASK   0x40u
+#define PDB_SC_PDBEN_MASK   0x80u
+#define PDB_SC_TRGSEL(x)    ((((uint32_t) (x)) & 0xFu) << 8)
+#define PDB_SC_PRESCALER(x) ((((uint32_t) (x)) & 0x7u) << 12)
+#define PDB_SC_DMAEN_MASK   0x8000u
+#define PDB_SC_SWTRIG_MASK  0x10000u
+
+// DMAMUX0
+extern volatile uint8_t DMAMUX0_CHCFG0;
+extern volatile uint8_t DMAMUX0_CHCFG1;
+extern volatile uint8_t DMAMUX0_CHCFG2;
+#define DMAMUX_CHCFG_SOURCE(x)  (((uint8_t) (x)) & 0x3Fu)
+#define DMAMUX_CHCFG_SOURCE_MASK 0x3Fu
+#define DMAMUX_CHCFG_ENBL_MASK  0x80u
+
+// eDMA
+#define DMA_SERQ (*AdcSim_SERQ())
+#define DMA_CERQ (*AdcSim_CERQ())
+#define DMA_CINT (*AdcSim_CINT())
+#define DMA_INT  (*AdcSim_INT())
+#define DMA_SERQ_SERQ(x)    (((uint8_t) (x)) & 0xFu)
+#define DMA_CERQ_CERQ(x)    (((uint8_t) (x)) & 0xFu)
+#define DMA_CINT_CINT(x)    (((uint8_t) (x)) & 0xFu)
+#define DMA_TCD0_SADDR           AdcSim_TCD[0].SADDR
+#define DMA_TCD0_SOFF            AdcSim_TCD[0].SOFF
+#define DMA_TCD0_ATTR            AdcSim_TCD[0].ATTR
+#define DMA_TCD0_NBYTES_MLNO     AdcSim_TCD[0].NBYTES_MLNO
+#define DMA_TCD0_SLAST           AdcSim_TCD[0].SLAST
+#define DMA_TCD0_DADDR           AdcSim_TCD[0].DADDR
+#define DMA_TCD0_DOFF            AdcSim_TCD[0].DOFF
+#define DMA_TCD0_DLASTSGA        AdcSim_TCD[0].DLASTSGA
+#define DMA_TCD0_CSR             AdcSim_TCD[0].CSR
+#define DMA_TCD0_CITER_ELINKNO   AdcSim_TCD[0].CITER
+#define DMA_TCD0_CITER_ELINKYES  AdcSim_TCD[0].CITER
+#define DMA_TCD0_BITER_ELINKNO   AdcSim_TCD[0].BITER
+#define DMA_TCD0_BITER_ELINKYES  AdcSim_TCD[0].BITER
+#define DMA_TCD1_SADDR           AdcSim_TCD[1].SADDR
+#define DMA_TCD1_SOFF            AdcSim_TCD[1].SOFF
+#define DMA_TCD1_ATTR            AdcSim_TCD[1].ATTR
+#define DMA_TCD1_NBYTES_MLNO     AdcSim_TCD[1].NBYTES_MLNO
+#define DMA_TCD1_SLAST           AdcSim_TCD[1].SLAST
+#define DMA_TCD1_DADDR           AdcSim_TCD[1].DADDR
+#define DMA_TCD1_DOFF            AdcSim_TCD[1].DOFF
+#define DMA_TCD1_DLASTSGA        AdcSim_TCD[1].DLASTSGA
+#define DMA_TCD1_CSR             AdcSim_TCD[1].CSR
+#define DMA_TCD1_CITER_ELINKNO   AdcSim_TCD[1].CITER
+#define DMA_TCD1_CITER_ELINKYES  AdcSim_TCD[1].CITER
+#define DMA_TCD1_BITER_ELINKNO   AdcSim_TCD[1].BITER
+#define DMA_TCD1_BITER_ELINKYES  AdcSim_TCD[1].BITER
+#define DMA_TCD2_SADDR           AdcSim_TCD[2].SADDR
+#define DMA_TCD2_SOFF            AdcSim_TCD[2].SOFF
+#define DMA_TCD2_ATTR            AdcSim_TCD[2].ATTR
+#define DMA_TCD2_NBYTES_MLNO     AdcSim_TCD[2].NBYTES_MLNO
+#define DMA_TCD2_SLAST           AdcSim_TCD[2].SLAST
+#define DMA_TCD2_DADDR           AdcSim_TCD[2].DADDR
+#define DMA_TCD2_DOFF            AdcSim_TCD[2].DOFF
+#define DMA_TCD2_DLASTSGA        AdcSim_TCD[2].DLASTSGA
+#define DMA_TCD2_CSR             AdcSim_TCD[2].CSR
+#define DMA_TCD2_CITER_ELINKNO   AdcSim_TCD[2].CITER
+#define DMA_TCD2_CITER_ELINKYES  AdcSim_TCD[2].CITER
+#define DMA_TCD2_BITER_ELINKNO   AdcSim_TCD[2].BITER
+#define DMA_TCD2_BITER_ELINKYES  AdcSim_TCD[2].BITER
+#define DMA_ATTR_DSIZE(x)   (((uint16_t) (x)) & 0x7u)
+#define DMA_ATTR_SSIZE(x)   ((((uint16_t) (x)) & 0x7u) << 8)
+#define DMA_CITER_ELINKYES_CITER(x)   (((uint16_t) (x)) & 0x1FFu)
+#define DMA_CITER_ELINKYES_LINKCH(x)  ((((uint16_t) (x)) & 0xFu) << 9)
+#define DMA_CITER_ELINKYES_ELINK_MASK 0x8000u
+#define DMA_BITER_ELINKYES_BITER(x)   (((uint16_t) (x)) & 0x1FFu)
+#define DMA_BITER_ELINKYES_LINKCH(x)  ((((uint16_t) (x)) & 0xFu) << 9)
+#define DMA_BITER_ELINKYES_ELINK_MASK 0x8000u
+#define DMA_CSR_START_MASK      0x1u
+#define DMA_CSR_INTMAJOR_MASK   0x2u
+#define DMA_CSR_MAJORELINK_MASK 0x20u
+#define DMA_CSR_ACTIVE_MASK     0x40u
+#define DMA_CSR_DONE_MASK       0x80u
+#define DMA_CSR_MAJORLINKCH(x)  ((((uint16_t) (x)) & 0xFu) << 8)
+
+// NVIC
+extern volatile uint32_t NVICICPR0;
+extern volatile uint32_t NVICISER0;
+
+// SCB. Any access to AIRCR is taken as a reset request, which the test handles.
+volatile uint32_t *Host_Reset(void);
+#define SCB_AIRCR (*Host_Reset())
+#define SCB_AIRCR_VECTKEY(x)        (((uint32_t) (x)) << 16)
+#define SCB_AIRCR_SYSRESETREQ_MASK  0x4u
+
+// Setting PENDSVSET pends PendSV, which the OS port takes once interrupts are enabled again
+extern volatile uint32_t SCB_ICSR;
+extern volatile uint32_t SCB_SHPR3;
+#define SCB_ICSR_PENDSVSET_MASK     0x10000000u
+#define SCB_SHPR3_PRI_14_MASK       0xFF0000u
+#define SCB_SHPR3_PRI_14(x)         (((uint32_t) (x)) << 16)
+#define SCB_SHPR3_PRI_15_MASK       0xFF000000u
+#define SCB_SHPR3_PRI_15(x)         (((uint32_t) (x)) << 24)
+
+// SysTick. The tests tick the OS themselves, with OS_SysTick_ISR.
+extern volatile uint32_t SYST_CSR;
+extern volatile uint32_t SYST_RVR;
+extern volatile uint32_t SYST_CVR;
+#define SysTick_RVR_RELOAD(x)       (((uint32_t) (x)) & 0xFFFFFFu)
+#define SysTick_CSR_ENABLE_MASK     0x1u
+#define SysTick_CSR_TICKINT_MASK    0x2u
+#define SysTick_CSR_CLKSOURCE_MASK  0x4u
+
+// FTFE
+#define FTFE_FSTAT  (*FlashSim_FSTAT())
+#define FTFE_FCNFG  FlashSim_FCNFG
+#define FTFE_FCCOB0 FlashSim_FCCOB[0x0]
+#define FTFE_FCCOB1 FlashSim_FCCOB[0x1]
+#define FTFE_FCCOB2 FlashSim_FCCOB[0x2]
+#define FTFE_FCCOB3 FlashSim_FCCOB[0x3]
+#define FTFE_FCCOB4 FlashSim_FCCOB[0x4]
+#define FTFE_FCCOB5 FlashSim_FCCOB[0x5]
+#define FTFE_FCCOB6 FlashSim_FCCOB[0x6]
+#define FTFE_FCCOB7 FlashSim_FCCOB[0x7]
+#define FTFE_FCCOB8 FlashSim_FCCOB[0x8]
+#define FTFE_FCCOB9 FlashSim_FCCOB[0x9]
+#define FTFE_FCCOBA FlashSim_FCCOB[0xA]
+#define FTFE_FCCOBB FlashSim_FCCOB[0xB]
+
+#define FTFE_FSTAT_MGSTAT0_MASK 0x01u
+#define FTFE_FSTAT_FPVIOL_MASK  0x10u
+#define FTFE_FSTAT_ACCERR_MASK  0x20u
+#define FTFE_FSTAT_RDCOLERR_MASK 0x40u
+#define FTFE_FSTAT_CCIF_MASK    0x80u
+#define FTFE_FCNFG_RAMRDY_MASK  0x02u
+#define FTFE_FCNFG_CCIE_MASK    0x80u
+
+#endif
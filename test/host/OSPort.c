@@ -0,0 +1,141 @@
+/*! @file
+ *  OSPort.c
+ *
+ *  @brief Host port of the kernel
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup OSPort_module OSPort module documentation
+**  @{
+ */
+
+// The kernel itself, so that the port can reach its threads
+#include "OS.c"
+#include "OSPort.h"
+
+#include <stdlib.h>
+#include <ucontext.h>
+
+// Bytes of host stack for each thread
+#define HOST_STACK_SIZE 0x10000
+
+// Where Create puts a new thread's argument, return address and function in its frame
+#define FRAME_R0 SOFTWARE_FRAME_SIZE
+#define FRAME_LR (SOFTWARE_FRAME_SIZE + 5)
+#define FRAME_PC (SOFTWARE_FRAME_SIZE + 6)
+
+static ucontext_t Contexts[OS_NB_PRIORITIES];
+static uint8_t HostStacks[OS_NB_PRIORITIES][HOST_STACK_SIZE] __attribute__ ((aligned(16)));
+// main's context, saved by the first switch and gone back to by OSPort_Stop
+static ucontext_t StartContext;
+// Depth of the interrupts run by OSPort_Interrupt
+static uint8_t InterruptNesting;
+
+/*! @brief Checks whether an interrupt is being run.
+ *
+ *  @return bool - TRUE if called from an interrupt.
+ */
+static bool InISR(void)
+{
+  return (InterruptNesting > 0);
+}
+
+/*! @brief Runs a new thread from the frame Create laid out: its function, then the return address.
+ *
+ *  @param priority The thread.
+ */
+static void Launch(int priority)
+{
+  uint32_t *frame = Threads[priority].sp;
+  void (*thread)(void *) = (void (*)(void *)) frame[FRAME_PC];
+  void (*threadExit)(void) = (void (*)(void)) frame[FRAME_LR];
+
+  // Taken, so that switching back to the thread resumes it
+  frame[FRAME_PC] = 0;
+  thread((void *) frame[FRAME_R0]);
+  threadExit();
+  // Deleted, so never switched back to
+  abort();
+}
+
+/*! @brief The PendSV handler, which switches to the highest priority ready thread.
+ *
+ *  Runs whenever interrupts are enabled again, and does nothing unless PendSV is pending and no interrupt is running.
+ */
+static void PendSV(void)
+{
+  if (InterruptNesting || !(SCB_ICSR & SCB_ICSR_PENDSVSET_MASK))
+    {
+      return;
+    }
+  SCB_ICSR &= ~SCB_ICSR_PENDSVSET_MASK;
+
+  TTCB *previous = Current;
+  uint32_t *sp = Switch(previous ? previous->sp : NULL);
+  if (Current == previous)
+    {
+      return;
+    }
+
+  uint8_t priority = Current - Threads;
+  if (sp[FRAME_PC])
+    {
+      (void) getcontext(&Contexts[priority]);
+      Contexts[priority].uc_stack.ss_sp = HostStacks[priority];
+      Contexts[priority].uc_stack.ss_size = HOST_STACK_SIZE;
+      Contexts[priority].uc_link = NULL;
+      makecontext(&Contexts[priority], (void (*)(void)) &Launch, 1, (int) priority);
+    }
+  (void) swapcontext(previous ? &Contexts[previous - Threads] : &StartContext, &Contexts[priority]);
+}
+
+/*! @brief Starts running the highest priority thread, with interrupts enabled.
+ *
+ *  Returns once a thread calls OSPort_Stop.
+ */
+void OS_Start(void)
+{
+  __DI();
+  Host_SetPendingHandler(&PendSV);
+  Current = NULL;
+  Started = 1;
+  SCB_ICSR = SCB_ICSR_PENDSVSET_MASK;
+  // The first switch saves main's context, which OSPort_Stop goes back to
+  __EI();
+
+  Host_SetPendingHandler(NULL);
+  SCB_ICSR = 0;
+  Started = 0;
+  Current = NULL;
+  // OSPort_Stop may have been called with interrupts disabled, from the idle hook
+  __EI();
+}
+
+/*! @brief Runs an interrupt service routine as if the interrupt had been taken.
+ *
+ *  @param isr The routine.
+ */
+void OSPort_Interrupt(void (*isr)(void))
+{
+  InterruptNesting++;
+  isr();
+  InterruptNesting--;
+  // PendSV tail-chains the last interrupt, unless interrupts were disabled when it came in
+  if (!Host_InCritical())
+    {
+      PendSV();
+    }
+}
+
+/*! @brief Goes back to the caller of OS_Start.
+ */
+void OSPort_Stop(void)
+{
+  (void) setcontext(&StartContext);
+}
+
+/* END OSPort */
+/*!
+** @}
+*/
@@ -0,0 +1,35 @@
+/*! @file
+ *
+ *  @brief Host port of the kernel, for the host tests of OS.c.
+ *
+ *  The kernel is built from OS.c as it is, so Schedule and Switch pick threads from the bitmaps as on the device.
+ *  Only the parts in assembly are replaced. Each thread runs on a host stack of its own, and the PendSV handler
+ *  switches between them with swapcontext. PendSV is taken as on the device, once interrupts are enabled again
+ *  and every interrupt has returned.
+ *
+ *  The frame Create lays out holds 32-bit addresses, so the thread stacks and pData must be static.
+ *  OS_Start returns once a thread calls OSPort_Stop.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef OSPORT_H
+#define OSPORT_H
+
+#include "OS.h"
+
+/*! @brief Runs an interrupt service routine as if the interrupt had been taken.
+ *
+ *  @param isr The routine. It may run OSPort_Interrupt itself, as a nested interrupt.
+ *  @note A switch the routine asks for happens once it returns, if interrupts are enabled.
+ */
+void OSPort_Interrupt(void (*isr)(void));
+
+/*! @brief Goes back to the caller of OS_Start, leaving the threads where they are.
+ *
+ *  @note Call from a thread, or from OS_IdleHook.
+ */
+void OSPort_Stop(void);
+
+#endif
@@ -0,0 +1,48 @@
+/*! @file
+ *
+ *  @brief Host version of the Processor Expert types and critical sections.
+ *
+ *  Critical sections nest like EnterCritical and ExitCritical on the device. Leaving the outermost one runs
+ *  whatever the device would have taken as soon as interrupts were enabled again, see Host_SetPendingHandler.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef PE_TYPES_H
+#define PE_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+// NULL, as the Processor Expert types define it
+#include <stddef.h>
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+/*! @brief Disables interrupts, saving whether they were enabled.
+ */
+void Host_EnterCritical(void);
+
+/*! @brief Restores interrupts as they were before the matching Host_EnterCritical.
+ */
+void Host_ExitCritical(void);
+
+/*! @brief Disables interrupts.
+ */
+void Host_DisableInterrupts(void);
+
+/*! @brief Enables interrupts.
+ */
+void Host_EnableInterrupts(void);
+
+#define EnterCritical() Host_EnterCritical()
+#define ExitCritical()  Host_ExitCritical()
+#define __DI()          Host_DisableInterrupts()
+#define __EI()          Host_EnableInterrupts()
+
+#endif
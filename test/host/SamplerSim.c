@@ -0,0 +1,114 @@
+/*! @file
+ *  SamplerSim.c
+ *
+ *  @brief A stand-in for the Sampler
+ *
+ *  @author  Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ *
+ *  @addtogroup SamplerSim_module SamplerSim module documentation
+**  @{
+ */
+
+#include "SamplerSim.h"
+
+#include <stddef.h>
+
+static int16_t Samples[SAMPLER_NB_CHANNELS][SAMPLER_RING_SIZE];
+static uint32_t Base;
+static uint32_t Count;
+static void (*RowCallback)(void *);
+static void *RowArguments;
+
+/*! @brief Empties the ring, clears the row callback and restarts the count.
+ *
+ *  @param count The count of the first row pushed.
+ */
+void SamplerSim_Init(const uint32_t count)
+{
+  Base = count;
+  Count = count;
+  RowCallback = NULL;
+  RowArguments = NULL;
+}
+
+/*! @brief Takes a row of samples, then calls the row callback.
+ *
+ *  @param row A sample of each channel.
+ */
+void SamplerSim_Row(const int16_t row[SAMPLER_NB_CHANNELS])
+{
+  for (uint8_t channelNb = 0; channelNb < SAMPLER_NB_CHANNELS; channelNb++)
+    {
+      Samples[channelNb][(Count - Base) % SAMPLER_RING_SIZE] = row[channelNb];
+    }
+  Count++;
+  if (RowCallback)
+    {
+      RowCallback(RowArguments);
+    }
+}
+
+uint32_t Sampler_Count(void)
+{
+  return Count;
+}
+
+uint16_t Sampler_Read(const uint8_t channelNb, uint32_t * const cursor, int16_t * const buffer, const uint16_t maxSamples)
+{
+  uint16_t nbRead = 0;
+
+  if (channelNb >= SAMPLER_NB_CHANNELS)
+    {
+      return 0;
+    }
+
+  // As on the device: nothing from before the start, and the oldest row is left out as the DMA writes it next
+  if (Count - *cursor > Count - Base)
+    {
+      *cursor = Base;
+    }
+  if (Count - *cursor > SAMPLER_RING_SIZE - 1)
+    {
+      *cursor = Count - (SAMPLER_RING_SIZE - 1);
+    }
+
+  while ((*cursor != Count) && (nbRead < maxSamples))
+    {
+      buffer[nbRead++] = Samples[channelNb][(*cursor - Base) % SAMPLER_RING_SIZE];
+      (*cursor)++;
+    }
+  return nbRead;
+}
+
+bool Sampler_SetRowCallback(void (*userFunction)(void *), void * userArguments)
+{
+  RowArguments = userArguments;
+  RowCallback = userFunction;
+  return 1;
+}
+
+bool Sampler_RowSample(const uint8_t channelNb, int16_t * const value)
+{
+  if ((channelNb >= SAMPLER_NB_CHANNELS) || (Count == Base))
+    {
+      return 0;
+    }
+  *value = Samples[channelNb][(Count - Base - 1) % SAMPLER_RING_SIZE];
+  return 1;
+}
+
+uint32_t Sampler_SampleAge(void)
+{
+  return 0;
+}
+
+uint32_t Sampler_RowsMissed(void)
+{
+  return 0;
+}
+
+/* END SamplerSim */
+/*!
+** @}
+*/
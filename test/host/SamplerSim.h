@@ -0,0 +1,30 @@
+/*! @file
+ *
+ *  @brief A stand-in for the Sampler, for the host tests of the modules that read it.
+ *
+ *  Every channel is sampled. The test pushes rows of samples in, and the ring behaves as the real one does:
+ *  a reader that falls a whole ring behind skips to the oldest sample still held, and the row callback is called
+ *  at the end of each row.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef SAMPLERSIM_H
+#define SAMPLERSIM_H
+
+#include "Sampler.h"
+
+/*! @brief Empties the ring, clears the row callback and restarts the count.
+ *
+ *  @param count The count of the first row pushed. Close to 0xFFFFFFFF tests the wrap.
+ */
+void SamplerSim_Init(const uint32_t count);
+
+/*! @brief Takes a row of samples, then calls the row callback.
+ *
+ *  @param row A sample of each channel, in two's complement counts.
+ */
+void SamplerSim_Row(const int16_t row[SAMPLER_NB_CHANNELS]);
+
+#endif
@@ -0,0 +1,75 @@
+/*! @file
+ *
+ *  @brief The Cortex-M4 DSP intrinsics the firmware uses, in C, for the host tests.
+ *
+ *  A test built with __ARM_FEATURE_DSP defined runs the firmware's SIMD paths through these, so the results of both
+ *  paths can be compared on the host. Each one follows the instruction's description in the ARMv7-M reference manual;
+ *  the low halfword of a word is the first lane.
+ *
+ *  @author Abel Queipo 12592503, Yann Clair 13698257
+ *  @date 18 Oct 2026
+ */
+
+#ifndef ARM_ACLE_H
+#define ARM_ACLE_H
+
+#include <stdint.h>
+
+static inline int32_t Acle_Low(const uint32_t x)
+{
+  return (int16_t) x;
+}
+
+static inline int32_t Acle_High(const uint32_t x)
+{
+  return (int16_t) (x >> 16);
+}
+
+static inline uint32_t Acle_Pack(const int32_t low, const int32_t high)
+{
+  return (uint16_t) low | ((uint32_t) (uint16_t) high << 16);
+}
+
+// SMLALD: both products of the halfword pairs added to a 64-bit accumulator
+static inline int64_t __smlald(const int32_t x, const int32_t y, const int64_t acc)
+{
+  return acc + ((int64_t) Acle_Low(x) * Acle_Low(y)) + ((int64_t) Acle_High(x) * Acle_High(y));
+}
+
+// SMUAD: the sum of both products of the halfword pairs
+static inline int32_t __smuad(const uint32_t x, const uint32_t y)
+{
+  return (int32_t) ((uint32_t) (Acle_Low(x) * Acle_Low(y)) + (uint32_t) (Acle_High(x) * Acle_High(y)));
+}
+
+// SMUSDX: low of x by high of y, less high of x by low of y
+static inline int32_t __smusdx(const uint32_t x, const uint32_t y)
+{
+  return (int32_t) ((uint32_t) (Acle_Low(x) * Acle_High(y)) - (uint32_t) (Acle_High(x) * Acle_Low(y)));
+}
+
+// SHADD16: halved sums of the lanes
+static inline uint32_t __shadd16(const uint32_t x, const uint32_t y)
+{
+  return Acle_Pack((Acle_Low(x) + Acle_Low(y)) >> 1, (Acle_High(x) + Acle_High(y)) >> 1);
+}
+
+// SHSUB16: halved differences of the lanes
+static inline uint32_t __shsub16(const uint32_t x, const uint32_t y)
+{
+  return Acle_Pack((Acle_Low(x) - Acle_Low(y)) >> 1, (Acle_High(x) - Acle_High(y)) >> 1);
+}
+
+// SHASX: low lane (x.low - y.high) / 2, high lane (x.high + y.low) / 2
+static inline uint32_t __shasx(const uint32_t x, const uint32_t y)
+{
+  return Acle_Pack((Acle_Low(x) - Acle_High(y)) >> 1, (Acle_High(x) + Acle_Low(y)) >> 1);
+}
+
+// SHSAX: low lane (x.low + y.high) / 2, high lane (x.high - y.low) / 2
+static inline uint32_t __shsax(const uint32_t x, const uint32_t y)
+{
+  return Acle_Pack((Acle_Low(x) + Acle_High(y)) >> 1, (Acle_High(x) - Acle_Low(y)) >> 1);
+}
+
+#endif